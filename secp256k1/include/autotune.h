@@ -0,0 +1,83 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+/*******************************************************************************
+
+    AUTOTUNE -- Mining geometry tuning and per-device profiles
+
+********************************************************************************
+
+SweepGeometry
+    Every candidate geometry of the backend is timed over TUNE_ITERS
+    iterations after a warm-up one. A new block is only picked up between
+    iterations, so candidates with an iteration longer than 'maxIterMs' are
+    rejected, together with larger candidates of the same block dimension.
+    The candidate of the best hashrate is chosen, the smallest one if none
+    fits into the limit.
+
+Profiles file
+    Text file of chosen geometries, one line per device model and driver:
+
+        <blockDim> <nonces> <key>
+
+    Key is the rest of the line. A profile rejected by the backend, e.g.
+    after a rebuild with a smaller NONCES_PER_ITER, is swept again.
+
+Autotune
+    Geometry of the stored profile of the backend, or a sweep which is
+    stored. Bound of the device is zeroed for the sweep and restored, so
+    no solutions are found and the swept nonces are mined again.
+
+*******************************************************************************/
+
+#include "backend.h"
+#include "definitions.h"
+#include <string>
+
+// profile of the key, EXIT_FAILURE if the file or the key is missing
+int LoadProfile(
+    // profiles file
+    const char * fileName,
+    // device model and driver
+    const std::string & key,
+    // stored geometry
+    geometry_t * geometry
+);
+
+// store profile of the key, replacing the previous one
+int StoreProfile(
+    // profiles file
+    const char * fileName,
+    // device model and driver
+    const std::string & key,
+    // geometry
+    const geometry_t & geometry
+);
+
+// time candidate geometries, the best one is set to the backend
+int SweepGeometry(
+    // mining device with uploaded block data
+    MiningBackend * backend,
+    // first nonce of timed iterations
+    const uint64_t base,
+    // maximal duration of an iteration
+    const uint32_t maxIterMs,
+    // chosen geometry
+    geometry_t * best,
+    // hashrate of the chosen geometry, MH/s
+    double * hashrate
+);
+
+// set stored or swept geometry, nothing is done if tuning is disabled
+int Autotune(
+    // mining device with uploaded block data
+    MiningBackend * backend,
+    // profiles file, empty if tuning is disabled
+    const char * profiles,
+    // first nonce of timed iterations
+    const uint64_t base,
+    // boundary for puzzle, restored after the sweep
+    const uint8_t * bound
+);
+
+#endif // AUTOTUNE_H
@@ -0,0 +1,221 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+/*******************************************************************************
+
+    BACKEND -- Mining device abstraction
+
+********************************************************************************
+
+MiningBackend
+    Device independent set of operations driven by the miner thread cycle:
+
+    Allocate     -- bind device to the calling thread, allocate memory,
+                    copy key-pair, may reset 'keepPrehash' and 'doubleBuffer'
+    InitPrehash  -- uncompleted first iteration of hashes precalculation
+    UploadBlock  -- copy bound, message and one-time key-pair of a block
+    UploadBound  -- copy bound only, prehash of the block stays valid
+    Prehash      -- precalculate hashes for the uploaded block
+    Mine         -- search for solutions among nonces
+                    [base, base + NoncesPerIter()), solutions of the
+                    previous iteration are discarded; the miner thread
+                    drops solutions past its own nonce range
+    FetchResults -- solutions of the iteration, MAX_RESULTS at most, and
+                    number of solutions lost on buffer overflow
+    Release      -- free memory
+
+    Double buffered hash table, if 'doubleBuffer' is kept by Allocate:
+
+    PrehashBack  -- copy block data to the back buffer and start its
+                    prehash, mining goes on with the front buffer
+    BackReady    -- ready := 1 if prehash of the back buffer finished
+    WaitBack     -- BackReady, waits at most 'ms' milliseconds for the
+                    prehash to finish, woken as soon as it does
+    SwapBuffers  -- back buffer becomes the front one
+
+    Unfinalized hash contexts transfer for the on-disk cache, if
+    'keepPrehash' is kept by Allocate:
+
+    UploadUctxs  -- copy a chunk of contexts to the device
+    DownloadUctxs -- copy a chunk of contexts from the device
+
+    Mining geometry, set after Allocate by the tuner (see autotune.h):
+
+    ProfileKey   -- device model and driver, tuned geometries are stored
+                    under it, empty if the device is not tunable
+    Geometries   -- candidates of the tuning sweep
+    SetGeometry  -- use the geometry for next iterations, NoncesPerIter
+                    follows it
+
+    Miner thread state machine with double buffering:
+
+        FRONT ---(new message)---> FRONT + BUILDING BACK
+          ^                                 |
+          +--------(BackReady, Swap)--------+
+
+    All operations return EXIT_SUCCESS or EXIT_FAILURE, the miner thread
+    stops on failure.
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+class MiningBackend
+{
+public:
+    virtual ~MiningBackend(void) {}
+
+    // device name for logs: "GPU 0", "CPU"
+    virtual const char * Name(void) const = 0;
+
+    // PCI bus and device IDs, (-1, -1) if the device is not on PCI bus
+    virtual std::pair<int, int> PciIds(void) const = 0;
+
+    // NUMA node closest to the device, its miner thread runs there,
+    // -1 if none
+    virtual int NumaNode(void) const = 0;
+
+    // number of nonces per mining iteration
+    virtual uint32_t NoncesPerIter(void) const = 0;
+
+    // number of mining iterations between hashrate updates
+    virtual int HashrateCycles(void) const = 0;
+
+    virtual int Allocate(
+        // public key
+        const uint8_t * pk,
+        // secret key
+        const uint8_t * sk,
+        // keep unfinalized hash contexts option
+        int * keepPrehash,
+        // double buffered hash table option
+        int * doubleBuffer
+    ) = 0;
+
+    virtual int InitPrehash(void) = 0;
+
+    virtual int UploadBlock(
+        // boundary for puzzle
+        const uint8_t * bound,
+        // message
+        const uint8_t * mes,
+        // one-time secret key
+        const uint8_t * x,
+        // one-time public key
+        const uint8_t * w
+    ) = 0;
+
+    virtual int UploadBound(
+        // boundary for puzzle
+        const uint8_t * bound
+    ) = 0;
+
+    virtual int Prehash(void) = 0;
+
+    virtual int Mine(
+        // first nonce of the iteration
+        const uint64_t base
+    ) = 0;
+
+    virtual int FetchResults(
+        // solutions, MAX_RESULTS elements
+        result_t * results,
+        // number of solutions
+        uint32_t * count,
+        // number of solutions not kept
+        uint32_t * lost
+    ) = 0;
+
+    virtual void Release(void) = 0;
+
+    virtual int PrehashBack(
+        // boundary for puzzle
+        const uint8_t * bound,
+        // message
+        const uint8_t * mes,
+        // one-time secret key
+        const uint8_t * x,
+        // one-time public key
+        const uint8_t * w
+    )
+    {
+        return EXIT_FAILURE;
+    }
+
+    virtual int BackReady(
+        // prehash of the back buffer finished
+        int * ready
+    )
+    {
+        return EXIT_FAILURE;
+    }
+
+    virtual int WaitBack(
+        // prehash of the back buffer finished
+        int * ready,
+        // longest wait, ms
+        const uint32_t
+    )
+    {
+        return BackReady(ready);
+    }
+
+    virtual int SwapBuffers(void) { return EXIT_FAILURE; }
+
+    virtual std::string ProfileKey(void) const { return ""; }
+
+    virtual void Geometries(
+        // candidates, ascending number of nonces for every block dimension
+        std::vector<geometry_t> * candidates
+    ) const
+    {
+        candidates->clear();
+    }
+
+    virtual int SetGeometry(
+        // launch geometry
+        const geometry_t & geometry
+    )
+    {
+        return EXIT_FAILURE;
+    }
+
+    virtual int UploadUctxs(
+        // index of the first context
+        const uint32_t first,
+        // number of contexts
+        const uint32_t cnt,
+        // contexts
+        const uctx_t * uctxs
+    )
+    {
+        return EXIT_FAILURE;
+    }
+
+    virtual int DownloadUctxs(
+        // index of the first context
+        const uint32_t first,
+        // number of contexts
+        const uint32_t cnt,
+        // contexts
+        uctx_t * uctxs
+    )
+    {
+        return EXIT_FAILURE;
+    }
+};
+
+// enumerate available mining devices: GPUs first, then CPU if requested
+int EnumerateBackends(
+    // use CPU mining
+    const int cpuMining,
+    // placement of the CPU table over NUMA nodes
+    const numa_t numa,
+    // created backends, owned by the caller
+    std::vector<MiningBackend *> * backends
+);
+
+#endif // BACKEND_H
@@ -0,0 +1,114 @@
+#ifndef BATCHVERIFY_H
+#define BATCHVERIFY_H
+
+/*******************************************************************************
+
+    BATCHVERIFY -- Pool-side verification of submitted solutions
+
+********************************************************************************
+
+    A pool only knows the public data of a solution: pk, w, nonce, d and
+    the block message and bound. With f the sum of the K_LEN raw table
+    elements of the nonce mod Q, the solution is valid if
+
+        d < bound    and    w^f = g^d * pk
+
+    The miner computes d = x * f - sk mod Q, so the equation holds for
+    w = g^x and pk = g^sk. Elements are computed with the host reference
+    implementation, raw elements are obtained with x = 1, and the curve
+    equation is checked with OpenSSL.
+
+    Submissions are JSON objects, e.g. a solution of the miner extended by
+    its block:
+
+        {"pk":"<hex>","w":"<hex>","n":"<hex>","d":<dec>e0,"msg":"<hex>",
+         "b":<dec>}
+
+    Numbers may be given as JSON strings or numbers, "e0" suffix of d is
+    accepted.
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+
+// submitted solution with its block
+struct submission_t
+{
+    // public key -- COMPRESSED
+    uint8_t pk[PK_SIZE_8];
+    // one-time public key -- COMPRESSED
+    uint8_t w[PK_SIZE_8];
+    // message -- BIG ENDIAN
+    uint8_t mes[NUM_SIZE_8];
+    // boundary for puzzle -- LITTLE ENDIAN
+    uint32_t bound[NUM_SIZE_32];
+    // d -- LITTLE ENDIAN
+    uint32_t d[NUM_SIZE_32];
+    // nonce
+    uint64_t nonce;
+};
+
+// parse submission, EXIT_FAILURE if malformed
+int ParseSubmission(
+    // JSON object
+    const char * in,
+    // length of the object
+    const uint32_t inlen,
+    // parsed submission
+    submission_t * sub
+);
+
+// verifier with its own OpenSSL context, one per thread
+class SubmissionVerifier
+{
+public:
+    SubmissionVerifier(void);
+    ~SubmissionVerifier(void);
+
+    // 1 if the solution is valid
+    int Verify(
+        // submission
+        const submission_t & sub
+    );
+
+private:
+    SubmissionVerifier(const SubmissionVerifier &);
+    SubmissionVerifier & operator=(const SubmissionVerifier &);
+
+    // f := sum of raw elements of the nonce mod Q
+    void SumElements(
+        // submission
+        const submission_t & sub,
+        // result -- LITTLE ENDIAN
+        uint32_t * f
+    );
+
+    EC_GROUP * group;
+    BN_CTX * ctx;
+    EC_POINT * pk;
+    EC_POINT * w;
+    EC_POINT * lhs;
+    BIGNUM * order;
+    BIGNUM * dn;
+    BIGNUM * fn;
+
+    // data: pk || mes || w || padding || x || sk, x = 1, sk = 0
+    uint32_t data[DATA_SIZE_8 >> 2];
+};
+
+// verify submissions with worker threads, valid[i] := 1 if subs[i] is valid
+void VerifyBatch(
+    // submissions
+    const submission_t * subs,
+    // number of submissions
+    const uint32_t count,
+    // results
+    uint8_t * valid,
+    // number of worker threads, 0 for all hardware threads
+    const uint32_t threads
+);
+
+#endif // BATCHVERIFY_H
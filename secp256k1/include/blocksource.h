@@ -0,0 +1,159 @@
+#ifndef BLOCKSOURCE_H
+#define BLOCKSOURCE_H
+
+/*******************************************************************************
+
+    BLOCKSOURCE -- Acquisition of block candidates
+
+********************************************************************************
+
+BlockSource
+    Source of block candidates driven by the main thread:
+
+    Fetch        -- wait for the next candidate for a bounded time and put
+                    it to the puzzle global info, signalling miners
+    Stats        -- request statistics since the previous call
+    Submit       -- send a solution through the source, only for sources
+                    which take solutions themselves (pools), called from
+                    the submitter thread, SUBMIT_STALE if the job of the
+                    solution is replaced and it is not sent
+    SetMetrics   -- registry to observe candidate request times in
+
+PollSource
+    Conditional GET requests of /mining/candidate every BLOCK_POLL_MS over
+    one keep-alive connection. An ETag of the node is sent back in
+    If-None-Match, so an unchanged candidate costs a 304 response; a node
+    or proxy which holds such a request until the candidate changes turns
+    polling into long polling.
+
+PushSource
+    Server-sent events stream (text/event-stream) of candidates, every event
+    'data' is a candidate JSON. The stream is reconnected if dropped, and
+    the candidate is polled every BLOCK_FALLBACK_MS in case of lost events.
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include "metrics.h"
+#include "submitter.h"
+#include <curl/curl.h>
+#include <stdlib.h>
+#include <string>
+
+// block source statistics
+struct source_stats_t
+{
+    // requests made
+    uint32_t requests;
+    // requests answered with 304 Not Modified
+    uint32_t unchanged;
+    // candidates received by push
+    uint32_t pushed;
+    // shares accepted and rejected by pool
+    uint32_t accepted;
+    uint32_t rejected;
+    // average request time, ms
+    double requestTime;
+};
+
+class BlockSource
+{
+public:
+    BlockSource(void): metrics(NULL) {}
+    virtual ~BlockSource(void) {}
+
+    virtual const char * Name(void) const = 0;
+
+    virtual int Fetch(
+        // puzzle global info
+        info_t * info,
+        // exit if the candidate is for other public key
+        const int checkPubKey
+    ) = 0;
+
+    virtual void Stats(source_stats_t * stats) = 0;
+
+    virtual int Submit(const solution_t *) { return EXIT_FAILURE; }
+
+    virtual void SetMetrics(Metrics * metrics) { this->metrics = metrics; }
+
+protected:
+    // NULL if not measured
+    Metrics * metrics;
+};
+
+class PollSource: public BlockSource
+{
+public:
+    PollSource(const char * from);
+    ~PollSource(void);
+
+    const char * Name(void) const { return "poll"; }
+    int Fetch(info_t * info, const int checkPubKey);
+    void Stats(source_stats_t * stats);
+
+    // single conditional request without waiting
+    int Request(info_t * info, const int checkPubKey);
+
+    // apply candidate received elsewhere, compared with the latest one
+    int Apply(json_t * req, info_t * info, const int checkPubKey);
+
+private:
+    static size_t HeaderFunc(char * buf, size_t size, size_t n, void * arg);
+
+    CURL * curl;
+    curl_slist * headers;
+
+    // latest and currently received candidates
+    json_t oldreq;
+    json_t newreq;
+
+    // entity tags of the latest candidate, of the current response and
+    // of the request headers
+    std::string lastTag;
+    std::string etag;
+    std::string headerTag;
+    const std::string noTag;
+
+    uint32_t requests;
+    uint32_t unchanged;
+    double requestTime;
+};
+
+class PushSource: public BlockSource
+{
+public:
+    PushSource(const char * from, const char * push);
+    ~PushSource(void);
+
+    const char * Name(void) const { return "push"; }
+    int Fetch(info_t * info, const int checkPubKey);
+    void Stats(source_stats_t * stats);
+    void SetMetrics(Metrics * metrics);
+
+private:
+    static size_t StreamFunc(char * buf, size_t size, size_t n, void * arg);
+
+    // apply complete events of the stream buffer
+    void ApplyEvents(void);
+
+    PollSource poll;
+
+    CURLM * multi;
+    CURL * curl;
+    curl_slist * headers;
+    int active;
+
+    // stream buffer and data of the current event
+    std::string stream;
+    std::string data;
+
+    json_t newreq;
+    info_t * info;
+
+    int64_t lastPoll;
+    int64_t retryAt;
+    uint32_t pushed;
+};
+
+#endif // BLOCKSOURCE_H
@@ -3,14 +3,29 @@
 
 /*******************************************************************************
 
-    COMPACTION -- Identification of hashes subject to rehash 
+    COMPACTION -- Identification of hashes subject to rehash, compaction of
+    mining candidates
 
 *******************************************************************************/
 
 #include "definitions.h"
+#include <cooperative_groups.h>
 
-// increment a counter in a warp
-__device__ uint32_t WarpInc(uint32_t * len);
+// increment a counter in a warp: one atomic per group of converged threads,
+// returns distinct consecutive old values, inlined since device code is not
+// linked across units
+__device__ __forceinline__ uint32_t WarpInc(uint32_t * len)
+{
+    // unlike __activemask, threads of the group are converged for sure, so
+    // divergent groups never count the same threads
+    cooperative_groups::coalesced_group group
+        = cooperative_groups::coalesced_threads();
+    uint32_t pos = 0;
+
+    if (!group.thread_rank()) { pos = atomicAdd(len, group.size()); }
+
+    return group.shfl(pos, 0) + group.thread_rank();
+}
 
 // compactify an array, omit all zeros
 __global__ void Compactify(
@@ -9,6 +9,36 @@
 
 #include <stdint.h>
 
+struct uint256_t;
+
+// convert string of decimal digits to 256-bit number,
+// EXIT_FAILURE on other characters or overflow
+int DecStrToUint256(
+    const char * in,
+    const uint32_t inlen,
+    uint256_t * out
+);
+
+// convert string of at most 64 hexadecimal digits to 256-bit number,
+// EXIT_FAILURE on other characters
+int HexStrToUint256(
+    const char * in,
+    const uint32_t inlen,
+    uint256_t * out
+);
+
+// convert 256-bit number to string of decimal digits, returns its length
+uint32_t Uint256ToDecStr(
+    const uint256_t & in,
+    char * out
+);
+
+// convert 256-bit number to string of 64 hexadecimal digits
+void Uint256ToHexStr(
+    const uint256_t & in,
+    char * out
+);
+
 // convert string of decimal digits to string of 64 hexadecimal digits
 int DecStrToHexStrOf64(
     const char * in,
@@ -0,0 +1,161 @@
+#ifndef CPUBACKEND_H
+#define CPUBACKEND_H
+
+/*******************************************************************************
+
+    CPUBACKEND -- Host mining device
+
+********************************************************************************
+
+    On a host of several NUMA nodes (see TOPOLOGY) the table is placed as
+    configured by 'numa':
+
+        NUMA_REPLICATE  -- one replica of the table per node, built once
+                           and copied, nonces of an iteration are split
+                           between nodes in proportion to their cores and
+                           workers of a node are pinned to its cores and
+                           read its replica
+        NUMA_INTERLEAVE -- one table interleaved over nodes page by page,
+                           workers pinned to nodes as above
+        NUMA_OFF        -- one table, workers not pinned
+
+    Unfinalized contexts are interleaved if the table is not NUMA_OFF.
+
+    Worker threads are kept in a pool for the lifetime of the backend, so
+    an iteration does not start threads. The back buffer is built by
+    threads of its own, as it runs along with mining. With NUMA nodes,
+    Allocate starts a pool of workers pinned to the cores of every node
+    and a leader per node, pinned as well, which mines the part of the
+    node on them.
+
+*******************************************************************************/
+
+#include "backend.h"
+#include "cpuprimitives.h"
+#include "definitions.h"
+#include "hostarena.h"
+#include "topology.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CpuBackend: public MiningBackend
+{
+public:
+    CpuBackend(const uint32_t threads, const numa_t numa);
+    ~CpuBackend(void);
+
+    const char * Name(void) const { return "CPU"; }
+    std::pair<int, int> PciIds(void) const { return std::make_pair(-1, -1); }
+    int NumaNode(void) const { return -1; }
+    uint32_t NoncesPerIter(void) const { return geometry.nonces; }
+    int HashrateCycles(void) const { return 5; }
+
+    int Allocate(
+        const uint8_t * pk,
+        const uint8_t * sk,
+        int * keepPrehash,
+        int * doubleBuffer
+    );
+    int InitPrehash(void);
+    int UploadBlock(
+        const uint8_t * bound,
+        const uint8_t * mes,
+        const uint8_t * x,
+        const uint8_t * w
+    );
+    int UploadBound(const uint8_t * bound);
+    int Prehash(void);
+    int Mine(const uint64_t base);
+    int FetchResults(result_t * results, uint32_t * count, uint32_t * lost);
+    void Release(void);
+    int PrehashBack(
+        const uint8_t * bound,
+        const uint8_t * mes,
+        const uint8_t * x,
+        const uint8_t * w
+    );
+    int BackReady(int * ready);
+    int WaitBack(int * ready, const uint32_t ms);
+    int SwapBuffers(void);
+    std::string ProfileKey(void) const { return key; }
+    void Geometries(std::vector<geometry_t> * candidates) const;
+    int SetGeometry(const geometry_t & geometry);
+    int UploadUctxs(
+        const uint32_t first,
+        const uint32_t cnt,
+        const uctx_t * uctxs
+    );
+    int DownloadUctxs(const uint32_t first, const uint32_t cnt, uctx_t * uctxs);
+
+private:
+    // build table of the block in all replicas, by 'workers' if not NULL
+    int BuildTables(
+        const uint32_t * data,
+        std::vector<uint32_t *> * tables,
+        CpuPool * workers
+    );
+
+    // number of worker threads and the threads themselves
+    uint32_t threads;
+    CpuPool pool;
+    int keep;
+
+    // placement of the table, nodes with workers pinned to, one if none
+    numa_t numa;
+    std::vector<numa_node_t> nodes;
+
+    // processor model, BLAKE2b-256 instruction set and number of threads
+    std::string key;
+    // mining geometry: worker threads and CPU_NONCES_PER_ITER nonces at most
+    geometry_t geometry;
+
+    // boundary for puzzle
+    uint32_t bound_h[NUM_SIZE_32];
+    // solutions of the last iteration and their number
+    result_t results_h[MAX_RESULTS];
+    uint32_t count_h;
+
+    // data: pk || mes || w || padding || x || sk || ctx
+    uint32_t * data_h;
+    // precalculated hashes, one replica per node if replicated
+    std::vector<uint32_t *> hashes_h;
+    // unfinalized hash contexts
+    uctx_t * uctxs_h;
+
+    // back buffer: boundary, data and precalculated hashes
+    uint32_t backBound_h[NUM_SIZE_32];
+    uint32_t * backData_h;
+    std::vector<uint32_t *> backHashes_h;
+
+    // solutions of nodes, their numbers and statuses of mining
+    std::vector<result_t> nodeResults_h;
+    std::vector<uint32_t> nodeCounts_h;
+    std::vector<int> nodeStatus_h;
+
+    // pinned workers of every node and leaders of nodes, if NUMA is used
+    std::vector<std::unique_ptr<CpuPool>> nodePools;
+    std::unique_ptr<CpuPool> leaders;
+
+    // work buffers of block mining, sized by the geometry: survivors of
+    // the prefilter and compacted ones, a nonces each, survivors of
+    // compaction chunks, a thread each per node
+    std::vector<uint32_t> flags_h;
+    std::vector<uint32_t> cands_h;
+    std::vector<uint32_t> counts_h;
+
+    // huge pages buffers of hashes and contexts, kept over reallocations
+    HostArena arena;
+    // pages of buffers are logged
+    int reported;
+
+    // back buffer prehash thread
+    std::thread builder;
+    std::atomic<int> built;
+    // advanced when the back buffer is built
+    epoch_t backBuilt;
+};
+
+#endif // CPUBACKEND_H
@@ -0,0 +1,211 @@
+#ifndef CPUMINING_H
+#define CPUMINING_H
+
+/*******************************************************************************
+
+    CPUMINING -- Host reference implementation of Autolykos procedures
+
+********************************************************************************
+
+CpuUncompleteInitPrehash
+    in:     array 'data' contains pk
+
+    out:    computes an array 'uctx' of N uctx_t elements:
+            uctx[j] := unfinalized hash context for blake2b-256(j || M || pk)
+
+********************************************************************************
+
+CpuPrehash
+    in:     array 'data' contains (pk || mes || w || padding || x || sk)
+
+    in:     array 'uctx' of N uctx_t elements if 'keep' is set
+
+    out:    computes array 'hash' of N uint256_t elements -- LITTLE ENDIAN:
+            hash[j] := blake2b-256(j || M || pk || mes || w) * x mod Q
+
+            the array is split as in PREHASH, word i of hash[j] is at
+            TABLE_POS(j, i)
+
+CpuPrehashRange
+    out:    the same for j in [first, first + cnt) only, other elements
+            of 'hash' are not written
+
+********************************************************************************
+
+CpuBlockMining
+    in:     array 'data' contains (pk || mes || w || padding || x || sk)
+
+    in:     array 'hash' of N uint256_t elements computed by CpuPrehash
+
+    out:    for each nonce in [base, base + len):
+            d := sum(hash[i_k] : i_k in indices(blake2b-256(mes || nonce)))
+                 - sk mod Q
+
+    out:    results := (nonce, d) of nonces with d < bound in any order,
+            MAX_RESULTS at most, count := number of such nonces
+
+            three passes, as on the device: prefilter by the high 64 bits
+            of elements (see MiningPrefilter) flags survivors, which are
+            compacted into a candidates list (see CPUPRIMITIVES), then only
+            the candidates are hashed again and fully evaluated
+
+    in:     work buffers of the passes: 'flags' and 'cands' of 'len'
+            elements, 'counts' of CpuThreads(threads) elements, allocated
+            by the call if NULL
+
+            the prefilter is interleaved over CPU_GATHER_DEPTH nonces: all
+            K_LEN reads of a nonce are prefetched as soon as its indices
+            are known and consumed CPU_GATHER_DEPTH nonces later, so that
+            hashing of the following nonces hides their latency
+
+********************************************************************************
+
+MiningPrefilter
+    in:     bound and sk
+
+    out:    filter of nonces by the high 64 bits of elements, shared by the
+            host and the device mining:
+
+            with hi := sum of high 64 bits of elements mod 2^64, the high
+            64 bits of d differ from (hi - sk_hi) by -2 ... K_LEN (carries
+            of low bits, borrows of sk and of the reduction mod Q), so
+            d < bound is only possible for
+
+                hi - sk_hi in [-K_LEN, bound_hi + 2] mod 2^64
+
+            which is (hi + offset) mod 2^64 <= threshold for
+            offset := K_LEN - sk_hi and threshold := bound_hi + K_LEN + 2,
+            every nonce survives if the latter overflows
+
+*******************************************************************************/
+
+#include "cpuprimitives.h"
+#include "definitions.h"
+
+// hash of the message with nonce: blake2b-256(mes || nonce)
+void CpuBlakeHash(
+    // message
+    const uint8_t * mes,
+    // nonce
+    const uint64_t nonce,
+    // hash -- BIG ENDIAN
+    uint8_t * hash
+);
+
+// indices of the precalculated hashes from hash of the message with nonce
+void CpuGenIndices(
+    // hash of the message with nonce
+    const uint8_t * hash,
+    // K_LEN indices
+    uint32_t * indices
+);
+
+// single precalculated hash
+void CpuHashElement(
+    // data: pk || mes || w || padding || x || sk
+    const uint32_t * data,
+    // unfinalized hash contexts or NULL
+    const uctx_t * uctxs,
+    // element index
+    const uint32_t j,
+    // element -- LITTLE ENDIAN
+    uint32_t * elem
+);
+
+// d := sum(elems) - sk mod Q, check d < bound
+int CpuSumModQ(
+    // boundary for puzzle
+    const uint32_t * bound,
+    // secret key
+    const uint32_t * sk,
+    // K_LEN consecutive elements
+    const uint32_t * elems,
+    // result -- LITTLE ENDIAN
+    uint32_t * d
+);
+
+// uncompleted first iteration of hashes precalculation
+int CpuUncompleteInitPrehash(
+    // data: pk
+    const uint32_t * data,
+    // unfinalized hash contexts
+    uctx_t * uctxs,
+    // number of worker threads
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool = NULL
+);
+
+// precalculate hashes
+int CpuPrehash(
+    const int keep,
+    // data: pk || mes || w || padding || x || sk
+    const uint32_t * data,
+    // unfinalized hash contexts
+    const uctx_t * uctxs,
+    // hashes
+    uint32_t * hashes,
+    // number of worker threads
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool = NULL
+);
+
+// precalculate hashes of a range of elements
+int CpuPrehashRange(
+    const int keep,
+    // data: pk || mes || w || padding || x || sk
+    const uint32_t * data,
+    // unfinalized hash contexts
+    const uctx_t * uctxs,
+    // first element
+    const uint32_t first,
+    // number of elements
+    const uint32_t cnt,
+    // hashes
+    uint32_t * hashes,
+    // number of worker threads
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool = NULL
+);
+
+// exact prefilter of nonces by high 64 bits of elements
+void MiningPrefilter(
+    // boundary for puzzle
+    const uint32_t * bound,
+    // secret key
+    const uint32_t * sk,
+    // filter
+    prefilter_t * filter
+);
+
+// block mining iteration
+int CpuBlockMining(
+    // boundary for puzzle
+    const uint32_t * bound,
+    // precalculated hashes
+    const uint32_t * hashes,
+    // data: pk || mes || w || padding || x || sk
+    const uint32_t * data,
+    // first nonce of the iteration
+    const uint64_t base,
+    // number of nonces
+    const uint32_t len,
+    // solutions, MAX_RESULTS at most
+    result_t * results,
+    // number of solutions found, may exceed MAX_RESULTS
+    uint32_t * count,
+    // survivors of the prefilter or NULL
+    uint32_t * flags,
+    // compacted survivors or NULL
+    uint32_t * cands,
+    // survivors of compaction chunks or NULL
+    uint32_t * counts,
+    // number of worker threads
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool = NULL
+);
+
+#endif // CPUMINING_H
@@ -0,0 +1,214 @@
+#ifndef CPUPRIMITIVES_H
+#define CPUPRIMITIVES_H
+
+/*******************************************************************************
+
+    CPUPRIMITIVES -- Host parallel reduction, scan and stream compaction
+
+********************************************************************************
+
+    Host counterparts of REDUCTION and COMPACTION: the same operations over
+    arrays of uint32_t with worker threads, each worker takes a contiguous
+    chunk of CPU_PRIMITIVES_GRAIN elements at least.
+
+    Workers are those of a pool if one is given, threads started for the
+    call otherwise.
+
+CpuPool
+    persistent worker threads: Run wakes all of them, the first 'num' run
+    the job with their number, and returns once all of them are done;
+    jobs of the pool are serialized, a worker must not run a job of its
+    own pool; every worker calls 'init' with its number once started, to
+    pin itself for instance
+
+CpuFindSum
+    out:    sum of all elements mod 2^32
+
+CpuFindNonZero
+    out:    first nonzero element, 0 if there is none
+
+CpuExclusiveScan
+    out:    out[i] := in[0] + ... + in[i - 1] mod 2^32, in place allowed,
+            returns the sum of all elements
+
+CpuCompactify
+    out:    nonzero elements of 'in' in their order, returns their number,
+            'out' does not overlap 'in'
+
+    in:     'counts' of chunks, CpuThreads(threads) elements, allocated by
+            the call if NULL
+
+    Scan and compaction take two passes: sums (counts) of chunks, then
+    chunks with offsets from the scan of those.
+
+CpuPrefetch
+    software prefetch of a cache line, for gathers that issue reads well
+    before they consume them
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+// number of host worker threads, all available cores if zero requested
+uint32_t CpuThreads(const uint32_t threads);
+
+// hint the cache line of an address to be read soon, issues no fault
+inline void CpuPrefetch(const void * addr)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(addr, 0, 3);
+#elif defined(_MSC_VER)
+    _mm_prefetch((const char *)addr, _MM_HINT_T0);
+#endif
+
+    return;
+}
+
+class CpuPool
+{
+public:
+    CpuPool(
+        // number of worker threads, 0 for all available cores
+        const uint32_t threads,
+        // setup of a worker thread or empty
+        const std::function<void(uint32_t)> & init
+        = std::function<void(uint32_t)>()
+    );
+    ~CpuPool(void);
+
+    uint32_t Size(void) const { return workers.size(); }
+
+    // run job(worker) on the first 'num' workers and wait for them
+    void Run(const uint32_t num, const std::function<void(uint32_t)> & job);
+
+private:
+    void Work(const uint32_t worker, std::function<void(uint32_t)> init);
+
+    std::vector<std::thread> workers;
+    // one job at a time
+    std::mutex mutex;
+
+    // job of the current round and its number of workers
+    const std::function<void(uint32_t)> * job;
+    uint32_t num;
+    int stopping;
+
+    // advanced to start a round, and once all workers are done with it
+    epoch_t start;
+    epoch_t finish;
+    std::atomic<uint32_t> pending;
+};
+
+// run func(worker, first, last) over [0, len) split between worker threads
+template<typename Func>
+void ParallelFor(
+    // number of items
+    const uint32_t len,
+    // number of worker threads, 0 for all available cores
+    const uint32_t threads,
+    // function of a chunk
+    Func func,
+    // persistent workers, threads are started for the call if NULL
+    CpuPool * pool = NULL
+)
+{
+    uint32_t num = CpuThreads(threads);
+
+    if (pool && num > pool->Size()) { num = pool->Size(); }
+    if (num > len) { num = (len)? len: 1; }
+
+    const uint32_t chunk = len / num;
+
+    if (pool)
+    {
+        pool->Run(
+            num,
+            [&](const uint32_t t)
+            {
+                func(t, t * chunk, (t == num - 1)? len: (t + 1) * chunk);
+            }
+        );
+
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    uint32_t first = 0;
+
+    for (uint32_t t = 0; t < num; ++t)
+    {
+        uint32_t last = (t == num - 1)? len: first + chunk;
+
+        workers.push_back(std::thread(func, t, first, last));
+        first = last;
+    }
+
+    for (uint32_t t = 0; t < num; ++t) { workers[t].join(); }
+
+    return;
+}
+
+// sum of all elements in array
+uint32_t CpuFindSum(
+    // array
+    const uint32_t * in,
+    // length of array
+    const uint32_t inlen,
+    // number of worker threads, 0 for all available cores
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool = NULL
+);
+
+// first non zero item in array
+uint32_t CpuFindNonZero(
+    // array
+    const uint32_t * in,
+    // length of array
+    const uint32_t inlen,
+    // number of worker threads, 0 for all available cores
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool = NULL
+);
+
+// exclusive prefix sums of array
+uint32_t CpuExclusiveScan(
+    // array
+    const uint32_t * in,
+    // length of array
+    const uint32_t inlen,
+    // prefix sums, may be 'in'
+    uint32_t * out,
+    // number of worker threads, 0 for all available cores
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool = NULL
+);
+
+// compactify an array, omit all zeros, keep order
+uint32_t CpuCompactify(
+    // array
+    const uint32_t * in,
+    // length of array
+    const uint32_t inlen,
+    // nonzero elements
+    uint32_t * out,
+    // number of worker threads, 0 for all available cores
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool = NULL,
+    // nonzero elements of chunks or NULL
+    uint32_t * counts = NULL
+);
+
+#endif // CPUPRIMITIVES_H
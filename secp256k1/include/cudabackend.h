@@ -0,0 +1,125 @@
+#ifndef CUDABACKEND_H
+#define CUDABACKEND_H
+
+/*******************************************************************************
+
+    CUDABACKEND -- CUDA mining device
+
+*******************************************************************************/
+
+#include "backend.h"
+#include "definitions.h"
+#include <cuda_runtime.h>
+#include <string>
+#include <vector>
+
+class CudaBackend: public MiningBackend
+{
+public:
+    CudaBackend(const int deviceId);
+    ~CudaBackend(void);
+
+    const char * Name(void) const { return name; }
+    std::pair<int, int> PciIds(void) const { return pci; }
+    int NumaNode(void) const { return node; }
+    uint32_t NoncesPerIter(void) const { return geometry.nonces; }
+    int HashrateCycles(void) const { return 50; }
+
+    int Allocate(
+        const uint8_t * pk,
+        const uint8_t * sk,
+        int * keepPrehash,
+        int * doubleBuffer
+    );
+    int InitPrehash(void);
+    int UploadBlock(
+        const uint8_t * bound,
+        const uint8_t * mes,
+        const uint8_t * x,
+        const uint8_t * w
+    );
+    int UploadBound(const uint8_t * bound);
+    int Prehash(void);
+    int Mine(const uint64_t base);
+    int FetchResults(result_t * results, uint32_t * count, uint32_t * lost);
+    void Release(void);
+    int PrehashBack(
+        const uint8_t * bound,
+        const uint8_t * mes,
+        const uint8_t * x,
+        const uint8_t * w
+    );
+    int BackReady(int * ready);
+    int WaitBack(int * ready, const uint32_t ms);
+    int SwapBuffers(void);
+    std::string ProfileKey(void) const { return key; }
+    void Geometries(std::vector<geometry_t> * candidates) const;
+    int SetGeometry(const geometry_t & geometry);
+    int UploadUctxs(
+        const uint32_t first,
+        const uint32_t cnt,
+        const uctx_t * uctxs
+    );
+    int DownloadUctxs(const uint32_t first, const uint32_t cnt, uctx_t * uctxs);
+
+    // append all CUDA devices, EXIT_FAILURE if devices can not be checked
+    static int Enumerate(std::vector<MiningBackend *> * backends);
+
+private:
+    int deviceId;
+    char name[20];
+    std::pair<int, int> pci;
+    // NUMA node of the PCI bus
+    int node;
+    int keep;
+
+    // device model, compute capability and driver version
+    std::string key;
+    // mining geometry, NONCES_PER_ITER nonces at most
+    geometry_t geometry;
+
+    // message of the uploaded block
+    uint8_t mes_h[NUM_SIZE_8];
+    // hash context of the message
+    ctx_t ctx_h;
+    // secret key
+    uint32_t sk_h[NUM_SIZE_32];
+    // prefilter of nonces of the uploaded block
+    prefilter_t filter;
+
+    // boundary for puzzle
+    uint32_t * bound_d;
+    // data: pk || mes || w || padding || x || sk || ctx
+    uint32_t * data_d;
+    // hashes of the message with nonces
+    uint32_t * bhashes_d;
+    // solution candidates: number and thread ids
+    uint32_t * cands_d;
+    // out of range hashes of a prehash: number and indices, the back
+    // buffer prehash uses the second half
+    uint32_t * invalid_d;
+    // precalculated hashes
+    uint32_t * hashes_d;
+    // solutions of the iteration
+    result_t * results_d;
+    // number of solutions found in the iteration
+    uint32_t * count_d;
+    // unfinalized hash contexts
+    uctx_t * uctxs_d;
+
+    // back buffer: hash context, prefilter, boundary, data and
+    // precalculated hashes
+    ctx_t backCtx_h;
+    prefilter_t backFilter;
+    uint32_t * backBound_d;
+    uint32_t * backData_d;
+    uint32_t * backHashes_d;
+
+    // back buffer prehash stream and its completion
+    cudaStream_t stream;
+    cudaEvent_t built;
+    // advanced by the stream when the back buffer is built
+    epoch_t backBuilt;
+};
+
+#endif // CUDABACKEND_H
@@ -13,6 +13,7 @@
 #include <stddef.h>
 #include <time.h>
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <string.h>
 ////////////////////////////////////////////////////////////////////////////////
@@ -36,12 +37,109 @@
 // number of nonces per thread
 #define NONCES_PER_THREAD  1
 
-// total number of nonces per iteration
+// maximal total number of nonces per iteration, the mining geometry
+// chosen at runtime may use less
 // #define NONCES_PER_ITER    0x200000 // 2^22
 //
-// kernel block size
+// prehash kernel block size, mining kernels are compiled for all of
+// MINING_BLOCK_DIMS and use the one chosen at runtime
 // #define BLOCK_DIM          64
 
+// capacity of the solutions buffer of one mining iteration,
+// solutions over it are counted as lost
+#define MAX_RESULTS        64
+
+// capacity of the list of out of range hashes of a prehash, all hashes
+// are checked for rehash on overflow
+#define MAX_INVALID        0x400
+
+// number of threads per block of device reductions, FindSum and
+// FindNonZero need REDUCTION_BLOCK_DIM auxiliary words
+#define REDUCTION_BLOCK_DIM 256
+
+// number of blocks of the kernel evaluating prefilter survivors, threads
+// stride over the compacted candidates list
+#define CANDIDATE_BLOCKS   64
+
+////////////////////////////////////////////////////////////////////////////////
+//  PARAMETERS: Host mining parameters
+////////////////////////////////////////////////////////////////////////////////
+// maximal total number of nonces per host iteration
+#define CPU_NONCES_PER_ITER 0x100000 // 2^20
+
+// number of host worker threads, 0 for all available cores
+#define CPU_THREADS        0
+
+// number of independent BLAKE2b-256 lanes hashed per host call
+#define B2B_LANES          8
+
+// nonces of a host worker with table reads in flight, power of two
+#define CPU_GATHER_DEPTH   4
+
+// largest pages tried for host table and contexts buffers (see HOSTARENA):
+// 0 -- 4 KiB, 1 -- transparent huge pages, 2 -- 2 MiB, 3 -- 1 GiB
+#define HOST_HUGE_PAGES    3
+
+// maximal NUMA node id + 1
+#define MAX_NUMA_NODES     1024
+
+// minimal number of elements per worker of host reduction, scan and
+// compaction
+#define CPU_PRIMITIVES_GRAIN 0x10000
+
+////////////////////////////////////////////////////////////////////////////////
+//  PARAMETERS: Unfinalized hash contexts cache file
+////////////////////////////////////////////////////////////////////////////////
+// cache file format version, increment on any layout change
+#define UCTX_CACHE_VERSION 1
+
+// number of contexts per checksummed chunk // 20 MiB
+#define UCTX_CACHE_CHUNK   0x40000 // 2^18
+
+// alignment of contexts in the file
+#define UCTX_CACHE_ALIGN   4096
+
+////////////////////////////////////////////////////////////////////////////////
+//  PARAMETERS: Mining geometry tuning
+////////////////////////////////////////////////////////////////////////////////
+// block dimensions of the compiled mining kernel variants
+#define MINING_BLOCK_DIMS  { 32, 64, 128, 256 }
+
+// maximal duration of a mining iteration: new blocks are picked up
+// between iterations, slower geometries are rejected by the tuner
+#define MAX_ITER_MS        100
+
+// number of timed iterations of every tuning candidate
+#define TUNE_ITERS         8
+
+// smallest number of nonces per iteration of the GPU and host sweeps
+#define TUNE_MIN_NONCES    0x100000 // 2^20
+#define CPU_TUNE_MIN_NONCES 0x10000 // 2^16
+
+// default file of tuned geometry profiles
+#define TUNE_PROFILES      "geometry.txt"
+
+////////////////////////////////////////////////////////////////////////////////
+//  PARAMETERS: Host verification of solutions
+////////////////////////////////////////////////////////////////////////////////
+// number of invalid solutions within the window raising the derate level
+#define VERIFY_FAULT_LIMIT 3
+
+// window of fault counting, mining iterations
+#define VERIFY_FAULT_WINDOW 1000
+
+// maximal derate level
+#define VERIFY_MAX_DERATE  4
+
+// idle time per derate level, percent of the iteration time
+#define VERIFY_DERATE_IDLE 25
+
+// submissions verified per batch by the verify tool
+#define VERIFY_BATCH       4096
+
+// maximal number of JSON tokens of a submission
+#define VERIFY_MAX_TOKENS  32
+
 ////////////////////////////////////////////////////////////////////////////////
 // Memory compatibility checks
 // should probably be now more correctly set
@@ -91,9 +189,69 @@
 // CURL number of retries to POST solution if failed
 #define MAX_POST_RETRIES   5
 
+// capacity of the solution submission queue, power of 2
+#define SUBMIT_QUEUE_LEN   64
+
+// delay before the first POST retry, doubled for each next one
+#define SUBMIT_BACKOFF_MS  100
+
+// status of a share not sent as the pool has replaced its job
+#define SUBMIT_STALE       2
+
+// interval between block candidate requests of the polling source
+#define BLOCK_POLL_MS      15
+
+// interval between fallback requests of the push source
+#define BLOCK_FALLBACK_MS  1000
+
+// maximal wait for a pushed block in one push source step
+#define BLOCK_PUSH_WAIT_MS 100
+
+// delay before reconnecting a dropped push stream
+#define BLOCK_PUSH_RETRY_MS 1000
+
+// interval between hashrate reports of the main thread
+#define STATS_INTERVAL_MS  30000
+
 // URL max size 
 #define MAX_URL_SIZE       1024
 
+//============================================================================//
+//  Pool protocol
+//============================================================================//
+// maximal length of a pool message line
+#define STRATUM_LINE_LEN   0x4000
+
+// id of the first share submission, lower ids are for session setup
+#define STRATUM_SUBMIT_ID  3
+
+// maximal number of JSON tokens in a pool message
+#define STRATUM_TOKS       64
+
+//============================================================================//
+//  Metrics
+//============================================================================//
+// cache line size, counters of different threads are padded to it
+#define CACHE_LINE_SIZE    64
+
+// number of finite buckets of latency histograms
+#define METRICS_BUCKETS    16
+
+//============================================================================//
+//  GPU telemetry
+//============================================================================//
+// default interval between telemetry samples
+#define TELEMETRY_INTERVAL_MS 1000
+
+// minimal interval between telemetry samples
+#define TELEMETRY_MIN_INTERVAL_MS 100
+
+// number of telemetry snapshots kept
+#define TELEMETRY_HISTORY  600
+
+// length of GPU name, UUID and PCI bus id strings
+#define TELEMETRY_STR_LEN  96
+
 //============================================================================//
 //  CURL requests
 //============================================================================//
@@ -103,17 +261,15 @@
 // maximal request capacity
 #define MAX_JSON_CAPACITY  8192
 
-// total JSON objects count
-#define REQ_LEN            7
+// initial JSON tokens count of block candidate, grown for extra fields
+#define REQ_LEN            32
 
-// JSON position of message
-#define MES_POS            2
+// maximal JSON tokens count of block candidate
+#define MAX_REQ_LEN        1024
 
-// JSON position of bound
-#define BOUND_POS          4
-
-// JSON position of public key
-#define PK_POS             6
+// FNV-1a 64-bit hash of a response body, basis and prime
+#define JSON_HASH_BASIS    0xCBF29CE484222325
+#define JSON_HASH_PRIME    0x100000001B3
 
 //============================================================================//
 //  Configuration file 
@@ -151,6 +307,24 @@
 #define NUM_SIZE_8_BLOCK   (NUM_SIZE_32_BLOCK << 2)
 #define ROUND_NUM_SIZE_32  (NUM_SIZE_32_BLOCK * BLOCK_DIM)
 
+// maximal number of decimal digits of a 256-bit number
+#define MAX_DEC_DIGITS     78
+// decimal digits converted at once, 10^19 < 2^64
+#define DEC_CHUNK_DIGITS   19
+
+// precalculated hashes table, structure of arrays -- LITTLE ENDIAN:
+// high 64 bits of all N_LEN elements, then low 192 bits of all elements
+#define TABLE_HI_SIZE_32   2
+#define TABLE_LO_SIZE_32   (NUM_SIZE_32 - TABLE_HI_SIZE_32)
+
+// table position of word i of element j, N_LEN * NUM_SIZE_32 < 2^32
+#define TABLE_POS(j, i)                                                        \
+(                                                                              \
+    ((i) >= TABLE_LO_SIZE_32)?                                                 \
+    (uint32_t)(j) * TABLE_HI_SIZE_32 + (i) - TABLE_LO_SIZE_32:                 \
+    (uint32_t)N_LEN * TABLE_HI_SIZE_32 + (uint32_t)(j) * TABLE_LO_SIZE_32 + (i)\
+)
+
 // public key sizes
 #define PK_SIZE_4          (PK_SIZE_8 << 1)
 #define PK_SIZE_32_BLOCK   (1 + NUM_SIZE_32 / BLOCK_DIM)
@@ -231,6 +405,49 @@ typedef enum
 }
 state_t;
 
+// placement of the host table over NUMA nodes
+typedef enum
+{
+    NUMA_OFF = 0,
+    NUMA_INTERLEAVE = 1,
+    NUMA_REPLICATE = 2
+}
+numa_t;
+
+// epoch counter, waiters sleep until it advances
+struct epoch_t
+{
+    epoch_t(const uint_t val = 0);
+
+    uint_t load(void) const { return value.load(); }
+
+    // advance and wake all waiters, returns new value
+    uint_t operator++(void);
+    epoch_t & operator=(const uint_t val);
+
+    // wait at most 'ms' milliseconds for a value other than 'seen',
+    // returns current value
+    uint_t Wait(const uint_t seen, const uint32_t ms);
+
+    // wake-up latency from advance to waiter in microseconds
+    void Latency(uint64_t * avg, uint64_t * max) const;
+
+    // time of the last advance, steady clock microseconds
+    int64_t Stamp(void) const { return stamp.load(); }
+
+private:
+    std::atomic<uint_t> value;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // time of the last advance, steady clock microseconds
+    std::atomic<int64_t> stamp;
+
+    std::atomic<uint64_t> wakeups;
+    std::atomic<uint64_t> totalLatency;
+    std::atomic<uint64_t> maxLatency;
+};
+
 // puzzle global info
 struct info_t
 {
@@ -249,10 +466,35 @@ struct info_t
     char skstr[NUM_SIZE_4];
     char pkstr[PK_SIZE_4 + 1];
     int keepPrehash;
+    int doubleBuffer;
     char to[MAX_URL_SIZE];
+    // directory of unfinalized hash contexts cache, empty if disabled
+    char cache[MAX_URL_SIZE];
+    // file of tuned geometry profiles, empty if tuning is disabled
+    char profiles[MAX_URL_SIZE];
+
+    // nonce range of the block: upper bits are fixed to nonceBase,
+    // lower nonceBits bits are split between miner threads
+    uint64_t nonceBase;
+    uint32_t nonceBits;
+
+    // mining shares of a pool: mining goes on after solutions are found
+    int poolMining;
 
     // Increment when new block is sent by node
-    std::atomic<uint_t> blockId; 
+    epoch_t blockId;
+
+    // Increment when message of the block changed,
+    // same mesId with new blockId means only bound changed
+    std::atomic<uint_t> mesId;
+};
+
+// pool connection settings, empty url for solo mining
+struct pool_t
+{
+    char url[MAX_URL_SIZE];
+    char user[MAX_URL_SIZE];
+    char pass[MAX_URL_SIZE];
 };
 
 // json string for CURL http requests and config 
@@ -262,13 +504,33 @@ struct json_t
     size_t len;
     char * ptr;
     jsmntok_t * toks;
+    // tokens capacity
+    int toklen;
+
+    // FNV-1a hash of the string, updated as it is written
+    uint64_t hash;
+
+    // tokens of block candidate values, -1 if not parsed
+    int mesPos;
+    int boundPos;
+    int pkPos;
 
     json_t(const int strlen, const int toklen);
     json_t(const json_t & newjson);
     ~json_t(void);
 
-    // reset len to zero
-    void Reset(void) { len = 0; return; }
+    // reset len to zero, capacity is kept for the next string
+    void Reset(void)
+    {
+        len = 0;
+        hash = JSON_HASH_BASIS;
+        mesPos = boundPos = pkPos = -1;
+
+        return;
+    }
+
+    // exchange strings and tokens with other JSON string
+    void Swap(json_t & other);
 
     // tokens access methods
     int GetTokenStartPos(const int pos) { return toks[pos].start; }
@@ -295,6 +557,33 @@ struct ctx_t
     uint32_t c;
 };
 
+// solution found in a mining iteration
+struct result_t
+{
+    // nonce
+    uint64_t nonce;
+    // d -- LITTLE ENDIAN
+    uint32_t d[NUM_SIZE_32];
+};
+
+// launch geometry of a mining iteration
+struct geometry_t
+{
+    // GPU: threads per block, host: worker threads
+    uint32_t blockDim;
+    // nonces per iteration
+    uint32_t nonces;
+};
+
+// exact early reject of nonces derived from bound and secret key: with hi
+// the sum of high 64 bits of the K_LEN elements, a nonce may meet the bound
+// only if (hi + offset) mod 2^64 <= threshold
+struct prefilter_t
+{
+    uint64_t offset;
+    uint64_t threshold;
+};
+
 // BLAKE2b-256 packed uncomplete hash state context 
 struct uctx_t
 {
@@ -644,34 +933,6 @@ do                                                                             \
 }                                                                              \
 while (0)
 
-////////////////////////////////////////////////////////////////////////////////
-//  Little-Endian to Big-Endian convertation
-////////////////////////////////////////////////////////////////////////////////
-#define REVERSE_ENDIAN(p)                                                      \
-    ((((uint64_t)((uint8_t *)(p))[0]) << 56) ^                                 \
-    (((uint64_t)((uint8_t *)(p))[1]) << 48) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[2]) << 40) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[3]) << 32) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[4]) << 24) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[5]) << 16) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[6]) << 8) ^                                   \
-    ((uint64_t)((uint8_t *)(p))[7]))
-
-#define INPLACE_REVERSE_ENDIAN(p)                                              \
-do                                                                             \
-{                                                                              \
-    *((uint64_t *)(p))                                                         \
-    = ((((uint64_t)((uint8_t *)(p))[0]) << 56) ^                               \
-    (((uint64_t)((uint8_t *)(p))[1]) << 48) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[2]) << 40) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[3]) << 32) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[4]) << 24) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[5]) << 16) ^                                  \
-    (((uint64_t)((uint8_t *)(p))[6]) << 8) ^                                   \
-    ((uint64_t)((uint8_t *)(p))[7]));                                          \
-}                                                                              \
-while (0)
-
 ////////////////////////////////////////////////////////////////////////////////
 //  Wrappers for function calls
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,74 @@
+#ifndef HOSTARENA_H
+#define HOSTARENA_H
+
+/*******************************************************************************
+
+    HOSTARENA -- Host buffers of the table and of the contexts on huge pages
+
+********************************************************************************
+
+    Table and unfinalized contexts are read at random over gigabytes, so
+    with default 4 KiB pages nearly every read also misses the TLB. Their
+    buffers are mapped on the largest pages available, up to
+    HOST_HUGE_PAGES:
+
+        1 GiB pages  -- mmap with MAP_HUGETLB | MAP_HUGE_1GB, hugetlbfs
+                        pool of 1 GiB pages must be reserved
+        2 MiB pages  -- mmap with MAP_HUGETLB | MAP_HUGE_2MB, hugetlbfs
+                        pool of 2 MiB pages must be reserved
+        THP          -- 2 MiB aligned anonymous mapping advised with
+                        MADV_HUGEPAGE, the kernel may back it in part only
+        4 KiB pages  -- plain allocation
+
+    Released buffers stay mapped and are handed out again to requests that
+    fit, so a backend reallocating its buffers does not map and fault
+    gigabytes again. Buffers are unmapped by Clear and on destruction.
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// pages backing a host buffer
+typedef enum
+{
+    PAGES_DEFAULT = 0,
+    PAGES_THP = 1,
+    PAGES_2M = 2,
+    PAGES_1G = 3
+}
+pages_t;
+
+class HostArena
+{
+public:
+    HostArena(void) {}
+    ~HostArena(void);
+
+    // buffer of at least 'size' bytes, NULL if out of memory
+    void * Acquire(const size_t size);
+    // return buffer to the arena, it stays mapped
+    void Release(void * ptr);
+    // unmap all buffers, released or not
+    void Clear(void);
+
+    // pages obtained for a buffer, e.g. "1 GiB pages" or
+    // "THP, 1536 of 2048 MiB"
+    std::string Describe(const void * ptr) const;
+
+private:
+    struct block_t
+    {
+        void * ptr;
+        // mapped size
+        size_t size;
+        pages_t pages;
+        int used;
+    };
+
+    std::vector<block_t> blocks;
+};
+
+#endif // HOSTARENA_H
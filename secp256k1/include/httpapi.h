@@ -2,14 +2,20 @@
 #define HTTPAPI_H
 
 #include "httplib.h"
+#include "metrics.h"
+#include "telemetry.h"
 #include <vector>
 #include <string>
-#include <nvml.h>
 #include <unordered_map>
 #include <sstream>
 #include <chrono>
 
-void HttpApiThread(std::vector<double>* hashrates, std::vector<std::pair<int,int>>* props);
+// sampler is NULL if there is no GPU telemetry
+void HttpApiThread(
+    Metrics* metrics,
+    std::vector<std::pair<int,int>>* props,
+    TelemetrySampler* sampler
+);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,161 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/*******************************************************************************
+
+    METRICS -- Mining metrics registry
+
+********************************************************************************
+
+    Counters, gauges and latency histograms of miner threads, block source
+    and submitter. Every value has a single writer thread and is read by the
+    HTTP API thread, so values are relaxed atomics padded to CACHE_LINE_SIZE:
+    miners of different devices never write to the same cache line.
+
+    Histograms have METRICS_BUCKETS fixed buckets from 100 us to 10 s and
+    an overflow bucket. They are exposed in Prometheus text format with
+    cumulative 'le' buckets in seconds:
+
+    autolykos_hashrate_mhs               gauge,     per device
+    autolykos_iterations_total           counter,   per device
+    autolykos_stale_iterations_total     counter,   per device, iterations
+                                         interrupted by a new block
+    autolykos_solutions_total            counter,   per device
+    autolykos_lost_solutions_total       counter,   per device, solutions
+                                         lost on full result buffer
+    autolykos_invalid_solutions_total    counter,   per device, solutions
+                                         failed host verification
+    autolykos_derate_level               gauge,     per device
+    autolykos_prehash_seconds            histogram, per device
+    autolykos_iteration_seconds          histogram, per device
+    autolykos_block_switch_seconds       histogram, per device, from new
+                                         block publication to its mining
+    autolykos_poll_seconds               histogram, block candidate requests
+    autolykos_post_seconds               histogram, from solution found to
+                                         its submission
+    autolykos_post_failures_total        counter
+
+    Devices are labelled with their index and PCI bus and device ids.
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+// counter on its own cache line
+struct counter_t
+{
+    counter_t(void): value(0) {}
+
+    void Add(const uint64_t n = 1)
+    {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t Load(void) const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value;
+    char pad[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+};
+
+// gauge on its own cache line
+struct gauge_t
+{
+    gauge_t(void): value(0) {}
+
+    void Set(const double val)
+    {
+        value.store(val, std::memory_order_relaxed);
+    }
+
+    double Load(void) const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value;
+    char pad[CACHE_LINE_SIZE - sizeof(std::atomic<double>)];
+};
+
+// latency histogram with fixed buckets
+struct histogram_t
+{
+    histogram_t(void);
+
+    // add observation in microseconds
+    void Observe(const uint64_t us);
+
+    // upper bounds of finite buckets, microseconds
+    static const uint64_t bounds[METRICS_BUCKETS];
+
+    // last bucket is for observations above all bounds
+    std::atomic<uint64_t> buckets[METRICS_BUCKETS + 1];
+    // sum of observations, microseconds
+    std::atomic<uint64_t> sum;
+    char pad[CACHE_LINE_SIZE];
+};
+
+// metrics of one mining device, written by its miner thread
+struct device_metrics_t
+{
+    // average hashrate, MH/s
+    gauge_t hashrate;
+    // time of the latest hashrate update, ms since epoch
+    gauge_t stamp;
+
+    counter_t iterations;
+    counter_t staleIterations;
+    counter_t solutions;
+    counter_t lostSolutions;
+    counter_t invalidSolutions;
+
+    // derate level after invalid solutions
+    gauge_t derate;
+
+    histogram_t prehash;
+    histogram_t iteration;
+    histogram_t blockSwitch;
+};
+
+class Metrics
+{
+public:
+    Metrics(const int devices);
+    ~Metrics(void);
+
+    int Devices(void) const { return devices; }
+    device_metrics_t * Device(const int id) { return device + id; }
+
+    // Prometheus text exposition
+    void Prometheus(
+        // PCI bus and device ids of devices
+        const std::vector<std::pair<int, int>> & pci,
+        // output text
+        std::string * out
+    ) const;
+
+    // written by the main thread
+    histogram_t poll;
+
+    // written by the submitter thread
+    histogram_t post;
+    counter_t postFailures;
+
+private:
+    Metrics(const Metrics &);
+    Metrics & operator=(const Metrics &);
+
+    int devices;
+    device_metrics_t * device;
+};
+
+// steady clock microseconds for latency measurements
+int64_t MetricsNowUs(void);
+
+#endif // METRICS_H
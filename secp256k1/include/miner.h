@@ -0,0 +1,29 @@
+#ifndef MINER_H
+#define MINER_H
+
+/*******************************************************************************
+
+    MINER -- Autolykos puzzle cycle of a mining device
+
+*******************************************************************************/
+
+#include "backend.h"
+#include "definitions.h"
+#include "metrics.h"
+#include "submitter.h"
+
+// miner thread cycle, returns if any backend operation fails
+void MinerThread(
+    // mining device
+    MiningBackend * backend,
+    // index of the device in metrics
+    const int id,
+    // puzzle global info
+    info_t * info,
+    // queue of found solutions
+    Submitter * submitter,
+    // metrics of all devices
+    Metrics * metrics
+);
+
+#endif // MINER_H
@@ -25,21 +25,31 @@ void InitMining(
     const uint32_t meslen
 );
 
-// block mining iteration
-__global__ void BlockMining(
+// mining iteration of geometry.nonces nonces starting from base: hashes of
+// the message with nonces, prefilter of nonces compacting survivors into
+// the candidates list, then block mining of candidates only, all in the
+// default stream, EXIT_FAILURE if geometry.blockDim is not one of
+// MINING_BLOCK_DIMS
+int LaunchMining(
+    // launch geometry
+    const geometry_t & geometry,
+    // prefilter of nonces, see MiningPrefilter
+    const prefilter_t & filter,
     // boundary for puzzle
     const uint32_t * bound,
     // precalculated hashes
-    const uint32_t * __restrict__ hashes,
+    const uint32_t * hashes,
     const uint32_t * data,
-    // results
-    uint32_t * res,
-    // indices of valid solutions
-    uint32_t * valid,
-    uint32_t*  BHashes
+    // first nonce of the iteration
+    const uint64_t base,
+    // solutions, MAX_RESULTS at most
+    result_t * results,
+    // number of solutions found, may exceed MAX_RESULTS
+    uint32_t * count,
+    // hashes of the message with nonces, NUM_SIZE_8 bytes per nonce
+    uint32_t * bhashes,
+    // candidates: number and thread ids, 4 * (1 + nonces) bytes
+    uint32_t * cands
 );
 
-
-__global__ void BlakeHash(const uint32_t* data, const uint64_t base, uint32_t* BHashes);
-
 #endif // MINING_H
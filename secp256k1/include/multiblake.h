@@ -0,0 +1,79 @@
+#ifndef MULTIBLAKE_H
+#define MULTIBLAKE_H
+
+/*******************************************************************************
+
+    MULTIBLAKE -- Multi-lane BLAKE2b-256 compression on the host
+
+********************************************************************************
+
+CpuBlakeCompress
+    in:     lane state 's' of B2B_LANES independent hash contexts
+            s->h[i][l] := i-th chained state word of the l-th context
+            s->m[i][l] := i-th message word of the l-th context
+
+    in:     't' total number of bytes hashed after the block (same for all
+            lanes), 'last' flag of the final block
+
+    out:    s->h := blake2b compression of s->h with s->m for every lane
+
+    Compression of all lanes goes in lockstep: AVX-512 handles 8 lanes at
+    once, AVX2 handles 4 lanes at once, the scalar fallback one lane at a
+    time. The implementation is chosen once at runtime by CPUID.
+
+*******************************************************************************/
+
+#include "definitions.h"
+
+// lane state for multi-lane BLAKE2b-256 -- structure of arrays
+struct b2b_lanes_t
+{
+    // chained states
+    alignas(64) uint64_t h[8][B2B_LANES];
+    // message blocks
+    alignas(64) uint64_t m[16][B2B_LANES];
+};
+
+// name of the selected instruction set: "avx512", "avx2" or "scalar"
+const char * CpuBlakeIsa(void);
+
+// select instruction set by name, the best supported one if NULL,
+// returns EXIT_FAILURE if the instruction set is not supported
+int CpuBlakeSelect(const char * isa);
+
+// initialize chained states of all lanes for BLAKE2b-256
+void CpuBlakeInit(b2b_lanes_t * s);
+
+// load message block of one lane, pad with zeros to BUF_SIZE_8 bytes
+void CpuBlakeLoad(
+    // lane state
+    b2b_lanes_t * s,
+    // lane index
+    const uint32_t lane,
+    // message block
+    const uint8_t * block,
+    // message block length
+    const uint32_t len
+);
+
+// compress message blocks of all lanes
+void CpuBlakeCompress(
+    // lane state
+    b2b_lanes_t * s,
+    // total number of bytes hashed
+    const uint64_t t,
+    // final block flag
+    const int last
+);
+
+// dump hash of one lane -- BIG ENDIAN
+void CpuBlakeDump(
+    // lane state
+    const b2b_lanes_t * s,
+    // lane index
+    const uint32_t lane,
+    // hash
+    uint8_t * hash
+);
+
+#endif // MULTIBLAKE_H
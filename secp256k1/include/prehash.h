@@ -13,8 +13,9 @@ InitPrehash
     out:    computes array 'hash' of N uint256_t elements:
             hash[j] := blake2b-256(j || M || pk || mes || w) 
 
-    out:    computes array 'invalid' of N uint32_t elements:
-            invalid[j] := (hash[j] < 15 * Q)? 0: j + 1 
+    out:    appends indices of out of range hashes to the compacted list
+            'invalid' (WarpInc), its length at invalid[0]:
+            invalid[1 + ...] := { j : hash[j] >= Q }
 
 ********************************************************************************
 
@@ -30,17 +31,11 @@ UpdatePrehash
     in:     array 'hash' of N uint256_t elements:
             hash[j] == blake2b-256(j || M || pk || mes || w) 
 
-    in:     array 'invalid' of 'len' uint32_t nonzero elements:
-            invalid == { i : hash[i - 1] >= 15 * Q }
+    in:     compacted list 'invalid' of InitPrehash, all hashes are
+            checked if more than MAX_INVALID were appended
 
-    in:     constant 'len':
-            length of 'invalid'
-
-    alt:    for each i in 'invalid':
-            hash[i - 1] := blake2b-256(hash[i - 1])
-
-    alt:    for each i in 'invalid':
-            invalid[i - 1] := (hash[i - 1] < 15 * Q)? 0: i
+    alt:    for each j in 'invalid' while hash[j] >= Q:
+            hash[j] := blake2b-256(hash[j])
 
 ********************************************************************************
 
@@ -55,6 +50,11 @@ FinalPrehash
 
 ********************************************************************************
 
+    Array 'hash' is stored as a structure of arrays (TABLE_POS): the high
+    64 bits of all elements, then their low 192 bits -- LITTLE ENDIAN.
+    Mining sums the high parts first and fetches low parts of surviving
+    nonces only.
+
 *******************************************************************************/
 
 #include "definitions.h"
@@ -65,7 +65,7 @@ __global__ void InitPrehash(
     const uint32_t * data,
     // hashes
     uint32_t * hashes,
-    // indices of invalid range hashes
+    // invalid range hashes: their number, then MAX_INVALID indices
     uint32_t * invalid
 );
 
@@ -85,18 +85,16 @@ __global__ void CompleteInitPrehash(
     const uctx_t * uctxs,
     // hashes
     uint32_t * hashes,
-    // indices of invalid range hashes
+    // invalid range hashes: their number, then MAX_INVALID indices
     uint32_t * invalid
 );
 
-// unfinalized hashes update
+// rehash of out of range hashes
 __global__ void UpdatePrehash(
     // hashes
     uint32_t * hashes,
-    // indices of invalid range hashes
-    uint32_t * invalid,
-    // length of invalid
-    const uint32_t len
+    // invalid range hashes: their number, then indices
+    const uint32_t * invalid
 );
 
 // hashes modulo Q 
@@ -122,8 +120,10 @@ int Prehash(
     uctx_t * uctxs,
     // hashes
     uint32_t * hashes,
-    // indices of invalid range hashes
-    uint32_t * invalid
+    // invalid range hashes: their number, then MAX_INVALID indices
+    uint32_t * invalid,
+    // stream to launch kernels in
+    cudaStream_t stream
 );
 
 #endif // PREHASH_H
@@ -15,7 +15,15 @@ int ReadConfig(
     char * skstr,
     char * from,
     char * to,
-    int * keep
+    int * keep,
+    int * cpu,
+    numa_t * numa,
+    int * dbuf,
+    char * cache,
+    char * push,
+    pool_t * pool,
+    int * telemetry,
+    char * profiles
 );
 
 // print public key
@@ -5,6 +5,15 @@
 
     REDUCTION -- Identification of Autolykos puzzle solution 
 
+********************************************************************************
+
+    Device reductions of uint32_t arrays in two passes: blocks of
+    REDUCTION_BLOCK_DIM threads reduce grid-strided parts of the array to
+    one item per block in the auxiliary array, then a single block reduces
+    those. Results are copied to the host synchronously.
+
+    Host counterparts are in CPUPRIMITIVES.
+
 *******************************************************************************/
 
 #include "definitions.h"
@@ -46,17 +55,23 @@ void ReduceSum(
     uint32_t blockSize
 );
 
-// find non zero item in array
+// find non zero item in array, any of them, 0 if there is none
 uint32_t FindNonZero(
+    // array
     uint32_t * data,
+    // auxiliary array of REDUCTION_BLOCK_DIM elements
     uint32_t * aux,
+    // length of array
     uint32_t inlen
 );
 
-// find sum of all elements in array
+// find sum of all elements in array mod 2^32
 uint32_t FindSum(
+    // array
     uint32_t * data,
+    // auxiliary array of REDUCTION_BLOCK_DIM elements
     uint32_t * aux,
+    // length of array
     uint32_t inlen
 );
 
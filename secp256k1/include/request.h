@@ -21,13 +21,11 @@ size_t WriteFunc(
     json_t * request
 );
 
-// lowercase letters convert to uppercase
-int ToUppercase(char * str);
-
 // CURL log error 
 void CurlLogError(CURLcode curl_status);
 
-// Parse GET request data
+// Parse GET request data, skipped if the body equals the latest one,
+// fields are found regardless of their order, case and extra fields
 int ParseRequest(
     json_t * oldreq ,
     json_t * newreq, 
@@ -35,21 +33,29 @@ int ParseRequest(
     int checkPubKey
 );
 
-// CURL http GET request
-int GetLatestBlock(
-    const char * from,
+// Parse block data and keep it in 'oldreq' if it is new
+int ApplyBlock(
     json_t * oldreq,
+    json_t * newreq,
     info_t * info,
     int checkPubKey
 );
 
-// CURL http POST request
-int PostPuzzleSolution(
-    const char * to,
+// form JSON of the puzzle solution
+void SolutionRequest(
     const char * pkstr,
     const uint8_t * w,
     const uint8_t * nonce,
-    const uint8_t * d
+    const uint8_t * d,
+    char * request
 );
 
+// CURL handle with headers and timeouts for http POST requests,
+// keeps connection to the node alive between requests
+CURL * InitPostHandle(const char * to, curl_slist ** headers);
+
+// CURL http POST request with a prepared handle, single attempt,
+// EXIT_FAILURE on transport or node server error
+int PostSolutionRequest(CURL * curl, const char * request);
+
 #endif // REQUEST_H
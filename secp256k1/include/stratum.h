@@ -0,0 +1,131 @@
+#ifndef STRATUM_H
+#define STRATUM_H
+
+/*******************************************************************************
+
+    STRATUM -- Pool protocol client
+
+********************************************************************************
+
+    Line-delimited JSON-RPC over one TCP connection to a pool, the pool URL
+    is "stratum+tcp://host:port". The session is:
+
+    -> {"id":1,"method":"mining.subscribe","params":["autolykos-miner"]}
+    <- {"id":1,"result":[[...],"<extranonce1>",<extranonce2 size>]}
+    -> {"id":2,"method":"mining.authorize","params":["<user>","<pass>"]}
+    <- {"id":2,"result":true}
+
+    and then pool notifications:
+
+    mining.set_difficulty  [<share difficulty>]
+    mining.set_extranonce  ["<extranonce1>",<extranonce2 size>]
+    mining.notify          ["<job>",<height>,"<msg>","<block bound>",<clean>]
+
+    Share difficulty is separate from the block bound: a share is a solution
+    with d < q / difficulty. Miners search with the larger of share and block
+    bounds, the pool tells blocks from shares.
+
+    Extranonce1 (hex) is the upper part of the 8 bytes nonce, extranonce2 of
+    the given size in bytes is its lower part. The lower part is the nonce
+    range of the job, which is split between miner threads so that they do
+    not overlap. A job with a new message or a new extranonce1 replaces the
+    message of the miners, so solutions of the replaced job are dropped.
+
+    Shares are sent from the submitter thread:
+
+    -> {"id":N,"method":"mining.submit",
+        "params":["<user>","<job>","<extranonce2>","<pk>","<w>","<d>"]}
+    <- {"id":N,"result":true}
+
+*******************************************************************************/
+
+#include "blocksource.h"
+#include "definitions.h"
+#include "submitter.h"
+#include <curl/curl.h>
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+class StratumSource: public BlockSource
+{
+public:
+    StratumSource(
+        // pool connection settings
+        const pool_t * pool,
+        // public key string
+        const char * pkstr
+    );
+    ~StratumSource(void);
+
+    const char * Name(void) const { return "stratum"; }
+    int Fetch(info_t * info, const int checkPubKey);
+    void Stats(source_stats_t * stats);
+    int Submit(const solution_t * sol);
+
+private:
+    int Connect(void);
+    void Disconnect(void);
+
+    // send one message, sendMutex is to be held
+    int Send(const std::string & line);
+
+    // handle one received message
+    void Handle(const std::string & line, info_t * info);
+    void Notify(const int params, const int numtoks, info_t * info);
+    int SetExtranonce(const int en1, const int size);
+
+    // put current job to the puzzle global info
+    void ApplyJob(info_t * info, const int mesChanged);
+
+    // pool host and port as CURL URL, credentials, public key
+    char address[MAX_URL_SIZE];
+    char user[MAX_URL_SIZE];
+    char pass[MAX_URL_SIZE];
+    char pkstr[PK_SIZE_4 + 1];
+
+    CURL * curl;
+    curl_socket_t sock;
+    std::atomic<int> connected;
+    int64_t retryAt;
+
+    // received bytes and the message being handled
+    std::string stream;
+    json_t msg;
+
+    // session nonce range
+    uint64_t extraNonce1;
+    uint32_t nonceBits;
+
+    // share bound, valid after the first difficulty
+    uint8_t shareBound[NUM_SIZE_8];
+    int hasDifficulty;
+
+    // latest job as received
+    std::string job;
+    uint8_t mes[NUM_SIZE_8];
+    uint8_t blockBound[NUM_SIZE_8];
+    int hasJob;
+
+    // job of the miners: shares of other messages are not sent
+    std::mutex jobMutex;
+    std::string jobId;
+    uint_t jobMesId;
+    uint32_t jobNonceBits;
+
+    // socket writes, submission ids and their send time
+    std::mutex sendMutex;
+    uint32_t nextId;
+    std::map<uint32_t, int64_t> pending;
+
+    std::atomic<uint32_t> submitted;
+    std::atomic<uint32_t> accepted;
+    std::atomic<uint32_t> rejected;
+    uint32_t jobs;
+    uint32_t responses;
+    double responseTime;
+};
+
+#endif // STRATUM_H
@@ -0,0 +1,129 @@
+#ifndef SUBMITTER_H
+#define SUBMITTER_H
+
+/*******************************************************************************
+
+    SUBMITTER -- Asynchronous puzzle solution submission
+
+********************************************************************************
+
+    Miner threads put found solutions into a bounded lock-free queue and go
+    on mining. A single submitter thread POSTs them to the node through one
+    CURL handle, so the connection to the node is reused. In pool mining
+    solutions are sent as shares through the pool connection instead.
+
+    A failed POST is retried up to MAX_POST_RETRIES times with exponential
+    backoff starting from SUBMIT_BACKOFF_MS. A solution is dropped without
+    POST once the message of its block is replaced (mesId changed), a bound
+    only change keeps it.
+
+    Latency of a submission is measured from the moment the solution was
+    found to the node response.
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include "metrics.h"
+#include <atomic>
+#include <thread>
+
+class BlockSource;
+
+// puzzle solution to submit
+struct solution_t
+{
+    // one-time public key
+    uint8_t w[PK_SIZE_8];
+    // nonce
+    uint8_t nonce[NONCE_SIZE_8];
+    // d
+    uint8_t d[NUM_SIZE_8];
+    // message id of the block
+    uint_t mesId;
+    // time the solution was found, ms since epoch
+    int64_t found;
+};
+
+// submission statistics
+struct submit_stats_t
+{
+    // accepted by the node transport (including rejected solutions)
+    uint32_t posted;
+    // POST failed after all retries
+    uint32_t failed;
+    // dropped as stale
+    uint32_t stale;
+    // dropped on full queue
+    uint32_t dropped;
+    // latency of the last posted solution, ms
+    uint32_t lastLatency;
+    // maximum latency of posted solutions, ms
+    uint32_t maxLatency;
+};
+
+class Submitter
+{
+public:
+    Submitter(
+        // solution posting URL
+        const char * to,
+        // public key string
+        const char * pkstr,
+        // puzzle global info
+        info_t * info,
+        // pool to send shares to, NULL for solo mining
+        BlockSource * pool = NULL
+    );
+    ~Submitter(void);
+
+    // start submitter thread
+    int Start(void);
+    // stop submitter thread, solutions left in the queue are dropped
+    void Stop(void);
+
+    // put solution to the queue, EXIT_FAILURE if the queue is full
+    int Enqueue(const solution_t * sol);
+
+    // current statistics
+    void Stats(submit_stats_t * stats) const;
+
+    // registry to observe submission latencies in, set before start
+    void SetMetrics(Metrics * metrics) { this->metrics = metrics; }
+
+private:
+    // queue slot, 'seq' tells whether it is ready for a writer or a reader
+    struct slot_t
+    {
+        std::atomic<uint32_t> seq;
+        solution_t sol;
+    };
+
+    int Dequeue(solution_t * sol);
+    void Run(void);
+    void Submit(void * curl, const solution_t * sol);
+
+    char to[MAX_URL_SIZE];
+    char pkstr[PK_SIZE_4 + 1];
+    info_t * info;
+    BlockSource * pool;
+    Metrics * metrics;
+
+    slot_t slots[SUBMIT_QUEUE_LEN];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+
+    // advanced on every enqueue, submitter thread sleeps on it
+    epoch_t queued;
+
+    std::thread thread;
+    std::atomic<int> running;
+
+    std::atomic<uint32_t> posted;
+    std::atomic<uint32_t> failed;
+    std::atomic<uint32_t> stale;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> lastLatency;
+    std::atomic<uint32_t> maxLatency;
+};
+
+#endif // SUBMITTER_H
@@ -0,0 +1,126 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/*******************************************************************************
+
+    TELEMETRY -- Background sampling of GPU telemetry
+
+********************************************************************************
+
+TelemetryProvider
+    Source of GPU readings:
+
+    Open         -- initialize the library, called by the sampler thread
+                    every interval until it succeeds
+    Sample       -- read all GPUs
+    Close        -- release the library
+
+NvmlProvider
+    NVML readings: name, UUID, PCI ids, fan speed, power usage and
+    temperature. NVML is initialized once for the lifetime of the sampler
+    instead of on every read.
+
+TelemetrySampler
+    Thread which samples the provider every given interval into a ring of
+    TELEMETRY_HISTORY snapshots. Readers take the latest snapshot or the
+    snapshots of a recent window under a mutex held only for copying, so
+    they never wait for the provider.
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// readings of one GPU
+struct gpu_sample_t
+{
+    char name[TELEMETRY_STR_LEN];
+    char uuid[TELEMETRY_STR_LEN];
+    // PCI bus id string and PCI bus and device ids
+    char busId[TELEMETRY_STR_LEN];
+    int pciBus;
+    int pciDevice;
+    // percent
+    uint32_t fan;
+    // W
+    uint32_t power;
+    // C
+    uint32_t temperature;
+};
+
+// readings of all GPUs at one moment
+struct telemetry_t
+{
+    // sample time, ms since epoch
+    int64_t time;
+    // provider failed, no readings
+    int error;
+    std::vector<gpu_sample_t> gpus;
+};
+
+class TelemetryProvider
+{
+public:
+    virtual ~TelemetryProvider(void) {}
+
+    virtual int Open(void) = 0;
+    virtual int Sample(std::vector<gpu_sample_t> * gpus) = 0;
+    virtual void Close(void) = 0;
+};
+
+#ifndef CPU_ONLY
+class NvmlProvider: public TelemetryProvider
+{
+public:
+    int Open(void);
+    int Sample(std::vector<gpu_sample_t> * gpus);
+    void Close(void);
+};
+#endif
+
+class TelemetrySampler
+{
+public:
+    TelemetrySampler(
+        // GPU readings source, owned by the caller
+        TelemetryProvider * provider,
+        // sampling interval, ms
+        const uint32_t interval
+    );
+    ~TelemetrySampler(void);
+
+    // start sampler thread
+    int Start(void);
+    // stop sampler thread
+    void Stop(void);
+
+    // latest snapshot, EXIT_FAILURE if there is none yet
+    int Latest(telemetry_t * snap);
+
+    // snapshots of the last 'ms' milliseconds, oldest first
+    void Window(const uint32_t ms, std::vector<telemetry_t> * snaps);
+
+private:
+    void Run(void);
+
+    TelemetryProvider * provider;
+    uint32_t interval;
+
+    // ring of snapshots, 'head' is the next to write
+    std::mutex mutex;
+    std::vector<telemetry_t> ring;
+    uint32_t head;
+    uint32_t size;
+
+    // advanced on stop, sampler thread sleeps on it
+    epoch_t wake;
+
+    std::thread thread;
+    std::atomic<int> running;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,80 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+/*******************************************************************************
+
+    TOPOLOGY -- NUMA nodes of the host, thread pinning and memory placement
+
+********************************************************************************
+
+    Nodes are read from /sys/devices/system/node, a host without it (or
+    not Linux) is one node of all cores. No libnuma is needed: threads are
+    pinned with pthread_setaffinity_np, memory is placed with the mbind
+    system call before it is first touched.
+
+NumaNodes
+    out:    nodes with their cores in order of node ids, one node at least
+
+PciNumaNode
+    out:    node of the PCI device domain:bus:device.0 from
+            /sys/bus/pci/devices, -1 if unknown
+
+PinThread
+    out:    calling thread runs on the given cores only, threads it starts
+            inherit that
+
+BindMemory
+    out:    pages of a page aligned buffer are placed on one node if it
+            has free memory, or interleaved over all nodes for node -1,
+            pages already touched are moved
+
+*******************************************************************************/
+
+#include "definitions.h"
+#include <stddef.h>
+#include <vector>
+
+// NUMA node of the host
+struct numa_node_t
+{
+    // node id
+    int id;
+    // logical cores of the node
+    std::vector<uint32_t> cpus;
+};
+
+// list of cores "0-3,8,10-11" to numbers
+int ParseCpuList(
+    // list
+    const char * in,
+    // cores
+    std::vector<uint32_t> * cpus
+);
+
+// NUMA nodes of the host, returns their number
+int NumaNodes(std::vector<numa_node_t> * nodes);
+
+// NUMA node of a PCI device, -1 if unknown
+int PciNumaNode(
+    // PCI domain
+    const int domain,
+    // PCI bus
+    const int bus,
+    // PCI device
+    const int device
+);
+
+// pin the calling thread to cores
+int PinThread(const std::vector<uint32_t> & cpus);
+
+// place pages of a buffer on a node, interleave over all nodes if -1
+int BindMemory(
+    // page aligned buffer
+    void * ptr,
+    // size of buffer
+    const size_t size,
+    // node id or -1
+    const int node
+);
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,110 @@
+#ifndef UCTXCACHE_H
+#define UCTXCACHE_H
+
+/*******************************************************************************
+
+    UCTXCACHE -- On-disk cache of unfinalized hash contexts
+
+********************************************************************************
+
+    Unfinalized hash contexts depend only on pk and the constant message,
+    so they are stored once per public key and reused on restart.
+
+    File layout:
+
+        header   -- uctx_cache_header_t, 64 bytes
+        checks   -- 'chunks' checksums of context chunks, 8 bytes each
+        padding  -- up to UCTX_CACHE_ALIGN boundary
+        uctxs    -- 'n' uctx_t elements
+
+    Header keeps magic, format version, sizeof(uctx_t), number of contexts,
+    chunk size and blake2b-256(pk). A file is rejected if any of them does
+    not match the running miner, or if any chunk checksum fails.
+
+UctxCacheLoad
+    in:     file 'name' is memory mapped, header is checked against 'pk'
+            and 'n'
+
+    out:    sink(arg, first, cnt, chunk) is called for each chunk after
+            its checksum is verified, chunk points into the mapping
+
+UctxCacheStore
+    in:     source(arg, first, cnt, chunk) fills each chunk
+
+    out:    file 'name' is written through a temporary file which is
+            renamed at the end, so readers never see a partial cache
+
+*******************************************************************************/
+
+#include "definitions.h"
+
+// cache file header
+struct uctx_cache_header_t
+{
+    // "AUTOUCTX"
+    char magic[8];
+    // UCTX_CACHE_VERSION
+    uint32_t version;
+    // sizeof(uctx_t)
+    uint32_t size;
+    // number of contexts
+    uint64_t n;
+    // number of contexts per chunk
+    uint32_t chunk;
+    // number of chunks
+    uint32_t chunks;
+    // blake2b-256(pk)
+    uint8_t pkhash[NUM_SIZE_8];
+};
+
+// chunk transfer between the file and a mining device
+typedef int (* uctx_chunk_t)(
+    // transfer argument
+    void * arg,
+    // index of the first context of the chunk
+    const uint32_t first,
+    // number of contexts in the chunk
+    const uint32_t cnt,
+    // contexts
+    uctx_t * chunk
+);
+
+// cache file name: dir/uctx-<hex of blake2b-256(pk) prefix>.bin
+void UctxCacheName(
+    // cache directory
+    const char * dir,
+    // public key
+    const uint8_t * pk,
+    // file name, MAX_URL_SIZE chars
+    char * name
+);
+
+// load cache file, EXIT_FAILURE if absent, stale or corrupted
+int UctxCacheLoad(
+    // file name
+    const char * name,
+    // public key
+    const uint8_t * pk,
+    // number of contexts
+    const uint32_t n,
+    // consumer of verified chunks
+    uctx_chunk_t sink,
+    // consumer argument
+    void * arg
+);
+
+// store cache file
+int UctxCacheStore(
+    // file name
+    const char * name,
+    // public key
+    const uint8_t * pk,
+    // number of contexts
+    const uint32_t n,
+    // producer of chunks
+    uctx_chunk_t source,
+    // producer argument
+    void * arg
+);
+
+#endif // UCTXCACHE_H
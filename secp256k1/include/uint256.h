@@ -0,0 +1,365 @@
+#ifndef UINT256_H
+#define UINT256_H
+
+/*******************************************************************************
+
+    UINT256 -- Fixed-width 256-bit unsigned arithmetic on the host
+
+********************************************************************************
+
+    A number is four 64-bit limbs, least significant first, which is the
+    memory layout of the LITTLE ENDIAN 256-bit numbers of the miner (bound,
+    d, secret keys, table elements) on little-endian hosts.
+
+    Construction, comparison and constants are constexpr. Carry chains use
+    _addcarry_u64 / _subborrow_u64 on x86-64 (adc / sbb, adcx / adox with
+    ADX enabled), wide multiplication uses unsigned __int128 or _umul128
+    (mul, mulx with BMI2 enabled), other platforms get portable code.
+
+    Modular arithmetic over Q lives with its users (CPUMINING), parsing
+    and formatting in CONVERSION.
+
+*******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#define U256_X64_INTRIN
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define U256_X64_INTRIN
+#endif
+
+// 256-bit unsigned number
+struct uint256_t
+{
+    // limbs -- LITTLE ENDIAN
+    uint64_t w[4];
+
+    constexpr uint256_t(void): w{0, 0, 0, 0} {}
+
+    constexpr explicit uint256_t(
+        const uint64_t w0,
+        const uint64_t w1 = 0,
+        const uint64_t w2 = 0,
+        const uint64_t w3 = 0
+    ): w{w0, w1, w2, w3} {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//  Limb primitives
+////////////////////////////////////////////////////////////////////////////////
+// r := a + b + carry, carry out
+static inline uint8_t AddCarry64(
+    const uint8_t carry,
+    const uint64_t a,
+    const uint64_t b,
+    uint64_t * r
+)
+{
+#ifdef U256_X64_INTRIN
+    unsigned long long t;
+    uint8_t c = _addcarry_u64(carry, a, b, &t);
+
+    *r = t;
+
+    return c;
+#else
+    uint64_t s = a + b;
+    uint64_t t = s + carry;
+
+    *r = t;
+
+    return (s < a) | (t < s);
+#endif
+}
+
+// r := a - b - borrow, borrow out
+static inline uint8_t SubBorrow64(
+    const uint8_t borrow,
+    const uint64_t a,
+    const uint64_t b,
+    uint64_t * r
+)
+{
+#ifdef U256_X64_INTRIN
+    unsigned long long t;
+    uint8_t c = _subborrow_u64(borrow, a, b, &t);
+
+    *r = t;
+
+    return c;
+#else
+    uint64_t s = a - b;
+    uint64_t t = s - borrow;
+
+    *r = t;
+
+    return (a < b) | (s < (uint64_t)borrow);
+#endif
+}
+
+// a * b + c + d, high limb to 'hi', never overflows
+static inline uint64_t MulAdd64(
+    const uint64_t a,
+    const uint64_t b,
+    const uint64_t c,
+    const uint64_t d,
+    uint64_t * hi
+)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = (unsigned __int128)a * b + c + d;
+
+    *hi = (uint64_t)(p >> 64);
+
+    return (uint64_t)p;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t h;
+    uint64_t l = _umul128(a, b, &h);
+
+    h += _addcarry_u64(0, l, c, (unsigned long long *)&l);
+    h += _addcarry_u64(0, l, d, (unsigned long long *)&l);
+    *hi = h;
+
+    return l;
+#else
+    const uint64_t a0 = (uint32_t)a;
+    const uint64_t a1 = a >> 32;
+    const uint64_t b0 = (uint32_t)b;
+    const uint64_t b1 = b >> 32;
+
+    uint64_t p00 = a0 * b0;
+    uint64_t p01 = a0 * b1;
+    uint64_t p10 = a1 * b0;
+    uint64_t p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    uint64_t l = (mid << 32) | (uint32_t)p00;
+    uint64_t h = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+
+    l += c;
+    h += l < c;
+    l += d;
+    h += l < d;
+    *hi = h;
+
+    return l;
+#endif
+}
+
+// (hi, lo) / d with hi < d, remainder to 'rem'
+static inline uint64_t Div128(
+    const uint64_t hi,
+    const uint64_t lo,
+    const uint64_t d,
+    uint64_t * rem
+)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 n = ((unsigned __int128)hi << 64) | lo;
+
+    *rem = (uint64_t)(n % d);
+
+    return (uint64_t)(n / d);
+#elif defined(_MSC_VER) && defined(_M_X64) && _MSC_VER >= 1920
+    return _udiv128(hi, lo, d, rem);
+#else
+    uint64_t r = hi;
+    uint64_t q = 0;
+
+    // binary long division, remainder may take 65 bits before subtraction
+    for (int i = 63; i >= 0; --i)
+    {
+        int carry = (int)(r >> 63);
+
+        r = (r << 1) | ((lo >> i) & 1);
+
+        if (carry || r >= d)
+        {
+            r -= d;
+            q |= (uint64_t)1 << i;
+        }
+    }
+
+    *rem = r;
+
+    return q;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Comparison
+////////////////////////////////////////////////////////////////////////////////
+// -1, 0 or 1 as a is less than, equal to or greater than b
+constexpr int U256Compare(
+    const uint256_t & a,
+    const uint256_t & b,
+    const int i = 3
+)
+{
+    return (a.w[i] != b.w[i])?
+        ((a.w[i] < b.w[i])? -1: 1):
+        ((i)? U256Compare(a, b, i - 1): 0);
+}
+
+constexpr int U256Less(const uint256_t & a, const uint256_t & b)
+{
+    return U256Compare(a, b) < 0;
+}
+
+constexpr int U256IsZero(const uint256_t & a)
+{
+    return !(a.w[0] | a.w[1] | a.w[2] | a.w[3]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Arithmetic
+////////////////////////////////////////////////////////////////////////////////
+// r := a + b mod 2^256, carry out
+static inline uint8_t U256Add(
+    const uint256_t & a,
+    const uint256_t & b,
+    uint256_t * r
+)
+{
+    uint8_t c = AddCarry64(0, a.w[0], b.w[0], r->w + 0);
+
+    c = AddCarry64(c, a.w[1], b.w[1], r->w + 1);
+    c = AddCarry64(c, a.w[2], b.w[2], r->w + 2);
+
+    return AddCarry64(c, a.w[3], b.w[3], r->w + 3);
+}
+
+// r := a - b mod 2^256, borrow out
+static inline uint8_t U256Sub(
+    const uint256_t & a,
+    const uint256_t & b,
+    uint256_t * r
+)
+{
+    uint8_t c = SubBorrow64(0, a.w[0], b.w[0], r->w + 0);
+
+    c = SubBorrow64(c, a.w[1], b.w[1], r->w + 1);
+    c = SubBorrow64(c, a.w[2], b.w[2], r->w + 2);
+
+    return SubBorrow64(c, a.w[3], b.w[3], r->w + 3);
+}
+
+// r := a * b, 8 limbs -- LITTLE ENDIAN
+static inline void U256MulWide(
+    const uint256_t & a,
+    const uint256_t & b,
+    uint64_t * r
+)
+{
+    memset(r, 0, 8 * sizeof(uint64_t));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        uint64_t carry = 0;
+
+        for (int j = 0; j < 4; ++j)
+        {
+            r[i + j] = MulAdd64(a.w[i], b.w[j], r[i + j], carry, &carry);
+        }
+
+        r[i + 4] = carry;
+    }
+
+    return;
+}
+
+// r := r * m + a mod 2^256, limb carried out
+static inline uint64_t U256MulAddSmall(
+    uint256_t * r,
+    const uint64_t m,
+    const uint64_t a
+)
+{
+    uint64_t carry = a;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        r->w[i] = MulAdd64(r->w[i], m, carry, 0, &carry);
+    }
+
+    return carry;
+}
+
+// r := r / d, remainder returned
+static inline uint64_t U256DivSmall(
+    uint256_t * r,
+    const uint64_t d
+)
+{
+    uint64_t rem = 0;
+
+    for (int i = 3; i >= 0; --i)
+    {
+        r->w[i] = Div128(rem, r->w[i], d, &rem);
+    }
+
+    return rem;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Byte order
+////////////////////////////////////////////////////////////////////////////////
+// number of 32 bytes -- LITTLE ENDIAN
+static inline uint256_t U256FromLittleEndian(const void * in)
+{
+    uint256_t r;
+
+    memcpy(r.w, in, sizeof(r.w));
+
+    return r;
+}
+
+static inline void U256ToLittleEndian(
+    const uint256_t & a,
+    void * out
+)
+{
+    memcpy(out, a.w, sizeof(a.w));
+
+    return;
+}
+
+// number of 32 bytes -- BIG ENDIAN
+static inline uint256_t U256FromBigEndian(const void * in)
+{
+    const uint8_t * p = (const uint8_t *)in;
+    uint256_t r;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint8_t * q = p + ((3 - i) << 3);
+
+        r.w[i]
+            = ((uint64_t)q[0] << 56) | ((uint64_t)q[1] << 48)
+            | ((uint64_t)q[2] << 40) | ((uint64_t)q[3] << 32)
+            | ((uint64_t)q[4] << 24) | ((uint64_t)q[5] << 16)
+            | ((uint64_t)q[6] << 8) | (uint64_t)q[7];
+    }
+
+    return r;
+}
+
+static inline void U256ToBigEndian(
+    const uint256_t & a,
+    void * out
+)
+{
+    uint8_t * p = (uint8_t *)out;
+
+    for (int i = 0; i < 32; ++i)
+    {
+        p[i] = (uint8_t)(a.w[(31 - i) >> 3] >> (((31 - i) & 7) << 3));
+    }
+
+    return;
+}
+
+#endif // UINT256_H
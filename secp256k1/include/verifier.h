@@ -0,0 +1,84 @@
+#ifndef VERIFIER_H
+#define VERIFIER_H
+
+/*******************************************************************************
+
+    VERIFIER -- Host verification of solutions found by a mining device
+
+********************************************************************************
+
+    Overclocked devices produce wrong solutions. Every solution is checked
+    on the host before it is submitted: d of the nonce is recomputed from
+    scratch with the host reference implementation, only the K_LEN table
+    elements of the nonce are hashed, and it must equal d of the device and
+    be below the bound. The verifier keeps a copy of the block data of the
+    device front buffer for it.
+
+    Derating: VERIFY_FAULT_LIMIT faults within VERIFY_FAULT_WINDOW
+    iterations raise the derate level up to VERIFY_MAX_DERATE. At level L
+    the miner thread idles for L * VERIFY_DERATE_IDLE percent of the
+    iteration time after every iteration, which lowers power and
+    temperature of the device. The level is kept until restart.
+
+*******************************************************************************/
+
+#include "definitions.h"
+
+class SolutionVerifier
+{
+public:
+    SolutionVerifier(void);
+
+    // key-pair of the miner
+    void SetKeys(
+        // public key
+        const uint8_t * pk,
+        // secret key
+        const uint8_t * sk
+    );
+
+    // block mined by the device
+    void SetBlock(
+        // message
+        const uint8_t * mes,
+        // one-time secret key
+        const uint8_t * x,
+        // one-time public key
+        const uint8_t * w
+    );
+
+    void SetBound(
+        // boundary for puzzle
+        const uint8_t * bound
+    );
+
+    // 1 if the solution is valid, a fault is counted otherwise
+    int Verify(
+        // solution of the device
+        const result_t & result
+    );
+
+    // end of a mining iteration
+    void Iteration(void);
+
+    // current derate level, 0 if the device is not derated
+    uint32_t Derate(void) const { return derate; }
+
+    // idle time after an iteration of the given duration
+    int64_t IdleUs(const int64_t iterUs) const
+    {
+        return iterUs * derate * VERIFY_DERATE_IDLE / 100;
+    }
+
+private:
+    // data: pk || mes || w || padding || x || sk
+    uint32_t data[DATA_SIZE_8 >> 2];
+    uint32_t bound[NUM_SIZE_32];
+
+    // faults and iterations of the current window
+    uint32_t faults;
+    uint32_t iterations;
+    uint32_t derate;
+};
+
+#endif // VERIFIER_H
@@ -0,0 +1,336 @@
+// autotune.cc
+
+/*******************************************************************************
+
+    AUTOTUNE -- Mining geometry tuning and per-device profiles
+
+*******************************************************************************/
+
+#include "../include/autotune.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using namespace std::chrono;
+
+// miner threads of different devices share the profiles file
+static std::mutex profilesMutex;
+
+////////////////////////////////////////////////////////////////////////////////
+//  Profiles file
+////////////////////////////////////////////////////////////////////////////////
+// split profile line, EXIT_FAILURE if malformed
+static int ParseProfile(
+    const std::string & line,
+    geometry_t * geometry,
+    std::string * key
+)
+{
+    int pos = 0;
+
+    if (
+        sscanf(
+            line.c_str(), "%u %u %n", &geometry->blockDim, &geometry->nonces,
+            &pos
+        ) != 2 || !pos || (size_t)pos >= line.size()
+    )
+    {
+        return EXIT_FAILURE;
+    }
+
+    *key = line.substr(pos);
+
+    return EXIT_SUCCESS;
+}
+
+int LoadProfile(
+    const char * fileName,
+    const std::string & key,
+    geometry_t * geometry
+)
+{
+    std::lock_guard<std::mutex> lock(profilesMutex);
+
+    std::ifstream in(fileName);
+    std::string line;
+    std::string stored;
+    geometry_t geom;
+
+    while (std::getline(in, line))
+    {
+        if (ParseProfile(line, &geom, &stored) == EXIT_SUCCESS && stored == key)
+        {
+            *geometry = geom;
+
+            return EXIT_SUCCESS;
+        }
+    }
+
+    return EXIT_FAILURE;
+}
+
+int StoreProfile(
+    const char * fileName,
+    const std::string & key,
+    const geometry_t & geometry
+)
+{
+    std::lock_guard<std::mutex> lock(profilesMutex);
+
+    std::vector<std::string> lines;
+    std::string line;
+    std::string stored;
+    geometry_t geom;
+
+    {
+        std::ifstream in(fileName);
+
+        // profiles of other devices are kept
+        while (std::getline(in, line))
+        {
+            if (
+                ParseProfile(line, &geom, &stored) == EXIT_SUCCESS
+                && stored != key
+            )
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    // unique temporary file for concurrent miner processes
+    char tmp[MAX_URL_SIZE + 64];
+
+    snprintf(
+        tmp, sizeof(tmp), "%s.%d.%zx.tmp", fileName, (int)getpid(),
+        std::hash<std::thread::id>()(std::this_thread::get_id())
+    );
+
+    FILE * out = fopen(tmp, "w");
+
+    if (!out)
+    {
+        LOG(ERROR) << "Failed to create geometry profiles " << tmp;
+
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+
+    for (uint32_t i = 0; i < lines.size(); ++i)
+    {
+        if (fprintf(out, "%s\n", lines[i].c_str()) < 0) { status = EXIT_FAILURE; }
+    }
+
+    if (
+        fprintf(
+            out, "%u %u %s\n", geometry.blockDim, geometry.nonces, key.c_str()
+        ) < 0
+    )
+    {
+        status = EXIT_FAILURE;
+    }
+
+    if (fclose(out)) { status = EXIT_FAILURE; }
+
+    if (status == EXIT_SUCCESS && rename(tmp, fileName))
+    {
+        status = EXIT_FAILURE;
+    }
+
+    if (status != EXIT_SUCCESS)
+    {
+        LOG(ERROR) << "Failed to store geometry profiles " << fileName;
+
+        remove(tmp);
+    }
+
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Sweep of candidate geometries
+////////////////////////////////////////////////////////////////////////////////
+// duration of 'iters' iterations, us
+static int TimeIterations(
+    MiningBackend * backend,
+    const uint64_t base,
+    const uint32_t iters,
+    int64_t * us
+)
+{
+    result_t results[MAX_RESULTS];
+    uint32_t count;
+    uint32_t lost;
+
+    steady_clock::time_point start = steady_clock::now();
+
+    for (uint32_t i = 0; i < iters; ++i)
+    {
+        if (
+            backend->Mine(base + (uint64_t)i * backend->NoncesPerIter())
+            != EXIT_SUCCESS
+            || backend->FetchResults(results, &count, &lost) != EXIT_SUCCESS
+        )
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    *us = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    return EXIT_SUCCESS;
+}
+
+int SweepGeometry(
+    MiningBackend * backend,
+    const uint64_t base,
+    const uint32_t maxIterMs,
+    geometry_t * best,
+    double * hashrate
+)
+{
+    const int64_t maxUs = (int64_t)maxIterMs * 1000;
+    std::vector<geometry_t> candidates;
+
+    backend->Geometries(&candidates);
+
+    if (candidates.empty()) { return EXIT_FAILURE; }
+
+    // smallest candidate if none fits into the limit
+    *best = candidates[0];
+    *hashrate = 0;
+
+    for (uint32_t c = 1; c < candidates.size(); ++c)
+    {
+        if (candidates[c].nonces < best->nonces) { *best = candidates[c]; }
+    }
+
+    // block dimension with a too long iteration
+    uint32_t slowDim = 0;
+
+    for (uint32_t c = 0; c < candidates.size(); ++c)
+    {
+        const geometry_t & geom = candidates[c];
+        int64_t us;
+
+        if (
+            (slowDim && geom.blockDim == slowDim)
+            || backend->SetGeometry(geom) != EXIT_SUCCESS
+        )
+        {
+            continue;
+        }
+
+        slowDim = 0;
+
+        // warm-up iteration, larger candidates are only slower
+        if (TimeIterations(backend, base, 1, &us) != EXIT_SUCCESS)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (us <= maxUs)
+        {
+            if (TimeIterations(backend, base, TUNE_ITERS, &us) != EXIT_SUCCESS)
+            {
+                return EXIT_FAILURE;
+            }
+
+            us /= TUNE_ITERS;
+        }
+
+        VLOG(1) << backend->Name() << " geometry: block " << geom.blockDim
+            << ", " << geom.nonces << " nonces, " << us << " us per iteration";
+
+        if (us > maxUs)
+        {
+            slowDim = geom.blockDim;
+
+            continue;
+        }
+
+        // MH/s
+        double rate = (double)geom.nonces / ((us)? us: 1);
+
+        if (rate > *hashrate)
+        {
+            *best = geom;
+            *hashrate = rate;
+        }
+    }
+
+    return backend->SetGeometry(*best);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Stored or swept geometry of a device
+////////////////////////////////////////////////////////////////////////////////
+int Autotune(
+    MiningBackend * backend,
+    const char * profiles,
+    const uint64_t base,
+    const uint8_t * bound
+)
+{
+    const std::string key = backend->ProfileKey();
+    geometry_t geom;
+    double hashrate;
+
+    if (!profiles[0] || key.empty()) { return EXIT_SUCCESS; }
+
+    if (
+        LoadProfile(profiles, key, &geom) == EXIT_SUCCESS
+        && backend->SetGeometry(geom) == EXIT_SUCCESS
+    )
+    {
+        LOG(INFO) << backend->Name() << " uses stored geometry: block "
+            << geom.blockDim << ", " << geom.nonces << " nonces";
+
+        return EXIT_SUCCESS;
+    }
+
+    LOG(INFO) << backend->Name() << " tuning mining geometry for " << key;
+
+    uint8_t zero[NUM_SIZE_8];
+
+    memset(zero, 0, NUM_SIZE_8);
+
+    if (
+        backend->UploadBound(zero) != EXIT_SUCCESS
+        || SweepGeometry(backend, base, MAX_ITER_MS, &geom, &hashrate)
+        != EXIT_SUCCESS
+        || backend->UploadBound(bound) != EXIT_SUCCESS
+    )
+    {
+        LOG(ERROR) << backend->Name() << " geometry tuning failed";
+
+        return EXIT_FAILURE;
+    }
+
+    LOG(INFO) << backend->Name() << " tuned geometry: block " << geom.blockDim
+        << ", " << geom.nonces << " nonces, " << hashrate << " MH/s";
+
+    // failure to store only costs a sweep on next start
+    StoreProfile(profiles, key, geom);
+
+    return EXIT_SUCCESS;
+}
+
+// autotune.cc
@@ -0,0 +1,53 @@
+// backend.cc
+
+/*******************************************************************************
+
+    BACKEND -- Mining device abstraction
+
+*******************************************************************************/
+
+#include "../include/backend.h"
+#include "../include/cpubackend.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+
+#ifndef CPU_ONLY
+#include "../include/cudabackend.h"
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//  Enumerate available mining devices
+////////////////////////////////////////////////////////////////////////////////
+int EnumerateBackends(
+    // use CPU mining
+    const int cpuMining,
+    // placement of the CPU table over NUMA nodes
+    const numa_t numa,
+    // created backends, owned by the caller
+    std::vector<MiningBackend *> * backends
+)
+{
+    int status = EXIT_SUCCESS;
+
+#ifndef CPU_ONLY
+    status = CudaBackend::Enumerate(backends);
+#endif
+
+    if (status != EXIT_SUCCESS && !cpuMining)
+    {
+        LOG(ERROR) << "Error checking GPU";
+        return EXIT_FAILURE;
+    }
+
+    LOG(INFO) << "Using " << backends->size() << " GPU devices";
+
+    if (cpuMining)
+    {
+        LOG(INFO) << "Using CPU mining";
+        backends->push_back(new CpuBackend(CPU_THREADS, numa));
+    }
+
+    return (backends->empty())? EXIT_FAILURE: EXIT_SUCCESS;
+}
+
+// backend.cc
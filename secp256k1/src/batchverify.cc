@@ -0,0 +1,298 @@
+// batchverify.cc
+
+/*******************************************************************************
+
+    BATCHVERIFY -- Pool-side verification of submitted solutions
+
+*******************************************************************************/
+
+#include "../include/batchverify.h"
+#include "../include/conversion.h"
+#include "../include/cpumining.h"
+#include "../include/cpuprimitives.h"
+#include "../include/definitions.h"
+#include "../include/jsmn.h"
+#include "../include/uint256.h"
+#include <ctype.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//  Submission parsing
+////////////////////////////////////////////////////////////////////////////////
+// token name check
+static int KeyEq(
+    const char * in,
+    const jsmntok_t & tok,
+    const char * key
+)
+{
+    return tok.type == JSMN_STRING
+        && (int)strlen(key) == tok.end - tok.start
+        && !strncmp(in + tok.start, key, tok.end - tok.start);
+}
+
+// hexadecimal string of exactly 'outlen' bytes to big endian
+static int ParseHex(
+    const char * in,
+    const uint32_t inlen,
+    uint8_t * out,
+    const uint32_t outlen
+)
+{
+    if (inlen != (outlen << 1)) { return EXIT_FAILURE; }
+
+    for (uint32_t i = 0; i < inlen; ++i)
+    {
+        if (!isxdigit((unsigned char)in[i])) { return EXIT_FAILURE; }
+    }
+
+    HexStrToBigEndian(in, inlen, out, outlen);
+
+    return EXIT_SUCCESS;
+}
+
+// decimal number, optionally with "e0" suffix, to 256-bit little endian
+static int ParseDec(
+    const char * in,
+    uint32_t inlen,
+    uint32_t * out
+)
+{
+    uint256_t num;
+
+    if (inlen > 2 && in[inlen - 2] == 'e' && in[inlen - 1] == '0')
+    {
+        inlen -= 2;
+    }
+
+    if (DecStrToUint256(in, inlen, &num) != EXIT_SUCCESS)
+    {
+        return EXIT_FAILURE;
+    }
+
+    U256ToLittleEndian(num, out);
+
+    return EXIT_SUCCESS;
+}
+
+int ParseSubmission(
+    const char * in,
+    const uint32_t inlen,
+    submission_t * sub
+)
+{
+    jsmn_parser parser;
+    jsmntok_t toks[VERIFY_MAX_TOKENS];
+
+    jsmn_init(&parser);
+
+    int count = jsmn_parse(&parser, in, inlen, toks, VERIFY_MAX_TOKENS);
+
+    if (count < 1 || toks[0].type != JSMN_OBJECT) { return EXIT_FAILURE; }
+
+    // fields found: pk, w, n, d, msg, b
+    uint32_t found = 0;
+
+    for (int t = 1; t + 1 < count; t += 2)
+    {
+        const jsmntok_t & val = toks[t + 1];
+        const char * start = in + val.start;
+        const uint32_t len = val.end - val.start;
+        int status = EXIT_SUCCESS;
+
+        // nested values are not expected
+        if (val.type != JSMN_STRING && val.type != JSMN_PRIMITIVE)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (KeyEq(in, toks[t], "pk"))
+        {
+            status = ParseHex(start, len, sub->pk, PK_SIZE_8);
+            found |= 1;
+        }
+        else if (KeyEq(in, toks[t], "w"))
+        {
+            status = ParseHex(start, len, sub->w, PK_SIZE_8);
+            found |= 2;
+        }
+        else if (KeyEq(in, toks[t], "n"))
+        {
+            uint8_t nonce[NONCE_SIZE_8];
+
+            status = ParseHex(start, len, nonce, NONCE_SIZE_8);
+
+            // nonce string is big endian
+            sub->nonce = 0;
+
+            for (int i = 0; i < NONCE_SIZE_8; ++i)
+            {
+                sub->nonce = (sub->nonce << 8) | nonce[i];
+            }
+
+            found |= 4;
+        }
+        else if (KeyEq(in, toks[t], "d"))
+        {
+            status = ParseDec(start, len, sub->d);
+            found |= 8;
+        }
+        else if (KeyEq(in, toks[t], "msg"))
+        {
+            status = ParseHex(start, len, sub->mes, NUM_SIZE_8);
+            found |= 16;
+        }
+        else if (KeyEq(in, toks[t], "b"))
+        {
+            status = ParseDec(start, len, sub->bound);
+            found |= 32;
+        }
+
+        if (status != EXIT_SUCCESS) { return EXIT_FAILURE; }
+    }
+
+    return (found == 63)? EXIT_SUCCESS: EXIT_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Verifier
+////////////////////////////////////////////////////////////////////////////////
+SubmissionVerifier::SubmissionVerifier(void)
+{
+    FUNCTION_CALL(
+        group, EC_GROUP_new_by_curve_name(NID_secp256k1), ERROR_OPENSSL
+    );
+    FUNCTION_CALL(ctx, BN_CTX_new(), ERROR_OPENSSL);
+    FUNCTION_CALL(pk, EC_POINT_new(group), ERROR_OPENSSL);
+    FUNCTION_CALL(w, EC_POINT_new(group), ERROR_OPENSSL);
+    FUNCTION_CALL(lhs, EC_POINT_new(group), ERROR_OPENSSL);
+    FUNCTION_CALL(order, BN_new(), ERROR_OPENSSL);
+    FUNCTION_CALL(dn, BN_new(), ERROR_OPENSSL);
+    FUNCTION_CALL(fn, BN_new(), ERROR_OPENSSL);
+
+    CALL(EC_GROUP_get_order(group, order, ctx), ERROR_OPENSSL);
+
+    memset(data, 0, sizeof(data));
+
+    // x = 1 gives raw elements
+    data[COUPLED_PK_SIZE_32 + NUM_SIZE_32] = 1;
+}
+
+SubmissionVerifier::~SubmissionVerifier(void)
+{
+    BN_free(fn);
+    BN_free(dn);
+    BN_free(order);
+    EC_POINT_free(lhs);
+    EC_POINT_free(w);
+    EC_POINT_free(pk);
+    BN_CTX_free(ctx);
+    EC_GROUP_free(group);
+}
+
+void SubmissionVerifier::SumElements(
+    const submission_t & sub,
+    uint32_t * f
+)
+{
+    uint8_t hash[NUM_SIZE_8];
+    uint32_t ind[K_LEN];
+    uint32_t elems[K_LEN * NUM_SIZE_32];
+    uint32_t bound[NUM_SIZE_32];
+
+    memcpy(data, sub.pk, PK_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8, sub.mes, NUM_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8 + NUM_SIZE_8, sub.w, PK_SIZE_8);
+
+    CpuBlakeHash(sub.mes, sub.nonce, hash);
+    CpuGenIndices(hash, ind);
+
+    for (int k = 0; k < K_LEN; ++k)
+    {
+        CpuHashElement(data, NULL, ind[k], elems + k * NUM_SIZE_32);
+    }
+
+    // no bound, zero secret key
+    memset(bound, 0xFF, NUM_SIZE_8);
+
+    CpuSumModQ(bound, data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, elems, f);
+
+    return;
+}
+
+// little endian 256-bit number to BIGNUM
+static int LittleEndianToBN(
+    const uint32_t * in,
+    BIGNUM * out
+)
+{
+    uint8_t be[NUM_SIZE_8];
+
+    U256ToBigEndian(U256FromLittleEndian(in), be);
+
+    return BN_bin2bn(be, NUM_SIZE_8, out) != NULL;
+}
+
+int SubmissionVerifier::Verify(const submission_t & sub)
+{
+    //========================================================================//
+    //  d < bound
+    //========================================================================//
+    if (
+        !U256Less(U256FromLittleEndian(sub.d), U256FromLittleEndian(sub.bound))
+    )
+    {
+        return 0;
+    }
+
+    //========================================================================//
+    //  w^f = g^d * pk
+    //========================================================================//
+    // keys not on the curve are invalid
+    if (
+        !EC_POINT_oct2point(group, pk, sub.pk, PK_SIZE_8, ctx)
+        || !EC_POINT_oct2point(group, w, sub.w, PK_SIZE_8, ctx)
+    )
+    {
+        return 0;
+    }
+
+    uint32_t f[NUM_SIZE_32];
+
+    SumElements(sub, f);
+
+    // g^d * w^(-f) = pk^(-1), one multi-scalar multiplication
+    return LittleEndianToBN(sub.d, dn) && LittleEndianToBN(f, fn)
+        && BN_sub(fn, order, fn)
+        && EC_POINT_mul(group, lhs, dn, w, fn, ctx)
+        && EC_POINT_invert(group, pk, ctx)
+        && !EC_POINT_cmp(group, lhs, pk, ctx);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Batch verification
+////////////////////////////////////////////////////////////////////////////////
+void VerifyBatch(
+    const submission_t * subs,
+    const uint32_t count,
+    uint8_t * valid,
+    const uint32_t threads
+)
+{
+    ParallelFor(
+        count, threads,
+        [&](const uint32_t, const uint32_t first, const uint32_t last)
+        {
+            SubmissionVerifier verifier;
+
+            for (uint32_t i = first; i < last; ++i)
+            {
+                valid[i] = (uint8_t)verifier.Verify(subs[i]);
+            }
+        }
+    );
+
+    return;
+}
+
+// batchverify.cc
@@ -0,0 +1,656 @@
+// bench.cu
+
+/*******************************************************************************
+
+    BENCH -- Micro-benchmarks of the host hot paths
+
+********************************************************************************
+
+    Host only, no CUDA device is needed. Every benchmark is repeated with a
+    doubling number of operations until it runs for the minimal time, the
+    last run is reported. Results are printed to stdout as JSON:
+
+    {
+        "isa": "avx2", "threads": 8, "tableBits": 22,
+        "pages": "transparent huge pages, 128 of 128 MiB",
+        "benchmarks": [
+            { "name": "blake2b_single", "ops": 4194304, "ns": 875000000,
+              "nsPerOp": 208.6, "opsPerSec": 4793490.3 },
+            ...
+        ]
+    }
+
+    Usage: bench.out [-t MIN_MS] [-b TABLE_BITS] [-p]
+
+    -t      minimal time of every benchmark, ms (default 500)
+    -b      log2 of the number of elements of the gathered table and of the
+            arrays of parallel primitives (default 22, N_LEN is 2^26)
+    -p      also build the whole table of N_LEN elements with all threads
+            (2 GiB of host memory) and mine over it
+
+    Gathered table is mapped as the mining table (see HOSTARENA), "pages"
+    are those obtained for it.
+
+    Gathers also report "mlp", the memory-level parallelism achieved: the
+    number of random reads in flight on average, estimated as reads per
+    operation times the latency of a single miss (gather_latency) over the
+    time per operation. With all threads (block_mining) it is the total of
+    all cores. "gbPerSec" is the bandwidth of gathers, a cache line per
+    read.
+
+    The compact part of the table is also gathered by a thread on cores of
+    every NUMA node from a copy in memory of every node (see TOPOLOGY),
+    gather_reject_node<c>_mem<m>: local pairs against remote ones.
+
+*******************************************************************************/
+
+#include "../include/batchverify.h"
+#include "../include/conversion.h"
+#include "../include/cpumining.h"
+#include "../include/cpuprimitives.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include "../include/hostarena.h"
+#include "../include/multiblake.h"
+#include "../include/request.h"
+#include "../include/topology.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std::chrono;
+
+// benchmark result
+struct bench_t
+{
+    std::string name;
+    uint64_t ops;
+    uint64_t ns;
+    // random table reads per operation, 0 if not a gather
+    uint32_t reads;
+};
+
+// results of operations are xored into it, so they are not optimized away
+static volatile uint32_t sink = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+//  Run operation op(i) with doubling number of iterations
+////////////////////////////////////////////////////////////////////////////////
+template<typename Func>
+static void Bench(
+    // benchmark name
+    const char * name,
+    // minimal run time, ms
+    const uint32_t minMs,
+    // operation
+    Func op,
+    // results
+    std::vector<bench_t> * results
+)
+{
+    bench_t res;
+    uint64_t ops = 1;
+
+    res.name = name;
+    res.reads = 0;
+
+    do
+    {
+        steady_clock::time_point start = steady_clock::now();
+
+        for (uint64_t i = 0; i < ops; ++i) { op(i); }
+
+        res.ops = ops;
+        res.ns = duration_cast<nanoseconds>(
+            steady_clock::now() - start
+        ).count();
+
+        ops <<= 1;
+    }
+    while (res.ns < (uint64_t)minMs * 1000000);
+
+    results->push_back(res);
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Main
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char ** argv)
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    // stdout is for results only
+    el::Loggers::reconfigureAllLoggers(
+        el::ConfigurationType::ToStandardOutput, "false"
+    );
+    el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToFile, "false");
+
+    uint32_t minMs = 500;
+    uint32_t tableBits = 22;
+    int fullPrehash = 0;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        if (!strcmp(argv[a], "-t") && a + 1 < argc)
+        {
+            minMs = strtoul(argv[++a], NULL, 10);
+        }
+        else if (!strcmp(argv[a], "-b") && a + 1 < argc)
+        {
+            tableBits = strtoul(argv[++a], NULL, 10);
+        }
+        else if (!strcmp(argv[a], "-p")) { fullPrehash = 1; }
+        else
+        {
+            fprintf(
+                stderr, "Usage: %s [-t MIN_MS] [-b TABLE_BITS] [-p]\n", argv[0]
+            );
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (tableBits < 5 || tableBits > 26)
+    {
+        fprintf(stderr, "Table bits must be in [5, 26]\n");
+
+        return EXIT_FAILURE;
+    }
+
+    //========================================================================//
+    //  Inputs
+    //========================================================================//
+    std::vector<bench_t> results;
+
+    // data: pk || mes || w || padding || x || sk
+    std::vector<uint32_t> data(DATA_SIZE_8 / sizeof(uint32_t) + 1, 0);
+    const uint8_t * mes = (const uint8_t *)data.data() + PK_SIZE_8;
+    const uint32_t * sk = data.data() + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32;
+
+    for (uint32_t i = 0; i < COUPLED_PK_SIZE_32 + 3 * NUM_SIZE_32; ++i)
+    {
+        data[i] = 0x9E3779B9 * (i + 1);
+    }
+
+    // top words of x and sk less than Q
+    data[COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32 - 1] = 0x7FFFFFFF;
+    data[COUPLED_PK_SIZE_32 + 3 * NUM_SIZE_32 - 1] = 0x7FFFFFFF;
+
+    uint32_t bound[NUM_SIZE_32];
+
+    memset(bound, 0, NUM_SIZE_8);
+    bound[NUM_SIZE_32 - 1] = 0x00010000;
+
+    // gathered table, on pages of the mining table
+    HostArena arena;
+    const uint32_t tableMask = (1 << tableBits) - 1;
+    const uint64_t tableLen = ((uint64_t)tableMask + 1) * NUM_SIZE_32;
+    uint32_t * table = (uint32_t *)arena.Acquire(tableLen * sizeof(uint32_t));
+    uint64_t * chase = (uint64_t *)arena.Acquire(
+        ((uint64_t)tableMask + 1) * sizeof(uint64_t)
+    );
+
+    if (!table || !chase)
+    {
+        fprintf(stderr, "Not enough memory for the table\n");
+
+        return EXIT_FAILURE;
+    }
+
+    for (uint64_t i = 0; i < tableLen; ++i)
+    {
+        table[i] = (uint32_t)(i * 0x9E3779B97F4A7C15);
+    }
+
+    //========================================================================//
+    //  BLAKE2b-256
+    //========================================================================//
+    uint8_t hash[B2B_LANES * NUM_SIZE_8];
+
+    Bench("blake2b_single", minMs, [&](const uint64_t i)
+    {
+        CpuBlakeHash(mes, i, hash);
+        sink ^= hash[0];
+    }, &results);
+
+    b2b_lanes_t lanes;
+    uint8_t block[NUM_SIZE_8 + NONCE_SIZE_8];
+
+    memcpy(block, mes, NUM_SIZE_8);
+
+    // one operation is B2B_LANES hashes
+    Bench("blake2b_multilane", minMs, [&](const uint64_t i)
+    {
+        CpuBlakeInit(&lanes);
+
+        for (uint32_t l = 0; l < B2B_LANES; ++l)
+        {
+            uint64_t nonce = i * B2B_LANES + l;
+
+            memcpy(block + NUM_SIZE_8, &nonce, NONCE_SIZE_8);
+            CpuBlakeLoad(&lanes, l, block, NUM_SIZE_8 + NONCE_SIZE_8);
+        }
+
+        CpuBlakeCompress(&lanes, NUM_SIZE_8 + NONCE_SIZE_8, 1);
+
+        for (uint32_t l = 0; l < B2B_LANES; ++l)
+        {
+            CpuBlakeDump(&lanes, l, hash + l * NUM_SIZE_8);
+        }
+
+        sink ^= hash[0];
+    }, &results);
+
+    results.back().ops *= B2B_LANES;
+
+    //========================================================================//
+    //  Indices, gather and sum
+    //========================================================================//
+    uint32_t ind[K_LEN];
+
+    CpuBlakeHash(mes, 0, hash);
+
+    Bench("index_derivation", minMs, [&](const uint64_t i)
+    {
+        hash[0] = (uint8_t)i;
+        CpuGenIndices(hash, ind);
+        sink ^= ind[K_LEN - 1];
+    }, &results);
+
+    // indices of different nonces, as in mining
+    const uint32_t indSets = 0x10000;
+    std::vector<uint32_t> indices(indSets * K_LEN);
+
+    for (uint32_t n = 0; n < indSets; ++n)
+    {
+        CpuBlakeHash(mes, n, hash);
+        CpuGenIndices(hash, indices.data() + n * K_LEN);
+
+        for (int k = 0; k < K_LEN; ++k) { indices[n * K_LEN + k] &= tableMask; }
+    }
+
+    // 32-way gather of 256-bit elements and their sum
+    Bench("gather_sum", minMs, [&](const uint64_t i)
+    {
+        const uint32_t * set = indices.data() + (i % indSets) * K_LEN;
+        uint64_t acc[NUM_SIZE_32] = {0};
+
+        for (int k = 0; k < K_LEN; ++k)
+        {
+            const uint32_t * elem = table + (uint64_t)set[k] * NUM_SIZE_32;
+
+            for (int j = 0; j < NUM_SIZE_32; ++j) { acc[j] += elem[j]; }
+        }
+
+        sink ^= (uint32_t)acc[0];
+    }, &results);
+
+    results.back().reads = K_LEN;
+
+    // 32-way gather of high 64 bits of elements, the early reject pass over
+    // the compact part of the table split as in mining (TABLE_POS)
+    const uint64_t * hi = (const uint64_t *)table;
+
+    Bench("gather_reject", minMs, [&](const uint64_t i)
+    {
+        const uint32_t * set = indices.data() + (i % indSets) * K_LEN;
+        uint64_t sum = 0;
+
+        for (int k = 0; k < K_LEN; ++k) { sum += hi[set[k]]; }
+
+        sink ^= (uint32_t)sum;
+    }, &results);
+
+    results.back().reads = K_LEN;
+
+    // the same with reads of CPU_GATHER_DEPTH sets in flight, as in mining
+    Bench("gather_reject_interleaved", minMs, [&](const uint64_t i)
+    {
+        const uint32_t * ahead
+            = indices.data() + ((i + CPU_GATHER_DEPTH) % indSets) * K_LEN;
+        const uint32_t * set = indices.data() + (i % indSets) * K_LEN;
+        uint64_t sum = 0;
+
+        for (int k = 0; k < K_LEN; ++k) { CpuPrefetch(hi + ahead[k]); }
+        for (int k = 0; k < K_LEN; ++k) { sum += hi[set[k]]; }
+
+        sink ^= (uint32_t)sum;
+    }, &results);
+
+    results.back().reads = K_LEN;
+
+    // dependent reads over the compact part of the table, one per cache
+    // line in random cyclic order: the latency of a single miss
+    const uint32_t lines = (tableMask + 1) >> 3;
+    std::vector<uint32_t> order(lines);
+    uint64_t state = 0x9E3779B97F4A7C15;
+
+    for (uint32_t l = 0; l < lines; ++l) { order[l] = l; }
+
+    // single cycle permutation (Sattolo)
+    for (uint32_t l = lines - 1; l > 0; --l)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        std::swap(order[l], order[(state >> 33) % l]);
+    }
+
+    for (uint32_t l = 0; l < lines; ++l)
+    {
+        chase[(uint64_t)order[l] << 3] = (uint64_t)order[(l + 1) % lines] << 3;
+    }
+
+    uint64_t cur = 0;
+
+    Bench("gather_latency", minMs, [&](const uint64_t)
+    {
+        cur = chase[cur];
+    }, &results);
+
+    sink ^= (uint32_t)cur;
+    results.back().reads = 1;
+
+    //========================================================================//
+    //  Gathers of every pair of NUMA nodes
+    //========================================================================//
+    std::vector<numa_node_t> nodes;
+    const uint64_t hiSize = ((uint64_t)tableMask + 1) * sizeof(uint64_t);
+
+    NumaNodes(&nodes);
+
+    for (uint32_t m = 0; m < nodes.size(); ++m)
+    {
+        uint64_t * copy = (uint64_t *)arena.Acquire(hiSize);
+
+        if (!copy)
+        {
+            fprintf(stderr, "Not enough memory for the table of a node\n");
+
+            return EXIT_FAILURE;
+        }
+
+        // pages touched by another node before are moved
+        BindMemory(copy, hiSize, nodes[m].id);
+        memcpy(copy, hi, hiSize);
+
+        for (uint32_t c = 0; c < nodes.size(); ++c)
+        {
+            const std::string name = "gather_reject_node"
+                + std::to_string(nodes[c].id) + "_mem"
+                + std::to_string(nodes[m].id);
+
+            std::thread pinned(
+                [&]()
+                {
+                    PinThread(nodes[c].cpus);
+
+                    Bench(name.c_str(), minMs, [&](const uint64_t i)
+                    {
+                        const uint32_t * ahead = indices.data()
+                            + ((i + CPU_GATHER_DEPTH) % indSets) * K_LEN;
+                        const uint32_t * set
+                            = indices.data() + (i % indSets) * K_LEN;
+                        uint64_t sum = 0;
+
+                        for (int k = 0; k < K_LEN; ++k)
+                        {
+                            CpuPrefetch(copy + ahead[k]);
+                        }
+
+                        for (int k = 0; k < K_LEN; ++k) { sum += copy[set[k]]; }
+
+                        sink ^= (uint32_t)sum;
+                    }, &results);
+                }
+            );
+
+            pinned.join();
+            results.back().reads = K_LEN;
+        }
+
+        arena.Release(copy);
+    }
+
+    uint32_t d[NUM_SIZE_32];
+
+    // sum of consecutive elements, subtraction of sk and reduction mod Q
+    Bench("sum_mod_q", minMs, [&](const uint64_t i)
+    {
+        const uint32_t * elems = table
+            + (i & ((tableMask + 1) / K_LEN - 1)) * K_LEN * NUM_SIZE_32;
+
+        sink ^= CpuSumModQ(bound, sk, elems, d) ^ d[0];
+    }, &results);
+
+    //========================================================================//
+    //  Conversions and candidate parsing
+    //========================================================================//
+    const char * dec = "2134827235332678044033321050158788970700537299772469398"
+        "8999057291299";
+    char hex[NUM_SIZE_4 + 1];
+
+    Bench("dec_to_hex", minMs, [&](const uint64_t)
+    {
+        DecStrToHexStrOf64(dec, strlen(dec), hex);
+        sink ^= hex[NUM_SIZE_4 - 1];
+    }, &results);
+
+    char decOut[NUM_SIZE_4 * 2];
+    uint32_t decLen;
+
+    Bench("le_to_dec", minMs, [&](const uint64_t i)
+    {
+        bound[0] = (uint32_t)i;
+        LittleEndianOf256ToDecStr((const uint8_t *)bound, decOut, &decLen);
+        sink ^= decOut[0];
+    }, &results);
+
+    const char * candidate = "{ \"msg\" : \"46b7e949bfad202ab4e3dd9cc0603c1f61f"
+        "53485854028b8fa03f399544fb298\", \"b\" : 213482723533267804403332105"
+        "01587889707005372997724693988999057291299,  \"pk\" : \"0395f8d54fdd5"
+        "edb7eeab3228c952d39f5e60d048178f94ac992d4f76a6dce4c71\"  }";
+
+    info_t info;
+    json_t empty(0, REQ_LEN);
+    json_t oldreq(0, REQ_LEN);
+    json_t newreq(0, REQ_LEN);
+
+    info.blockId = 0;
+    info.mesId = 0;
+
+    WriteFunc((void *)candidate, 1, strlen(candidate), &oldreq);
+    WriteFunc((void *)candidate, 1, strlen(candidate), &newreq);
+    ParseRequest(&empty, &oldreq, &info, 0);
+
+    // unchanged candidate, as on most polls
+    Bench("parse_request", minMs, [&](const uint64_t)
+    {
+        sink ^= ParseRequest(&oldreq, &newreq, &info, 0);
+    }, &results);
+
+    // the same candidate with other extra fields is parsed in full
+    const char * extra = "{\"height\": 1, \"msg\" : \"46b7e949bfad202ab4e3dd9"
+        "cc0603c1f61f53485854028b8fa03f399544fb298\", \"b\" : 21348272353326"
+        "780440333210501587889707005372997724693988999057291299, \"pk\" : \"0"
+        "395f8d54fdd5edb7eeab3228c952d39f5e60d048178f94ac992d4f76a6dce4c71\"}";
+
+    newreq.Reset();
+    WriteFunc((void *)extra, 1, strlen(extra), &newreq);
+
+    Bench("parse_request_full", minMs, [&](const uint64_t)
+    {
+        sink ^= ParseRequest(&oldreq, &newreq, &info, 0);
+    }, &results);
+
+    //========================================================================//
+    //  Table build
+    //========================================================================//
+    uint32_t elem[NUM_SIZE_32];
+
+    Bench("table_element", minMs, [&](const uint64_t i)
+    {
+        CpuHashElement(data.data(), NULL, (uint32_t)(i & N_MASK), elem);
+        sink ^= elem[0];
+    }, &results);
+
+    //========================================================================//
+    //  Pool-side verification
+    //========================================================================//
+    submission_t sub;
+    SubmissionVerifier verifier;
+
+    memcpy(sub.mes, mes, NUM_SIZE_8);
+    memset(sub.bound, 0xFF, NUM_SIZE_8);
+    memset(sub.d, 0, NUM_SIZE_8);
+
+    // valid compressed keys: generator of secp256k1
+    HexStrToBigEndian(
+        "0279BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798",
+        PK_SIZE_4, sub.pk, PK_SIZE_8
+    );
+    memcpy(sub.w, sub.pk, PK_SIZE_8);
+
+    // one operation is a whole verification on one thread
+    Bench("verify_submission", minMs, [&](const uint64_t i)
+    {
+        sub.nonce = i;
+        sink ^= verifier.Verify(sub);
+    }, &results);
+
+    //========================================================================//
+    //  Parallel primitives
+    //========================================================================//
+    // one operation is a whole pass over 2^tableBits sparse items
+    std::vector<uint32_t> items((uint64_t)tableMask + 1);
+    std::vector<uint32_t> scan(items.size());
+
+    for (uint32_t i = 0; i < items.size(); ++i)
+    {
+        items[i] = (!(i % 97))? i + 1: 0;
+    }
+
+    Bench("reduce_sum", minMs, [&](const uint64_t)
+    {
+        sink ^= CpuFindSum(items.data(), items.size(), 0);
+    }, &results);
+
+    Bench("exclusive_scan", minMs, [&](const uint64_t)
+    {
+        sink ^= CpuExclusiveScan(items.data(), items.size(), scan.data(), 0);
+    }, &results);
+
+    Bench("compactify", minMs, [&](const uint64_t)
+    {
+        sink ^= CpuCompactify(items.data(), items.size(), scan.data(), 0);
+    }, &results);
+
+    if (fullPrehash)
+    {
+        uint32_t * hashes = (uint32_t *)arena.Acquire(
+            (uint64_t)N_LEN * NUM_SIZE_8
+        );
+        bench_t res;
+
+        if (!hashes)
+        {
+            fprintf(stderr, "Not enough memory for the whole table\n");
+
+            return EXIT_FAILURE;
+        }
+
+        steady_clock::time_point start = steady_clock::now();
+
+        CpuPrehash(0, data.data(), NULL, hashes, 0);
+
+        res.name = "table_build";
+        res.ops = N_LEN;
+        res.ns = duration_cast<nanoseconds>(
+            steady_clock::now() - start
+        ).count();
+
+        res.reads = 0;
+        results.push_back(res);
+
+        // one operation is a nonce, whole mining on all threads, threads
+        // and work buffers kept between iterations as by the backend
+        const uint32_t nonces = 0x10000;
+        result_t found[MAX_RESULTS];
+        uint32_t count;
+        CpuPool pool(0);
+        std::vector<uint32_t> flags(nonces);
+        std::vector<uint32_t> cands(nonces);
+        std::vector<uint32_t> counts(CpuThreads(0));
+
+        Bench("block_mining", minMs, [&](const uint64_t i)
+        {
+            CpuBlockMining(
+                bound, hashes, data.data(), i * nonces, nonces, found,
+                &count, flags.data(), cands.data(), counts.data(), 0, &pool
+            );
+            sink ^= count;
+        }, &results);
+
+        results.back().ops *= nonces;
+        results.back().reads = K_LEN;
+    }
+
+    //========================================================================//
+    //  Output
+    //========================================================================//
+    printf(
+        "{\n    \"isa\": \"%s\", \"threads\": %u, \"tableBits\": %u,\n"
+        "    \"pages\": \"%s\",\n    \"benchmarks\": [\n",
+        CpuBlakeIsa(), CpuThreads(0), tableBits, arena.Describe(table).c_str()
+    );
+
+    // latency of a single miss
+    double latency = 0;
+
+    for (uint32_t b = 0; b < results.size(); ++b)
+    {
+        if (results[b].name == "gather_latency")
+        {
+            latency = (double)results[b].ns / results[b].ops;
+        }
+    }
+
+    for (uint32_t b = 0; b < results.size(); ++b)
+    {
+        const bench_t & res = results[b];
+        char mlp[64] = "";
+
+        // misses in flight: reads per operation over operations per latency
+        if (res.reads && res.ns && latency > 0)
+        {
+            sprintf(
+                mlp, ", \"mlp\": %.2f, \"gbPerSec\": %.2f",
+                res.reads * latency * res.ops / res.ns,
+                res.reads * 64.0 * res.ops / res.ns
+            );
+        }
+
+        printf(
+            "        { \"name\": \"%s\", \"ops\": %llu, \"ns\": %llu, "
+            "\"nsPerOp\": %.3f, \"opsPerSec\": %.1f%s }%s\n",
+            res.name.c_str(), (unsigned long long)res.ops,
+            (unsigned long long)res.ns, (double)res.ns / res.ops,
+            (res.ns)? res.ops * 1e9 / res.ns: 0.0, mlp,
+            (b + 1 < results.size())? ",": ""
+        );
+    }
+
+    printf("    ]\n}\n");
+
+    return EXIT_SUCCESS;
+}
+
+// bench.cu
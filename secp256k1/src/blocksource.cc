@@ -0,0 +1,363 @@
+// blocksource.cc
+
+/*******************************************************************************
+
+    BLOCKSOURCE -- Acquisition of block candidates
+
+*******************************************************************************/
+
+#include "../include/blocksource.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include "../include/metrics.h"
+#include "../include/request.h"
+#include <curl/curl.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace std::chrono;
+
+static int64_t NowMs(void)
+{
+    return duration_cast<milliseconds>(
+        steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Polling source
+////////////////////////////////////////////////////////////////////////////////
+PollSource::PollSource(const char * from):
+    headers(NULL), oldreq(0, REQ_LEN), newreq(0, REQ_LEN), requests(0),
+    unchanged(0), requestTime(0)
+{
+    curl = curl_easy_init();
+
+    if (!curl)
+    {
+        LOG(ERROR) << "CURL initialization failed in PollSource";
+
+        return;
+    }
+
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_URL, from));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteFunc));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &newreq));
+    CurlLogError(curl_easy_setopt(
+        curl, CURLOPT_HEADERFUNCTION, PollSource::HeaderFunc
+    ));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_HEADERDATA, this));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L));
+
+    // set timeout to 30 sec so it doesn't hang up
+    // waiting for default 5 minutes if url is unreachable / wrong
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L));
+}
+
+PollSource::~PollSource(void)
+{
+    if (curl) { curl_easy_cleanup(curl); }
+    curl_slist_free_all(headers);
+}
+
+// keeps entity tag of the response
+size_t PollSource::HeaderFunc(char * buf, size_t size, size_t n, void * arg)
+{
+    PollSource * source = (PollSource *)arg;
+    size_t len = size * n;
+
+    if (
+        len > 5 && toupper(buf[0]) == 'E' && toupper(buf[1]) == 'T'
+        && toupper(buf[2]) == 'A' && toupper(buf[3]) == 'G' && buf[4] == ':'
+    )
+    {
+        size_t start = 5;
+        size_t end = len;
+
+        while (start < end && isspace(buf[start])) { ++start; }
+        while (end > start && isspace(buf[end - 1])) { --end; }
+
+        source->etag.assign(buf + start, end - start);
+    }
+
+    return len;
+}
+
+int PollSource::Apply(json_t * req, info_t * info, const int checkPubKey)
+{
+    return ApplyBlock(&oldreq, req, info, checkPubKey);
+}
+
+int PollSource::Request(info_t * info, const int checkPubKey)
+{
+    if (!curl) { return EXIT_FAILURE; }
+
+    //========================================================================//
+    //  Conditional request with entity tag of the latest candidate
+    //========================================================================//
+    // headers are rebuilt only when the tag changes
+    const std::string & tag = (oldreq.len)? lastTag: noTag;
+
+    if (tag != headerTag)
+    {
+        curl_slist_free_all(headers);
+        headers = NULL;
+        headerTag = tag;
+
+        if (!tag.empty())
+        {
+            headers = curl_slist_append(
+                headers, ("If-None-Match: " + tag).c_str()
+            );
+        }
+
+        CurlLogError(curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers));
+    }
+
+    newreq.Reset();
+    etag.clear();
+
+    int64_t start = MetricsNowUs();
+    CURLcode curlError = curl_easy_perform(curl);
+    long code = 0;
+    int64_t elapsed = MetricsNowUs() - start;
+
+    if (metrics) { metrics->poll.Observe(elapsed); }
+
+    requestTime += elapsed * 1e-3;
+    ++requests;
+
+    CurlLogError(curlError);
+
+    if (curlError != CURLE_OK) { return EXIT_FAILURE; }
+
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+
+    if (code == 304)
+    {
+        ++unchanged;
+
+        return EXIT_SUCCESS;
+    }
+
+    if (code != 200)
+    {
+        LOG(ERROR) << "Node responded with code " << code;
+
+        return EXIT_FAILURE;
+    }
+
+    VLOG(1) << "GET request " << newreq.ptr;
+
+    int status = ApplyBlock(&oldreq, &newreq, info, checkPubKey);
+
+    // a candidate that failed is requested in full again
+    if (status == EXIT_SUCCESS) { lastTag = etag; }
+
+    return status;
+}
+
+int PollSource::Fetch(info_t * info, const int checkPubKey)
+{
+    int status = Request(info, checkPubKey);
+
+    std::this_thread::sleep_for(milliseconds(BLOCK_POLL_MS));
+
+    return status;
+}
+
+void PollSource::Stats(source_stats_t * stats)
+{
+    stats->requests = requests;
+    stats->unchanged = unchanged;
+    stats->pushed = 0;
+    stats->accepted = 0;
+    stats->rejected = 0;
+    stats->requestTime = (requests)? requestTime / requests: 0;
+
+    requests = unchanged = 0;
+    requestTime = 0;
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Push source
+////////////////////////////////////////////////////////////////////////////////
+PushSource::PushSource(const char * from, const char * push):
+    poll(from), multi(NULL), headers(NULL), active(0), newreq(0, REQ_LEN),
+    info(NULL), lastPoll(0), retryAt(0), pushed(0)
+{
+    multi = curl_multi_init();
+    curl = curl_easy_init();
+
+    if (!multi || !curl)
+    {
+        LOG(ERROR) << "CURL initialization failed in PushSource";
+
+        return;
+    }
+
+    headers = curl_slist_append(headers, "Accept: text/event-stream");
+
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_URL, push));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers));
+    CurlLogError(curl_easy_setopt(
+        curl, CURLOPT_WRITEFUNCTION, PushSource::StreamFunc
+    ));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_WRITEDATA, this));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L));
+}
+
+PushSource::~PushSource(void)
+{
+    if (multi && curl && active) { curl_multi_remove_handle(multi, curl); }
+    if (curl) { curl_easy_cleanup(curl); }
+    if (multi) { curl_multi_cleanup(multi); }
+    curl_slist_free_all(headers);
+}
+
+size_t PushSource::StreamFunc(char * buf, size_t size, size_t n, void * arg)
+{
+    PushSource * source = (PushSource *)arg;
+
+    source->stream.append(buf, size * n);
+    source->ApplyEvents();
+
+    return size * n;
+}
+
+// events are separated by empty lines, 'data' lines of an event are joined
+void PushSource::ApplyEvents(void)
+{
+    size_t pos;
+
+    while ((pos = stream.find('\n')) != std::string::npos)
+    {
+        std::string line = stream.substr(0, pos);
+
+        stream.erase(0, pos + 1);
+
+        if (!line.empty() && line[line.size() - 1] == '\r')
+        {
+            line.erase(line.size() - 1);
+        }
+
+        if (!line.compare(0, 5, "data:"))
+        {
+            size_t start = (line.size() > 5 && line[5] == ' ')? 6: 5;
+
+            if (!data.empty()) { data += '\n'; }
+            data.append(line, start, std::string::npos);
+        }
+        else if (line.empty() && !data.empty())
+        {
+            newreq.Reset();
+            WriteFunc((void *)data.c_str(), 1, data.size(), &newreq);
+            data.clear();
+
+            ++pushed;
+
+            VLOG(1) << "Pushed candidate " << newreq.ptr;
+
+            poll.Apply(&newreq, info, 0);
+        }
+    }
+
+    return;
+}
+
+int PushSource::Fetch(info_t * info, const int checkPubKey)
+{
+    this->info = info;
+
+    int64_t now = NowMs();
+    int status = EXIT_SUCCESS;
+
+    // candidates are polled at start and then rarely, in case of lost events
+    if (checkPubKey || now - lastPoll >= BLOCK_FALLBACK_MS)
+    {
+        lastPoll = now;
+        status = poll.Request(info, checkPubKey);
+    }
+
+    if (!multi || !curl) { return EXIT_FAILURE; }
+
+    //========================================================================//
+    //  (Re)connect event stream
+    //========================================================================//
+    if (!active && now >= retryAt)
+    {
+        stream.clear();
+        data.clear();
+
+        curl_multi_add_handle(multi, curl);
+        active = 1;
+    }
+
+    if (!active)
+    {
+        std::this_thread::sleep_for(milliseconds(BLOCK_PUSH_WAIT_MS));
+
+        return status;
+    }
+
+    //========================================================================//
+    //  Wait for events
+    //========================================================================//
+    int running = 0;
+
+    curl_multi_perform(multi, &running);
+
+    if (running)
+    {
+        curl_multi_poll(multi, NULL, 0, BLOCK_PUSH_WAIT_MS, NULL);
+        curl_multi_perform(multi, &running);
+    }
+
+    if (!running)
+    {
+        int left;
+        CURLMsg * msg = curl_multi_info_read(multi, &left);
+
+        if (msg && msg->msg == CURLMSG_DONE)
+        {
+            CurlLogError(msg->data.result);
+        }
+
+        LOG(INFO) << "Block push stream closed, reconnecting in "
+            << BLOCK_PUSH_RETRY_MS << " ms";
+
+        curl_multi_remove_handle(multi, curl);
+        active = 0;
+        retryAt = NowMs() + BLOCK_PUSH_RETRY_MS;
+    }
+
+    return status;
+}
+
+void PushSource::SetMetrics(Metrics * metrics)
+{
+    this->metrics = metrics;
+    poll.SetMetrics(metrics);
+
+    return;
+}
+
+void PushSource::Stats(source_stats_t * stats)
+{
+    poll.Stats(stats);
+
+    stats->pushed = pushed;
+    pushed = 0;
+
+    return;
+}
+
+// blocksource.cc
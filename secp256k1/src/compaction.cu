@@ -0,0 +1,34 @@
+// compaction.cu
+
+/*******************************************************************************
+
+    COMPACTION -- Identification of hashes subject to rehash, compaction of
+    mining candidates
+
+*******************************************************************************/
+
+#include "../include/compaction.h"
+#include <cuda.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//  Compactify an array, omit all zeros
+////////////////////////////////////////////////////////////////////////////////
+__global__ void Compactify(
+    // array
+    const uint32_t * in,
+    // length of array
+    const uint32_t inlen,
+    // nonzero elements in any order
+    uint32_t * out,
+    // number of nonzero elements, incremented
+    uint32_t * outlen
+)
+{
+    uint32_t tid = threadIdx.x + blockDim.x * blockIdx.x;
+
+    if (tid < inlen && in[tid]) { out[WarpInc(outlen)] = in[tid]; }
+
+    return;
+}
+
+// compaction.cu
@@ -9,6 +9,7 @@
 #include "../include/conversion.h"
 #include "../include/definitions.h"
 #include "../include/easylogging++.h"
+#include "../include/uint256.h"
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -16,89 +17,103 @@
 #include <string.h>
 
 ////////////////////////////////////////////////////////////////////////////////
-//  Convert string of decimal digits to string of 64 hexadecimal digits
+//  Convert string of decimal digits to 256-bit number
 ////////////////////////////////////////////////////////////////////////////////
-int DecStrToHexStrOf64(
+// powers of ten up to the largest one of 64 bits
+static const uint64_t pow10[DEC_CHUNK_DIGITS + 1] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+    100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull,
+    10000000000000000000ull
+};
+
+int DecStrToUint256(
     const char * in,
     const uint32_t inlen,
-    char * out
-) {
-    //somehow MSVC does not accept array with const size
-    #ifndef _WIN32
-    uint32_t fs[inlen];
-    #else
-    uint32_t fs[1024];
-    #endif
-    uint32_t tmp;
-    uint32_t rem;
-    uint32_t ip;
-
-    for (int i = inlen - 1, k = 0; i >= 0; --i)
+    uint256_t * out
+)
+{
+    uint64_t overflow = 0;
+
+    *out = uint256_t();
+
+    if (!inlen) { return EXIT_FAILURE; }
+
+    // chunks of DEC_CHUNK_DIGITS digits, the first one is partial
+    uint32_t len = inlen % DEC_CHUNK_DIGITS;
+
+    if (!len) { len = DEC_CHUNK_DIGITS; }
+
+    for (uint32_t pos = 0; pos < inlen; pos += len, len = DEC_CHUNK_DIGITS)
     {
-        if (in[i] >= '0' && in[i] <= '9') { fs[k++] = (uint32_t)(in[i] - '0'); }
-        else
-        { 
-            char errbuf[1024];
+        uint64_t chunk = 0;
 
-            errbuf[0] = '\0';
-            strncat(errbuf, in, inlen);
+        for (uint32_t i = pos; i < pos + len; ++i)
+        {
+            if (in[i] < '0' || in[i] > '9') { return EXIT_FAILURE; }
 
-            LOG(ERROR) << "DecStrToHexStrOf64 failed on string " << errbuf;
-            CALL(0, ERROR_IO); 
+            chunk = chunk * 10 + (uint64_t)(in[i] - '0');
         }
+
+        overflow |= U256MulAddSmall(out, pow10[len], chunk);
     }
 
-    uint32_t ts[74] = {1};
-    uint32_t accs[74] = {0};
+    return (overflow)? EXIT_FAILURE: EXIT_SUCCESS;
+}
 
-    for (uint_t i = 0; i < inlen; ++i)
+////////////////////////////////////////////////////////////////////////////////
+//  Convert string of hexadecimal digits to 256-bit number
+////////////////////////////////////////////////////////////////////////////////
+int HexStrToUint256(
+    const char * in,
+    const uint32_t inlen,
+    uint256_t * out
+)
+{
+    *out = uint256_t();
+
+    if (!inlen || inlen > NUM_SIZE_4) { return EXIT_FAILURE; }
+
+    for (uint32_t i = 0; i < inlen; ++i)
     {
-        for (int j = 0; j < 64; ++j)
-        {
-            accs[j] += ts[j] * fs[i];
-
-            tmp = accs[j];
-            rem = 0;
-            ip = j;
-
-            do
-            {
-                rem = tmp >> 4;
-                accs[ip++] = tmp - (rem << 4);
-                accs[ip] += rem;
-                tmp = accs[ip];
-            }
-            while (tmp >= 16);
-        }
+        const char c = in[inlen - i - 1];
+        uint64_t dig;
 
-        for (int j = 0; j < 64; ++j) { ts[j] *= 10; }
+        if (c >= '0' && c <= '9') { dig = c - '0'; }
+        else if (c >= 'A' && c <= 'F') { dig = c - 'A' + 0xA; }
+        else if (c >= 'a' && c <= 'f') { dig = c - 'a' + 0xA; }
+        else { return EXIT_FAILURE; }
 
-        for (int j = 0; j < 64; ++j)
-        {
-            tmp = ts[j];
-            rem = 0;
-            ip = j;
-
-            do
-            {
-                rem = tmp >> 4;
-                ts[ip++] = tmp - (rem << 4);
-                ts[ip] += rem;
-                tmp = ts[ip];
-            }
-            while (tmp >= 16);
-        }
+        out->w[i >> 4] |= dig << ((i & 15) << 2);
     }
 
-    for (int i = 63; i >= 0; --i)
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Convert string of decimal digits to string of 64 hexadecimal digits
+////////////////////////////////////////////////////////////////////////////////
+int DecStrToHexStrOf64(
+    const char * in,
+    const uint32_t inlen,
+    char * out
+) {
+    uint256_t num;
+
+    if (DecStrToUint256(in, inlen, &num) != EXIT_SUCCESS)
     {
-        out[63 - i]
-            = (accs[i] < 10)?
-            (char)(accs[i] + '0'):
-            (char)(accs[i] + 'A' - 0xA);
+        char errbuf[1024];
+
+        errbuf[0] = '\0';
+        strncat(errbuf, in, (inlen < 1023)? inlen: 1023);
+
+        LOG(ERROR) << "DecStrToHexStrOf64 failed on string " << errbuf;
+        CALL(0, ERROR_IO);
     }
 
-    out[64] = '\0';
+    Uint256ToHexStr(num, out);
 
     return 0;
 }
@@ -151,81 +166,67 @@ void HexStrToLittleEndian(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//  Convert little endian of 256 bits to string of decimal digits
+//  Convert 256-bit number to string of decimal digits
 ////////////////////////////////////////////////////////////////////////////////
-void LittleEndianOf256ToDecStr(
-    const uint8_t * in,
-    char * out,
-    uint32_t * outlen
-) {
-    uint32_t fs[64];
-    uint32_t tmp;
-    uint32_t rem;
-    uint32_t ip;
+uint32_t Uint256ToDecStr(
+    const uint256_t & in,
+    char * out
+)
+{
+    // chunks of DEC_CHUNK_DIGITS digits -- LITTLE ENDIAN
+    uint64_t chunks[(MAX_DEC_DIGITS + DEC_CHUNK_DIGITS - 1) / DEC_CHUNK_DIGITS];
+    uint256_t num = in;
+    int count = 0;
 
-    for (int i = 0; i < 64; ++i)
+    do
     {
-        fs[i] = (uint32_t)(in[i >> 1] >> (((i & 1)) << 2)) & 0xF;
+        chunks[count++] = U256DivSmall(&num, pow10[DEC_CHUNK_DIGITS]);
     }
+    while (!U256IsZero(num));
 
-    uint32_t ts[90] = {1};
-    uint32_t accs[90] = {0};
+    // leading chunk without zeros, the rest padded
+    uint32_t len = sprintf(out, "%" PRIu64, chunks[--count]);
 
-    for (int i = 0; i < 64; ++i)
+    while (count--)
     {
-        for (int j = 0; j < 78; ++j)
-        {
-            accs[j] += ts[j] * fs[i];
-
-            tmp = accs[j];
-            rem = 0;
-            ip = j;
-
-            do
-            {
-                rem = tmp / 10;
-                accs[ip++] = tmp - rem * 10;
-                accs[ip] += rem;
-                tmp = accs[ip];
-            }
-            while (tmp >= 10);
-        }
-
-        for (int j = 0; j < 78; ++j) { ts[j] <<= 4; }
-
-        for (int j = 0; j < 78; ++j)
-        {
-            tmp = ts[j];
-            rem = 0;
-            ip = j;
-
-            do
-            {
-                rem = tmp / 10;
-                ts[ip++] = tmp - rem * 10;
-                ts[ip] += rem;
-                tmp = ts[ip];
-            }
-            while (tmp >= 10);
-        }
+        len += sprintf(
+            out + len, "%0*" PRIu64, DEC_CHUNK_DIGITS, chunks[count]
+        );
     }
 
-    int k = 0;
-    int lead = 1;
+    return len;
+}
 
-    for (int i = 77; i >= 0; --i)
+////////////////////////////////////////////////////////////////////////////////
+//  Convert 256-bit number to string of 64 hexadecimal digits
+////////////////////////////////////////////////////////////////////////////////
+void Uint256ToHexStr(
+    const uint256_t & in,
+    char * out
+)
+{
+    for (int i = 0; i < NUM_SIZE_4; ++i)
     {
-        if (lead)
-        {
-            if (!(accs[i])) { continue; }
-            else { lead = 0; }
-        }
+        uint8_t dig = (in.w[(NUM_SIZE_4 - 1 - i) >> 4] >> (((~i) & 15) << 2))
+            & 0xF;
 
-        out[k++] = (char)(accs[i] + '0');
+        out[i] = (dig <= 9)? (char)dig + '0': (char)dig + 'A' - 0xA;
     }
 
-    out[k] = '\0';
-    *outlen = k;
+    out[NUM_SIZE_4] = '\0';
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Convert little endian of 256 bits to string of decimal digits
+////////////////////////////////////////////////////////////////////////////////
+void LittleEndianOf256ToDecStr(
+    const uint8_t * in,
+    char * out,
+    uint32_t * outlen
+) {
+    *outlen = Uint256ToDecStr(U256FromLittleEndian(in), out);
 
     return;
 }
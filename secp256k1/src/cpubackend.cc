@@ -0,0 +1,616 @@
+// cpubackend.cc
+
+/*******************************************************************************
+
+    CPUBACKEND -- Host mining device
+
+*******************************************************************************/
+
+#include "../include/cpubackend.h"
+#include "../include/cpumining.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include "../include/hostarena.h"
+#include "../include/multiblake.h"
+#include "../include/topology.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+//  Construction
+////////////////////////////////////////////////////////////////////////////////
+CpuBackend::CpuBackend(const uint32_t threads, const numa_t numa):
+    threads(CpuThreads(threads)), pool(threads), keep(0), numa(numa),
+    count_h(0),
+    data_h(NULL), uctxs_h(NULL), backData_h(NULL), reported(0), built(0)
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    std::string model = "CPU";
+
+    while (std::getline(cpuinfo, line))
+    {
+        if (!line.compare(0, 10, "model name"))
+        {
+            std::string::size_type colon = line.find(':');
+
+            if (colon != std::string::npos && colon + 2 <= line.size())
+            {
+                model = line.substr(colon + 2);
+            }
+
+            break;
+        }
+    }
+
+    // single node: nothing to place or pin
+    if (NumaNodes(&nodes) < 2 || numa == NUMA_OFF)
+    {
+        this->numa = NUMA_OFF;
+        nodes.resize(1);
+    }
+
+    nodeResults_h.resize(nodes.size() * MAX_RESULTS);
+    nodeCounts_h.resize(nodes.size());
+    nodeStatus_h.resize(nodes.size());
+    counts_h.resize(nodes.size() * this->threads);
+
+    geometry.blockDim = this->threads;
+    geometry.nonces = CPU_NONCES_PER_ITER;
+    flags_h.resize(geometry.nonces);
+    cands_h.resize(geometry.nonces);
+
+    key = model + " " + CpuBlakeIsa() + " " + std::to_string(this->threads)
+        + " threads";
+}
+
+CpuBackend::~CpuBackend(void)
+{
+    Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Memory allocation
+////////////////////////////////////////////////////////////////////////////////
+// tables of one block: one, or one per node if replicated
+static int AcquireTables(
+    HostArena * arena,
+    const numa_t numa,
+    const std::vector<numa_node_t> & nodes,
+    std::vector<uint32_t *> * tables
+)
+{
+    const size_t size = (size_t)N_LEN * NUM_SIZE_8;
+
+    tables->assign((numa == NUMA_REPLICATE)? nodes.size(): 1, NULL);
+
+    for (uint32_t r = 0; r < tables->size(); ++r)
+    {
+        (*tables)[r] = (uint32_t *)arena->Acquire(size);
+
+        if (!(*tables)[r]) { return EXIT_FAILURE; }
+
+        // pages go to their node on first touch by any thread
+        if (numa != NUMA_OFF)
+        {
+            BindMemory(
+                (*tables)[r], size,
+                (numa == NUMA_REPLICATE)? nodes[r].id: -1
+            );
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// tables back to the arena
+static void ReleaseTables(HostArena * arena, std::vector<uint32_t *> * tables)
+{
+    for (uint32_t r = 0; r < tables->size(); ++r)
+    {
+        arena->Release((*tables)[r]);
+    }
+
+    tables->clear();
+
+    return;
+}
+
+int CpuBackend::Allocate(
+    const uint8_t * pk,
+    const uint8_t * sk,
+    int * keepPrehash,
+    int * doubleBuffer
+)
+{
+    LOG(INFO) << "CPU allocating memory for " << threads << " threads, "
+        << CpuBlakeIsa() << " BLAKE2b-256";
+
+    if (numa != NUMA_OFF)
+    {
+        LOG(INFO) << "CPU table "
+            << ((numa == NUMA_REPLICATE)? "replicated on ": "interleaved over ")
+            << nodes.size() << " NUMA nodes";
+    }
+
+    // data: pk || mes || w || padding || x || sk || ctx
+    data_h = (uint32_t *)calloc(1, DATA_SIZE_8);
+
+    // precalculated hashes
+    // N_LEN * NUM_SIZE_8 bytes // 2 GiB per replica
+    if (
+        !data_h
+        || AcquireTables(&arena, numa, nodes, &hashes_h) != EXIT_SUCCESS
+    )
+    {
+        LOG(ERROR) << "Not enough host memory for CPU mining,"
+            << " minimum " << 2 * hashes_h.size() << " GiB needed";
+
+        Release();
+
+        return EXIT_FAILURE;
+    }
+
+    // unfinalized hash contexts
+    // if keepPrehash == true // N_LEN * 80 bytes // 5 GiB
+    if (*keepPrehash)
+    {
+        uctxs_h = (uctx_t *)arena.Acquire((size_t)N_LEN * sizeof(uctx_t));
+
+        if (!uctxs_h)
+        {
+            LOG(ERROR) << "Not enough host memory for keeping prehashes, "
+                << "setting keepPrehash to false for CPU";
+
+            *keepPrehash = 0;
+        }
+        else if (numa != NUMA_OFF)
+        {
+            BindMemory(uctxs_h, (size_t)N_LEN * sizeof(uctx_t), -1);
+        }
+    }
+
+    keep = *keepPrehash;
+
+    // back buffer
+    // if doubleBuffer == true // N_LEN * NUM_SIZE_8 bytes // 2 GiB per replica
+    if (*doubleBuffer)
+    {
+        backData_h = (uint32_t *)calloc(1, DATA_SIZE_8);
+
+        if (
+            !backData_h
+            || AcquireTables(&arena, numa, nodes, &backHashes_h)
+            != EXIT_SUCCESS
+        )
+        {
+            LOG(ERROR) << "Not enough host memory for double buffering, "
+                << "setting doubleBuffer to false for CPU";
+
+            FREE(backData_h);
+            ReleaseTables(&arena, &backHashes_h);
+
+            *doubleBuffer = 0;
+        }
+    }
+
+    //========================================================================//
+    //  Pinned workers of nodes, kept for all iterations
+    //========================================================================//
+    if (numa != NUMA_OFF)
+    {
+        uint32_t whole = 0;
+
+        for (uint32_t n = 0; n < nodes.size(); ++n)
+        {
+            whole += nodes[n].cpus.size();
+        }
+
+        nodePools.clear();
+
+        for (uint32_t n = 0; n < nodes.size(); ++n)
+        {
+            const std::vector<uint32_t> cpus = nodes[n].cpus;
+            const uint32_t share = (uint64_t)threads * cpus.size() / whole;
+
+            nodePools.push_back(std::unique_ptr<CpuPool>(new CpuPool(
+                (share)? share: 1,
+                [cpus](const uint32_t) { PinThread(cpus); }
+            )));
+        }
+
+        leaders.reset(new CpuPool(
+            nodes.size(),
+            [this](const uint32_t n) { PinThread(nodes[n].cpus); }
+        ));
+    }
+
+    // copy public key and secret key
+    memcpy(data_h, pk, PK_SIZE_8);
+    memcpy(data_h + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, sk, NUM_SIZE_8);
+
+    if (backData_h) { memcpy(backData_h, data_h, DATA_SIZE_8); }
+
+    return EXIT_SUCCESS;
+}
+
+void CpuBackend::Release(void)
+{
+    if (builder.joinable()) { builder.join(); }
+
+    leaders.reset();
+    nodePools.clear();
+
+    FREE(data_h);
+    FREE(backData_h);
+
+    // buffers stay mapped for the next allocation
+    ReleaseTables(&arena, &hashes_h);
+    ReleaseTables(&arena, &backHashes_h);
+    arena.Release(uctxs_h);
+
+    uctxs_h = NULL;
+    reported = 0;
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Hashes precalculation
+////////////////////////////////////////////////////////////////////////////////
+int CpuBackend::InitPrehash(void)
+{
+    if (!keep) { return EXIT_SUCCESS; }
+
+    LOG(INFO) << "Preparing unfinalized hashes on CPU";
+
+    return CpuUncompleteInitPrehash(data_h, uctxs_h, threads, &pool);
+}
+
+int CpuBackend::UploadBlock(
+    const uint8_t * bound,
+    const uint8_t * mes,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    memcpy(bound_h, bound, NUM_SIZE_8);
+
+    // message, one time secret key and one time public key
+    memcpy((uint8_t *)data_h + PK_SIZE_8, mes, NUM_SIZE_8);
+    memcpy(data_h + COUPLED_PK_SIZE_32 + NUM_SIZE_32, x, NUM_SIZE_8);
+    memcpy((uint8_t *)data_h + PK_SIZE_8 + NUM_SIZE_8, w, PK_SIZE_8);
+
+    return EXIT_SUCCESS;
+}
+
+int CpuBackend::UploadBound(const uint8_t * bound)
+{
+    memcpy(bound_h, bound, NUM_SIZE_8);
+
+    return EXIT_SUCCESS;
+}
+
+int CpuBackend::BuildTables(
+    const uint32_t * data,
+    std::vector<uint32_t *> * tables,
+    CpuPool * workers
+)
+{
+    const uint32_t * table = (*tables)[0];
+
+    int status = CpuPrehash(
+        keep, data, uctxs_h, (*tables)[0], threads, workers
+    );
+
+    // replicas are copies, cheaper than prehash on every node
+    for (uint32_t r = 1; r < tables->size(); ++r)
+    {
+        uint8_t * replica = (uint8_t *)(*tables)[r];
+
+        ParallelFor(
+            N_LEN, threads,
+            [&](const uint32_t, const uint32_t first, const uint32_t last)
+            {
+                memcpy(
+                    replica + (size_t)first * NUM_SIZE_8,
+                    (const uint8_t *)table + (size_t)first * NUM_SIZE_8,
+                    (size_t)(last - first) * NUM_SIZE_8
+                );
+            },
+            workers
+        );
+    }
+
+    return status;
+}
+
+int CpuBackend::Prehash(void)
+{
+    int status = BuildTables(data_h, &hashes_h, &pool);
+
+    // transparent huge pages are only obtained when buffers are written
+    if (!reported)
+    {
+        for (uint32_t r = 0; r < hashes_h.size(); ++r)
+        {
+            LOG(INFO) << "CPU table"
+                << ((numa == NUMA_REPLICATE)?
+                    " replica of node " + std::to_string(nodes[r].id): "")
+                << " on " << arena.Describe(hashes_h[r]);
+        }
+
+        if (uctxs_h)
+        {
+            LOG(INFO) << "CPU unfinalized hashes on "
+                << arena.Describe(uctxs_h);
+        }
+
+        reported = 1;
+    }
+
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Block mining
+////////////////////////////////////////////////////////////////////////////////
+int CpuBackend::Mine(const uint64_t base)
+{
+    if (numa == NUMA_OFF)
+    {
+        return CpuBlockMining(
+            bound_h, hashes_h[0], data_h, base, geometry.nonces, results_h,
+            &count_h, flags_h.data(), cands_h.data(), counts_h.data(),
+            geometry.blockDim, &pool
+        );
+    }
+
+    if (!leaders) { return EXIT_FAILURE; }
+
+    //========================================================================//
+    //  Nonces and workers split in proportion to cores of nodes
+    //========================================================================//
+    uint32_t whole = 0;
+
+    for (uint32_t n = 0; n < nodes.size(); ++n)
+    {
+        whole += nodes[n].cpus.size();
+    }
+
+    // leader of a node mines its part on the workers of the node
+    leaders->Run(
+        nodes.size(),
+        [&](const uint32_t n)
+        {
+            uint32_t part = 0;
+
+            for (uint32_t m = 0; m < n; ++m) { part += nodes[m].cpus.size(); }
+
+            const uint32_t first = (uint64_t)geometry.nonces * part / whole;
+            const uint32_t last = (uint64_t)geometry.nonces
+                * (part + nodes[n].cpus.size()) / whole;
+            const uint32_t share
+                = (uint64_t)geometry.blockDim * nodes[n].cpus.size() / whole;
+
+            // nodes take disjoint parts of the work buffers
+            nodeStatus_h[n] = CpuBlockMining(
+                bound_h, hashes_h[(hashes_h.size() > 1)? n: 0], data_h,
+                base + first, last - first,
+                nodeResults_h.data() + n * MAX_RESULTS, &nodeCounts_h[n],
+                flags_h.data() + first, cands_h.data() + first,
+                counts_h.data() + n * threads, (share)? share: 1,
+                nodePools[n].get()
+            );
+        }
+    );
+
+    for (uint32_t n = 0; n < nodes.size(); ++n)
+    {
+        if (nodeStatus_h[n] != EXIT_SUCCESS)
+        {
+            LOG(ERROR) << "CPU mining failed on NUMA node " << nodes[n].id;
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    //========================================================================//
+    //  Solutions of all nodes
+    //========================================================================//
+    uint32_t kept = 0;
+
+    count_h = 0;
+
+    for (uint32_t n = 0; n < nodes.size(); ++n)
+    {
+        uint32_t cnt = (nodeCounts_h[n] < MAX_RESULTS)?
+            nodeCounts_h[n]: MAX_RESULTS;
+
+        if (cnt > MAX_RESULTS - kept) { cnt = MAX_RESULTS - kept; }
+
+        memcpy(
+            results_h + kept, nodeResults_h.data() + n * MAX_RESULTS,
+            cnt * sizeof(result_t)
+        );
+
+        kept += cnt;
+        count_h += nodeCounts_h[n];
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int CpuBackend::FetchResults(
+    result_t * results,
+    uint32_t * count,
+    uint32_t * lost
+)
+{
+    *count = (count_h < MAX_RESULTS)? count_h: MAX_RESULTS;
+    *lost = count_h - *count;
+
+    memcpy(results, results_h, *count * sizeof(result_t));
+
+    count_h = 0;
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Double buffered hash table
+////////////////////////////////////////////////////////////////////////////////
+int CpuBackend::PrehashBack(
+    const uint8_t * bound,
+    const uint8_t * mes,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    if (!backData_h || builder.joinable()) { return EXIT_FAILURE; }
+
+    memcpy(backBound_h, bound, NUM_SIZE_8);
+
+    // message, one time secret key and one time public key
+    memcpy((uint8_t *)backData_h + PK_SIZE_8, mes, NUM_SIZE_8);
+    memcpy(backData_h + COUPLED_PK_SIZE_32 + NUM_SIZE_32, x, NUM_SIZE_8);
+    memcpy((uint8_t *)backData_h + PK_SIZE_8 + NUM_SIZE_8, w, PK_SIZE_8);
+
+    built = 0;
+
+    // worker threads of the back buffer share cores with mining, they are
+    // not taken from the pool busy with mining
+    builder = std::thread(
+        [this]()
+        {
+            BuildTables(backData_h, &backHashes_h, NULL);
+            built = 1;
+            ++backBuilt;
+        }
+    );
+
+    return EXIT_SUCCESS;
+}
+
+int CpuBackend::BackReady(int * ready)
+{
+    *ready = built.load();
+
+    return EXIT_SUCCESS;
+}
+
+int CpuBackend::WaitBack(int * ready, const uint32_t ms)
+{
+    // advance after the check is not missed
+    uint_t seen = backBuilt.load();
+
+    *ready = built.load();
+
+    if (!*ready)
+    {
+        backBuilt.Wait(seen, ms);
+        *ready = built.load();
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int CpuBackend::SwapBuffers(void)
+{
+    if (!builder.joinable()) { return EXIT_FAILURE; }
+
+    builder.join();
+
+    std::swap(data_h, backData_h);
+    std::swap(hashes_h, backHashes_h);
+    memcpy(bound_h, backBound_h, NUM_SIZE_8);
+
+    built = 0;
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Mining geometry
+////////////////////////////////////////////////////////////////////////////////
+void CpuBackend::Geometries(std::vector<geometry_t> * candidates) const
+{
+    std::vector<uint32_t> widths(1, threads);
+    geometry_t geom;
+
+    // one thread per core if cores run two hardware threads
+    if (threads > 1 && !(threads & 1)) { widths.push_back(threads >> 1); }
+
+    candidates->clear();
+
+    for (uint32_t i = 0; i < widths.size(); ++i)
+    {
+        geom.blockDim = widths[i];
+
+        for (
+            geom.nonces = CPU_TUNE_MIN_NONCES;
+            geom.nonces <= CPU_NONCES_PER_ITER;
+            geom.nonces <<= 1
+        )
+        {
+            candidates->push_back(geom);
+        }
+    }
+
+    return;
+}
+
+int CpuBackend::SetGeometry(const geometry_t & geom)
+{
+    if (
+        !geom.blockDim || geom.blockDim > threads
+        || !geom.nonces || geom.nonces > CPU_NONCES_PER_ITER
+    )
+    {
+        LOG(ERROR) << "CPU unsupported mining geometry: " << geom.blockDim
+            << " threads, " << geom.nonces << " nonces";
+
+        return EXIT_FAILURE;
+    }
+
+    geometry = geom;
+    flags_h.resize(geometry.nonces);
+    cands_h.resize(geometry.nonces);
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Unfinalized hash contexts transfer
+////////////////////////////////////////////////////////////////////////////////
+int CpuBackend::UploadUctxs(
+    const uint32_t first,
+    const uint32_t cnt,
+    const uctx_t * uctxs
+)
+{
+    if (!uctxs_h) { return EXIT_FAILURE; }
+
+    memcpy(uctxs_h + first, uctxs, (size_t)cnt * sizeof(uctx_t));
+
+    return EXIT_SUCCESS;
+}
+
+int CpuBackend::DownloadUctxs(
+    const uint32_t first,
+    const uint32_t cnt,
+    uctx_t * uctxs
+)
+{
+    if (!uctxs_h) { return EXIT_FAILURE; }
+
+    memcpy(uctxs, uctxs_h + first, (size_t)cnt * sizeof(uctx_t));
+
+    return EXIT_SUCCESS;
+}
+
+// cpubackend.cc
@@ -0,0 +1,860 @@
+// cpumining.cc
+
+/*******************************************************************************
+
+    CPUMINING -- Host reference implementation of Autolykos procedures
+
+*******************************************************************************/
+
+#include "../include/cpumining.h"
+#include "../include/cpuprimitives.h"
+#include "../include/definitions.h"
+#include "../include/multiblake.h"
+#include "../include/uint256.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+//  Constants
+////////////////////////////////////////////////////////////////////////////////
+// Q
+static constexpr uint256_t q256(Q0, Q1, Q2, Q3);
+
+// 2^256 - Q by 64 bits limbs -- LITTLE ENDIAN
+#define DELTA_SIZE_64      3
+
+static const uint64_t deltaLimbs[DELTA_SIZE_64] = {
+    0x402DA1732FC9BEBF, 0x4551231950B75FC4, 0x0000000000000001
+};
+
+// constant message M: big endian 64 bits representations of 0, 1, ..., 1023
+struct constmes_t
+{
+    uint8_t b[CONST_MES_SIZE_8];
+
+    constmes_t(void)
+    {
+        for (uint32_t j = 0; j < CONST_MES_SIZE_8; ++j)
+        {
+            b[j]
+                = (
+                    !((7 - (j & 7)) >> 1)
+                    * ((j >> 3) >> (((~(j & 7)) & 1) << 3))
+                ) & 0xFF;
+        }
+    }
+};
+
+static const constmes_t constMes;
+
+////////////////////////////////////////////////////////////////////////////////
+//  Arithmetic modulo Q
+////////////////////////////////////////////////////////////////////////////////
+// a < Q
+static inline int LessThanQ(const uint256_t & a)
+{
+    return U256Less(a, q256);
+}
+
+// number of 'len' 64 bits limbs modulo Q
+static uint256_t ModQ(
+    // number -- LITTLE ENDIAN, NUM_SIZE_64 to 2 * NUM_SIZE_64 limbs
+    const uint64_t * num,
+    uint32_t len
+)
+{
+    uint64_t r[NUM_SIZE_64 << 1];
+    uint64_t t[NUM_SIZE_64 << 1];
+
+    memcpy(r, num, len * sizeof(uint64_t));
+
+    while (len > NUM_SIZE_64 && !r[len - 1]) { --len; }
+
+    //========================================================================//
+    //  r := r mod 2^256 + (r div 2^256) * (2^256 - Q)
+    //========================================================================//
+    while (len > NUM_SIZE_64)
+    {
+        memset(t, 0, sizeof(t));
+        memcpy(t, r, NUM_SIZE_8);
+
+        for (uint32_t i = 0; i < len - NUM_SIZE_64; ++i)
+        {
+            uint64_t carry = 0;
+
+            for (uint32_t j = 0; j < DELTA_SIZE_64; ++j)
+            {
+                t[i + j] = MulAdd64(
+                    r[NUM_SIZE_64 + i], deltaLimbs[j], t[i + j], carry, &carry
+                );
+            }
+
+            for (uint32_t k = i + DELTA_SIZE_64; carry; ++k)
+            {
+                carry = AddCarry64(0, t[k], carry, t + k);
+            }
+        }
+
+        len = NUM_SIZE_64 << 1;
+
+        while (len > NUM_SIZE_64 && !t[len - 1]) { --len; }
+
+        memcpy(r, t, len * sizeof(uint64_t));
+    }
+
+    //========================================================================//
+    //  r := r - Q while r >= Q
+    //========================================================================//
+    uint256_t res(r[0], r[1], r[2], r[3]);
+
+    while (!LessThanQ(res)) { U256Sub(res, q256, &res); }
+
+    return res;
+}
+
+// r := h * x mod Q
+static inline void MultModQ(
+    const uint256_t & h,
+    const uint32_t * x,
+    uint32_t * r
+)
+{
+    uint64_t m[NUM_SIZE_64 << 1];
+
+    U256MulWide(h, U256FromLittleEndian(x), m);
+    U256ToLittleEndian(ModQ(m, NUM_SIZE_64 << 1), r);
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  BLAKE2b-256 helpers
+////////////////////////////////////////////////////////////////////////////////
+// initialize context
+static inline void InitContext(ctx_t * ctx)
+{
+    memset(ctx->b, 0, BUF_SIZE_8);
+    B2B_IV(ctx->h);
+    ctx->h[0] ^= 0x01010000 ^ NUM_SIZE_8;
+    memset(ctx->t, 0, 16);
+    ctx->c = 0;
+
+    return;
+}
+
+// finalize context and dump hash -- BIG ENDIAN
+static inline void FinalContext(ctx_t * ctx, uint64_t * aux, uint8_t * hash)
+{
+    HOST_B2B_H_LAST(ctx, aux);
+
+    for (int j = 0; j < NUM_SIZE_8; ++j)
+    {
+        hash[j] = (ctx->h[j >> 3] >> ((j & 7) << 3)) & 0xFF;
+    }
+
+    return;
+}
+
+// absorb j || M up to the unfinalized context
+static void UncompleteElement(const uint32_t j, ctx_t * ctx, uint64_t * aux)
+{
+    InitContext(ctx);
+
+    //========================================================================//
+    //  Hash j and constant message
+    //========================================================================//
+    for (int i = 0; i < INDEX_SIZE_8; ++i)
+    {
+        ctx->b[i] = (j >> ((INDEX_SIZE_8 - i - 1) << 3)) & 0xFF;
+    }
+
+    memcpy(ctx->b + INDEX_SIZE_8, constMes.b, BUF_SIZE_8 - INDEX_SIZE_8);
+    ctx->c = BUF_SIZE_8;
+
+    for (
+        uint32_t pos = BUF_SIZE_8 - INDEX_SIZE_8;
+        pos + BUF_SIZE_8 <= CONST_MES_SIZE_8;
+        pos += BUF_SIZE_8
+    )
+    {
+        HOST_B2B_H(ctx, aux);
+
+        memcpy(ctx->b, constMes.b + pos, BUF_SIZE_8);
+        ctx->c = BUF_SIZE_8;
+    }
+
+    HOST_B2B_H(ctx, aux);
+
+    return;
+}
+
+// finalize j || M || pk || mes || w and rehash out of bounds hash
+static void CompleteElement(
+    const uint8_t * rem,
+    ctx_t * ctx,
+    uint64_t * aux,
+    uint256_t * num
+)
+{
+    uint8_t hash[NUM_SIZE_8];
+
+    //========================================================================//
+    //  Hash constant message tail, public key, message & one-time public key
+    //========================================================================//
+    memcpy(
+        ctx->b, constMes.b + CONST_MES_SIZE_8 - INDEX_SIZE_8, INDEX_SIZE_8
+    );
+    memcpy(ctx->b + INDEX_SIZE_8, rem, 2 * PK_SIZE_8 + NUM_SIZE_8);
+    ctx->c = INDEX_SIZE_8 + 2 * PK_SIZE_8 + NUM_SIZE_8;
+
+    FinalContext(ctx, aux, hash);
+    *num = U256FromBigEndian(hash);
+
+    //========================================================================//
+    //  Rehash out of bounds hash
+    //========================================================================//
+    while (!LessThanQ(*num))
+    {
+        InitContext(ctx);
+        memcpy(ctx->b, hash, NUM_SIZE_8);
+        ctx->c = NUM_SIZE_8;
+
+        FinalContext(ctx, aux, hash);
+        *num = U256FromBigEndian(hash);
+    }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Multi-lane BLAKE2b-256 helpers
+////////////////////////////////////////////////////////////////////////////////
+// load the same message block into all lanes
+static inline void LoadAllLanes(b2b_lanes_t * s, const uint8_t * block)
+{
+    for (uint32_t l = 0; l < B2B_LANES; ++l)
+    {
+        CpuBlakeLoad(s, l, block, BUF_SIZE_8);
+    }
+
+    return;
+}
+
+// absorb j || M up to the unfinalized contexts of B2B_LANES indices from j
+static void UncompleteLanes(const uint32_t j, b2b_lanes_t * s)
+{
+    uint8_t block[BUF_SIZE_8];
+
+    CpuBlakeInit(s);
+
+    //========================================================================//
+    //  Hash j and constant message
+    //========================================================================//
+    memcpy(block + INDEX_SIZE_8, constMes.b, BUF_SIZE_8 - INDEX_SIZE_8);
+
+    for (uint32_t l = 0; l < B2B_LANES; ++l)
+    {
+        for (int i = 0; i < INDEX_SIZE_8; ++i)
+        {
+            block[i] = ((j + l) >> ((INDEX_SIZE_8 - i - 1) << 3)) & 0xFF;
+        }
+
+        CpuBlakeLoad(s, l, block, BUF_SIZE_8);
+    }
+
+    CpuBlakeCompress(s, BUF_SIZE_8, 0);
+
+    for (
+        uint32_t pos = BUF_SIZE_8 - INDEX_SIZE_8;
+        pos + BUF_SIZE_8 <= CONST_MES_SIZE_8;
+        pos += BUF_SIZE_8
+    )
+    {
+        LoadAllLanes(s, constMes.b + pos);
+        CpuBlakeCompress(s, pos + INDEX_SIZE_8 + BUF_SIZE_8, 0);
+    }
+
+    return;
+}
+
+// finalize B2B_LANES contexts of elements from j, rehash out of bounds
+// hashes, multiply by one-time secret key mod Q and store first 'lanes'
+// of them to the table
+static void CompleteLanes(
+    const uint32_t * data,
+    b2b_lanes_t * s,
+    const uint32_t j,
+    const uint32_t lanes,
+    uint32_t * hashes
+)
+{
+    uint8_t block[BUF_SIZE_8] = {0};
+    uint8_t hash[NUM_SIZE_8];
+    uint32_t elem[NUM_SIZE_32];
+    uint256_t h;
+    ctx_t ctx;
+    uint64_t aux[32];
+
+    //========================================================================//
+    //  Hash constant message tail, public key, message & one-time public key
+    //========================================================================//
+    memcpy(block, constMes.b + CONST_MES_SIZE_8 - INDEX_SIZE_8, INDEX_SIZE_8);
+    memcpy(block + INDEX_SIZE_8, data, 2 * PK_SIZE_8 + NUM_SIZE_8);
+
+    LoadAllLanes(s, block);
+    CpuBlakeCompress(
+        s, CONST_MES_SIZE_8 + INDEX_SIZE_8 + 2 * PK_SIZE_8 + NUM_SIZE_8, 1
+    );
+
+    for (uint32_t l = 0; l < lanes; ++l)
+    {
+        CpuBlakeDump(s, l, hash);
+        h = U256FromBigEndian(hash);
+
+        //====================================================================//
+        //  Rehash out of bounds hash
+        //====================================================================//
+        while (!LessThanQ(h))
+        {
+            InitContext(&ctx);
+            memcpy(ctx.b, hash, NUM_SIZE_8);
+            ctx.c = NUM_SIZE_8;
+
+            FinalContext(&ctx, aux, hash);
+            h = U256FromBigEndian(hash);
+        }
+
+        MultModQ(h, data + COUPLED_PK_SIZE_32 + NUM_SIZE_32, elem);
+
+        for (int i = 0; i < NUM_SIZE_32; ++i)
+        {
+            hashes[TABLE_POS(j + l, i)] = elem[i];
+        }
+    }
+
+    return;
+}
+
+// hashes of the message with B2B_LANES consecutive nonces from base
+static void BlakeHashLanes(
+    const uint8_t * mes,
+    const uint64_t base,
+    b2b_lanes_t * s,
+    uint8_t * hashes
+)
+{
+    uint8_t block[NUM_SIZE_8 + NONCE_SIZE_8];
+
+    CpuBlakeInit(s);
+    memcpy(block, mes, NUM_SIZE_8);
+
+    for (uint32_t l = 0; l < B2B_LANES; ++l)
+    {
+        for (int i = 0; i < NONCE_SIZE_8; ++i)
+        {
+            block[NUM_SIZE_8 + i]
+                = ((base + l) >> ((NONCE_SIZE_8 - i - 1) << 3)) & 0xFF;
+        }
+
+        CpuBlakeLoad(s, l, block, NUM_SIZE_8 + NONCE_SIZE_8);
+    }
+
+    CpuBlakeCompress(s, NUM_SIZE_8 + NONCE_SIZE_8, 1);
+
+    for (uint32_t l = 0; l < B2B_LANES; ++l)
+    {
+        CpuBlakeDump(s, l, hashes + l * NUM_SIZE_8);
+    }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Hash of the message with nonce
+////////////////////////////////////////////////////////////////////////////////
+void CpuBlakeHash(
+    // message
+    const uint8_t * mes,
+    // nonce
+    const uint64_t nonce,
+    // hash -- BIG ENDIAN
+    uint8_t * hash
+)
+{
+    ctx_t ctx;
+    uint64_t aux[32];
+
+    InitContext(&ctx);
+    memcpy(ctx.b, mes, NUM_SIZE_8);
+
+    for (int i = 0; i < NONCE_SIZE_8; ++i)
+    {
+        ctx.b[NUM_SIZE_8 + i] = (nonce >> ((NONCE_SIZE_8 - i - 1) << 3)) & 0xFF;
+    }
+
+    ctx.c = NUM_SIZE_8 + NONCE_SIZE_8;
+
+    FinalContext(&ctx, aux, hash);
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Indices of the precalculated hashes
+////////////////////////////////////////////////////////////////////////////////
+void CpuGenIndices(
+    // hash of the message with nonce
+    const uint8_t * hash,
+    // K_LEN indices
+    uint32_t * indices
+)
+{
+    for (int k = 0; k < K_LEN; ++k)
+    {
+        indices[k]
+            = (
+                ((uint32_t)hash[k & (NUM_SIZE_8 - 1)] << 24)
+                ^ ((uint32_t)hash[(k + 1) & (NUM_SIZE_8 - 1)] << 16)
+                ^ ((uint32_t)hash[(k + 2) & (NUM_SIZE_8 - 1)] << 8)
+                ^ (uint32_t)hash[(k + 3) & (NUM_SIZE_8 - 1)]
+            ) & N_MASK;
+    }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Single precalculated hash
+////////////////////////////////////////////////////////////////////////////////
+void CpuHashElement(
+    // data: pk || mes || w || padding || x || sk
+    const uint32_t * data,
+    // unfinalized hash contexts or NULL
+    const uctx_t * uctxs,
+    // element index
+    const uint32_t j,
+    // element -- LITTLE ENDIAN
+    uint32_t * elem
+)
+{
+    ctx_t ctx;
+    uint64_t aux[32];
+    uint256_t h;
+
+    if (uctxs)
+    {
+        memcpy(ctx.h, uctxs[j].h, sizeof(ctx.h));
+        memcpy(ctx.t, uctxs[j].t, sizeof(ctx.t));
+    }
+    else { UncompleteElement(j, &ctx, aux); }
+
+    CompleteElement((const uint8_t *)data, &ctx, aux, &h);
+
+    // multiply by one-time secret key mod Q
+    MultModQ(h, data + COUPLED_PK_SIZE_32 + NUM_SIZE_32, elem);
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Sum of elements modulo Q
+////////////////////////////////////////////////////////////////////////////////
+// r := sum + Q - sk mod Q, check r < bound
+static inline int FinalizeSum(
+    const uint32_t * bound,
+    const uint32_t * sk,
+    const uint64_t * acc,
+    uint32_t * d
+)
+{
+    uint32_t words[NUM_SIZE_32];
+    uint64_t r[NUM_SIZE_64 + 1];
+    uint64_t carry = 0;
+
+    //========================================================================//
+    //  Carries propagation of 32 bits columns
+    //========================================================================//
+    for (int i = 0; i < NUM_SIZE_32; ++i)
+    {
+        carry += acc[i];
+        words[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+
+    //========================================================================//
+    //  Subtraction of secret key and result mod Q
+    //========================================================================//
+    uint256_t sum = U256FromLittleEndian(words);
+    uint256_t qsk;
+
+    U256Sub(q256, U256FromLittleEndian(sk), &qsk);
+    r[NUM_SIZE_64] = carry + U256Add(sum, qsk, &sum);
+    memcpy(r, sum.w, NUM_SIZE_8);
+
+    const uint256_t res = ModQ(r, NUM_SIZE_64 + 1);
+
+    U256ToLittleEndian(res, d);
+
+    return U256Less(res, U256FromLittleEndian(bound));
+}
+
+int CpuSumModQ(
+    // boundary for puzzle
+    const uint32_t * bound,
+    // secret key
+    const uint32_t * sk,
+    // K_LEN consecutive elements
+    const uint32_t * elems,
+    // result -- LITTLE ENDIAN
+    uint32_t * d
+)
+{
+    uint64_t acc[NUM_SIZE_32] = {0};
+
+    for (int k = 0; k < K_LEN; ++k)
+    {
+        for (int i = 0; i < NUM_SIZE_32; ++i)
+        {
+            acc[i] += elems[k * NUM_SIZE_32 + i];
+        }
+    }
+
+    return FinalizeSum(bound, sk, acc, d);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Uncompleted first iteration of hashes precalculation
+////////////////////////////////////////////////////////////////////////////////
+int CpuUncompleteInitPrehash(
+    // data: pk
+    const uint32_t * data,
+    // unfinalized hash contexts
+    uctx_t * uctxs,
+    // number of worker threads
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool
+)
+{
+    ParallelFor(
+        N_LEN / B2B_LANES, threads,
+        [=](const uint32_t, const uint32_t first, const uint32_t last)
+        {
+            b2b_lanes_t s;
+
+            for (uint32_t g = first; g < last; ++g)
+            {
+                uint32_t j = g * B2B_LANES;
+
+                UncompleteLanes(j, &s);
+
+                for (uint32_t l = 0; l < B2B_LANES; ++l)
+                {
+                    for (int i = 0; i < 8; ++i)
+                    {
+                        uctxs[j + l].h[i] = s.h[i][l];
+                    }
+
+                    uctxs[j + l].t[0] = CONST_MES_SIZE_8;
+                    uctxs[j + l].t[1] = 0;
+                }
+            }
+        },
+        pool
+    );
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Precalculate hashes
+////////////////////////////////////////////////////////////////////////////////
+int CpuPrehashRange(
+    const int keep,
+    // data: pk || mes || w || padding || x || sk
+    const uint32_t * data,
+    // unfinalized hash contexts
+    const uctx_t * uctxs,
+    // first element
+    const uint32_t first,
+    // number of elements
+    const uint32_t cnt,
+    // hashes
+    uint32_t * hashes,
+    // number of worker threads
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool
+)
+{
+    ParallelFor(
+        (cnt + B2B_LANES - 1) / B2B_LANES, threads,
+        [=](const uint32_t, const uint32_t from, const uint32_t to)
+        {
+            b2b_lanes_t s;
+
+            for (uint32_t g = from; g < to; ++g)
+            {
+                uint32_t j = first + g * B2B_LANES;
+                // last group may be partial
+                uint32_t lanes = (cnt - g * B2B_LANES < B2B_LANES)?
+                    cnt - g * B2B_LANES: B2B_LANES;
+
+                if (keep)
+                {
+                    for (uint32_t l = 0; l < B2B_LANES; ++l)
+                    {
+                        for (int i = 0; i < 8; ++i)
+                        {
+                            s.h[i][l] = uctxs[j + ((l < lanes)? l: 0)].h[i];
+                        }
+                    }
+                }
+                else { UncompleteLanes(j, &s); }
+
+                CompleteLanes(data, &s, j, lanes, hashes);
+            }
+        },
+        pool
+    );
+
+    return EXIT_SUCCESS;
+}
+
+int CpuPrehash(
+    const int keep,
+    // data: pk || mes || w || padding || x || sk
+    const uint32_t * data,
+    // unfinalized hash contexts
+    const uctx_t * uctxs,
+    // hashes
+    uint32_t * hashes,
+    // number of worker threads
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool
+)
+{
+    return CpuPrehashRange(
+        keep, data, uctxs, 0, N_LEN, hashes, threads, pool
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Prefilter of nonces
+////////////////////////////////////////////////////////////////////////////////
+void MiningPrefilter(
+    // boundary for puzzle
+    const uint32_t * bound,
+    // secret key
+    const uint32_t * sk,
+    // filter
+    prefilter_t * filter
+)
+{
+    const uint64_t boundHi = U256FromLittleEndian(bound).w[3];
+
+    // window [-K_LEN, bound_hi + 2] of (hi - sk_hi) shifted to zero
+    filter->offset = (uint64_t)K_LEN - U256FromLittleEndian(sk).w[3];
+    filter->threshold = (boundHi < UINT64_MAX - (K_LEN + 2))?
+        boundHi + K_LEN + 2: UINT64_MAX;
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Block mining
+////////////////////////////////////////////////////////////////////////////////
+// full evaluation of candidates [first, last) of the compacted list of
+// nonce offsets plus one, solutions appended to results
+static void EvaluateCandidates(
+    const uint32_t * bound,
+    const uint32_t * sk,
+    const uint8_t * mes,
+    const uint32_t * hashes,
+    const uint64_t base,
+    const uint32_t * cands,
+    const uint32_t first,
+    const uint32_t last,
+    result_t * results,
+    std::atomic<uint32_t> * found
+)
+{
+    uint8_t hash[NUM_SIZE_8];
+    // indices of this candidate and of the next one
+    uint32_t ind[2 * K_LEN];
+    uint64_t acc[NUM_SIZE_32];
+    uint32_t d[NUM_SIZE_32];
+
+    if (first < last)
+    {
+        CpuBlakeHash(mes, base + cands[first] - 1, hash);
+        CpuGenIndices(hash, ind);
+    }
+
+    for (uint32_t c = first; c < last; ++c)
+    {
+        const uint32_t * cur = ind + ((c - first) & 1) * K_LEN;
+        uint32_t * next = ind + ((c - first + 1) & 1) * K_LEN;
+
+        // low parts of the next candidate are read while this one is summed
+        if (c + 1 < last)
+        {
+            CpuBlakeHash(mes, base + cands[c + 1] - 1, hash);
+            CpuGenIndices(hash, next);
+
+            for (int k = 0; k < K_LEN; ++k)
+            {
+                CpuPrefetch(hashes + TABLE_POS(next[k], 0));
+                CpuPrefetch(hashes + TABLE_POS(next[k], TABLE_LO_SIZE_32 - 1));
+            }
+        }
+
+        memset(acc, 0, sizeof(acc));
+
+        for (int k = 0; k < K_LEN; ++k)
+        {
+            for (int i = 0; i < NUM_SIZE_32; ++i)
+            {
+                acc[i] += hashes[TABLE_POS(cur[k], i)];
+            }
+        }
+
+        if (FinalizeSum(bound, sk, acc, d))
+        {
+            uint32_t slot = (*found)++;
+
+            if (slot < MAX_RESULTS)
+            {
+                results[slot].nonce = base + cands[c] - 1;
+                memcpy(results[slot].d, d, NUM_SIZE_8);
+            }
+        }
+    }
+
+    return;
+}
+
+int CpuBlockMining(
+    // boundary for puzzle
+    const uint32_t * bound,
+    // precalculated hashes
+    const uint32_t * hashes,
+    // data: pk || mes || w || padding || x || sk
+    const uint32_t * data,
+    // first nonce of the iteration
+    const uint64_t base,
+    // number of nonces
+    const uint32_t len,
+    // solutions, MAX_RESULTS at most
+    result_t * results,
+    // number of solutions found, may exceed MAX_RESULTS
+    uint32_t * count,
+    // survivors of the prefilter or NULL
+    uint32_t * flags,
+    // compacted survivors or NULL
+    uint32_t * cands,
+    // survivors of compaction chunks or NULL
+    uint32_t * counts,
+    // number of worker threads
+    const uint32_t threads,
+    // persistent workers or NULL
+    CpuPool * pool
+)
+{
+    const uint8_t * mes = (const uint8_t *)data + PK_SIZE_8;
+    const uint32_t * sk = data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32;
+    const uint64_t * hi = (const uint64_t *)hashes;
+
+    prefilter_t filter;
+
+    MiningPrefilter(bound, sk, &filter);
+
+    // work buffers of the call if the caller keeps none
+    std::vector<uint32_t> own(((flags)? 0: len) + ((cands)? 0: len));
+
+    if (!flags) { flags = own.data(); }
+    if (!cands) { cands = own.data() + own.size() - len; }
+
+    //========================================================================//
+    //  Prefilter by high 64 bits of elements
+    //========================================================================//
+    // flags: nonce offset plus one of every survivor, zero for the rest
+    ParallelFor(
+        len, threads,
+        [&](const uint32_t, const uint32_t first, const uint32_t last)
+        {
+            b2b_lanes_t s;
+            uint8_t hash[B2B_LANES * NUM_SIZE_8];
+            // indices of nonces with table reads in flight
+            uint32_t ring[CPU_GATHER_DEPTH * K_LEN];
+
+            // nonce n is issued at step n and consumed at step
+            // n + CPU_GATHER_DEPTH, its slot of the ring is reused then
+            for (uint32_t n = first; n < last + CPU_GATHER_DEPTH; ++n)
+            {
+                uint32_t * slot = ring + (n % CPU_GATHER_DEPTH) * K_LEN;
+
+                if (n - first >= CPU_GATHER_DEPTH)
+                {
+                    const uint32_t done = n - CPU_GATHER_DEPTH;
+                    uint64_t sum = filter.offset;
+
+                    for (int k = 0; k < K_LEN; ++k) { sum += hi[slot[k]]; }
+
+                    flags[done] = (sum <= filter.threshold) * (done + 1);
+                }
+
+                // indices and prefetch of their high 64 bits
+                if (n < last)
+                {
+                    uint32_t l = (n - first) % B2B_LANES;
+
+                    if (!l) { BlakeHashLanes(mes, base + n, &s, hash); }
+
+                    CpuGenIndices(hash + l * NUM_SIZE_8, slot);
+
+                    for (int k = 0; k < K_LEN; ++k)
+                    {
+                        CpuPrefetch(hi + slot[k]);
+                    }
+                }
+            }
+        },
+        pool
+    );
+
+    //========================================================================//
+    //  Compaction of survivors
+    //========================================================================//
+    const uint32_t cnt = CpuCompactify(
+        flags, len, cands, threads, pool, counts
+    );
+
+    //========================================================================//
+    //  Full evaluation of candidates
+    //========================================================================//
+    // solutions are appended by all workers
+    std::atomic<uint32_t> found(0);
+
+    ParallelFor(
+        cnt, threads,
+        [&](const uint32_t, const uint32_t first, const uint32_t last)
+        {
+            EvaluateCandidates(
+                bound, sk, mes, hashes, base, cands, first, last,
+                results, &found
+            );
+        },
+        pool
+    );
+
+    *count = found;
+
+    return EXIT_SUCCESS;
+}
+
+// cpumining.cc
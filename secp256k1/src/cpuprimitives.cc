@@ -0,0 +1,295 @@
+// cpuprimitives.cc
+
+/*******************************************************************************
+
+    CPUPRIMITIVES -- Host parallel reduction, scan and stream compaction
+
+*******************************************************************************/
+
+#include "../include/cpuprimitives.h"
+#include "../include/definitions.h"
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+//  Worker threads
+////////////////////////////////////////////////////////////////////////////////
+uint32_t CpuThreads(const uint32_t threads)
+{
+    if (threads) { return threads; }
+
+    uint32_t cores = std::thread::hardware_concurrency();
+
+    return (cores)? cores: 1;
+}
+
+CpuPool::CpuPool(
+    const uint32_t threads,
+    const std::function<void(uint32_t)> & init
+):
+    job(NULL), num(0), stopping(0), pending(0)
+{
+    const uint32_t size = CpuThreads(threads);
+
+    for (uint32_t w = 0; w < size; ++w)
+    {
+        workers.push_back(std::thread(&CpuPool::Work, this, w, init));
+    }
+}
+
+CpuPool::~CpuPool(void)
+{
+    stopping = 1;
+    ++start;
+
+    for (uint32_t w = 0; w < workers.size(); ++w) { workers[w].join(); }
+}
+
+void CpuPool::Run(
+    const uint32_t num,
+    const std::function<void(uint32_t)> & job
+)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // every worker takes part in a round, so none of them can read the job
+    // of the next one before it is set
+    this->job = &job;
+    this->num = num;
+    pending = workers.size();
+
+    uint_t seen = finish.load();
+
+    ++start;
+
+    while (finish.Wait(seen, 1000) == seen) {}
+
+    return;
+}
+
+void CpuPool::Work(
+    const uint32_t worker,
+    std::function<void(uint32_t)> init
+)
+{
+    uint_t seen = 0;
+
+    if (init) { init(worker); }
+
+    while (1)
+    {
+        uint_t round = start.Wait(seen, 1000);
+
+        if (round == seen) { continue; }
+
+        seen = round;
+
+        if (stopping) { return; }
+
+        if (worker < num) { (*job)(worker); }
+
+        if (--pending == 0) { ++finish; }
+    }
+}
+
+// number of workers, CPU_PRIMITIVES_GRAIN elements at least per worker,
+// as many chunks as ParallelFor makes
+static uint32_t Workers(
+    const uint32_t len,
+    const uint32_t threads,
+    const CpuPool * pool
+)
+{
+    uint32_t num = CpuThreads(threads);
+    uint32_t most = len / CPU_PRIMITIVES_GRAIN;
+
+    if (pool && num > pool->Size()) { num = pool->Size(); }
+
+    if (!most) { most = 1; }
+
+    return (num < most)? num: most;
+}
+
+// sums of chunks to their offsets, total returned
+static uint32_t ScanChunks(uint32_t * sums, const uint32_t num)
+{
+    uint32_t total = 0;
+
+    for (uint32_t t = 0; t < num; ++t)
+    {
+        uint32_t sum = sums[t];
+
+        sums[t] = total;
+        total += sum;
+    }
+
+    return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Reduction
+////////////////////////////////////////////////////////////////////////////////
+uint32_t CpuFindSum(
+    const uint32_t * in,
+    const uint32_t inlen,
+    const uint32_t threads,
+    CpuPool * pool
+)
+{
+    const uint32_t num = Workers(inlen, threads, pool);
+    std::vector<uint32_t> sums(num, 0);
+
+    ParallelFor(
+        inlen, num,
+        [&](const uint32_t t, const uint32_t first, const uint32_t last)
+        {
+            uint32_t sum = 0;
+
+            for (uint32_t i = first; i < last; ++i) { sum += in[i]; }
+
+            sums[t] = sum;
+        },
+        pool
+    );
+
+    return ScanChunks(sums.data(), num);
+}
+
+uint32_t CpuFindNonZero(
+    const uint32_t * in,
+    const uint32_t inlen,
+    const uint32_t threads,
+    CpuPool * pool
+)
+{
+    const uint32_t num = Workers(inlen, threads, pool);
+    std::vector<uint32_t> items(num, 0);
+
+    ParallelFor(
+        inlen, num,
+        [&](const uint32_t t, const uint32_t first, const uint32_t last)
+        {
+            uint32_t i = first;
+
+            while (i < last && !in[i]) { ++i; }
+
+            items[t] = (i < last)? in[i]: 0;
+        },
+        pool
+    );
+
+    for (uint32_t t = 0; t < num; ++t)
+    {
+        if (items[t]) { return items[t]; }
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Scan
+////////////////////////////////////////////////////////////////////////////////
+uint32_t CpuExclusiveScan(
+    const uint32_t * in,
+    const uint32_t inlen,
+    uint32_t * out,
+    const uint32_t threads,
+    CpuPool * pool
+)
+{
+    const uint32_t num = Workers(inlen, threads, pool);
+    std::vector<uint32_t> sums(num, 0);
+
+    // sums of chunks
+    ParallelFor(
+        inlen, num,
+        [&](const uint32_t t, const uint32_t first, const uint32_t last)
+        {
+            uint32_t sum = 0;
+
+            for (uint32_t i = first; i < last; ++i) { sum += in[i]; }
+
+            sums[t] = sum;
+        },
+        pool
+    );
+
+    const uint32_t total = ScanChunks(sums.data(), num);
+
+    // chunks from their offsets
+    ParallelFor(
+        inlen, num,
+        [&](const uint32_t t, const uint32_t first, const uint32_t last)
+        {
+            uint32_t sum = sums[t];
+
+            for (uint32_t i = first; i < last; ++i)
+            {
+                uint32_t item = in[i];
+
+                out[i] = sum;
+                sum += item;
+            }
+        },
+        pool
+    );
+
+    return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Stream compaction
+////////////////////////////////////////////////////////////////////////////////
+uint32_t CpuCompactify(
+    const uint32_t * in,
+    const uint32_t inlen,
+    uint32_t * out,
+    const uint32_t threads,
+    CpuPool * pool,
+    uint32_t * counts
+)
+{
+    const uint32_t num = Workers(inlen, threads, pool);
+    // no allocation if counts are given
+    std::vector<uint32_t> own((counts)? 0: num);
+
+    if (!counts) { counts = own.data(); }
+
+    // nonzero elements of chunks
+    ParallelFor(
+        inlen, num,
+        [&](const uint32_t t, const uint32_t first, const uint32_t last)
+        {
+            uint32_t count = 0;
+
+            for (uint32_t i = first; i < last; ++i) { count += (in[i] != 0); }
+
+            counts[t] = count;
+        },
+        pool
+    );
+
+    const uint32_t total = ScanChunks(counts, num);
+
+    // every element is written, only nonzero ones advance
+    ParallelFor(
+        inlen, num,
+        [&](const uint32_t t, const uint32_t first, const uint32_t last)
+        {
+            uint32_t * tail = out + counts[t];
+            uint32_t * end = out + ((t + 1 < num)? counts[t + 1]: total);
+
+            for (uint32_t i = first; i < last && tail < end; ++i)
+            {
+                *tail = in[i];
+                tail += (in[i] != 0);
+            }
+        },
+        pool
+    );
+
+    return total;
+}
+
+// cpuprimitives.cc
@@ -9,6 +9,7 @@
 #include "../include/cryptography.h"
 #include "../include/conversion.h"
 #include "../include/definitions.h"
+#include "../include/uint256.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -64,21 +65,14 @@ int GenerateSecKey(
     //====================================================================//
     //  Mod Q
     //====================================================================//
-    uint8_t borrow[2];
+    const uint256_t q(Q0, Q1, Q2, Q3);
+    uint256_t num = U256FromLittleEndian(sk);
 
-    borrow[0] = ((uint64_t *)sk)[0] < Q0;
-    aux[0] = ((uint64_t *)sk)[0] - Q0;
-
-    borrow[1] = ((uint64_t *)sk)[1] < Q1 + borrow[0];
-    aux[1] = ((uint64_t *)sk)[1] - Q1 - borrow[0];
-
-    borrow[0] = ((uint64_t *)sk)[2] < Q2 + borrow[1];
-    aux[2] = ((uint64_t *)sk)[2] - Q2 - borrow[1];
-
-    borrow[1] = ((uint64_t *)sk)[3] < Q3 + borrow[0];
-    aux[3] = ((uint64_t *)sk)[3] - Q3 - borrow[0];
-
-    if (!(borrow[1] || borrow[0])) { memcpy(sk, aux, NUM_SIZE_8); }
+    if (!U256Less(num, q))
+    {
+        U256Sub(num, q, &num);
+        U256ToLittleEndian(num, sk);
+    }
 
     // convert secret key to hex string
     LittleEndianToHexStr(sk, NUM_SIZE_8, skstr);
@@ -0,0 +1,566 @@
+// cudabackend.cu
+
+/*******************************************************************************
+
+    CUDABACKEND -- CUDA mining device
+
+*******************************************************************************/
+
+#include "../include/cpumining.h"
+#include "../include/cudabackend.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include "../include/mining.h"
+#include "../include/prehash.h"
+#include "../include/topology.h"
+#include <cuda.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+//  Construction
+////////////////////////////////////////////////////////////////////////////////
+CudaBackend::CudaBackend(const int deviceId):
+    deviceId(deviceId), pci(-1, -1), node(-1), keep(0), bound_d(NULL),
+    data_d(NULL), bhashes_d(NULL), cands_d(NULL), invalid_d(NULL),
+    hashes_d(NULL), results_d(NULL), count_d(NULL), uctxs_d(NULL),
+    backBound_d(NULL), backData_d(NULL), backHashes_d(NULL), stream(NULL),
+    built(NULL)
+{
+    cudaDeviceProp props;
+    int driver = 0;
+
+    sprintf(name, "GPU %i", deviceId);
+
+    geometry.blockDim = BLOCK_DIM;
+    geometry.nonces = NONCES_PER_ITER;
+
+    if (cudaGetDeviceProperties(&props, deviceId) == cudaSuccess)
+    {
+        char ids[64];
+
+        pci = std::make_pair(props.pciBusID, props.pciDeviceID);
+        node = PciNumaNode(
+            props.pciDomainID, props.pciBusID, props.pciDeviceID
+        );
+        cudaDriverGetVersion(&driver);
+
+        sprintf(
+            ids, " sm_%i%i driver %i", props.major, props.minor, driver
+        );
+
+        key = std::string(props.name) + ids;
+    }
+}
+
+CudaBackend::~CudaBackend(void)
+{
+    Release();
+}
+
+int CudaBackend::Enumerate(std::vector<MiningBackend *> * backends)
+{
+    int deviceCount;
+
+    if (cudaGetDeviceCount(&deviceCount) != cudaSuccess)
+    {
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < deviceCount; ++i)
+    {
+        backends->push_back(new CudaBackend(i));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Memory allocation
+////////////////////////////////////////////////////////////////////////////////
+int CudaBackend::Allocate(
+    const uint8_t * pk,
+    const uint8_t * sk,
+    int * keepPrehash,
+    int * doubleBuffer
+)
+{
+    CUDA_CALL(cudaSetDevice(deviceId));
+    cudaSetDeviceFlags(cudaDeviceScheduleBlockingSync);
+
+    //========================================================================//
+    //  Check GPU memory
+    //========================================================================//
+    size_t freeMem;
+    size_t totalMem;
+
+    CUDA_CALL(cudaMemGetInfo(&freeMem, &totalMem));
+    
+    if (freeMem < MIN_FREE_MEMORY)
+    {
+        LOG(ERROR) << "Not enough GPU memory for mining,"
+            << " minimum 2.8 GiB needed";
+
+        return EXIT_FAILURE;
+    }
+
+    if (*keepPrehash && freeMem < MIN_FREE_MEMORY_PREHASH)
+    {
+        LOG(ERROR) << "Not enough memory for keeping prehashes, "
+                   << "setting keepPrehash to false";
+
+        *keepPrehash = 0;
+    }
+
+    keep = *keepPrehash;
+
+    if (
+        *doubleBuffer
+        && freeMem < ((keep)? MIN_FREE_MEMORY_PREHASH: MIN_FREE_MEMORY)
+        + (size_t)N_LEN * NUM_SIZE_8
+    )
+    {
+        LOG(ERROR) << "Not enough memory for double buffering, "
+                   << "setting doubleBuffer to false";
+
+        *doubleBuffer = 0;
+    }
+
+    //========================================================================//
+    //  Device memory allocation
+    //========================================================================//
+    LOG(INFO) << name << " allocating memory";
+
+    // boundary for puzzle
+    // (2 * PK_SIZE_8 + 2 + 4 * NUM_SIZE_8 + 212 + 4) bytes // ~0 MiB
+    CUDA_CALL(cudaMalloc(&bound_d, NUM_SIZE_8 + DATA_SIZE_8));
+    // data: pk || mes || w || padding || x || sk || ctx
+    data_d = bound_d + NUM_SIZE_32;
+    
+    // hashes of the message with nonces, for the largest geometry
+    // NONCES_PER_ITER * NUM_SIZE_8 bytes // 256 MiB
+    CUDA_CALL(cudaMalloc(&bhashes_d, (NUM_SIZE_8)*NONCES_PER_ITER));
+
+    // solution candidates of the prefilter and their number
+    // (NONCES_PER_ITER + 1) * 4 bytes // 32 MiB
+    CUDA_CALL(cudaMalloc(&cands_d, (NONCES_PER_ITER + 1) * sizeof(uint32_t)));
+
+    // out of range hashes of a prehash and their number, front and back
+    // buffers
+    CUDA_CALL(cudaMalloc(
+        &invalid_d, 2 * (MAX_INVALID + 1) * sizeof(uint32_t)
+    ));
+
+    // precalculated hashes
+    // N_LEN * NUM_SIZE_8 bytes // 2 GiB
+    CUDA_CALL(cudaMalloc(&hashes_d, (uint32_t)N_LEN * NUM_SIZE_8));
+
+    // solutions of the puzzle and their number
+    CUDA_CALL(cudaMalloc(
+        &results_d, MAX_RESULTS * sizeof(result_t) + sizeof(uint32_t)
+    ));
+    count_d = (uint32_t *)(results_d + MAX_RESULTS);
+
+    CUDA_CALL(cudaMemset(count_d, 0, sizeof(uint32_t)));
+
+    // unfinalized hash contexts
+    // if keepPrehash == true // N_LEN * 80 bytes // 5 GiB
+    if (keep)
+    {
+        CUDA_CALL(cudaMalloc(&uctxs_d, (uint32_t)N_LEN * sizeof(uctx_t)));
+    }
+
+    //========================================================================//
+    //  Key-pair transfer form host to device
+    //========================================================================//
+    // copy public key
+    CUDA_CALL(cudaMemcpy(data_d, pk, PK_SIZE_8, cudaMemcpyHostToDevice));
+
+    // copy secret key
+    CUDA_CALL(cudaMemcpy(
+        data_d + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, sk, NUM_SIZE_8,
+        cudaMemcpyHostToDevice
+    ));
+
+    cpySkSymbol((uint8_t *)sk);
+    memcpy(sk_h, sk, NUM_SIZE_8);
+
+    //========================================================================//
+    //  Back buffer allocation
+    //========================================================================//
+    // if doubleBuffer == true // N_LEN * NUM_SIZE_8 bytes // 2 GiB
+    if (*doubleBuffer)
+    {
+        CUDA_CALL(cudaMalloc(&backBound_d, NUM_SIZE_8 + DATA_SIZE_8));
+        backData_d = backBound_d + NUM_SIZE_32;
+
+        CUDA_CALL(cudaMalloc(&backHashes_d, (uint32_t)N_LEN * NUM_SIZE_8));
+
+        CUDA_CALL(cudaMemcpy(
+            backBound_d, bound_d, NUM_SIZE_8 + DATA_SIZE_8,
+            cudaMemcpyDeviceToDevice
+        ));
+
+        // mining kernels in the legacy default stream must not wait for it
+        CUDA_CALL(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+        CUDA_CALL(cudaEventCreateWithFlags(&built, cudaEventDisableTiming));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void CudaBackend::Release(void)
+{
+    if (bound_d) { cudaFree(bound_d); }
+    if (bhashes_d) { cudaFree(bhashes_d); }
+    if (cands_d) { cudaFree(cands_d); }
+    if (invalid_d) { cudaFree(invalid_d); }
+    if (hashes_d) { cudaFree(hashes_d); }
+    if (results_d) { cudaFree(results_d); }
+    if (uctxs_d) { cudaFree(uctxs_d); }
+    if (stream) { cudaStreamSynchronize(stream); }
+    if (backBound_d) { cudaFree(backBound_d); }
+    if (backHashes_d) { cudaFree(backHashes_d); }
+    if (built) { cudaEventDestroy(built); }
+    if (stream) { cudaStreamDestroy(stream); }
+
+    bound_d = data_d = bhashes_d = cands_d = invalid_d = hashes_d = NULL;
+    count_d = NULL;
+    results_d = NULL;
+    backBound_d = backData_d = backHashes_d = NULL;
+    uctxs_d = NULL;
+    stream = NULL;
+    built = NULL;
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Hashes precalculation
+////////////////////////////////////////////////////////////////////////////////
+int CudaBackend::InitPrehash(void)
+{
+    if (!keep) { return EXIT_SUCCESS; }
+
+    LOG(INFO) << "Preparing unfinalized hashes on " << name;
+
+    UncompleteInitPrehash<<<1 + (N_LEN - 1) / BLOCK_DIM, BLOCK_DIM>>>(
+        data_d, uctxs_d
+    );
+
+    CUDA_CALL(cudaDeviceSynchronize());
+
+    return EXIT_SUCCESS;
+}
+
+int CudaBackend::UploadBlock(
+    const uint8_t * bound,
+    const uint8_t * mes,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    memcpy(mes_h, mes, NUM_SIZE_8);
+    MiningPrefilter((const uint32_t *)bound, sk_h, &filter);
+
+    // copy boundary
+    CUDA_CALL(cudaMemcpy(
+        bound_d, bound, NUM_SIZE_8, cudaMemcpyHostToDevice
+    ));
+
+    // copy message
+    CUDA_CALL(cudaMemcpy(
+        ((uint8_t *)data_d + PK_SIZE_8), mes, NUM_SIZE_8,
+        cudaMemcpyHostToDevice
+    ));
+
+    // copy one time secret key
+    CUDA_CALL(cudaMemcpy(
+        (data_d + COUPLED_PK_SIZE_32 + NUM_SIZE_32), x, NUM_SIZE_8,
+        cudaMemcpyHostToDevice
+    ));
+
+    // copy one time public key
+    CUDA_CALL(cudaMemcpy(
+        ((uint8_t *)data_d + PK_SIZE_8 + NUM_SIZE_8), w, PK_SIZE_8,
+        cudaMemcpyHostToDevice
+    ));
+
+    return EXIT_SUCCESS;
+}
+
+int CudaBackend::UploadBound(const uint8_t * bound)
+{
+    MiningPrefilter((const uint32_t *)bound, sk_h, &filter);
+
+    CUDA_CALL(cudaMemcpy(
+        bound_d, bound, NUM_SIZE_8, cudaMemcpyHostToDevice
+    ));
+
+    return EXIT_SUCCESS;
+}
+
+int CudaBackend::Prehash(void)
+{
+    ::Prehash(keep, data_d, uctxs_d, hashes_d, invalid_d, 0);
+
+    // calculate unfinalized hash of message
+    VLOG(1) << "Starting InitMining";
+    InitMining(&ctx_h, (uint32_t *)mes_h, NUM_SIZE_8);
+
+    CUDA_CALL(cudaDeviceSynchronize());
+
+    // copy context
+    CUDA_CALL(cudaMemcpy(
+        data_d + COUPLED_PK_SIZE_32 + 3 * NUM_SIZE_32, &ctx_h,
+        sizeof(ctx_t), cudaMemcpyHostToDevice
+    ));
+
+    cpyCtxSymbol((ctx_t *)(data_d + COUPLED_PK_SIZE_32 + 3 * NUM_SIZE_32));
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Block mining
+////////////////////////////////////////////////////////////////////////////////
+int CudaBackend::Mine(const uint64_t base)
+{
+    CUDA_CALL(cudaMemsetAsync(count_d, 0, sizeof(uint32_t), 0));
+
+    return LaunchMining(
+        geometry, filter, bound_d, hashes_d, data_d, base, results_d, count_d,
+        bhashes_d, cands_d
+    );
+}
+
+int CudaBackend::FetchResults(
+    result_t * results,
+    uint32_t * count,
+    uint32_t * lost
+)
+{
+    uint32_t found;
+
+    CUDA_CALL(cudaMemcpy(
+        &found, count_d, sizeof(uint32_t), cudaMemcpyDeviceToHost
+    ));
+
+    *count = (found < MAX_RESULTS)? found: MAX_RESULTS;
+    *lost = found - *count;
+
+    // solutions found
+    if (*count)
+    {
+        CUDA_CALL(cudaMemcpy(
+            results, results_d, *count * sizeof(result_t),
+            cudaMemcpyDeviceToHost
+        ));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Double buffered hash table
+////////////////////////////////////////////////////////////////////////////////
+// wakes the miner thread once the stream reaches it
+static void CUDART_CB BackBuilt(void * epoch)
+{
+    ++(*(epoch_t *)epoch);
+}
+
+int CudaBackend::PrehashBack(
+    const uint8_t * bound,
+    const uint8_t * mes,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    if (!backHashes_d) { return EXIT_FAILURE; }
+
+    // calculate unfinalized hash of message
+    InitMining(&backCtx_h, (const uint32_t *)mes, NUM_SIZE_8);
+    MiningPrefilter((const uint32_t *)bound, sk_h, &backFilter);
+
+    // pageable host memory: copies return after staging the data
+    CUDA_CALL(cudaMemcpyAsync(
+        backBound_d, bound, NUM_SIZE_8, cudaMemcpyHostToDevice, stream
+    ));
+
+    CUDA_CALL(cudaMemcpyAsync(
+        ((uint8_t *)backData_d + PK_SIZE_8), mes, NUM_SIZE_8,
+        cudaMemcpyHostToDevice, stream
+    ));
+
+    CUDA_CALL(cudaMemcpyAsync(
+        (backData_d + COUPLED_PK_SIZE_32 + NUM_SIZE_32), x, NUM_SIZE_8,
+        cudaMemcpyHostToDevice, stream
+    ));
+
+    CUDA_CALL(cudaMemcpyAsync(
+        ((uint8_t *)backData_d + PK_SIZE_8 + NUM_SIZE_8), w, PK_SIZE_8,
+        cudaMemcpyHostToDevice, stream
+    ));
+
+    CUDA_CALL(cudaMemcpyAsync(
+        backData_d + COUPLED_PK_SIZE_32 + 3 * NUM_SIZE_32, &backCtx_h,
+        sizeof(ctx_t), cudaMemcpyHostToDevice, stream
+    ));
+
+    ::Prehash(
+        keep, backData_d, uctxs_d, backHashes_d, invalid_d + MAX_INVALID + 1,
+        stream
+    );
+
+    CUDA_CALL(cudaEventRecord(built, stream));
+    CUDA_CALL(cudaLaunchHostFunc(stream, BackBuilt, &backBuilt));
+
+    return EXIT_SUCCESS;
+}
+
+int CudaBackend::BackReady(int * ready)
+{
+    cudaError_t status = cudaEventQuery(built);
+
+    if (status != cudaSuccess && status != cudaErrorNotReady)
+    {
+        LOG(ERROR) << name << " back buffer prehash failed: "
+            << cudaGetErrorString(status);
+
+        return EXIT_FAILURE;
+    }
+
+    *ready = (status == cudaSuccess);
+
+    return EXIT_SUCCESS;
+}
+
+int CudaBackend::WaitBack(int * ready, const uint32_t ms)
+{
+    // advance after the check is not missed
+    uint_t seen = backBuilt.load();
+
+    if (BackReady(ready) != EXIT_SUCCESS) { return EXIT_FAILURE; }
+
+    if (!*ready)
+    {
+        backBuilt.Wait(seen, ms);
+
+        return BackReady(ready);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int CudaBackend::SwapBuffers(void)
+{
+    CUDA_CALL(cudaEventSynchronize(built));
+    // mining kernels of the front buffer
+    CUDA_CALL(cudaDeviceSynchronize());
+
+    std::swap(bound_d, backBound_d);
+    std::swap(data_d, backData_d);
+    std::swap(hashes_d, backHashes_d);
+    std::swap(filter, backFilter);
+
+    ctx_h = backCtx_h;
+    cpyCtxSymbol(&ctx_h);
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Mining geometry
+////////////////////////////////////////////////////////////////////////////////
+void CudaBackend::Geometries(std::vector<geometry_t> * candidates) const
+{
+    const uint32_t dims[] = MINING_BLOCK_DIMS;
+    geometry_t geom;
+
+    candidates->clear();
+
+    for (uint32_t i = 0; i < sizeof(dims) / sizeof(dims[0]); ++i)
+    {
+        geom.blockDim = dims[i];
+
+        for (
+            geom.nonces = (NONCES_PER_ITER < TUNE_MIN_NONCES)?
+                NONCES_PER_ITER: TUNE_MIN_NONCES;
+            geom.nonces <= NONCES_PER_ITER;
+            geom.nonces <<= 1
+        )
+        {
+            candidates->push_back(geom);
+        }
+    }
+
+    return;
+}
+
+int CudaBackend::SetGeometry(const geometry_t & geom)
+{
+    const uint32_t dims[] = MINING_BLOCK_DIMS;
+    int known = 0;
+
+    for (uint32_t i = 0; i < sizeof(dims) / sizeof(dims[0]); ++i)
+    {
+        known |= (geom.blockDim == dims[i]);
+    }
+
+    // every thread of hashing kernel takes 4 nonces
+    if (
+        !known || geom.nonces > NONCES_PER_ITER
+        || geom.nonces & (geom.nonces - 1)
+        || geom.nonces < 4 * NONCES_PER_THREAD * geom.blockDim
+    )
+    {
+        LOG(ERROR) << name << " unsupported mining geometry: block "
+            << geom.blockDim << ", " << geom.nonces << " nonces";
+
+        return EXIT_FAILURE;
+    }
+
+    geometry = geom;
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Unfinalized hash contexts transfer
+////////////////////////////////////////////////////////////////////////////////
+int CudaBackend::UploadUctxs(
+    const uint32_t first,
+    const uint32_t cnt,
+    const uctx_t * uctxs
+)
+{
+    if (!uctxs_d) { return EXIT_FAILURE; }
+
+    CUDA_CALL(cudaMemcpy(
+        uctxs_d + first, uctxs, (size_t)cnt * sizeof(uctx_t),
+        cudaMemcpyHostToDevice
+    ));
+
+    return EXIT_SUCCESS;
+}
+
+int CudaBackend::DownloadUctxs(
+    const uint32_t first,
+    const uint32_t cnt,
+    uctx_t * uctxs
+)
+{
+    if (!uctxs_d) { return EXIT_FAILURE; }
+
+    CUDA_CALL(cudaMemcpy(
+        uctxs, uctxs_d + first, (size_t)cnt * sizeof(uctx_t),
+        cudaMemcpyDeviceToHost
+    ));
+
+    return EXIT_SUCCESS;
+}
+
+// cudabackend.cu
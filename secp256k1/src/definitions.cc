@@ -9,6 +9,10 @@
 #include "../include/definitions.h"
 #include "../include/jsmn.h"
 #include <stddef.h>
+#include <chrono>
+#include <utility>
+
+using namespace std::chrono;
 
 ////////////////////////////////////////////////////////////////////////////////
 //  Initialize JSON string
@@ -29,6 +33,10 @@ json_t::json_t(
         toks, (jsmntok_t *)malloc(toklen * sizeof(jsmntok_t)), ERROR_ALLOC
     );
 
+    this->toklen = toklen;
+    hash = JSON_HASH_BASIS;
+    mesPos = boundPos = pkPos = -1;
+
     return;
 }
 
@@ -46,6 +54,12 @@ json_t::json_t(const json_t & newjson)
     FREE(toks);
     toks = newjson.toks;
 
+    toklen = newjson.toklen;
+    hash = newjson.hash;
+    mesPos = newjson.mesPos;
+    boundPos = newjson.boundPos;
+    pkPos = newjson.pkPos;
+
     return;
 }
 
@@ -60,6 +74,24 @@ json_t::~json_t(void)
     return;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//  Exchange JSON strings, buffers are not copied
+////////////////////////////////////////////////////////////////////////////////
+void json_t::Swap(json_t & other)
+{
+    std::swap(cap, other.cap);
+    std::swap(len, other.len);
+    std::swap(ptr, other.ptr);
+    std::swap(toks, other.toks);
+    std::swap(toklen, other.toklen);
+    std::swap(hash, other.hash);
+    std::swap(mesPos, other.mesPos);
+    std::swap(boundPos, other.boundPos);
+    std::swap(pkPos, other.pkPos);
+
+    return;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //  Token name check
 ////////////////////////////////////////////////////////////////////////////////
@@ -74,4 +106,89 @@ int json_t::jsoneq(const int pos, const char * str)
     return 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//  Epoch counter
+////////////////////////////////////////////////////////////////////////////////
+static int64_t NowUs(void)
+{
+    return duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+epoch_t::epoch_t(const uint_t val):
+    value(val), stamp(0), wakeups(0), totalLatency(0), maxLatency(0)
+{}
+
+uint_t epoch_t::operator++(void)
+{
+    uint_t val;
+
+    // update under mutex so that a waiter can not miss the wakeup
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        stamp = NowUs();
+        val = ++value;
+    }
+
+    cond.notify_all();
+
+    return val;
+}
+
+epoch_t & epoch_t::operator=(const uint_t val)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        stamp = NowUs();
+        value = val;
+    }
+
+    cond.notify_all();
+
+    return *this;
+}
+
+uint_t epoch_t::Wait(const uint_t seen, const uint32_t ms)
+{
+    uint_t val = value.load();
+
+    if (val != seen) { return val; }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    cond.wait_for(
+        lock, milliseconds(ms), [&](){ return value.load() != seen; }
+    );
+
+    val = value.load();
+
+    if (val != seen)
+    {
+        uint64_t latency = NowUs() - stamp.load();
+        uint64_t max = maxLatency.load();
+
+        ++wakeups;
+        totalLatency += latency;
+
+        while (latency > max && !maxLatency.compare_exchange_weak(
+            max, latency
+        ));
+    }
+
+    return val;
+}
+
+void epoch_t::Latency(uint64_t * avg, uint64_t * max) const
+{
+    uint64_t cnt = wakeups.load();
+
+    *avg = (cnt)? totalLatency.load() / cnt: 0;
+    *max = maxLatency.load();
+
+    return;
+}
+
 // definitions.cc
@@ -0,0 +1,249 @@
+// hostarena.cc
+
+/*******************************************************************************
+
+    HOSTARENA -- Host buffers of the table and of the contexts on huge pages
+
+*******************************************************************************/
+
+#include "../include/hostarena.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#endif
+
+// names of pages
+static const char * pageNames[] = {
+    "4 KiB pages", "transparent huge pages", "2 MiB pages", "1 GiB pages"
+};
+
+static const size_t size2M = (size_t)1 << 21;
+static const size_t size1G = (size_t)1 << 30;
+
+////////////////////////////////////////////////////////////////////////////////
+//  Mappings
+////////////////////////////////////////////////////////////////////////////////
+static size_t RoundUp(const size_t size, const size_t align)
+{
+    return (size + align - 1) / align * align;
+}
+
+#ifndef _WIN32
+// anonymous mapping, NULL on failure
+static void * MapAnonymous(const size_t size, const int flags)
+{
+    void * ptr = mmap(
+        NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags,
+        -1, 0
+    );
+
+    return (ptr == MAP_FAILED)? NULL: ptr;
+}
+
+// mapping from the hugetlbfs pool of pages of 2^shift bytes
+static void * MapHuge(const size_t size, const int shift)
+{
+#ifdef MAP_HUGETLB
+    return MapAnonymous(size, MAP_HUGETLB | (shift << MAP_HUGE_SHIFT));
+#else
+    return NULL;
+#endif
+}
+
+// 2 MiB aligned mapping advised for transparent huge pages
+static void * MapTransparent(const size_t size, pages_t * pages)
+{
+    uint8_t * raw = (uint8_t *)MapAnonymous(size + size2M, 0);
+
+    if (!raw) { return NULL; }
+
+    // trim unaligned head and tail
+    uint8_t * ptr = (uint8_t *)RoundUp((uintptr_t)raw, size2M);
+    size_t head = ptr - raw;
+
+    if (head) { munmap(raw, head); }
+    if (size2M - head) { munmap(ptr + size, size2M - head); }
+
+#ifdef MADV_HUGEPAGE
+    *pages = (madvise(ptr, size, MADV_HUGEPAGE))? PAGES_DEFAULT: PAGES_THP;
+#else
+    *pages = PAGES_DEFAULT;
+#endif
+
+    return ptr;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//  Buffers
+////////////////////////////////////////////////////////////////////////////////
+HostArena::~HostArena(void)
+{
+    Clear();
+}
+
+void * HostArena::Acquire(const size_t size)
+{
+    // smallest released buffer that fits
+    block_t * fit = NULL;
+
+    for (uint32_t b = 0; b < blocks.size(); ++b)
+    {
+        if (
+            !blocks[b].used && blocks[b].size >= size
+            && (!fit || blocks[b].size < fit->size)
+        )
+        {
+            fit = &blocks[b];
+        }
+    }
+
+    if (fit)
+    {
+        fit->used = 1;
+
+        return fit->ptr;
+    }
+
+    block_t block;
+
+    block.ptr = NULL;
+    block.used = 1;
+
+#ifdef _WIN32
+    block.size = size;
+    block.pages = PAGES_DEFAULT;
+    block.ptr = malloc(size);
+#else
+    // largest pages first, only for buffers of one page at least
+    if (HOST_HUGE_PAGES >= PAGES_1G && size >= size1G)
+    {
+        block.size = RoundUp(size, size1G);
+        block.pages = PAGES_1G;
+        block.ptr = MapHuge(block.size, 30);
+    }
+
+    if (!block.ptr && HOST_HUGE_PAGES >= PAGES_2M && size >= size2M)
+    {
+        block.size = RoundUp(size, size2M);
+        block.pages = PAGES_2M;
+        block.ptr = MapHuge(block.size, 21);
+    }
+
+    if (!block.ptr && HOST_HUGE_PAGES >= PAGES_THP && size >= size2M)
+    {
+        block.size = RoundUp(size, size2M);
+        block.ptr = MapTransparent(block.size, &block.pages);
+    }
+
+    if (!block.ptr)
+    {
+        block.size = (size)? size: 1;
+        block.pages = PAGES_DEFAULT;
+        block.ptr = MapAnonymous(block.size, 0);
+    }
+#endif
+
+    if (!block.ptr) { return NULL; }
+
+    blocks.push_back(block);
+
+    VLOG(1) << "Host buffer of " << (block.size >> 20) << " MiB mapped on "
+        << pageNames[block.pages];
+
+    return block.ptr;
+}
+
+void HostArena::Release(void * ptr)
+{
+    for (uint32_t b = 0; b < blocks.size(); ++b)
+    {
+        if (blocks[b].ptr == ptr) { blocks[b].used = 0; }
+    }
+
+    return;
+}
+
+void HostArena::Clear(void)
+{
+    for (uint32_t b = 0; b < blocks.size(); ++b)
+    {
+#ifdef _WIN32
+        free(blocks[b].ptr);
+#else
+        munmap(blocks[b].ptr, blocks[b].size);
+#endif
+    }
+
+    blocks.clear();
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Pages obtained
+////////////////////////////////////////////////////////////////////////////////
+// bytes of transparent huge pages backing [first, last)
+static size_t TransparentBytes(const uintptr_t first, const uintptr_t last)
+{
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    size_t bytes = 0;
+    int inside = 0;
+
+    while (std::getline(smaps, line))
+    {
+        unsigned long long start;
+        unsigned long long end;
+        unsigned long long kb;
+
+        // mapping header: start-end perms ...
+        if (sscanf(line.c_str(), "%llx-%llx ", &start, &end) == 2)
+        {
+            inside = start < last && end > first;
+        }
+        else if (
+            inside && sscanf(line.c_str(), "AnonHugePages: %llu kB", &kb) == 1
+        )
+        {
+            bytes += (size_t)kb << 10;
+        }
+    }
+
+    return bytes;
+}
+
+std::string HostArena::Describe(const void * ptr) const
+{
+    for (uint32_t b = 0; b < blocks.size(); ++b)
+    {
+        if (blocks[b].ptr != ptr) { continue; }
+
+        if (blocks[b].pages != PAGES_THP) { return pageNames[blocks[b].pages]; }
+
+        const uintptr_t first = (uintptr_t)ptr;
+        size_t bytes = TransparentBytes(first, first + blocks[b].size);
+
+        if (bytes > blocks[b].size) { bytes = blocks[b].size; }
+
+        return std::string(pageNames[PAGES_THP]) + ", "
+            + std::to_string(bytes >> 20) + " of "
+            + std::to_string(blocks[b].size >> 20) + " MiB";
+    }
+
+    return "unknown pages";
+}
+
+// hostarena.cc
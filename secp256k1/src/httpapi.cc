@@ -8,8 +8,25 @@ inline int key(std::pair<int,int> x)
 }
 
 
-// outputs JSON with GPUs hashrates, temps, and power usages
-void HttpApiThread(std::vector<double>* hashrates, std::vector<std::pair<int,int>>* props)
+// telemetry of one GPU as JSON fields
+static void Device(std::stringstream& strBuf, const gpu_sample_t& gpu)
+{
+    strBuf << " \"devname\" : \"" << gpu.name << "\" , ";
+    strBuf << " \"pciid\" : \"" << gpu.busId << "\" , ";
+    strBuf << " \"UUID\" : \"" << gpu.uuid << "\" , ";
+    strBuf << " \"fan\" : " << gpu.fan << " , ";
+    strBuf << " \"power\" : " << gpu.power << " , ";
+    strBuf << " \"temperature\" : " << gpu.temperature;
+}
+
+// outputs JSON with GPUs hashrates, temps, and power usages,
+// recent telemetry at /telemetry?window=<seconds>
+// and all metrics in Prometheus format at /metrics
+void HttpApiThread(
+    Metrics* metrics,
+    std::vector<std::pair<int,int>>* props,
+    TelemetrySampler* sampler
+)
 {
     std::chrono::time_point<std::chrono::system_clock> timeStart;
     timeStart = std::chrono::system_clock::now();
@@ -19,9 +36,9 @@ void HttpApiThread(std::vector<double>* hashrates, std::vector<std::pair<int,int
     svr.Get("/", [&](const Request& req, Response& res) {
         
         std::unordered_map<int, double> hrMap;
-        for(int i = 0; i < (*hashrates).size() ; i++)
+        for(int i = 0; i < metrics->Devices() ; i++)
         {
-            hrMap[key((*props)[i])] = (*hashrates)[i];
+            hrMap[key((*props)[i])] = metrics->Device(i)->hashrate.Load();
         }
         
         
@@ -29,81 +46,51 @@ void HttpApiThread(std::vector<double>* hashrates, std::vector<std::pair<int,int
         std::stringstream strBuf;
         strBuf << "{ ";
         
-        // NVML data 
+        // latest telemetry snapshot of the sampler thread
         double totalHr = 0;
-        nvmlReturn_t result;
-        result = nvmlInit();
-        if (result == NVML_SUCCESS)
-        { 
-
-            unsigned int devcount;
-            result = nvmlDeviceGetCount(&devcount);
-            bool first = true;
-            strBuf << " \"gpus\":" << devcount << " , ";
+        telemetry_t snap;
+
+        if (sampler && sampler->Latest(&snap) == EXIT_SUCCESS && !snap.error)
+        {
+            strBuf << " \"gpus\":" << snap.gpus.size() << " , ";
             strBuf << " \"devices\" : [ " ;
 
-            for(int i = 0; i < devcount; i++)
+            for(int i = 0; i < (int)snap.gpus.size(); i++)
             {
-                std::stringstream deviceInfo;
-                nvmlDevice_t device;
-                result = nvmlDeviceGetHandleByIndex(i, &device);
-                if(result == NVML_SUCCESS)
-                {
-                    
-
-                    nvmlPciInfo_t pciInfo;
-                    result = nvmlDeviceGetPciInfo ( device, &pciInfo );
-                    if(result != NVML_SUCCESS) { continue; }
-
-                    if(first)
-                    {
-                        first = false;
-                    }
-                    else
-                    {
-                        deviceInfo << " , ";        
-                    }
-
-                    deviceInfo << " { ";
-                    char devname[256];
-                    char UUID[256];
-                    result = nvmlDeviceGetName (device, devname, 256 );
-                    result = nvmlDeviceGetUUID (device, UUID, 256 );
-                    deviceInfo << " \"devname\" : \"" << devname << "\" , ";                    
-                    deviceInfo << " \"pciid\" : \"" << pciInfo.busId << "\" , ";
-                    deviceInfo << " \"UUID\" : \"" << UUID << "\" , ";
-
-                    double hrate;
-                    try{
-
-                        hrate = hrMap.at(key(std::make_pair((int)pciInfo.bus, (int)pciInfo.device)));
-                        deviceInfo << " \"hashrate\" : " << hrate << " , ";
-                        totalHr += hrate;
-                    }
-                    catch (...) // if GPU is not mining ( CUDA_VISIBLE_DEVICES is set)
-                    {}
-                    unsigned int temp;
-                    unsigned int power;
-                    unsigned int fanspeed;
-                    result = nvmlDeviceGetFanSpeed ( device, &fanspeed );
-                    result = nvmlDeviceGetPowerUsage ( device, &power );
-                    result = nvmlDeviceGetTemperature ( device, NVML_TEMPERATURE_GPU, &temp );
-                    deviceInfo << " \"fan\" : " << fanspeed << " , ";
-                    deviceInfo << " \"power\" : " << power/1000 << " , ";
-                    deviceInfo << " \"temperature\" : " << temp << " }";
-                    strBuf << deviceInfo.str();
+                const gpu_sample_t & gpu = snap.gpus[i];
+
+                if(i) { strBuf << " , "; }
+
+                strBuf << " { ";
+                Device(strBuf, gpu);
+
+                try{
+
+                    double hrate = hrMap.at(key(std::make_pair(gpu.pciBus, gpu.pciDevice)));
+                    strBuf << " , \"hashrate\" : " << hrate;
+                    totalHr += hrate;
                 }
+                catch (...) // if GPU is not mining ( CUDA_VISIBLE_DEVICES is set)
+                {}
+                strBuf << " }";
             }
 
             strBuf << " ] , \"total\": " << totalHr  ;
-
-
-            result = nvmlShutdown();
         }
-        else
+        else if (sampler)
         {
             strBuf << " \"error\": \"NVML error occured\"";
         }
+        else
+        {
+            // host only build: no GPUs, report total hashrate only
+            for (int i = 0; i < metrics->Devices(); i++)
+            {
+                totalHr += metrics->Device(i)->hashrate.Load();
+            }
+
+            strBuf << " \"gpus\": 0 , \"devices\" : [ ] , \"total\": " << totalHr;
+        }
         std::chrono::time_point<std::chrono::system_clock> timeEnd;
         timeEnd = std::chrono::system_clock::now();
         strBuf << " , \"uptime\": \"" << std::chrono::duration_cast<std::chrono::hours>(timeEnd - timeStart).count() << "h\" ";
@@ -113,6 +100,53 @@ void HttpApiThread(std::vector<double>* hashrates, std::vector<std::pair<int,int
         std::string str = strBuf.str();
         res.set_content(str.c_str(), "text/plain");
     });
+
+    svr.Get("/telemetry", [&](const Request& req, Response& res) {
+        // whole history by default, window is in seconds
+        uint32_t window = 0xFFFFFFFF;
+        std::vector<telemetry_t> snaps;
+        std::stringstream strBuf;
+
+        if (req.has_param("window"))
+        {
+            unsigned long sec = strtoul(req.get_param_value("window").c_str(), NULL, 10);
+            if (sec < window / 1000) { window = sec * 1000; }
+        }
+
+        if (sampler) { sampler->Window(window, &snaps); }
+
+        strBuf << "[ ";
+
+        for (int s = 0; s < (int)snaps.size(); s++)
+        {
+            if (s) { strBuf << " , "; }
+
+            strBuf << "{ \"time\" : " << snaps[s].time
+                << " , \"error\" : " << (snaps[s].error? "true": "false")
+                << " , \"devices\" : [ ";
+
+            for (int i = 0; i < (int)snaps[s].gpus.size(); i++)
+            {
+                if (i) { strBuf << " , "; }
+
+                strBuf << "{ ";
+                Device(strBuf, snaps[s].gpus[i]);
+                strBuf << " }";
+            }
+
+            strBuf << " ] }";
+        }
+
+        strBuf << " ]";
+
+        res.set_content(strBuf.str(), "application/json");
+    });
+
+    svr.Get("/metrics", [&](const Request& req, Response& res) {
+        std::string str;
+        metrics->Prometheus(*props, &str);
+        res.set_content(str, "text/plain; version=0.0.4");
+    });
     
 
     #ifdef HTTPAPI_PORT
@@ -0,0 +1,256 @@
+// metrics.cc
+
+/*******************************************************************************
+
+    METRICS -- Mining metrics registry
+
+*******************************************************************************/
+
+#include "../include/metrics.h"
+#include "../include/definitions.h"
+#include <stdint.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+
+using namespace std::chrono;
+
+int64_t MetricsNowUs(void)
+{
+    return duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Latency histogram
+////////////////////////////////////////////////////////////////////////////////
+const uint64_t histogram_t::bounds[METRICS_BUCKETS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+    500000, 1000000, 2500000, 5000000, 10000000
+};
+
+histogram_t::histogram_t(void): sum(0)
+{
+    for (int i = 0; i <= METRICS_BUCKETS; ++i) { buckets[i] = 0; }
+}
+
+void histogram_t::Observe(const uint64_t us)
+{
+    int i = 0;
+
+    while (i < METRICS_BUCKETS && us > bounds[i]) { ++i; }
+
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(us, std::memory_order_relaxed);
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Registry
+////////////////////////////////////////////////////////////////////////////////
+Metrics::Metrics(const int devices): devices(devices)
+{
+    device = new device_metrics_t[(devices)? devices: 1];
+}
+
+Metrics::~Metrics(void)
+{
+    delete[] device;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Prometheus text exposition
+////////////////////////////////////////////////////////////////////////////////
+static void Header(
+    std::ostringstream & out,
+    const char * name,
+    const char * type,
+    const char * help
+)
+{
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << ' ' << type << '\n';
+
+    return;
+}
+
+// cumulative buckets, sum and count of a histogram with given labels
+static void Histogram(
+    std::ostringstream & out,
+    const char * name,
+    const std::string & labels,
+    const histogram_t & hist
+)
+{
+    const char * sep = (labels.empty())? "": ",";
+    uint64_t count = 0;
+
+    for (int i = 0; i <= METRICS_BUCKETS; ++i)
+    {
+        count += hist.buckets[i].load(std::memory_order_relaxed);
+
+        out << name << "_bucket{" << labels << sep << "le=\"";
+
+        if (i < METRICS_BUCKETS) { out << hist.bounds[i] * 1e-6; }
+        else { out << "+Inf"; }
+
+        out << "\"} " << count << '\n';
+    }
+
+    std::string braces = (labels.empty())? "": "{" + labels + "}";
+
+    out << name << "_sum" << braces << ' '
+        << hist.sum.load(std::memory_order_relaxed) * 1e-6 << '\n';
+    out << name << "_count" << braces << ' ' << count << '\n';
+
+    return;
+}
+
+void Metrics::Prometheus(
+    const std::vector<std::pair<int, int>> & pci,
+    std::string * out
+) const
+{
+    std::ostringstream buf;
+    std::vector<std::string> labels(devices);
+
+    for (int i = 0; i < devices; ++i)
+    {
+        std::ostringstream label;
+
+        label << "device=\"" << i << '"';
+
+        if (i < (int)pci.size())
+        {
+            label << ",pci=\"" << pci[i].first << ':' << pci[i].second << '"';
+        }
+
+        labels[i] = label.str();
+    }
+
+    //========================================================================//
+    //  Devices
+    //========================================================================//
+    Header(buf, "autolykos_hashrate_mhs", "gauge", "Average hashrate, MH/s");
+
+    for (int i = 0; i < devices; ++i)
+    {
+        buf << "autolykos_hashrate_mhs{" << labels[i] << "} "
+            << device[i].hashrate.Load() << '\n';
+    }
+
+    Header(
+        buf, "autolykos_derate_level", "gauge",
+        "Derate level after invalid solutions"
+    );
+
+    for (int i = 0; i < devices; ++i)
+    {
+        buf << "autolykos_derate_level{" << labels[i] << "} "
+            << device[i].derate.Load() << '\n';
+    }
+
+    const struct
+    {
+        const char * name;
+        const char * help;
+        counter_t device_metrics_t::* counter;
+    }
+    counters[] = {
+        {
+            "autolykos_iterations_total", "Mining iterations",
+            &device_metrics_t::iterations
+        },
+        {
+            "autolykos_stale_iterations_total",
+            "Iterations interrupted by a new block",
+            &device_metrics_t::staleIterations
+        },
+        {
+            "autolykos_solutions_total", "Solutions found",
+            &device_metrics_t::solutions
+        },
+        {
+            "autolykos_lost_solutions_total",
+            "Solutions lost on full result buffer",
+            &device_metrics_t::lostSolutions
+        },
+        {
+            "autolykos_invalid_solutions_total",
+            "Solutions failed host verification",
+            &device_metrics_t::invalidSolutions
+        }
+    };
+
+    for (uint32_t c = 0; c < sizeof(counters) / sizeof(counters[0]); ++c)
+    {
+        Header(buf, counters[c].name, "counter", counters[c].help);
+
+        for (int i = 0; i < devices; ++i)
+        {
+            buf << counters[c].name << '{' << labels[i] << "} "
+                << (device[i].*counters[c].counter).Load() << '\n';
+        }
+    }
+
+    const struct
+    {
+        const char * name;
+        const char * help;
+        histogram_t device_metrics_t::* hist;
+    }
+    hists[] = {
+        {
+            "autolykos_prehash_seconds", "Prehash time",
+            &device_metrics_t::prehash
+        },
+        {
+            "autolykos_iteration_seconds", "Mining iteration time",
+            &device_metrics_t::iteration
+        },
+        {
+            "autolykos_block_switch_seconds",
+            "Time from new block publication to its mining",
+            &device_metrics_t::blockSwitch
+        }
+    };
+
+    for (uint32_t h = 0; h < sizeof(hists) / sizeof(hists[0]); ++h)
+    {
+        Header(buf, hists[h].name, "histogram", hists[h].help);
+
+        for (int i = 0; i < devices; ++i)
+        {
+            Histogram(buf, hists[h].name, labels[i], device[i].*hists[h].hist);
+        }
+    }
+
+    //========================================================================//
+    //  Block source and submitter
+    //========================================================================//
+    Header(
+        buf, "autolykos_poll_seconds", "histogram",
+        "Block candidate request time"
+    );
+    Histogram(buf, "autolykos_poll_seconds", "", poll);
+
+    Header(
+        buf, "autolykos_post_seconds", "histogram",
+        "Time from solution found to its submission"
+    );
+    Histogram(buf, "autolykos_post_seconds", "", post);
+
+    Header(
+        buf, "autolykos_post_failures_total", "counter",
+        "Solutions failed to submit after all retries"
+    );
+    buf << "autolykos_post_failures_total " << postFailures.Load() << '\n';
+
+    *out = buf.str();
+
+    return;
+}
+
+// metrics.cc
@@ -0,0 +1,598 @@
+// miner.cc
+
+/*******************************************************************************
+
+    MINER -- Autolykos puzzle cycle of a mining device
+
+*******************************************************************************/
+
+#include "../include/miner.h"
+#include "../include/autotune.h"
+#include "../include/cryptography.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include "../include/metrics.h"
+#include "../include/processing.h"
+#include "../include/request.h"
+#include "../include/topology.h"
+#include "../include/uctxcache.h"
+#include "../include/verifier.h"
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+////////////////////////////////////////////////////////////////////////////////
+//  Wait for a block other than the given one
+////////////////////////////////////////////////////////////////////////////////
+static void WaitBlock(info_t * info, const uint_t blockId)
+{
+    while (info->blockId.Wait(blockId, 1000) == blockId) {}
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Nonce range of the miner thread within the range of the block
+////////////////////////////////////////////////////////////////////////////////
+static void WorkerRange(
+    // upper bits of nonces of the block
+    const uint64_t nonceBase,
+    // number of lower bits iterated by miners
+    const uint32_t nonceBits,
+    // index of the miner thread
+    const int id,
+    // number of miner threads
+    const int workers,
+    // first nonce of the thread
+    uint64_t * start,
+    // number of nonces of the thread
+    uint64_t * span
+)
+{
+    uint64_t mask = (nonceBits >= 64)? ~(uint64_t)0:
+        ((uint64_t)1 << nonceBits) - 1;
+
+    *span = mask / workers;
+    *start = nonceBase + (uint64_t)id * *span;
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Unfinalized hash contexts cache transfers
+////////////////////////////////////////////////////////////////////////////////
+static int UploadChunk(
+    void * backend,
+    const uint32_t first,
+    const uint32_t cnt,
+    uctx_t * chunk
+)
+{
+    return ((MiningBackend *)backend)->UploadUctxs(first, cnt, chunk);
+}
+
+static int DownloadChunk(
+    void * backend,
+    const uint32_t first,
+    const uint32_t cnt,
+    uctx_t * chunk
+)
+{
+    return ((MiningBackend *)backend)->DownloadUctxs(first, cnt, chunk);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Miner thread cycle
+////////////////////////////////////////////////////////////////////////////////
+void MinerThread(
+    // mining device
+    MiningBackend * backend,
+    // index of the device in metrics
+    const int id,
+    // puzzle global info
+    info_t * info,
+    // queue of found solutions
+    Submitter * submitter,
+    // metrics of all devices
+    Metrics * metrics
+)
+{
+    const char * name = backend->Name();
+    device_metrics_t * stats = metrics->Device(id);
+
+    el::Helpers::setThreadName(std::string(name) + " miner");
+
+    // host side of the device runs on the node of its PCI bus
+    std::vector<numa_node_t> nodes;
+
+    NumaNodes(&nodes);
+
+    for (uint32_t n = 0; n < nodes.size(); ++n)
+    {
+        if (nodes.size() > 1 && nodes[n].id == backend->NumaNode())
+        {
+            if (PinThread(nodes[n].cpus) == EXIT_SUCCESS)
+            {
+                LOG(INFO) << name << " miner thread runs on NUMA node "
+                    << nodes[n].id;
+            }
+        }
+    }
+
+    state_t state = STATE_KEYGEN;
+    char logstr[1000];
+
+    //========================================================================//
+    //  Host memory allocation
+    //========================================================================//
+    // autolykos variables
+    uint8_t bound_h[NUM_SIZE_8];
+    uint8_t mes_h[NUM_SIZE_8];
+    uint8_t sk_h[NUM_SIZE_8];
+    uint8_t pk_h[PK_SIZE_8];
+    uint8_t x_h[NUM_SIZE_8];
+    uint8_t w_h[PK_SIZE_8];
+    result_t results_h[MAX_RESULTS];
+
+    // message and one-time key-pair of the back buffer
+    uint8_t mesBack_h[NUM_SIZE_8];
+    uint8_t xBack_h[NUM_SIZE_8];
+    uint8_t wBack_h[PK_SIZE_8];
+
+    // checks solutions against block data of the front buffer
+    SolutionVerifier verifier;
+
+    solution_t sol;
+    char cache[MAX_URL_SIZE];
+    char cacheName[MAX_URL_SIZE];
+    char profiles[MAX_URL_SIZE];
+    int keepPrehash = 0;
+    int doubleBuffer = 0;
+    int poolMining = 0;
+
+    // thread info variables
+    uint_t blockId = 0;
+    uint_t mesId = 0;
+    // message id of the back buffer being built, 0 if none
+    uint_t backMesId = 0;
+    // latest message id read from global memory
+    uint_t lastMesId = 0;
+    milliseconds start; 
+
+    // publication time of the block read last and of the back buffer block,
+    // block switch is measured at the first iteration of the new block
+    int64_t readStamp = 0;
+    int64_t backStamp = 0;
+    int64_t switchStamp = 0;
+    // start of the back buffer prehash
+    int64_t backStart = 0;
+    
+    //========================================================================//
+    //  Copy from global to thread local data
+    //========================================================================//
+    info->info_mutex.lock();
+
+    memcpy(sk_h, info->sk, NUM_SIZE_8);
+    memcpy(pk_h, info->pk, PK_SIZE_8);
+    memcpy(cache, info->cache, MAX_URL_SIZE * sizeof(char));
+    memcpy(profiles, info->profiles, MAX_URL_SIZE * sizeof(char));
+    keepPrehash = info->keepPrehash;
+    doubleBuffer = info->doubleBuffer;
+    poolMining = info->poolMining;
+    
+    info->info_mutex.unlock();
+    
+    //========================================================================//
+    //  Device memory allocation
+    //========================================================================//
+    if (backend->Allocate(pk_h, sk_h, &keepPrehash, &doubleBuffer) != EXIT_SUCCESS)
+    {
+        return;
+    }
+
+    verifier.SetKeys(pk_h, sk_h);
+
+    //========================================================================//
+    //  Autolykos puzzle cycle
+    //========================================================================//
+    // geometry is tuned on the first block
+    uint32_t len = backend->NoncesPerIter();
+    const int NCycles = backend->HashrateCycles();
+    int tuned = 0;
+
+    uint32_t count = 0;
+    uint32_t lost = 0;
+    uint64_t base = 0;
+    int cntCycles = 0;
+
+    // nonce range of the thread, nonces are not shared with other threads
+    uint64_t nonceStart = 0;
+    uint64_t nonceSpan = 0;
+
+    // set unfinalized hash contexts if necessary,
+    // take them from the cache file if it is valid
+    int cached = 0;
+
+    if (keepPrehash && cache[0])
+    {
+        UctxCacheName(cache, pk_h, cacheName);
+
+        cached = UctxCacheLoad(
+            cacheName, pk_h, N_LEN, UploadChunk, backend
+        ) == EXIT_SUCCESS;
+    }
+
+    if (!cached)
+    {
+        if (backend->InitPrehash() != EXIT_SUCCESS)
+        {
+            backend->Release();
+
+            return;
+        }
+
+        // failure to store only costs a recalculation on next start
+        if (keepPrehash && cache[0])
+        {
+            UctxCacheStore(cacheName, pk_h, N_LEN, DownloadChunk, backend);
+        }
+    }
+
+    // wait for the very first block to come before starting
+    WaitBlock(info, 0);
+
+    start = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+
+    do
+    {
+        ++cntCycles;
+
+        if (!(cntCycles % NCycles))
+        {
+            milliseconds timediff
+                = duration_cast<milliseconds>(
+                    system_clock::now().time_since_epoch()
+                ) - start;
+            
+            // change avg hashrate in global memory
+            stats->hashrate.Set(
+                (double)len * (double)NCycles
+                / ((double)1000 * timediff.count())
+            );
+             
+            start = duration_cast<milliseconds>(
+                system_clock::now().time_since_epoch()
+            );
+
+            stats->stamp.Set(start.count());
+        }
+    
+        // if solution was found by this thread wait for new block to come 
+        if (state == STATE_KEYGEN)
+        {
+            // or for the back buffer with the new block to be built
+            if (backMesId)
+            {
+                int ready = 0;
+
+                while (
+                    backend->WaitBack(&ready, 1000) == EXIT_SUCCESS && !ready
+                ) {}
+            }
+            else
+            {
+                WaitBlock(info, blockId);
+            }
+
+            state = STATE_CONTINUE;
+        }
+
+        // swap hash tables as soon as the back buffer is built
+        if (backMesId)
+        {
+            int ready = 0;
+
+            if (backend->BackReady(&ready) != EXIT_SUCCESS) { break; }
+
+            if (ready)
+            {
+                LOG(INFO) << name << " switched to prehash of new block";
+
+                if (backend->SwapBuffers() != EXIT_SUCCESS) { break; }
+
+                stats->prehash.Observe(MetricsNowUs() - backStart);
+                switchStamp = backStamp;
+
+                memcpy(x_h, xBack_h, NUM_SIZE_8);
+                memcpy(w_h, wBack_h, PK_SIZE_8);
+                mesId = backMesId;
+                backMesId = 0;
+
+                // bound could change while building
+                if (backend->UploadBound(bound_h) != EXIT_SUCCESS) { break; }
+
+                verifier.SetBlock(mesBack_h, x_h, w_h);
+                verifier.SetBound(bound_h);
+
+                // message changed again while building
+                if (mesId != lastMesId)
+                {
+                    GenerateKeyPair(xBack_h, wBack_h);
+                    memcpy(mesBack_h, mes_h, NUM_SIZE_8);
+
+                    backStart = MetricsNowUs();
+                    backStamp = readStamp;
+
+                    if (
+                        backend->PrehashBack(bound_h, mes_h, xBack_h, wBack_h)
+                        != EXIT_SUCCESS
+                    )
+                    {
+                        break;
+                    }
+
+                    backMesId = lastMesId;
+                }
+            }
+        }
+
+        uint_t controlId = info->blockId.load();
+        
+        if (blockId != controlId)
+        {
+            // if info->blockId changed
+            // read new message and bound to thread-local mem
+            info->info_mutex.lock();
+
+            memcpy(mes_h, info->mes, NUM_SIZE_8);
+            memcpy(bound_h, info->bound, NUM_SIZE_8);
+            uint_t controlMesId = info->mesId.load();
+            readStamp = info->blockId.Stamp();
+            uint64_t start;
+            uint64_t span;
+
+            WorkerRange(
+                info->nonceBase, info->nonceBits, id, metrics->Devices(),
+                &start, &span
+            );
+
+            info->info_mutex.unlock();
+
+            // pool gave other nonces
+            if (start != nonceStart || span != nonceSpan)
+            {
+                nonceStart = start;
+                nonceSpan = span;
+                base = start;
+
+                // iterations are cut to the range, the rest is wasted
+                if (span < len)
+                {
+                    LOG(ERROR) << name << " nonce range of " << span
+                        << " nonces is smaller than an iteration of " << len
+                        << " nonces";
+                }
+            }
+
+            blockId = controlId;
+            lastMesId = controlMesId;
+
+            // back buffer is busy: new data is taken at the swap
+            if (backMesId)
+            {
+                LOG(INFO) << name << " read new block data, "
+                    << "waiting for the back buffer";
+            }
+            // only bound changed: keep prehash and one-time key-pair
+            else if (mesId == controlMesId)
+            {
+                LOG(INFO) << name << " read new bound";
+
+                if (backend->UploadBound(bound_h) != EXIT_SUCCESS) { break; }
+
+                verifier.SetBound(bound_h);
+                switchStamp = readStamp;
+            }
+            // keep mining the front buffer while building the back one
+            else if (doubleBuffer && mesId)
+            {
+                LOG(INFO) << name << " read new block data, "
+                    << "prehashing in the back buffer";
+
+                GenerateKeyPair(xBack_h, wBack_h);
+                memcpy(mesBack_h, mes_h, NUM_SIZE_8);
+
+                backStart = MetricsNowUs();
+                backStamp = readStamp;
+
+                if (
+                    backend->PrehashBack(bound_h, mes_h, xBack_h, wBack_h)
+                    != EXIT_SUCCESS
+                )
+                {
+                    break;
+                }
+
+                backMesId = controlMesId;
+            }
+            else
+            {
+                LOG(INFO) << name << " read new block data";
+                mesId = controlMesId;
+
+                GenerateKeyPair(x_h, w_h);
+
+                VLOG(1) << "Generated new keypair,"
+                    << " copying new data in device memory now";
+
+                int64_t prehashStart = MetricsNowUs();
+
+                if (
+                    backend->UploadBlock(bound_h, mes_h, x_h, w_h)
+                    != EXIT_SUCCESS
+                )
+                {
+                    break;
+                }
+
+                VLOG(1) << "Starting prehashing with new block data";
+
+                if (backend->Prehash() != EXIT_SUCCESS) { break; }
+
+                verifier.SetBlock(mes_h, x_h, w_h);
+                verifier.SetBound(bound_h);
+
+                stats->prehash.Observe(MetricsNowUs() - prehashStart);
+                switchStamp = readStamp;
+
+                // timed on real hashes, swept nonces are mined again
+                if (!tuned)
+                {
+                    if (
+                        Autotune(backend, profiles, base, bound_h)
+                        != EXIT_SUCCESS
+                    )
+                    {
+                        break;
+                    }
+
+                    len = backend->NoncesPerIter();
+                    tuned = 1;
+                }
+            }
+
+            state = STATE_CONTINUE;
+        }
+
+        VLOG(1) << "Starting main BlockMining procedure";
+
+        int64_t iterStart = MetricsNowUs();
+
+        // first iteration of the new block
+        if (switchStamp)
+        {
+            stats->blockSwitch.Observe(iterStart - switchStamp);
+            switchStamp = 0;
+        }
+
+        // nonces of the range left, the iteration is cut to them
+        uint64_t left = (base - nonceStart < nonceSpan)?
+            nonceStart + nonceSpan - base: 0;
+
+        if (!left)
+        {
+            LOG(INFO) << name << " searched all nonces of the block";
+
+            base = nonceStart;
+            state = STATE_KEYGEN;
+
+            continue;
+        }
+
+        const uint64_t cut = (left < len)? left: len;
+
+        if (backend->Mine(base) != EXIT_SUCCESS) { break; }
+
+        VLOG(1) << "Trying to find solution";
+
+        // restart iteration if new block was found
+        if (blockId != info->blockId.load())
+        {
+            stats->staleIterations.Add();
+
+            continue;
+        }
+
+        if (
+            backend->FetchResults(results_h, &count, &lost) != EXIT_SUCCESS
+        )
+        {
+            break;
+        }
+
+        int64_t iterUs = MetricsNowUs() - iterStart;
+
+        stats->iteration.Observe(iterUs);
+        stats->iterations.Add();
+        stats->lostSolutions.Add(lost);
+
+        if (lost)
+        {
+            LOG(ERROR) << name << " lost " << lost
+                << " solutions on full result buffer";
+        }
+
+        uint32_t derate = verifier.Derate();
+        uint32_t valid = 0;
+
+        // solutions found
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            // nonces past the range belong to other miners or extranonces
+            if (results_h[i].nonce - base >= cut) { continue; }
+
+            // wrong results of a faulty device are not submitted
+            if (!verifier.Verify(results_h[i]))
+            {
+                LOG(ERROR) << name << " produced invalid solution, nonce "
+                    << results_h[i].nonce << " dropped";
+
+                stats->invalidSolutions.Add();
+
+                continue;
+            }
+
+            ++valid;
+
+            *((uint64_t *)sol.nonce) = results_h[i].nonce;
+            memcpy(sol.d, results_h[i].d, NUM_SIZE_8);
+
+            PrintPuzzleSolution(sol.nonce, sol.d, logstr);
+            LOG(INFO) << name << " found a solution:\n" << logstr;
+
+            memcpy(sol.w, w_h, PK_SIZE_8);
+            sol.mesId = mesId;
+            sol.found = duration_cast<milliseconds>(
+                system_clock::now().time_since_epoch()
+            ).count();
+
+            submitter->Enqueue(&sol);
+        }
+
+        stats->solutions.Add(valid);
+        verifier.Iteration();
+
+        if (verifier.Derate() != derate)
+        {
+            LOG(ERROR) << name << " derated to level " << verifier.Derate()
+                << " after repeated invalid solutions";
+
+            stats->derate.Set(verifier.Derate());
+        }
+
+        // idle part of the cycle of a derated device
+        if (verifier.Derate())
+        {
+            std::this_thread::sleep_for(
+                microseconds(verifier.IdleUs(iterUs))
+            );
+        }
+
+        // block is solved, pool shares are mined till the next job
+        if (valid && !poolMining) { state = STATE_KEYGEN; }
+
+        base += len;
+    }
+    while (1);
+
+    backend->Release();
+
+    return;
+}
+
+// miner.cc
@@ -6,6 +6,7 @@
 
 *******************************************************************************/
 
+#include "../include/compaction.h"
 #include "../include/mining.h"
 #include <cuda.h>
 
@@ -75,7 +76,19 @@ void InitMining(
 
 
 
-__global__ void BlakeHash(const uint32_t* data, const uint64_t base, uint32_t* BHashes)
+////////////////////////////////////////////////////////////////////////////////
+//  Hashes of the message with nonces, 4 nonces per thread
+////////////////////////////////////////////////////////////////////////////////
+template<uint32_t BlockDim>
+__global__ void __launch_bounds__(BlockDim) BlakeHash(
+    const uint32_t * data,
+    // first nonce of the iteration
+    const uint64_t base,
+    // hashes, word j of thread tid at BHashes[threads * j + tid]
+    uint32_t * BHashes,
+    // number of threads per iteration
+    const uint32_t threads
+)
 {
     uint32_t tid;
 
@@ -87,7 +100,7 @@ __global__ void BlakeHash(const uint32_t* data, const uint64_t base, uint32_t* B
 #pragma unroll
     for(int ii = 0; ii < 4; ii++)
     {
-        tid = (NONCES_PER_ITER/4)*ii + threadIdx.x + blockDim.x * blockIdx.x;
+        tid = (threads/4)*ii + threadIdx.x + BlockDim * blockIdx.x;
         
         asm volatile (
             "add.cc.u32 %0, %1, %2;":
@@ -135,8 +148,8 @@ __global__ void BlakeHash(const uint32_t* data, const uint64_t base, uint32_t* B
         {
             hsh = ivals[j >> 1];
             hsh ^= ((uint64_t *)(aux))[j >> 1] ^ ((uint64_t *)(aux))[ 8 + (j >> 1)];
-            BHashes[THREADS_PER_ITER*j + tid] = __byte_perm( ((uint32_t*)(&hsh))[0], 0 , 0x0123);
-            BHashes[THREADS_PER_ITER*(j+1) + tid] = __byte_perm( ((uint32_t*)(&hsh))[1], 0 , 0x0123);
+            BHashes[threads*j + tid] = __byte_perm( ((uint32_t*)(&hsh))[0], 0 , 0x0123);
+            BHashes[threads*(j+1) + tid] = __byte_perm( ((uint32_t*)(&hsh))[1], 0 , 0x0123);
 
         }
 
@@ -145,68 +158,126 @@ __global__ void BlakeHash(const uint32_t* data, const uint64_t base, uint32_t* B
 
 
 ////////////////////////////////////////////////////////////////////////////////
-//  Block mining                                                               
+//  Block prefilter, compaction of survivors
+////////////////////////////////////////////////////////////////////////////////
+template<uint32_t BlockDim>
+__global__ void __launch_bounds__(BlockDim) BlockPrefilter(
+    // precalculated hashes
+    const uint32_t * __restrict__ hashes,
+    // exact early reject by high 64 bits of elements
+    const prefilter_t filter,
+    // hashes of the message with nonces
+    const uint32_t * __restrict__ BHashes,
+    // number of threads per iteration
+    const uint32_t threads,
+    // candidates: number of survivors, then their thread ids
+    uint32_t * cands
+)
+{
+    uint32_t tid = threadIdx.x + BlockDim * blockIdx.x;
+
+    if (tid >= threads) { return; }
+
+    // high 64 bits of elements, compact part of table
+    const uint64_t * hi = (const uint64_t *)hashes;
+    uint64_t sum = filter.offset;
+
+    sum += hi[BHashes[tid] & N_MASK];
+    sum += hi[((BHashes[tid] << 8) | (BHashes[threads + tid] >> 24)) & N_MASK];
+
+    #pragma unroll
+    for (uint32_t k = 2; k < K_LEN-4; ++k)
+    {
+        sum += hi[__funnelshift_l( BHashes[ ((k>>2) + 1)*threads + tid], BHashes[(k>>2)*threads + tid], ((k%4) << 3) ) & N_MASK];
+    }
+
+    #pragma unroll
+    for (uint32_t k = K_LEN-4; k < K_LEN; ++k)
+    {
+        sum += hi[__funnelshift_l( BHashes[ tid], BHashes[(k>>2)*threads + tid], ((k%4) << 3) ) & N_MASK];
+    }
+
+    if (sum <= filter.threshold) { cands[1 + WarpInc(cands)] = tid; }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Block mining of candidates
 ////////////////////////////////////////////////////////////////////////////////
-__global__ void BlockMining(
+template<uint32_t BlockDim>
+__global__ void __launch_bounds__(BlockDim) BlockMining(
     // boundary for puzzle
     const uint32_t * __restrict__ bound,
     // precalculated hashes
     const uint32_t * __restrict__ hashes,
-    const uint32_t * __restrict__ data,
-    // results
-    uint32_t * res,
-    // indices of valid solutions
-    uint32_t * valid,
-    uint32_t * BHashes
+    // first nonce of the iteration
+    const uint64_t base,
+    // solutions, MAX_RESULTS at most
+    result_t * results,
+    // number of solutions found, may exceed MAX_RESULTS
+    uint32_t * count,
+    // hashes of the message with nonces
+    const uint32_t * BHashes,
+    // number of threads per iteration
+    const uint32_t threads,
+    // candidates: number of survivors, then their thread ids
+    const uint32_t * __restrict__ cands
 )
 {
-    uint32_t tid = threadIdx.x;
+    uint32_t tid;
 
- 
     uint32_t r[9];
 
     uint32_t indices[32];
     uint32_t *tmparr = indices + 2;    
     uint32_t *i1 = indices;
-    
-    #pragma unroll
-    for(int ii = 0; ii < 1; ii++)
+
+    const uint32_t num = cands[0];
+
+    for (
+        uint32_t c = threadIdx.x + BlockDim * blockIdx.x; c < num;
+        c += BlockDim * gridDim.x
+    )
     {
-        tid = ii*(THREADS_PER_ITER/4) + threadIdx.x + blockDim.x * blockIdx.x;
+        tid = cands[1 + c];
    
         uint32_t j;
-        i1[0] = ( (BHashes[tid]) & N_MASK) << 3;
-        i1[1] = ((( BHashes[tid] << 8) | (BHashes[THREADS_PER_ITER + tid] >> 24)) & N_MASK) << 3;
+        i1[0] = (BHashes[tid]) & N_MASK;
+        i1[1] = (( BHashes[tid] << 8) | (BHashes[threads + tid] >> 24)) & N_MASK;
         
         #pragma unroll
         for (uint32_t k = 2; k < K_LEN-4; ++k)
         {
-            i1[k] = (__funnelshift_l( BHashes[ ((k>>2) + 1)*THREADS_PER_ITER + tid], BHashes[(k>>2)*THREADS_PER_ITER + tid], ((k%4) << 3) ) & N_MASK) << 3;
+            i1[k] = (__funnelshift_l( BHashes[ ((k>>2) + 1)*threads + tid], BHashes[(k>>2)*threads + tid], ((k%4) << 3) ) & N_MASK);
         }
         #pragma unroll         
         for (uint32_t k = K_LEN-4; k < K_LEN; ++k)
         {
-            i1[k] = (__funnelshift_l( BHashes[ tid], BHashes[(k>>2)*THREADS_PER_ITER + tid], ((k%4) << 3) ) & N_MASK) << 3;
+            i1[k] = (__funnelshift_l( BHashes[ tid], BHashes[(k>>2)*threads + tid], ((k%4) << 3) ) & N_MASK);
         }
-        
+
+        // full elements of the candidate
         asm volatile (
             "add.cc.u32 %0, %1, %2;":
-            "=r"(r[6]): "r"(hashes[i1[0] + 6]), "r"(hashes[i1[1] + 6])
+            "=r"(r[0]):
+            "r"(hashes[TABLE_POS(i1[0], 0)]),
+            "r"(hashes[TABLE_POS(i1[1], 0)])
         );
 
         #pragma unroll
-        for (int i = 7; i < 8; ++i)
+        for (int i = 1; i < 8; ++i)
         {
             asm volatile (
                 "addc.cc.u32 %0, %1, %2;":
                 "=r"(r[i]):
-                "r"(hashes[i1[0] + i]),
-                "r"(hashes[i1[1] + i])
+                "r"(hashes[TABLE_POS(i1[0], i)]),
+                "r"(hashes[TABLE_POS(i1[1], i)])
             );
         }
 
         asm volatile ("addc.u32 %0, 0, 0;": "=r"(r[8]));
-        
+      
         // remaining additions
         #pragma unroll
         for (uint32_t k = 2; k < K_LEN-4; ++k)
@@ -214,15 +285,15 @@ __global__ void BlockMining(
 
             asm volatile (
                 "add.cc.u32 %0, %0, %1;":
-                "+r"(r[6]): "r"(hashes[i1[k] + 6])
+                "+r"(r[0]): "r"(hashes[TABLE_POS(i1[k], 0)])
             );
 
             #pragma unroll
-            for (int i = 7; i < 8; ++i)
+            for (int i = 1; i < 8; ++i)
             {
                 asm volatile (
                     "addc.cc.u32 %0, %0, %1;":
-                    "+r"(r[i]): "r"(hashes[i1[k]+i])
+                    "+r"(r[i]): "r"(hashes[TABLE_POS(i1[k], i)])
                 );
             }
 
@@ -232,28 +303,31 @@ __global__ void BlockMining(
         #pragma unroll
         for (uint32_t k = K_LEN-4; k < K_LEN; ++k)
         {
+
             asm volatile (
                 "add.cc.u32 %0, %0, %1;":
-                "+r"(r[6]): "r"(hashes[i1[k] + 6])
+                "+r"(r[0]): "r"(hashes[TABLE_POS(i1[k], 0)])
             );
 
             #pragma unroll
-            for (int i = 7; i < 8; ++i)
+            for (int i = 1; i < 8; ++i)
             {
                 asm volatile (
                     "addc.cc.u32 %0, %0, %1;":
-                    "+r"(r[i]): "r"(hashes[i1[k]+i])
+                    "+r"(r[i]): "r"(hashes[TABLE_POS(i1[k], i)])
                 );
             }
 
             asm volatile ("addc.u32 %0, %0, 0;": "+r"(r[8]));
         }
 
+
+
         // subtraction of secret key
-        asm volatile ("sub.cc.u32 %0, %0, %1;": "+r"(r[6]): "r"(sk[6]));
+        asm volatile ("sub.cc.u32 %0, %0, %1;": "+r"(r[0]): "r"(sk[0]));
 
         #pragma unroll
-        for (int i = 7; i < 8; ++i)
+        for (int i = 1; i < 8; ++i)
         {
             asm volatile (
                 "subc.cc.u32 %0, %0, %1;": "+r"(r[i]): "r"(sk[i])
@@ -262,244 +336,246 @@ __global__ void BlockMining(
 
         asm volatile ("subc.u32 %0, %0, 0;": "+r"(r[8]));
 
+        //================================================================//
+        //  Result mod Q
+        //================================================================//
+        // 20 bytes
+        uint32_t * med = tmparr;
+        // 4 bytes
+        uint32_t * d = i1; 
+        uint32_t * carry = d;
+        //uint32_t *d = 
+        d[0] = r[8];
+
+        //================================================================//
+        asm volatile (
+            "mul.lo.u32 %0, %1, " q0_s ";": "=r"(med[0]): "r"(*d)
+        );
 
+        asm volatile (
+            "mul.hi.u32 %0, %1, " q0_s ";": "=r"(med[1]): "r"(*d)
+        );
 
-        if((r[6] <= bound[6] && r[7] == 0)  || (r[7] == 0xFFFFFFFF && r[6] > 0xFFFFFFFF - 0x20))
-        {
-
-            asm volatile (
-                "add.cc.u32 %0, %1, %2;":
-                "=r"(r[0]): "r"(hashes[i1[0]]), "r"(hashes[i1[1]])
-            );
-
-            #pragma unroll
-            for (int i = 1; i < 8; ++i)
-            {
-                asm volatile (
-                    "addc.cc.u32 %0, %1, %2;":
-                    "=r"(r[i]):
-                    "r"(hashes[i1[0] + i]),
-                    "r"(hashes[i1[1] + i])
-                );
-            }
-
-            asm volatile ("addc.u32 %0, 0, 0;": "=r"(r[8]));
-          
-            // remaining additions
-            #pragma unroll
-            for (uint32_t k = 2; k < K_LEN-4; ++k)
-            {
-
-                asm volatile (
-                    "add.cc.u32 %0, %0, %1;":
-                    "+r"(r[0]): "r"(hashes[i1[k]])
-                );
-
-                #pragma unroll
-                for (int i = 1; i < 8; ++i)
-                {
-                    asm volatile (
-                        "addc.cc.u32 %0, %0, %1;":
-                        "+r"(r[i]): "r"(hashes[i1[k]+i])
-                    );
-                }
-
-                asm volatile ("addc.u32 %0, %0, 0;": "+r"(r[8]));
-            }
-
-            #pragma unroll
-            for (uint32_t k = K_LEN-4; k < K_LEN; ++k)
-            {
-
-                asm volatile (
-                    "add.cc.u32 %0, %0, %1;":
-                    "+r"(r[0]): "r"(hashes[i1[k]])
-                );
-
-                #pragma unroll
-                for (int i = 1; i < 8; ++i)
-                {
-                    asm volatile (
-                        "addc.cc.u32 %0, %0, %1;":
-                        "+r"(r[i]): "r"(hashes[i1[k]+i])
-                    );
-                }
-
-                asm volatile ("addc.u32 %0, %0, 0;": "+r"(r[8]));
-            }
-
-
-
-            // subtraction of secret key
-            asm volatile ("sub.cc.u32 %0, %0, %1;": "+r"(r[0]): "r"(sk[0]));
-
-            #pragma unroll
-            for (int i = 1; i < 8; ++i)
-            {
-                asm volatile (
-                    "subc.cc.u32 %0, %0, %1;": "+r"(r[i]): "r"(sk[i])
-                );
-            }
-
-            asm volatile ("subc.u32 %0, %0, 0;": "+r"(r[8]));
-
-            //================================================================//
-            //  Result mod Q
-            //================================================================//
-            // 20 bytes
-            uint32_t * med = tmparr;
-            // 4 bytes
-            uint32_t * d = i1; 
-            uint32_t * carry = d;
-            //uint32_t *d = 
-            d[0] = r[8];
-
-            //================================================================//
-            asm volatile (
-                "mul.lo.u32 %0, %1, " q0_s ";": "=r"(med[0]): "r"(*d)
-            );
+        asm volatile (
+            "mul.lo.u32 %0, %1, " q2_s ";": "=r"(med[2]): "r"(*d)
+        );
 
-            asm volatile (
-                "mul.hi.u32 %0, %1, " q0_s ";": "=r"(med[1]): "r"(*d)
-            );
+        asm volatile (
+            "mul.hi.u32 %0, %1, " q2_s ";": "=r"(med[3]): "r"(*d)
+        );
 
-            asm volatile (
-                "mul.lo.u32 %0, %1, " q2_s ";": "=r"(med[2]): "r"(*d)
-            );
+        asm volatile (
+            "mad.lo.cc.u32 %0, %1, " q1_s ", %0;": "+r"(med[1]): "r"(*d)
+        );
 
-            asm volatile (
-                "mul.hi.u32 %0, %1, " q2_s ";": "=r"(med[3]): "r"(*d)
-            );
+        asm volatile (
+            "madc.hi.cc.u32 %0, %1, " q1_s ", %0;": "+r"(med[2]): "r"(*d)
+        );
 
-            asm volatile (
-                "mad.lo.cc.u32 %0, %1, " q1_s ", %0;": "+r"(med[1]): "r"(*d)
-            );
+        asm volatile (
+            "madc.lo.cc.u32 %0, %1, " q3_s ", %0;": "+r"(med[3]): "r"(*d)
+        );
 
-            asm volatile (
-                "madc.hi.cc.u32 %0, %1, " q1_s ", %0;": "+r"(med[2]): "r"(*d)
-            );
+        asm volatile (
+            "madc.hi.u32 %0, %1, " q3_s ", 0;": "=r"(med[4]): "r"(*d)
+        );
 
-            asm volatile (
-                "madc.lo.cc.u32 %0, %1, " q3_s ", %0;": "+r"(med[3]): "r"(*d)
-            );
+        //================================================================//
+        asm volatile ("sub.cc.u32 %0, %0, %1;": "+r"(r[0]): "r"(med[0]));
 
+#pragma unroll
+        for (int i = 1; i < 5; ++i)
+        {
             asm volatile (
-                "madc.hi.u32 %0, %1, " q3_s ", 0;": "=r"(med[4]): "r"(*d)
+                "subc.cc.u32 %0, %0, %1;": "+r"(r[i]): "r"(med[i])
             );
-
-            //================================================================//
-            asm volatile ("sub.cc.u32 %0, %0, %1;": "+r"(r[0]): "r"(med[0]));
-
-#pragma unroll
-            for (int i = 1; i < 5; ++i)
-            {
-                asm volatile (
-                    "subc.cc.u32 %0, %0, %1;": "+r"(r[i]): "r"(med[i])
-                );
-            }
+        }
 
 #pragma unroll
-            for (int i = 5; i < 7; ++i)
-            {
-                asm volatile ("subc.cc.u32 %0, %0, 0;": "+r"(r[i]));
-            }
+        for (int i = 5; i < 7; ++i)
+        {
+            asm volatile ("subc.cc.u32 %0, %0, 0;": "+r"(r[i]));
+        }
 
-            asm volatile ("subc.u32 %0, %0, 0;": "+r"(r[7]));
+        asm volatile ("subc.u32 %0, %0, 0;": "+r"(r[7]));
 
-            //================================================================//
-            d[1] = d[0] >> 31;
-            d[0] <<= 1;
+        //================================================================//
+        d[1] = d[0] >> 31;
+        d[0] <<= 1;
 
-            asm volatile ("add.cc.u32 %0, %0, %1;": "+r"(r[4]): "r"(d[0]));
-            asm volatile ("addc.cc.u32 %0, %0, %1;": "+r"(r[5]): "r"(d[1]));
-            asm volatile ("addc.cc.u32 %0, %0, 0;": "+r"(r[6]));
-            asm volatile ("addc.u32 %0, %0, 0;": "+r"(r[7]));
+        asm volatile ("add.cc.u32 %0, %0, %1;": "+r"(r[4]): "r"(d[0]));
+        asm volatile ("addc.cc.u32 %0, %0, %1;": "+r"(r[5]): "r"(d[1]));
+        asm volatile ("addc.cc.u32 %0, %0, 0;": "+r"(r[6]));
+        asm volatile ("addc.u32 %0, %0, 0;": "+r"(r[7]));
 
-            //================================================================//
-            asm volatile ("sub.cc.u32 %0, %0, " q0_s ";": "+r"(r[0]));
-            asm volatile ("subc.cc.u32 %0, %0, " q1_s ";": "+r"(r[1]));
-            asm volatile ("subc.cc.u32 %0, %0, " q2_s ";": "+r"(r[2]));
-            asm volatile ("subc.cc.u32 %0, %0, " q3_s ";": "+r"(r[3]));
-            asm volatile ("subc.cc.u32 %0, %0, " q4_s ";": "+r"(r[4]));
+        //================================================================//
+        asm volatile ("sub.cc.u32 %0, %0, " q0_s ";": "+r"(r[0]));
+        asm volatile ("subc.cc.u32 %0, %0, " q1_s ";": "+r"(r[1]));
+        asm volatile ("subc.cc.u32 %0, %0, " q2_s ";": "+r"(r[2]));
+        asm volatile ("subc.cc.u32 %0, %0, " q3_s ";": "+r"(r[3]));
+        asm volatile ("subc.cc.u32 %0, %0, " q4_s ";": "+r"(r[4]));
 
 #pragma unroll
-            for (int i = 5; i < 8; ++i)
-            {
-                asm volatile ("subc.cc.u32 %0, %0, " qhi_s ";": "+r"(r[i]));
-            }
+        for (int i = 5; i < 8; ++i)
+        {
+            asm volatile ("subc.cc.u32 %0, %0, " qhi_s ";": "+r"(r[i]));
+        }
 
-            asm volatile ("subc.u32 %0, 0, 0;": "=r"(*carry));
+        asm volatile ("subc.u32 %0, 0, 0;": "=r"(*carry));
 
-            *carry = 0 - *carry;
+        *carry = 0 - *carry;
 
-            //================================================================//
-            asm volatile (
-                "mad.lo.cc.u32 %0, %1, " q0_s ", %0;": "+r"(r[0]): "r"(*carry)
-            );
+        //================================================================//
+        asm volatile (
+            "mad.lo.cc.u32 %0, %1, " q0_s ", %0;": "+r"(r[0]): "r"(*carry)
+        );
 
-            asm volatile (
-                "madc.lo.cc.u32 %0, %1, " q1_s ", %0;": "+r"(r[1]): "r"(*carry)
-            );
+        asm volatile (
+            "madc.lo.cc.u32 %0, %1, " q1_s ", %0;": "+r"(r[1]): "r"(*carry)
+        );
 
-            asm volatile (
-                "madc.lo.cc.u32 %0, %1, " q2_s ", %0;": "+r"(r[2]): "r"(*carry)
-            );
+        asm volatile (
+            "madc.lo.cc.u32 %0, %1, " q2_s ", %0;": "+r"(r[2]): "r"(*carry)
+        );
 
-            asm volatile (
-                "madc.lo.cc.u32 %0, %1, " q3_s ", %0;": "+r"(r[3]): "r"(*carry)
-            );
+        asm volatile (
+            "madc.lo.cc.u32 %0, %1, " q3_s ", %0;": "+r"(r[3]): "r"(*carry)
+        );
 
-            asm volatile (
-                "madc.lo.cc.u32 %0, %1, " q4_s ", %0;": "+r"(r[4]): "r"(*carry)
-            );
+        asm volatile (
+            "madc.lo.cc.u32 %0, %1, " q4_s ", %0;": "+r"(r[4]): "r"(*carry)
+        );
 
 #pragma unroll
-            for (int i = 5; i < 7; ++i)
-            {
-                asm volatile (
-                    "madc.lo.cc.u32 %0, %1, " qhi_s ", %0;":
-                    "+r"(r[i]): "r"(*carry)
-                );
-            }
-
+        for (int i = 5; i < 7; ++i)
+        {
             asm volatile (
-                "madc.lo.u32 %0, %1, " qhi_s ", %0;": "+r"(r[7]): "r"(*carry)
+                "madc.lo.cc.u32 %0, %1, " qhi_s ", %0;":
+                "+r"(r[i]): "r"(*carry)
             );
+        }
 
-            //================================================================//
-            //  Dump result to global memory -- LITTLE ENDIAN
-            //================================================================//
-            j = ((uint64_t *)r)[3] < ((uint64_t *)bound)[3]
-                || ((uint64_t *)r)[3] == ((uint64_t *)bound)[3] && (
-                    ((uint64_t *)r)[2] < ((uint64_t *)bound)[2]
-                    || ((uint64_t *)r)[2] == ((uint64_t *)bound)[2] && (
-                        ((uint64_t *)r)[1] < ((uint64_t *)bound)[1]
-                        || ((uint64_t *)r)[1] == ((uint64_t *)bound)[1]
-                        && ((uint64_t *)r)[0] < ((uint64_t *)bound)[0]
-                    )
-                );
+        asm volatile (
+            "madc.lo.u32 %0, %1, " qhi_s ", %0;": "+r"(r[7]): "r"(*carry)
+        );
 
-            
+        //================================================================//
+        //  Dump result to global memory -- LITTLE ENDIAN
+        //================================================================//
+        j = ((uint64_t *)r)[3] < ((uint64_t *)bound)[3]
+            || ((uint64_t *)r)[3] == ((uint64_t *)bound)[3] && (
+                ((uint64_t *)r)[2] < ((uint64_t *)bound)[2]
+                || ((uint64_t *)r)[2] == ((uint64_t *)bound)[2] && (
+                    ((uint64_t *)r)[1] < ((uint64_t *)bound)[1]
+                    || ((uint64_t *)r)[1] == ((uint64_t *)bound)[1]
+                    && ((uint64_t *)r)[0] < ((uint64_t *)bound)[0]
+                )
+            );
+
+        // append solution, every thread meeting the bound gets a slot
+        if (j)
+        {
+            uint32_t slot = WarpInc(count);
 
-            if(j)
+            if (slot < MAX_RESULTS)
             {
+                results[slot].nonce = base + tid;
 
-                
-                valid[0] = tid+1; 
                 #pragma unroll
                 for (int i = 0; i < NUM_SIZE_32; ++i)
                 {
-                    res[i] = r[i];
+                    results[slot].d[i] = r[i];
                 }
-
             }
-            
-        
         }
-        
     }
 
-  
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Mining iteration launch
+////////////////////////////////////////////////////////////////////////////////
+template<uint32_t BlockDim>
+static void LaunchIteration(
+    const uint32_t threads,
+    const prefilter_t & filter,
+    const uint32_t * bound,
+    const uint32_t * hashes,
+    const uint32_t * data,
+    const uint64_t base,
+    result_t * results,
+    uint32_t * count,
+    uint32_t * bhashes,
+    uint32_t * cands
+)
+{
+    CUDA_CALL(cudaMemsetAsync(cands, 0, sizeof(uint32_t), 0));
+
+    BlakeHash<BlockDim><<<1 + (threads - 1) / (BlockDim * 4), BlockDim>>>(
+        data, base, bhashes, threads
+    );
+
+    // compact solution candidates
+    BlockPrefilter<BlockDim><<<1 + (threads - 1) / BlockDim, BlockDim>>>(
+        hashes, filter, bhashes, threads, cands
+    );
+
+    // evaluate candidates
+    BlockMining<BlockDim><<<CANDIDATE_BLOCKS, BlockDim>>>(
+        bound, hashes, base, results, count, bhashes, threads, cands
+    );
+
+    return;
+}
+
+int LaunchMining(
+    const geometry_t & geometry,
+    const prefilter_t & filter,
+    const uint32_t * bound,
+    const uint32_t * hashes,
+    const uint32_t * data,
+    const uint64_t base,
+    result_t * results,
+    uint32_t * count,
+    uint32_t * bhashes,
+    uint32_t * cands
+)
+{
+    const uint32_t threads = geometry.nonces / NONCES_PER_THREAD;
+
+    // one case per element of MINING_BLOCK_DIMS
+    switch (geometry.blockDim)
+    {
+    case 32:
+        LaunchIteration<32>(
+            threads, filter, bound, hashes, data, base, results, count,
+            bhashes, cands
+        );
+        break;
+    case 64:
+        LaunchIteration<64>(
+            threads, filter, bound, hashes, data, base, results, count,
+            bhashes, cands
+        );
+        break;
+    case 128:
+        LaunchIteration<128>(
+            threads, filter, bound, hashes, data, base, results, count,
+            bhashes, cands
+        );
+        break;
+    case 256:
+        LaunchIteration<256>(
+            threads, filter, bound, hashes, data, base, results, count,
+            bhashes, cands
+        );
+        break;
+    default:
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
 }
 
 // mining.cu
@@ -0,0 +1,371 @@
+// multiblake.cc
+
+/*******************************************************************************
+
+    MULTIBLAKE -- Multi-lane BLAKE2b-256 compression on the host
+
+*******************************************************************************/
+
+#include "../include/multiblake.h"
+#include "../include/definitions.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define B2B_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//  Constants
+////////////////////////////////////////////////////////////////////////////////
+// message words permutations
+static const uint8_t sigma[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+// initialization vector
+static const uint64_t iv[8] = {
+    0x6A09E667F3BCC908, 0xBB67AE8584CAA73B,
+    0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+    0x510E527FADE682D1, 0x9B05688C2B3E6C1F,
+    0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//  Scalar compression
+////////////////////////////////////////////////////////////////////////////////
+static void CompressScalar(b2b_lanes_t * s, const uint64_t t, const int last)
+{
+    uint64_t v[16];
+    uint64_t m[16];
+
+    for (int l = 0; l < B2B_LANES; ++l)
+    {
+        for (int i = 0; i < 8; ++i) { v[i] = s->h[i][l]; }
+        for (int i = 0; i < 16; ++i) { m[i] = s->m[i][l]; }
+
+        B2B_IV(v + 8);
+
+        v[12] ^= t;
+        v[14] ^= (last)? ~(uint64_t)0: 0;
+
+        B2B_MIX(v, m);
+
+        for (int i = 0; i < 8; ++i) { s->h[i][l] ^= v[i] ^ v[i + 8]; }
+    }
+
+    return;
+}
+
+#ifdef B2B_X86_DISPATCH
+
+////////////////////////////////////////////////////////////////////////////////
+//  AVX2 compression: 4 lanes per vector
+////////////////////////////////////////////////////////////////////////////////
+#define ROTR64_AVX2(x, y)                                                      \
+(                                                                              \
+    ((y) == 32)? _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1)):           \
+    ((y) == 24)? _mm256_shuffle_epi8((x), rot24):                              \
+    ((y) == 16)? _mm256_shuffle_epi8((x), rot16):                              \
+    _mm256_or_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))    \
+)
+
+#define B2B_G_AVX2(v, a, b, c, d, x, y)                                        \
+do                                                                             \
+{                                                                              \
+    v[a] = _mm256_add_epi64(v[a], _mm256_add_epi64(v[b], x));                  \
+    v[d] = ROTR64_AVX2(_mm256_xor_si256(v[d], v[a]), 32);                      \
+    v[c] = _mm256_add_epi64(v[c], v[d]);                                       \
+    v[b] = ROTR64_AVX2(_mm256_xor_si256(v[b], v[c]), 24);                      \
+    v[a] = _mm256_add_epi64(v[a], _mm256_add_epi64(v[b], y));                  \
+    v[d] = ROTR64_AVX2(_mm256_xor_si256(v[d], v[a]), 16);                      \
+    v[c] = _mm256_add_epi64(v[c], v[d]);                                       \
+    v[b] = ROTR64_AVX2(_mm256_xor_si256(v[b], v[c]), 63);                      \
+}                                                                              \
+while (0)
+
+__attribute__((target("avx2")))
+static void CompressAvx2(b2b_lanes_t * s, const uint64_t t, const int last)
+{
+    const __m256i rot24 = _mm256_setr_epi8(
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10
+    );
+    const __m256i rot16 = _mm256_setr_epi8(
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9
+    );
+
+    __m256i v[16];
+    __m256i m[16];
+
+    for (int l = 0; l < B2B_LANES; l += 4)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            v[i] = _mm256_load_si256((const __m256i *)(s->h[i] + l));
+            v[i + 8] = _mm256_set1_epi64x((long long)iv[i]);
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            m[i] = _mm256_load_si256((const __m256i *)(s->m[i] + l));
+        }
+
+        v[12] = _mm256_xor_si256(v[12], _mm256_set1_epi64x((long long)t));
+        v[14] = _mm256_xor_si256(v[14], _mm256_set1_epi64x((last)? -1: 0));
+
+        for (int r = 0; r < 12; ++r)
+        {
+            B2B_G_AVX2(v, 0, 4,  8, 12, m[sigma[r][ 0]], m[sigma[r][ 1]]);
+            B2B_G_AVX2(v, 1, 5,  9, 13, m[sigma[r][ 2]], m[sigma[r][ 3]]);
+            B2B_G_AVX2(v, 2, 6, 10, 14, m[sigma[r][ 4]], m[sigma[r][ 5]]);
+            B2B_G_AVX2(v, 3, 7, 11, 15, m[sigma[r][ 6]], m[sigma[r][ 7]]);
+            B2B_G_AVX2(v, 0, 5, 10, 15, m[sigma[r][ 8]], m[sigma[r][ 9]]);
+            B2B_G_AVX2(v, 1, 6, 11, 12, m[sigma[r][10]], m[sigma[r][11]]);
+            B2B_G_AVX2(v, 2, 7,  8, 13, m[sigma[r][12]], m[sigma[r][13]]);
+            B2B_G_AVX2(v, 3, 4,  9, 14, m[sigma[r][14]], m[sigma[r][15]]);
+        }
+
+        for (int i = 0; i < 8; ++i)
+        {
+            __m256i h = _mm256_load_si256((const __m256i *)(s->h[i] + l));
+
+            h = _mm256_xor_si256(h, _mm256_xor_si256(v[i], v[i + 8]));
+            _mm256_store_si256((__m256i *)(s->h[i] + l), h);
+        }
+    }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  AVX-512 compression: 8 lanes per vector
+////////////////////////////////////////////////////////////////////////////////
+// full mask with the operand as source: unmasked shifts and rotations of
+// g++ 12 pass an undefined source and warn with -Wall
+#define ROTR64_AVX512(x, y)                                                    \
+(                                                                              \
+    _mm512_mask_ror_epi64((x), 0xFF, (x), (y))                                 \
+)
+
+#define B2B_G_AVX512(v, a, b, c, d, x, y)                                      \
+do                                                                             \
+{                                                                              \
+    v[a] = _mm512_add_epi64(v[a], _mm512_add_epi64(v[b], x));                  \
+    v[d] = ROTR64_AVX512(_mm512_xor_si512(v[d], v[a]), 32);                    \
+    v[c] = _mm512_add_epi64(v[c], v[d]);                                       \
+    v[b] = ROTR64_AVX512(_mm512_xor_si512(v[b], v[c]), 24);                    \
+    v[a] = _mm512_add_epi64(v[a], _mm512_add_epi64(v[b], y));                  \
+    v[d] = ROTR64_AVX512(_mm512_xor_si512(v[d], v[a]), 16);                    \
+    v[c] = _mm512_add_epi64(v[c], v[d]);                                       \
+    v[b] = ROTR64_AVX512(_mm512_xor_si512(v[b], v[c]), 63);                    \
+}                                                                              \
+while (0)
+
+__attribute__((target("avx512f")))
+static void CompressAvx512(b2b_lanes_t * s, const uint64_t t, const int last)
+{
+    __m512i v[16];
+    __m512i m[16];
+
+    for (int i = 0; i < 8; ++i)
+    {
+        v[i] = _mm512_load_si512((const void *)s->h[i]);
+        v[i + 8] = _mm512_set1_epi64((long long)iv[i]);
+    }
+
+    for (int i = 0; i < 16; ++i)
+    {
+        m[i] = _mm512_load_si512((const void *)s->m[i]);
+    }
+
+    v[12] = _mm512_xor_si512(v[12], _mm512_set1_epi64((long long)t));
+    v[14] = _mm512_xor_si512(v[14], _mm512_set1_epi64((last)? -1: 0));
+
+    for (int r = 0; r < 12; ++r)
+    {
+        B2B_G_AVX512(v, 0, 4,  8, 12, m[sigma[r][ 0]], m[sigma[r][ 1]]);
+        B2B_G_AVX512(v, 1, 5,  9, 13, m[sigma[r][ 2]], m[sigma[r][ 3]]);
+        B2B_G_AVX512(v, 2, 6, 10, 14, m[sigma[r][ 4]], m[sigma[r][ 5]]);
+        B2B_G_AVX512(v, 3, 7, 11, 15, m[sigma[r][ 6]], m[sigma[r][ 7]]);
+        B2B_G_AVX512(v, 0, 5, 10, 15, m[sigma[r][ 8]], m[sigma[r][ 9]]);
+        B2B_G_AVX512(v, 1, 6, 11, 12, m[sigma[r][10]], m[sigma[r][11]]);
+        B2B_G_AVX512(v, 2, 7,  8, 13, m[sigma[r][12]], m[sigma[r][13]]);
+        B2B_G_AVX512(v, 3, 4,  9, 14, m[sigma[r][14]], m[sigma[r][15]]);
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+        __m512i h = _mm512_load_si512((const void *)s->h[i]);
+
+        h = _mm512_xor_si512(h, _mm512_xor_si512(v[i], v[i + 8]));
+        _mm512_store_si512((void *)s->h[i], h);
+    }
+
+    return;
+}
+
+#endif // B2B_X86_DISPATCH
+
+////////////////////////////////////////////////////////////////////////////////
+//  Runtime dispatch
+////////////////////////////////////////////////////////////////////////////////
+typedef void (* compress_t)(b2b_lanes_t *, const uint64_t, const int);
+
+struct isa_t
+{
+    const char * name;
+    compress_t func;
+};
+
+// instruction sets in order of preference
+static const isa_t isas[] = {
+#ifdef B2B_X86_DISPATCH
+    { "avx512", CompressAvx512 },
+    { "avx2", CompressAvx2 },
+#endif
+    { "scalar", CompressScalar }
+};
+
+#define ISAS_LEN ((int)(sizeof(isas) / sizeof(isas[0])))
+
+// instruction set support check
+static int Supported(const isa_t * isa)
+{
+#ifdef B2B_X86_DISPATCH
+    if (!strcmp(isa->name, "avx512"))
+    {
+        return __builtin_cpu_supports("avx512f");
+    }
+
+    if (!strcmp(isa->name, "avx2")) { return __builtin_cpu_supports("avx2"); }
+#endif
+
+    return 1;
+}
+
+// best supported instruction set
+static const isa_t * Best(void)
+{
+    for (int i = 0; i < ISAS_LEN; ++i)
+    {
+        if (Supported(isas + i)) { return isas + i; }
+    }
+
+    return isas + ISAS_LEN - 1;
+}
+
+static std::atomic<const isa_t *> selected(Best());
+
+const char * CpuBlakeIsa(void)
+{
+    return selected.load()->name;
+}
+
+int CpuBlakeSelect(const char * isa)
+{
+    if (!isa)
+    {
+        selected = Best();
+
+        return EXIT_SUCCESS;
+    }
+
+    for (int i = 0; i < ISAS_LEN; ++i)
+    {
+        if (!strcmp(isa, isas[i].name) && Supported(isas + i))
+        {
+            selected = isas + i;
+
+            return EXIT_SUCCESS;
+        }
+    }
+
+    return EXIT_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Lane state access
+////////////////////////////////////////////////////////////////////////////////
+void CpuBlakeInit(b2b_lanes_t * s)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        for (int l = 0; l < B2B_LANES; ++l) { s->h[i][l] = iv[i]; }
+    }
+
+    for (int l = 0; l < B2B_LANES; ++l)
+    {
+        s->h[0][l] ^= 0x01010000 ^ NUM_SIZE_8;
+    }
+
+    return;
+}
+
+void CpuBlakeLoad(
+    // lane state
+    b2b_lanes_t * s,
+    // lane index
+    const uint32_t lane,
+    // message block
+    const uint8_t * block,
+    // message block length
+    const uint32_t len
+)
+{
+    uint64_t w[16] = {0};
+
+    memcpy(w, block, len);
+
+    for (int i = 0; i < 16; ++i) { s->m[i][lane] = w[i]; }
+
+    return;
+}
+
+void CpuBlakeCompress(
+    // lane state
+    b2b_lanes_t * s,
+    // total number of bytes hashed
+    const uint64_t t,
+    // final block flag
+    const int last
+)
+{
+    selected.load(std::memory_order_relaxed)->func(s, t, last);
+
+    return;
+}
+
+void CpuBlakeDump(
+    // lane state
+    const b2b_lanes_t * s,
+    // lane index
+    const uint32_t lane,
+    // hash
+    uint8_t * hash
+)
+{
+    for (int j = 0; j < NUM_SIZE_8; ++j)
+    {
+        hash[j] = (s->h[j >> 3][lane] >> ((j & 7) << 3)) & 0xFF;
+    }
+
+    return;
+}
+
+// multiblake.cc
@@ -19,7 +19,7 @@ __global__ void InitPrehash(
     const uint32_t * data,
     // hashes
     uint32_t * hashes,
-    // indices of invalid range hashes
+    // invalid range hashes: their number, then MAX_INVALID indices
     uint32_t * invalid
 )
 {
@@ -132,7 +132,7 @@ __global__ void InitPrehash(
         }
 
         //====================================================================//
-        //  Dump result to global memory -- BIG ENDIAN
+        //  Dump result to global memory -- LITTLE ENDIAN
         //====================================================================//
         j = ((uint64_t *)ldata)[3] < Q3
             || ((uint64_t *)ldata)[3] == Q3 && (
@@ -144,82 +144,19 @@ __global__ void InitPrehash(
                 )
             );
 
-        //invalid[tid] = (1 - j) * (tid + 1);
-
 #pragma unroll
-        for (int i = 0; i < NUM_SIZE_8; ++i)
+        for (int i = 0; i < NUM_SIZE_32; ++i)
         {
-            ((uint8_t *)hashes)[(tid + 1) * NUM_SIZE_8 - i - 1]
-                = ((uint8_t *)ldata)[i];
+            hashes[TABLE_POS(tid, i)] = ldata[i];
         }
 
-        // rehash out of bounds hash   
-        while(!j)
+        // out of bounds hash is rehashed by UpdatePrehash
+        if (!j)
         {
-            memset(ctx->b, 0, BUF_SIZE_8);
-            B2B_IV(ctx->h);
-            ctx->h[0] ^= 0x01010000 ^ NUM_SIZE_8;
-            memset(ctx->t, 0, 16);
-            ctx->c = 0;
-
-            //====================================================================//
-            //  Hash previous hash
-            //====================================================================//
-            #pragma unroll
-            for (j = 0; ctx->c < BUF_SIZE_8 && j < NUM_SIZE_8; ++j)
-            {
-                ctx->b[ctx->c++]
-                    = ((const uint8_t *)(hashes + tid * NUM_SIZE_32))[j];
-            }
-
-            #pragma unroll
-            for ( ; j < NUM_SIZE_8; )
-            {
-                DEVICE_B2B_H(ctx, aux);
-            
-            #pragma unroll
-                for ( ; ctx->c < BUF_SIZE_8 && j < NUM_SIZE_8; ++j)
-                {
-                    ctx->b[ctx->c++]
-                        = ((const uint8_t *)(hashes + tid * NUM_SIZE_32))[j];
-                }
-            }
-
-            //====================================================================//
-            //  Finalize hash
-            //====================================================================//
-            DEVICE_B2B_H_LAST(ctx, aux);
-
-            #pragma unroll
-            for (j = 0; j < NUM_SIZE_8; ++j)
-            {
-                ((uint8_t *)ldata)[NUM_SIZE_8 - j - 1]
-                    = (ctx->h[j >> 3] >> ((j & 7) << 3)) & 0xFF;
-            }
-
-            //====================================================================//
-            //  Dump result to global memory -- BIG ENDIAN
-            //====================================================================//
-            j = ((uint64_t *)ldata)[3] < Q3
-                || ((uint64_t *)ldata)[3] == Q3 && (
-                    ((uint64_t *)ldata)[2] < Q2
-                    || ((uint64_t *)ldata)[2] == Q2 && (
-                        ((uint64_t *)ldata)[1] < Q1
-                        || ((uint64_t *)ldata)[1] == Q1
-                        && ((uint64_t *)ldata)[0] < Q0
-                    )
-                );
-
-            #pragma unroll
-            for (int i = 0; i < NUM_SIZE_8; ++i)
-            {
-                    ((uint8_t *)hashes)[(tid + 1) * NUM_SIZE_8 - i - 1]
-                        = ((uint8_t *)ldata)[i];
-            }
+            uint32_t slot = WarpInc(invalid);
 
+            if (slot < MAX_INVALID) { invalid[1 + slot] = tid; }
         }
-
-
     }
 
     return;
@@ -362,7 +299,7 @@ __global__ void CompleteInitPrehash(
     const uctx_t * uctxs,
     // hashes
     uint32_t * hashes,
-    // indices of invalid range hashes
+    // invalid range hashes: their number, then MAX_INVALID indices
     uint32_t * invalid
 )
 {
@@ -486,7 +423,7 @@ __global__ void CompleteInitPrehash(
         }
 
         //====================================================================//    
-        //  Dump result to global memory -- BIG ENDIAN
+        //  Dump result to global memory -- LITTLE ENDIAN
         //====================================================================//
         j = ((uint64_t *)ldata)[3] < Q3
             || ((uint64_t *)ldata)[3] == Q3 && (
@@ -498,107 +435,45 @@ __global__ void CompleteInitPrehash(
                 )
             );
 
-        //invalid[tid] = (1 - j) * (tid + 1);
-
 #pragma unroll
-        for (int i = 0; i < NUM_SIZE_8; ++i)
+        for (int i = 0; i < NUM_SIZE_32; ++i)
         {
-            ((uint8_t *)hashes)[tid * NUM_SIZE_8 + NUM_SIZE_8 - i - 1]
-                = ((uint8_t *)ldata)[i];
+            hashes[TABLE_POS(tid, i)] = ldata[i];
         }
         
-        // rehash out of bounds hash
-        while(!j)
+        // out of bounds hash is rehashed by UpdatePrehash
+        if (!j)
         {
-            memset(ctx->b, 0, BUF_SIZE_8);
-            B2B_IV(ctx->h);
-            ctx->h[0] ^= 0x01010000 ^ NUM_SIZE_8;
-            memset(ctx->t, 0, 16);
-            ctx->c = 0;
-
-            //====================================================================//
-            //  Hash previous hash
-            //====================================================================//
-            #pragma unroll
-            for (j = 0; ctx->c < BUF_SIZE_8 && j < NUM_SIZE_8; ++j)
-            {
-                ctx->b[ctx->c++]
-                    = ((const uint8_t *)(hashes + tid*NUM_SIZE_32))[j];
-            }
-
-            #pragma unroll
-            for ( ; j < NUM_SIZE_8; )
-            {
-                DEVICE_B2B_H(ctx, aux);
-            
-            #pragma unroll
-                for ( ; ctx->c < BUF_SIZE_8 && j < NUM_SIZE_8; ++j)
-                {
-                    ctx->b[ctx->c++]
-                        = ((const uint8_t *)(hashes + tid * NUM_SIZE_32))[j];
-                }
-            }
-
-            //====================================================================//
-            //  Finalize hash
-            //====================================================================//
-            DEVICE_B2B_H_LAST(ctx, aux);
-
-            #pragma unroll
-            for (j = 0; j < NUM_SIZE_8; ++j)
-            {
-                ((uint8_t *)ldata)[NUM_SIZE_8 - j - 1]
-                    = (ctx->h[j >> 3] >> ((j & 7) << 3)) & 0xFF;
-            }
-
-            //====================================================================//
-            //  Dump result to global memory -- BIG ENDIAN
-            //====================================================================//
-            j = ((uint64_t *)ldata)[3] < Q3
-                || ((uint64_t *)ldata)[3] == Q3 && (
-                    ((uint64_t *)ldata)[2] < Q2
-                    || ((uint64_t *)ldata)[2] == Q2 && (
-                        ((uint64_t *)ldata)[1] < Q1
-                        || ((uint64_t *)ldata)[1] == Q1
-                        && ((uint64_t *)ldata)[0] < Q0
-                    )
-                );
-
-            #pragma unroll
-            for (int i = 0; i < NUM_SIZE_8; ++i)
-            {
-                    ((uint8_t *)hashes)[ (tid+1) * NUM_SIZE_8 - i - 1]
-                        = ((uint8_t *)ldata)[i];
-            }
+            uint32_t slot = WarpInc(invalid);
 
+            if (slot < MAX_INVALID) { invalid[1 + slot] = tid; }
         }
-    
-    
     }
 
-    
-
     return;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //  Rehash out of bounds hashes
-//  not used right now
 ////////////////////////////////////////////////////////////////////////////////
 __global__ void UpdatePrehash(
     // hashes
     uint32_t * hashes,
-    // indices of invalid range hashes
-    uint32_t * invalid,
-    const uint32_t len
+    // invalid range hashes: their number, then indices
+    const uint32_t * invalid
 )
 {
-    uint32_t tid = threadIdx.x + blockDim.x * blockIdx.x;
-
-    if (tid < len)
+    const uint32_t num = invalid[0];
+    // all hashes are checked if the list overflowed
+    const uint32_t len = (num > MAX_INVALID)? N_LEN: num;
+
+    for (
+        uint32_t c = threadIdx.x + blockDim.x * blockIdx.x; c < len;
+        c += blockDim.x * gridDim.x
+    )
     {
         uint32_t j;
-        uint32_t addr = invalid[tid] - 1;
+        uint32_t addr = (num > MAX_INVALID)? c: invalid[1 + c];
 
         // local memory
         // 472 bytes
@@ -609,53 +484,13 @@ __global__ void UpdatePrehash(
         // (212 + 4) bytes 
         ctx_t * ctx = (ctx_t *)(ldata + 64);
 
-        //====================================================================//
-        //  Initialize context
-        //====================================================================//
-        memset(ctx->b, 0, BUF_SIZE_8);
-        B2B_IV(ctx->h);
-        ctx->h[0] ^= 0x01010000 ^ NUM_SIZE_8;
-        memset(ctx->t, 0, 16);
-        ctx->c = 0;
-
-        //====================================================================//
-        //  Hash previous hash
-        //====================================================================//
-#pragma unroll
-        for (j = 0; ctx->c < BUF_SIZE_8 && j < NUM_SIZE_8; ++j)
-        {
-            ctx->b[ctx->c++]
-                = ((const uint8_t *)(hashes + addr * NUM_SIZE_32))[j];
-        }
-
-#pragma unroll
-        for ( ; j < NUM_SIZE_8; )
-        {
-            DEVICE_B2B_H(ctx, aux);
-           
+        // previous hash -- LITTLE ENDIAN
 #pragma unroll
-            for ( ; ctx->c < BUF_SIZE_8 && j < NUM_SIZE_8; ++j)
-            {
-                ctx->b[ctx->c++]
-                    = ((const uint8_t *)(hashes + addr * NUM_SIZE_32))[j];
-            }
-        }
-
-        //====================================================================//
-        //  Finalize hash
-        //====================================================================//
-        DEVICE_B2B_H_LAST(ctx, aux);
-
-#pragma unroll
-        for (j = 0; j < NUM_SIZE_8; ++j)
+        for (int i = 0; i < NUM_SIZE_32; ++i)
         {
-            ((uint8_t *)ldata)[NUM_SIZE_8 - j - 1]
-                = (ctx->h[j >> 3] >> ((j & 7) << 3)) & 0xFF;
+            ldata[i] = hashes[TABLE_POS(addr, i)];
         }
 
-        //====================================================================//
-        //  Dump result to global memory -- BIG ENDIAN
-        //====================================================================//
         j = ((uint64_t *)ldata)[3] < Q3
             || ((uint64_t *)ldata)[3] == Q3 && (
                 ((uint64_t *)ldata)[2] < Q2
@@ -666,13 +501,70 @@ __global__ void UpdatePrehash(
                 )
             );
 
-        invalid[tid] *= 1 - j;
+        while (!j)
+        {
+            //================================================================//
+            //  Initialize context
+            //================================================================//
+            memset(ctx->b, 0, BUF_SIZE_8);
+            B2B_IV(ctx->h);
+            ctx->h[0] ^= 0x01010000 ^ NUM_SIZE_8;
+            memset(ctx->t, 0, 16);
+            ctx->c = 0;
 
+            //================================================================//
+            //  Hash previous hash, kept in local memory
+            //================================================================//
 #pragma unroll
-        for (int i = 0; i < NUM_SIZE_8; ++i)
-        {
-            ((uint8_t *)hashes)[(addr + 1) * NUM_SIZE_8 - i - 1]
-                = ((uint8_t *)ldata)[i];
+            for (j = 0; ctx->c < BUF_SIZE_8 && j < NUM_SIZE_8; ++j)
+            {
+                ctx->b[ctx->c++]
+                    = ((const uint8_t *)ldata)[NUM_SIZE_8 - j - 1];
+            }
+
+#pragma unroll
+            for ( ; j < NUM_SIZE_8; )
+            {
+                DEVICE_B2B_H(ctx, aux);
+
+#pragma unroll
+                for ( ; ctx->c < BUF_SIZE_8 && j < NUM_SIZE_8; ++j)
+                {
+                    ctx->b[ctx->c++]
+                        = ((const uint8_t *)ldata)[NUM_SIZE_8 - j - 1];
+                }
+            }
+
+            //================================================================//
+            //  Finalize hash
+            //================================================================//
+            DEVICE_B2B_H_LAST(ctx, aux);
+
+#pragma unroll
+            for (j = 0; j < NUM_SIZE_8; ++j)
+            {
+                ((uint8_t *)ldata)[NUM_SIZE_8 - j - 1]
+                    = (ctx->h[j >> 3] >> ((j & 7) << 3)) & 0xFF;
+            }
+
+            //================================================================//
+            //  Dump result to global memory -- LITTLE ENDIAN
+            //================================================================//
+            j = ((uint64_t *)ldata)[3] < Q3
+                || ((uint64_t *)ldata)[3] == Q3 && (
+                    ((uint64_t *)ldata)[2] < Q2
+                    || ((uint64_t *)ldata)[2] == Q2 && (
+                        ((uint64_t *)ldata)[1] < Q1
+                        || ((uint64_t *)ldata)[1] == Q1
+                        && ((uint64_t *)ldata)[0] < Q0
+                    )
+                );
+
+#pragma unroll
+            for (int i = 0; i < NUM_SIZE_32; ++i)
+            {
+                hashes[TABLE_POS(addr, i)] = ldata[i];
+            }
         }
     }
 
@@ -695,10 +587,9 @@ __global__ void FinalPrehash(
         uint32_t h[NUM_SIZE_32];
 
 #pragma unroll
-        for (int i = 0; i < NUM_SIZE_8; ++i)
+        for (int i = 0; i < NUM_SIZE_32; ++i)
         {
-             ((uint8_t *)h)[i]
-                 = ((uint8_t *)hashes)[(tid + 1) * NUM_SIZE_8 - i - 1]; 
+            h[i] = hashes[TABLE_POS(tid, i)];
         }
 
         //====================================================================//
@@ -752,13 +643,12 @@ __global__ void FinalPrehash(
         );
 
         //====================================================================//
-        //  Dump result to global memory -- BIG ENDIAN
+        //  Dump result to global memory -- LITTLE ENDIAN
         //====================================================================//
 #pragma unroll
-        for (int i = 0; i < NUM_SIZE_8; ++i)
+        for (int i = 0; i < NUM_SIZE_32; ++i)
         {
-            ((uint8_t *)hashes)[tid * NUM_SIZE_8 + i]
-                = ((uint8_t *)h)[NUM_SIZE_8 - i - 1];
+            hashes[TABLE_POS(tid, i)] = h[i];
         }
     }
 
@@ -803,10 +693,9 @@ __global__ void FinalPrehashMultSecKey(
         uint32_t h[NUM_SIZE_32];
 
 #pragma unroll
-        for (int j = 0; j < NUM_SIZE_8; ++j)
+        for (int j = 0; j < NUM_SIZE_32; ++j)
         {
-             ((uint8_t *)h)[j]
-                 = ((uint8_t *)hashes)[(tid + 1) * NUM_SIZE_8 - j - 1]; 
+            h[j] = hashes[TABLE_POS(tid, j)];
         }
 
         uint32_t r[NUM_SIZE_32 << 1];
@@ -1100,7 +989,7 @@ __global__ void FinalPrehashMultSecKey(
 #pragma unroll
         for (int i = 0; i < NUM_SIZE_32; ++i)
         {
-            hashes[tid * NUM_SIZE_32 + i] = r[i];
+            hashes[TABLE_POS(tid, i)] = r[i];
         }
     }
 
@@ -1118,34 +1007,40 @@ int Prehash(
     uctx_t * uctxs,
     // hashes
     uint32_t * hashes,
-    // indices of invalid range hashes
-    uint32_t * invalid
+    // invalid range hashes: their number, then MAX_INVALID indices
+    uint32_t * invalid,
+    // stream to launch kernels in
+    cudaStream_t stream
 )
 {
-
-    uint32_t * ind = invalid;
+    CUDA_CALL(cudaMemsetAsync(invalid, 0, sizeof(uint32_t), stream));
 
     // complete init prehash by hashing message and public key
     if (keep)
     {
-        CompleteInitPrehash<<<1 + (N_LEN - 1) / BLOCK_DIM, BLOCK_DIM>>>(
-            data, uctxs, hashes, ind
-        );
+        CompleteInitPrehash<<<
+            1 + (N_LEN - 1) / BLOCK_DIM, BLOCK_DIM, 0, stream
+        >>>(data, uctxs, hashes, invalid);
         CUDA_CALL(cudaPeekAtLastError());
     }
     // hash index, constant message and public key
     else
     {
-        InitPrehash<<<1 + (N_LEN - 1) / BLOCK_DIM, BLOCK_DIM>>>(
-            data, hashes, ind
+        InitPrehash<<<1 + (N_LEN - 1) / BLOCK_DIM, BLOCK_DIM, 0, stream>>>(
+            data, hashes, invalid
         );
         CUDA_CALL(cudaPeekAtLastError());
     }
-    
+
+    // rehash compacted out of bounds hashes
+    UpdatePrehash<<<
+        1 + (MAX_INVALID - 1) / BLOCK_DIM, BLOCK_DIM, 0, stream
+    >>>(hashes, invalid);
+
     // multiply by secret key moq Q
-    FinalPrehashMultSecKey<<<1 + (N_LEN - 1) / BLOCK_DIM, BLOCK_DIM>>>(
-        data, hashes
-    );
+    FinalPrehashMultSecKey<<<
+        1 + (N_LEN - 1) / BLOCK_DIM, BLOCK_DIM, 0, stream
+    >>>(data, hashes);
 
     return EXIT_SUCCESS;
 }
@@ -10,6 +10,7 @@
 #include "../include/cryptography.h"
 #include "../include/definitions.h"
 #include "../include/jsmn.h"
+#include "../include/uint256.h"
 #include <ctype.h>
 #include <curl/curl.h>
 #include <inttypes.h>
@@ -31,7 +32,15 @@ int ReadConfig(
     char * skstr,
     char * from,
     char * to,
-    int * keep
+    int * keep,
+    int * cpu,
+    numa_t * numa,
+    int * dbuf,
+    char * cache,
+    char * push,
+    pool_t * pool,
+    int * telemetry,
+    char * profiles
 )
 {
     std::ifstream file(
@@ -77,6 +86,32 @@ int ReadConfig(
     // default keepPrehash = false
     *keep = 0;
 
+    // default cpuMining = false
+    *cpu = 0;
+
+    // default cpuNuma = replicate
+    *numa = NUMA_REPLICATE;
+
+    // default doubleBuffer = false
+    *dbuf = 0;
+
+    // default prehashCache is disabled
+    cache[0] = '\0';
+
+    // default blockPush is disabled
+    push[0] = '\0';
+
+    // default is solo mining
+    pool->url[0] = '\0';
+    pool->user[0] = '\0';
+    pool->pass[0] = '\0';
+
+    // default telemetry interval
+    *telemetry = TELEMETRY_INTERVAL_MS;
+
+    // default geometry profiles file
+    strcpy(profiles, TUNE_PROFILES);
+
     char* seedstring;
     char* seedPass;
 
@@ -109,6 +144,103 @@ int ReadConfig(
                 VLOG(1) << "Setting keepPrehash to 1";
             }
         }
+        else if (config.jsoneq(t, "cpuMining"))
+        {
+            if (!strncmp(config.GetTokenStart(t + 1), "true", 4))
+            {
+                *cpu = 1;
+
+                VLOG(1) << "Setting cpuMining to 1";
+            }
+        }
+        else if (config.jsoneq(t, "cpuNuma"))
+        {
+            if (!strncmp(config.GetTokenStart(t + 1), "interleave", 10))
+            {
+                *numa = NUMA_INTERLEAVE;
+            }
+            else if (!strncmp(config.GetTokenStart(t + 1), "off", 3))
+            {
+                *numa = NUMA_OFF;
+            }
+
+            VLOG(1) << "Setting cpuNuma to " << *numa;
+        }
+        else if (config.jsoneq(t, "doubleBuffer"))
+        {
+            if (!strncmp(config.GetTokenStart(t + 1), "true", 4))
+            {
+                *dbuf = 1;
+
+                VLOG(1) << "Setting doubleBuffer to 1";
+            }
+        }
+        else if (config.jsoneq(t, "prehashCache"))
+        {
+            cache[0] = '\0';
+
+            strncat(
+                cache, config.GetTokenStart(t + 1),
+                (config.GetTokenLen(t + 1) < MAX_URL_SIZE - 1)?
+                config.GetTokenLen(t + 1): MAX_URL_SIZE - 1
+            );
+
+            VLOG(1) << "Setting prehashCache to " << cache;
+        }
+        else if (config.jsoneq(t, "blockPush"))
+        {
+            push[0] = '\0';
+
+            strncat(
+                push, config.GetTokenStart(t + 1),
+                (config.GetTokenLen(t + 1) < MAX_URL_SIZE - 1)?
+                config.GetTokenLen(t + 1): MAX_URL_SIZE - 1
+            );
+
+            VLOG(1) << "Setting blockPush to " << push;
+        }
+        else if (
+            config.jsoneq(t, "pool") || config.jsoneq(t, "poolUser")
+            || config.jsoneq(t, "poolPass")
+        )
+        {
+            char * val = (config.jsoneq(t, "pool"))? pool->url:
+                (config.jsoneq(t, "poolUser"))? pool->user: pool->pass;
+
+            val[0] = '\0';
+
+            strncat(
+                val, config.GetTokenStart(t + 1),
+                (config.GetTokenLen(t + 1) < MAX_URL_SIZE - 1)?
+                config.GetTokenLen(t + 1): MAX_URL_SIZE - 1
+            );
+
+            // password is not logged
+            if (val != pool->pass) { VLOG(1) << "Setting pool option " << val; }
+        }
+        else if (config.jsoneq(t, "telemetryInterval"))
+        {
+            *telemetry = strtol(config.GetTokenStart(t + 1), NULL, 10);
+
+            if (*telemetry < TELEMETRY_MIN_INTERVAL_MS)
+            {
+                *telemetry = TELEMETRY_MIN_INTERVAL_MS;
+            }
+
+            VLOG(1) << "Setting telemetryInterval to " << *telemetry;
+        }
+        else if (config.jsoneq(t, "geometryProfiles"))
+        {
+            profiles[0] = '\0';
+
+            strncat(
+                profiles, config.GetTokenStart(t + 1),
+                (config.GetTokenLen(t + 1) < MAX_URL_SIZE - 1)?
+                config.GetTokenLen(t + 1): MAX_URL_SIZE - 1
+            );
+
+            VLOG(1) << "Setting geometryProfiles to " << profiles;
+        }
         else if (config.jsoneq(t, "mnemonic") || config.jsoneq(t,"seed"))
         {
 
@@ -130,7 +262,11 @@ int ReadConfig(
         else
         {
             LOG(INFO) << "Unrecognized config option, currently valid options are "
-                         "\"node\", \"mnemonic\", \"mnemonicPass\" and \"keepPrehash\"";
+                         "\"node\", \"mnemonic\", \"mnemonicPass\", \"keepPrehash\", "
+                         "\"cpuMining\", \"cpuNuma\", \"doubleBuffer\", "
+                         "\"prehashCache\", "
+                         "\"blockPush\", \"pool\", \"poolUser\", \"poolPass\", "
+                         "\"telemetryInterval\" and \"geometryProfiles\"";
         }
     }
 
@@ -175,10 +311,12 @@ int ReadConfig(
 
 
 
-    if (readSeed & readNode) { return EXIT_SUCCESS; }
+    // pool mining does not need a node
+    if (readSeed && (readNode || pool->url[0])) { return EXIT_SUCCESS; }
     else
     {
-        LOG(ERROR) << "Incomplete config: node or seed are not specified";
+        LOG(ERROR) << "Incomplete config: node or pool or seed are not "
+            "specified";
         return EXIT_FAILURE;
     }
 }
@@ -198,14 +336,10 @@ int PrintPublicKey(const char * pkstr, char * str)
 
 int PrintPublicKey(const uint8_t * pk, char * str)
 {
-    sprintf(
-        str, "   pkHex = 0x%02X%016lX%016lX%016lX%016lX",
-        pk[0],
-        REVERSE_ENDIAN((uint64_t *)(pk + 1) + 0),
-        REVERSE_ENDIAN((uint64_t *)(pk + 1) + 1),
-        REVERSE_ENDIAN((uint64_t *)(pk + 1) + 2),
-        REVERSE_ENDIAN((uint64_t *)(pk + 1) + 3)
-    );
+    char hex[NUM_SIZE_4 + 1];
+
+    Uint256ToHexStr(U256FromBigEndian(pk + 1), hex);
+    sprintf(str, "   pkHex = 0x%02X%s", pk[0], hex);
 
     return EXIT_SUCCESS;
 }
@@ -219,12 +353,15 @@ int PrintPuzzleSolution(
     char * str
 )
 {
+    uint64_t n;
+    const uint256_t d = U256FromLittleEndian(sol);
+
+    memcpy(&n, nonce, NONCE_SIZE_8);
+
     sprintf(
-        str, "   nonce = 0x%016lX\n"
-        "       d = 0x%016lX %016lX %016lX %016lX",
-        *((uint64_t *)nonce),
-        ((uint64_t *)sol)[3], ((uint64_t *)sol)[2],
-        ((uint64_t *)sol)[1], ((uint64_t *)sol)[0]
+        str, "   nonce = 0x%016" PRIX64 "\n"
+        "       d = 0x%016" PRIX64 " %016" PRIX64 " %016" PRIX64 " %016" PRIX64,
+        n, d.w[3], d.w[2], d.w[1], d.w[0]
     );
 
     return EXIT_SUCCESS;
@@ -0,0 +1,237 @@
+// reduction.cu
+
+/*******************************************************************************
+
+    REDUCTION -- Identification of Autolykos puzzle solution
+
+*******************************************************************************/
+
+#include "../include/reduction.h"
+#include <cuda.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//  Smallest power of two not lesser then given number
+////////////////////////////////////////////////////////////////////////////////
+uint32_t CeilToPower(uint32_t x)
+{
+    --x;
+
+    x |= x >> 1;
+    x |= x >> 2;
+    x |= x >> 4;
+    x |= x >> 8;
+    x |= x >> 16;
+
+    return ++x;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Block reductions
+////////////////////////////////////////////////////////////////////////////////
+template<uint32_t blockSize>
+__global__ void BlockNonZero(
+    // array
+    uint32_t * in,
+    // length of array
+    uint32_t inlen,
+    // items of blocks
+    uint32_t * out
+)
+{
+    __shared__ uint32_t sdata[blockSize];
+
+    uint32_t tid = threadIdx.x;
+    uint32_t item = 0;
+
+    // first non zero item of grid-strided part
+    for (
+        uint32_t i = tid + blockSize * blockIdx.x; i < inlen && !item;
+        i += blockSize * gridDim.x
+    )
+    {
+        item = in[i];
+    }
+
+    sdata[tid] = item;
+    __syncthreads();
+
+#pragma unroll
+    for (uint32_t s = blockSize >> 1; s > 0; s >>= 1)
+    {
+        if (tid < s && !sdata[tid]) { sdata[tid] = sdata[tid + s]; }
+
+        __syncthreads();
+    }
+
+    if (!tid) { out[blockIdx.x] = sdata[0]; }
+
+    return;
+}
+
+template<uint32_t blockSize>
+__global__ void BlockSum(
+    // array
+    uint32_t * in,
+    // length of array
+    uint32_t inlen,
+    // sums of blocks
+    uint32_t * out
+)
+{
+    __shared__ uint32_t sdata[blockSize];
+
+    uint32_t tid = threadIdx.x;
+    uint32_t sum = 0;
+
+    // sum of grid-strided part
+    for (
+        uint32_t i = tid + blockSize * blockIdx.x; i < inlen;
+        i += blockSize * gridDim.x
+    )
+    {
+        sum += in[i];
+    }
+
+    sdata[tid] = sum;
+    __syncthreads();
+
+#pragma unroll
+    for (uint32_t s = blockSize >> 1; s > 0; s >>= 1)
+    {
+        if (tid < s) { sdata[tid] += sdata[tid + s]; }
+
+        __syncthreads();
+    }
+
+    if (!tid) { out[blockIdx.x] = sdata[0]; }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Reductions of blocks of array
+////////////////////////////////////////////////////////////////////////////////
+void ReduceNonZero(
+    uint32_t * in,
+    uint32_t inlen,
+    uint32_t * out,
+    uint32_t gridSize,
+    uint32_t blockSize
+)
+{
+    // instance for block size rounded up to power of two
+    switch (CeilToPower(blockSize))
+    {
+    case 32:
+        BlockNonZero<32><<<gridSize, 32>>>(in, inlen, out);
+        break;
+    case 64:
+        BlockNonZero<64><<<gridSize, 64>>>(in, inlen, out);
+        break;
+    case 128:
+        BlockNonZero<128><<<gridSize, 128>>>(in, inlen, out);
+        break;
+    case 256:
+        BlockNonZero<256><<<gridSize, 256>>>(in, inlen, out);
+        break;
+    case 512:
+        BlockNonZero<512><<<gridSize, 512>>>(in, inlen, out);
+        break;
+    default:
+        BlockNonZero<1024><<<gridSize, 1024>>>(in, inlen, out);
+        break;
+    }
+
+    return;
+}
+
+void ReduceSum(
+    uint32_t * in,
+    uint32_t inlen,
+    uint32_t * out,
+    uint32_t gridSize,
+    uint32_t blockSize
+)
+{
+    // instance for block size rounded up to power of two
+    switch (CeilToPower(blockSize))
+    {
+    case 32:
+        BlockSum<32><<<gridSize, 32>>>(in, inlen, out);
+        break;
+    case 64:
+        BlockSum<64><<<gridSize, 64>>>(in, inlen, out);
+        break;
+    case 128:
+        BlockSum<128><<<gridSize, 128>>>(in, inlen, out);
+        break;
+    case 256:
+        BlockSum<256><<<gridSize, 256>>>(in, inlen, out);
+        break;
+    case 512:
+        BlockSum<512><<<gridSize, 512>>>(in, inlen, out);
+        break;
+    default:
+        BlockSum<1024><<<gridSize, 1024>>>(in, inlen, out);
+        break;
+    }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Reductions of array
+////////////////////////////////////////////////////////////////////////////////
+// number of blocks of the first pass, REDUCTION_BLOCK_DIM at most
+static uint32_t FirstGrid(const uint32_t inlen)
+{
+    uint32_t gridSize = 1 + (inlen - (inlen > 0)) / REDUCTION_BLOCK_DIM;
+
+    return (gridSize < REDUCTION_BLOCK_DIM)? gridSize: REDUCTION_BLOCK_DIM;
+}
+
+uint32_t FindNonZero(
+    uint32_t * data,
+    uint32_t * aux,
+    uint32_t inlen
+)
+{
+    uint32_t gridSize = FirstGrid(inlen);
+    uint32_t res;
+
+    ReduceNonZero(data, inlen, aux, gridSize, REDUCTION_BLOCK_DIM);
+
+    // single block reads all items before writing its own
+    if (gridSize > 1)
+    {
+        ReduceNonZero(aux, gridSize, aux, 1, REDUCTION_BLOCK_DIM);
+    }
+
+    CUDA_CALL(cudaMemcpy(&res, aux, sizeof(uint32_t), cudaMemcpyDeviceToHost));
+
+    return res;
+}
+
+uint32_t FindSum(
+    uint32_t * data,
+    uint32_t * aux,
+    uint32_t inlen
+)
+{
+    uint32_t gridSize = FirstGrid(inlen);
+    uint32_t res;
+
+    ReduceSum(data, inlen, aux, gridSize, REDUCTION_BLOCK_DIM);
+
+    // single block reads all items before writing its own
+    if (gridSize > 1)
+    {
+        ReduceSum(aux, gridSize, aux, 1, REDUCTION_BLOCK_DIM);
+    }
+
+    CUDA_CALL(cudaMemcpy(&res, aux, sizeof(uint32_t), cudaMemcpyDeviceToHost));
+
+    return res;
+}
+
+// reduction.cu
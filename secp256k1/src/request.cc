@@ -12,6 +12,7 @@
 #include "../include/jsmn.h"
 #include "../include/processing.h"
 #include "../include/request.h"
+#include "../include/uint256.h"
 #include <ctype.h>
 #include <curl/curl.h>
 #include <fcntl.h>
@@ -34,71 +35,166 @@ size_t WriteFunc(
 {
     size_t newlen = request->len + size * nmemb;
 
-    if (newlen > request->cap)
+    // buffer only grows, so a reused request does not allocate
+    if (newlen >= request->cap)
     {
-        request->cap = (newlen << 1) + 1;
+        size_t cap = (newlen << 1) + 1;
+        char * buf;
 
-        if (request->cap > MAX_JSON_CAPACITY)
+        if (cap > MAX_JSON_CAPACITY)
         {
             LOG(ERROR) << "Request capacity exceeds json capacity in WriteFunc";
         }
 
-        if (!(request->ptr = (char *)realloc(request->ptr, request->cap)))
+        if (!(buf = (char *)realloc(request->ptr, cap)))
         {
             LOG(ERROR) << "Request pointer realloc failed in WriteFunc";
-        } 
+
+            // CURL aborts transfer
+            return 0;
+        }
+
+        request->ptr = buf;
+        request->cap = cap;
+    }
+
+    const uint8_t * in = (const uint8_t *)ptr;
+    uint64_t hash = request->hash;
+
+    for (size_t i = 0; i < size * nmemb; ++i)
+    {
+        hash = (hash ^ in[i]) * JSON_HASH_PRIME;
     }
 
     memcpy(request->ptr + request->len, ptr, size * nmemb);
 
     request->ptr[newlen] = '\0';
     request->len = newlen;
+    request->hash = hash;
 
     return size * nmemb;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//  Lowercase letters convert to uppercase
+//  CURL log error 
 ////////////////////////////////////////////////////////////////////////////////
-int ToUppercase(char * str)
+void CurlLogError(CURLcode curl_status)
 {
-    for (int i = 0; str[i] != '\0'; ++i) { str[i] = toupper(str[i]); }
+    if (curl_status != CURLE_OK)
+    {
+        LOG(ERROR) << "CURL: " << curl_easy_strerror(curl_status);
+    }
 
-    return EXIT_SUCCESS;
+    return;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//  CURL log error 
+//  Case insensitive comparison of strings of the same length
 ////////////////////////////////////////////////////////////////////////////////
-void CurlLogError(CURLcode curl_status)
+static int StrEqNoCase(
+    const char * a,
+    const char * b,
+    const int len
+)
 {
-    if (curl_status != CURLE_OK)
+    for (int i = 0; i < len; ++i)
     {
-        LOG(ERROR) << "CURL: " << curl_easy_strerror(curl_status);
+        if (toupper((unsigned char)a[i]) != toupper((unsigned char)b[i]))
+        {
+            return 0;
+        }
     }
 
-    return;
+    return 1;
+}
+
+// token name check, case insensitive
+static int KeyEq(
+    const json_t * req,
+    const int pos,
+    const char * key
+)
+{
+    const jsmntok_t & tok = req->toks[pos];
+
+    return tok.type == JSMN_STRING
+        && (int)strlen(key) == tok.end - tok.start
+        && StrEqNoCase(req->ptr + tok.start, key, tok.end - tok.start);
+}
+
+// position of the token following the value at 'pos' with its children
+static int SkipValue(
+    const jsmntok_t * toks,
+    int pos
+)
+{
+    for (int pending = 1; pending > 0; ++pos)
+    {
+        pending += toks[pos].size - 1;
+    }
+
+    return pos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Tokenize JSON string, tokens array grows up to MAX_REQ_LEN
+////////////////////////////////////////////////////////////////////////////////
+static int Tokenize(json_t * req)
+{
+    jsmn_parser parser;
+    int numtoks;
+
+    for ( ; ; )
+    {
+        jsmn_init(&parser);
+
+        numtoks = jsmn_parse(
+            &parser, req->ptr, req->len, req->toks, req->toklen
+        );
+
+        if (numtoks != JSMN_ERROR_NOMEM || req->toklen >= MAX_REQ_LEN)
+        {
+            return numtoks;
+        }
+
+        jsmntok_t * toks = (jsmntok_t *)realloc(
+            req->toks, (req->toklen << 1) * sizeof(jsmntok_t)
+        );
+
+        if (!toks) { return JSMN_ERROR_NOMEM; }
+
+        req->toks = toks;
+        req->toklen <<= 1;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Parse JSON request and substitute data if needed
 // moved to separate function for tests
 ///////////////////////////////////////////////////////////////////////////////
-
 int ParseRequest(json_t * oldreq , json_t * newreq, info_t *info, int checkPubKey)
 {
-    jsmn_parser parser;
-    int mesChanged = 0;
-    int boundChanged = 0;
-    ToUppercase(newreq->ptr);
-    jsmn_init(&parser);
-    
+    // latest candidate is known only if it was parsed
+    int known = oldreq->len && oldreq->mesPos >= 0;
+
+    //========================================================================//
+    //  Fast path, unchanged body is not parsed
+    //========================================================================//
+    if (
+        known && newreq->len == oldreq->len && newreq->hash == oldreq->hash
+        && !memcmp(newreq->ptr, oldreq->ptr, newreq->len)
+    )
+    {
+        newreq->mesPos = -1;
 
-    int numtoks = jsmn_parse(
-        &parser, newreq->ptr, newreq->len, newreq->toks, REQ_LEN
-    );
+        return EXIT_SUCCESS;
+    }
 
-    if (numtoks < 0)
+    newreq->mesPos = newreq->boundPos = newreq->pkPos = -1;
+
+    int numtoks = Tokenize(newreq);
+
+    if (numtoks < 1 || newreq->toks[0].type != JSMN_OBJECT)
     {
         LOG(ERROR) << "Jsmn failed to parse latest block";
         LOG(ERROR) << "Block data: " << newreq->ptr;
@@ -106,29 +202,31 @@ int ParseRequest(json_t * oldreq , json_t * newreq, info_t *info, int checkPubKe
         return EXIT_FAILURE;
     }
 
+    //========================================================================//
+    //  Find fields of the top level object in place
+    //========================================================================//
     int PkPos = -1;
     int BoundPos = -1;
     int MesPos = -1;
 
-    for(int i = 1; i < numtoks; i+=2)
+    for (int i = 1; i + 1 < numtoks; i = SkipValue(newreq->toks, i + 1))
     {
-        if(newreq->jsoneq(i,"B"))
+        if (KeyEq(newreq, i, "b"))
         {
-            BoundPos = i+1; 
+            BoundPos = i + 1;
         }
-        else if(newreq->jsoneq(i,"PK"))
+        else if (KeyEq(newreq, i, "pk"))
         {
-            PkPos = i+1;
+            PkPos = i + 1;
         }
-        else if(newreq->jsoneq(i,"MSG"))
+        else if (KeyEq(newreq, i, "msg"))
         {
-            MesPos = i+1;
+            MesPos = i + 1;
         }
         else
         {
             VLOG(1) << "Unexpected field in /block/candidate json";
         }
-
     }
 
     if( PkPos < 0 || BoundPos < 0 || MesPos < 0 )
@@ -146,7 +244,7 @@ int ParseRequest(json_t * oldreq , json_t * newreq, info_t *info, int checkPubKe
 
     if (checkPubKey)
     {   
-        if (strncmp(info->pkstr, newreq->GetTokenStart(PkPos), PK_SIZE_4))
+        if (!StrEqNoCase(info->pkstr, newreq->GetTokenStart(PkPos), PK_SIZE_4))
         {
                 char logstr[1000];
 
@@ -163,66 +261,71 @@ int ParseRequest(json_t * oldreq , json_t * newreq, info_t *info, int checkPubKe
         }
     }
 
+    //========================================================================//
+    //  Compare with the latest candidate at its own positions
+    //========================================================================//
     int mesLen = newreq->GetTokenLen(MesPos);
     int boundLen = newreq->GetTokenLen(BoundPos);       
+    int mesChanged = 1;
+    int boundChanged = 1;
 
-
-    if (oldreq->len)
+    if (known)
     {
-        if (mesLen != oldreq->GetTokenLen(MesPos)) { mesChanged = 1; }
-        else
-        {
-            mesChanged = strncmp(
-                oldreq->GetTokenStart(MesPos),
-                newreq->GetTokenStart(MesPos),
-                mesLen
+        mesChanged = mesLen != oldreq->GetTokenLen(oldreq->mesPos)
+            || !StrEqNoCase(
+                oldreq->GetTokenStart(oldreq->mesPos),
+                newreq->GetTokenStart(MesPos), mesLen
             );
-        }
 
-        if (boundLen != oldreq->GetTokenLen(BoundPos))
-        {
-            boundChanged = 1;
-        }
-        else
-        {
-            boundChanged = strncmp(
-                oldreq->GetTokenStart(BoundPos),
-                newreq->GetTokenStart(BoundPos),
-                boundLen
+        boundChanged = boundLen != oldreq->GetTokenLen(oldreq->boundPos)
+            || memcmp(
+                oldreq->GetTokenStart(oldreq->boundPos),
+                newreq->GetTokenStart(BoundPos), boundLen
             );
-        }
     }
 
+    uint256_t bound;
+
+    if (
+        boundChanged
+        && DecStrToUint256(
+            newreq->GetTokenStart(BoundPos), boundLen, &bound
+        ) != EXIT_SUCCESS
+    )
+    {
+        LOG(ERROR) << "Wrong bound in block info";
+        LOG(ERROR) << "Block data: " << newreq->ptr;
+        return EXIT_FAILURE;
+    }
+
+    newreq->mesPos = MesPos;
+    newreq->boundPos = BoundPos;
+    newreq->pkPos = PkPos;
+
     // check if we need to change anything, only then lock info mutex
-    if (mesChanged || boundChanged || !(oldreq->len))
+    if (mesChanged || boundChanged)
     {
         info->info_mutex.lock();
         
         //================================================================//
         //  Substitute message and change state when message changed
         //================================================================//
-        if (!(oldreq->len) || mesChanged)
+        if (mesChanged)
         {
                 HexStrToBigEndian(
-                    newreq->GetTokenStart(MesPos), newreq->GetTokenLen(MesPos),
-                    info->mes, NUM_SIZE_8
+                    newreq->GetTokenStart(MesPos), mesLen, info->mes,
+                    NUM_SIZE_8
                 );
+
+                ++(info->mesId);
         }
 
         //================================================================//
         //  Substitute bound in case it changed
         //================================================================//
-        if (!(oldreq->len) || boundChanged)
+        if (boundChanged)
         {
-            char buf[NUM_SIZE_4 + 1];
-
-            DecStrToHexStrOf64(
-                newreq->GetTokenStart(BoundPos),
-                newreq->GetTokenLen(BoundPos),
-                buf
-            );
-
-            HexStrToLittleEndian(buf, NUM_SIZE_4, info->bound, NUM_SIZE_8);
+            U256ToLittleEndian(bound, info->bound);
         }
         
         info->info_mutex.unlock();
@@ -233,90 +336,47 @@ int ParseRequest(json_t * oldreq , json_t * newreq, info_t *info, int checkPubKe
     }
 
     return EXIT_SUCCESS;
-
-
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//  CURL http GET request
+//  Parse block data and keep it as the latest one
 ////////////////////////////////////////////////////////////////////////////////
-int GetLatestBlock(
-    const char * from,
+int ApplyBlock(
     json_t * oldreq,
+    json_t * newreq,
     info_t * info,
     int checkPubKey
 )
 {
-    CURL * curl;
-    json_t newreq(0, REQ_LEN);
+    if (ParseRequest(oldreq, newreq, info, checkPubKey) != EXIT_SUCCESS)
+    {
+        return EXIT_FAILURE;
+    }
 
     //========================================================================//
-    //  Get latest block
+    //  Substitute old block with newly read
     //========================================================================//
-    CURLcode curlError;
-
-    curl = curl_easy_init();
-    if (!curl) { LOG(ERROR) << "CURL initialization failed in GetLatestBlock"; }
-
-    CurlLogError(curl_easy_setopt(curl, CURLOPT_URL, from));
-    CurlLogError(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteFunc));
-    CurlLogError(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &newreq));
-    
-    // set timeout to 30 sec so it doesn't hang up
-    // waiting for default 5 minutes if url is unreachable / wrong 
-    CurlLogError(curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L));
-    CurlLogError(curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L));
-    curlError = curl_easy_perform(curl);
-    CurlLogError(curlError);
-    curl_easy_cleanup(curl);
-
-    VLOG(1) << "GET request " << newreq.ptr;
-    
-    // if curl returns error on request, do not change or check anything 
-    if (!curlError)
-    {
-        int oldId = info->blockId.load();
-        if(ParseRequest(oldreq, &newreq, info, checkPubKey) != EXIT_SUCCESS)
-        {
-            return EXIT_FAILURE;
-        }
-        //====================================================================//
-        //  Substitute old block with newly read
-        //====================================================================//
-        if(oldId != info->blockId.load())
-        {
-            FREE(oldreq->ptr);
-            FREE(oldreq->toks);
-            *oldreq = newreq;
-            newreq.ptr = NULL;
-            newreq.toks = NULL;
-        }
+    // swap buffers, so the old one is reused for the next request,
+    // an unchanged body is not parsed and kept as is
+    if (newreq->mesPos >= 0) { oldreq->Swap(*newreq); }
 
-        return EXIT_SUCCESS;
-    }
-    
-    return EXIT_FAILURE;
+    return EXIT_SUCCESS;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//  CURL http POST request
+//  Form puzzle solution request
 ////////////////////////////////////////////////////////////////////////////////
-int PostPuzzleSolution(
-    const char * to,
+void SolutionRequest(
     const char * pkstr,
     const uint8_t * w,
     const uint8_t * nonce,
-    const uint8_t * d
+    const uint8_t * d,
+    char * request
 )
 {
     uint32_t len;
     uint32_t pos = 0;
 
-    char request[JSON_CAPACITY];
-
-    //========================================================================//
-    //  Form message to post
-    //========================================================================//
     strcpy(request + pos, "{\"pk\":\"");
     pos += 7;
 
@@ -345,53 +405,63 @@ int PostPuzzleSolution(
 
     VLOG(1) << "POST request " << request;
 
-    //========================================================================//
-    //  POST request
-    //========================================================================//
-    CURL * curl;
-    curl = curl_easy_init();
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  CURL handle for http POST requests
+////////////////////////////////////////////////////////////////////////////////
+CURL * InitPostHandle(const char * to, curl_slist ** headers)
+{
+    CURL * curl = curl_easy_init();
 
     if (!curl)
     {
-        LOG(ERROR) << "CURL initialization failed in PostPuzzleSolution";
+        LOG(ERROR) << "CURL initialization failed in InitPostHandle";
+
+        return NULL;
     }
 
-    json_t respond(0, REQ_LEN);
-    curl_slist * headers = NULL;
     curl_slist * tmp;
-    CURLcode curlError;
-    tmp = curl_slist_append(headers, "Accept: application/json");
-    headers = curl_slist_append(tmp, "Content-Type: application/json");
+    *headers = NULL;
+    tmp = curl_slist_append(*headers, "Accept: application/json");
+    *headers = curl_slist_append(tmp, "Content-Type: application/json");
 
     CurlLogError(curl_easy_setopt(curl, CURLOPT_URL, to));
-    CurlLogError(curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers));;
-    CurlLogError(curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_HTTPHEADER, *headers));
     
     // set timeout to 30 sec for sending solution
     CurlLogError(curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L));
     CurlLogError(curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L));    
     CurlLogError(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteFunc));
-    CurlLogError(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &respond));
 
-    int retries = 0;
+    return curl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  CURL http POST request with a prepared handle, single attempt
+////////////////////////////////////////////////////////////////////////////////
+int PostSolutionRequest(CURL * curl, const char * request)
+{
+    json_t respond(0, REQ_LEN);
+    CURLcode curlError;
+    long code = 0;
 
-    do
-    {
-        curlError = curl_easy_perform(curl);
-        ++retries;
-    }
-    while (retries < MAX_POST_RETRIES && curlError != CURLE_OK);
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &respond));
+
+    curlError = curl_easy_perform(curl);
 
-    
-    
     CurlLogError(curlError);
 
-    LOG(INFO) << "Node response:" << respond.ptr;
+    if (curlError != CURLE_OK) { return EXIT_FAILURE; }
 
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
 
-    return EXIT_SUCCESS;
+    LOG(INFO) << "Node response:" << respond.ptr;
+
+    // node rejects invalid solutions with 4xx, retry server errors only
+    return (code >= 500)? EXIT_FAILURE: EXIT_SUCCESS;
 }
 
 // request.cc
@@ -0,0 +1,698 @@
+// stratum.cc
+
+/*******************************************************************************
+
+    STRATUM -- Pool protocol client
+
+*******************************************************************************/
+
+#include "../include/stratum.h"
+#include "../include/conversion.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include "../include/jsmn.h"
+#include "../include/request.h"
+#include "../include/uint256.h"
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/select.h>
+#include <sys/socket.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+using namespace std::chrono;
+
+static int64_t NowMs(void)
+{
+    return duration_cast<milliseconds>(
+        steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Bounds of 256 bits little endian
+////////////////////////////////////////////////////////////////////////////////
+// q / difficulty
+static void DifficultyToBound(const uint64_t diff, uint8_t * bound)
+{
+    uint256_t quot(Q0, Q1, Q2, Q3);
+
+    U256DivSmall(&quot, diff);
+    U256ToLittleEndian(quot, bound);
+
+    return;
+}
+
+static int BoundLess(const uint8_t * a, const uint8_t * b)
+{
+    return U256Less(U256FromLittleEndian(a), U256FromLittleEndian(b));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  JSON tokens navigation
+////////////////////////////////////////////////////////////////////////////////
+// position of the token next to the subtree of the given one
+static int Skip(const jsmntok_t * toks, const int numtoks, int pos)
+{
+    for (int left = 1; left > 0 && pos < numtoks; ++pos)
+    {
+        left += toks[pos].size - 1;
+    }
+
+    return pos;
+}
+
+// position of the k-th element of the array, -1 if absent
+static int Element(
+    const jsmntok_t * toks,
+    const int numtoks,
+    const int arr,
+    const int k
+)
+{
+    if (arr < 0 || toks[arr].type != JSMN_ARRAY || k >= toks[arr].size)
+    {
+        return -1;
+    }
+
+    int pos = arr + 1;
+
+    for (int i = 0; i < k; ++i) { pos = Skip(toks, numtoks, pos); }
+
+    return (pos < numtoks)? pos: -1;
+}
+
+static int IsDigits(const char * str, const int len, int (* check)(int))
+{
+    for (int i = 0; i < len; ++i)
+    {
+        if (!check((unsigned char)str[i])) { return 0; }
+    }
+
+    return len > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Pool client setup
+////////////////////////////////////////////////////////////////////////////////
+StratumSource::StratumSource(const pool_t * pool, const char * pkstr):
+    curl(NULL), sock(CURL_SOCKET_BAD), connected(0), retryAt(0),
+    msg(0, STRATUM_TOKS), extraNonce1(0), nonceBits(NONCE_SIZE_8 << 3),
+    hasDifficulty(0), hasJob(0), jobMesId(0), jobNonceBits(0), nextId(0),
+    submitted(0), accepted(0), rejected(0), jobs(0), responses(0),
+    responseTime(0)
+{
+    const char * host = strstr(pool->url, "://");
+
+    host = (host)? host + 3: pool->url;
+
+    // CURL only connects, any scheme it knows will do
+    snprintf(address, MAX_URL_SIZE, "http://%.1000s", host);
+
+    strncpy(user, pool->user, MAX_URL_SIZE);
+    strncpy(pass, pool->pass, MAX_URL_SIZE);
+    strncpy(this->pkstr, pkstr, PK_SIZE_4);
+    this->pkstr[PK_SIZE_4] = '\0';
+}
+
+StratumSource::~StratumSource(void)
+{
+    Disconnect();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Connection
+////////////////////////////////////////////////////////////////////////////////
+int StratumSource::Connect(void)
+{
+    std::lock_guard<std::mutex> lock(sendMutex);
+
+    curl = curl_easy_init();
+
+    if (!curl)
+    {
+        LOG(ERROR) << "CURL initialization failed in StratumSource";
+
+        return EXIT_FAILURE;
+    }
+
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_URL, address));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L));
+    CurlLogError(curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L));
+
+    CURLcode curlError = curl_easy_perform(curl);
+
+    CurlLogError(curlError);
+
+    if (
+        curlError != CURLE_OK
+        || curl_easy_getinfo(curl, CURLINFO_ACTIVESOCKET, &sock) != CURLE_OK
+        || sock == CURL_SOCKET_BAD
+    )
+    {
+        curl_easy_cleanup(curl);
+        curl = NULL;
+
+        return EXIT_FAILURE;
+    }
+
+    connected = 1;
+    stream.clear();
+    nextId = STRATUM_SUBMIT_ID;
+
+    // jobs of the previous session are replaced by the first new one
+    hasJob = 0;
+
+    LOG(INFO) << "Connected to pool " << address;
+
+    //========================================================================//
+    //  Session setup
+    //========================================================================//
+    std::string line
+        = "{\"id\":1,\"method\":\"mining.subscribe\","
+        "\"params\":[\"autolykos-miner\"]}\n"
+        "{\"id\":2,\"method\":\"mining.authorize\",\"params\":[\""
+        + std::string(user) + "\",\"" + std::string(pass) + "\"]}\n";
+
+    if (Send(line) != EXIT_SUCCESS)
+    {
+        connected = 0;
+        curl_easy_cleanup(curl);
+        curl = NULL;
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void StratumSource::Disconnect(void)
+{
+    // shares of the session are not sent anymore
+    jobMutex.lock();
+    jobMesId = 0;
+    jobMutex.unlock();
+
+    std::lock_guard<std::mutex> lock(sendMutex);
+
+    connected = 0;
+    pending.clear();
+
+    if (curl) { curl_easy_cleanup(curl); }
+
+    curl = NULL;
+    sock = CURL_SOCKET_BAD;
+
+    return;
+}
+
+int StratumSource::Send(const std::string & line)
+{
+    size_t sent = 0;
+
+    while (sent < line.size())
+    {
+        int res = send(
+            sock, line.c_str() + sent, (int)(line.size() - sent), MSG_NOSIGNAL
+        );
+
+        if (res <= 0)
+        {
+            LOG(ERROR) << "Failed to send message to pool";
+
+            return EXIT_FAILURE;
+        }
+
+        sent += res;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Pool messages
+////////////////////////////////////////////////////////////////////////////////
+int StratumSource::SetExtranonce(const int en1, const int size)
+{
+    int len = msg.GetTokenLen(en1);
+    uint32_t bytes = strtoul(msg.GetTokenStart(size), NULL, 10);
+
+    if (
+        len > NONCE_SIZE_4 || (len && !IsDigits(
+            msg.GetTokenStart(en1), len, isxdigit
+        ))
+        || bytes > NONCE_SIZE_8 || ((len + 1) >> 1) + bytes > NONCE_SIZE_8
+        || !bytes
+    )
+    {
+        LOG(ERROR) << "Pool sent wrong extranonce";
+
+        return EXIT_FAILURE;
+    }
+
+    char buf[NONCE_SIZE_4 + 1];
+
+    memcpy(buf, msg.GetTokenStart(en1), len);
+    buf[len] = '\0';
+
+    nonceBits = bytes << 3;
+    extraNonce1 = (nonceBits < 64)?
+        (uint64_t)strtoull(buf, NULL, 16) << nonceBits: 0;
+
+    LOG(INFO) << "Pool extranonce1 " << buf << ", nonce range of "
+        << nonceBits << " bits";
+
+    return EXIT_SUCCESS;
+}
+
+void StratumSource::ApplyJob(info_t * info, const int mesChanged)
+{
+    // miners search for the larger bound, either shares or blocks
+    const uint8_t * bound
+        = (hasDifficulty && BoundLess(blockBound, shareBound))?
+        shareBound: blockBound;
+
+    info->info_mutex.lock();
+
+    if (mesChanged)
+    {
+        memcpy(info->mes, mes, NUM_SIZE_8);
+        ++(info->mesId);
+    }
+
+    memcpy(info->bound, bound, NUM_SIZE_8);
+    info->nonceBase = extraNonce1;
+    info->nonceBits = nonceBits;
+
+    info->info_mutex.unlock();
+
+    jobMutex.lock();
+
+    jobId = job;
+    jobMesId = info->mesId.load();
+    jobNonceBits = nonceBits;
+
+    jobMutex.unlock();
+
+    // signaling uint
+    ++(info->blockId);
+
+    return;
+}
+
+void StratumSource::Notify(
+    const int params,
+    const int numtoks,
+    info_t * info
+)
+{
+    const jsmntok_t * toks = msg.toks;
+
+    int jobPos = Element(toks, numtoks, params, 0);
+    int mesPos = Element(toks, numtoks, params, 2);
+    int boundPos = Element(toks, numtoks, params, 3);
+
+    if (
+        jobPos < 0 || mesPos < 0 || boundPos < 0
+        || msg.GetTokenLen(mesPos) != NUM_SIZE_4
+        || !IsDigits(msg.GetTokenStart(mesPos), NUM_SIZE_4, isxdigit)
+        || msg.GetTokenLen(boundPos) > 78
+        || !IsDigits(
+            msg.GetTokenStart(boundPos), msg.GetTokenLen(boundPos), isdigit
+        )
+    )
+    {
+        LOG(ERROR) << "Pool sent wrong job: " << msg.ptr;
+
+        return;
+    }
+
+    uint8_t newMes[NUM_SIZE_8];
+    uint256_t newBound;
+
+    if (
+        DecStrToUint256(
+            msg.GetTokenStart(boundPos), msg.GetTokenLen(boundPos), &newBound
+        ) != EXIT_SUCCESS
+    )
+    {
+        LOG(ERROR) << "Pool sent wrong job bound: " << msg.ptr;
+
+        return;
+    }
+
+    HexStrToBigEndian(
+        msg.GetTokenStart(mesPos), NUM_SIZE_4, newMes, NUM_SIZE_8
+    );
+
+    U256ToLittleEndian(newBound, blockBound);
+
+    int mesChanged = !hasJob || memcmp(mes, newMes, NUM_SIZE_8);
+
+    memcpy(mes, newMes, NUM_SIZE_8);
+    job.assign(msg.GetTokenStart(jobPos), msg.GetTokenLen(jobPos));
+    hasJob = 1;
+    ++jobs;
+
+    LOG(INFO) << "Got new pool job " << job
+        << ((mesChanged)? "": " with the same message");
+
+    ApplyJob(info, mesChanged);
+
+    return;
+}
+
+void StratumSource::Handle(const std::string & line, info_t * info)
+{
+    VLOG(1) << "Pool message " << line;
+
+    jsmn_parser parser;
+    jsmn_init(&parser);
+
+    msg.Reset();
+    WriteFunc((void *)line.c_str(), 1, line.size(), &msg);
+
+    int numtoks = jsmn_parse(
+        &parser, msg.ptr, msg.len, msg.toks, STRATUM_TOKS
+    );
+
+    if (numtoks < 1 || msg.toks[0].type != JSMN_OBJECT)
+    {
+        LOG(ERROR) << "Jsmn failed to parse pool message " << line;
+
+        return;
+    }
+
+    int idPos = -1;
+    int methodPos = -1;
+    int paramsPos = -1;
+    int resultPos = -1;
+    int errorPos = -1;
+
+    for (int t = 1; t + 1 < numtoks; t = Skip(msg.toks, numtoks, t + 1))
+    {
+        if (msg.jsoneq(t, "id")) { idPos = t + 1; }
+        else if (msg.jsoneq(t, "method")) { methodPos = t + 1; }
+        else if (msg.jsoneq(t, "params")) { paramsPos = t + 1; }
+        else if (msg.jsoneq(t, "result")) { resultPos = t + 1; }
+        else if (msg.jsoneq(t, "error")) { errorPos = t + 1; }
+    }
+
+    //========================================================================//
+    //  Notifications
+    //========================================================================//
+    if (methodPos >= 0)
+    {
+        if (msg.jsoneq(methodPos, "mining.notify"))
+        {
+            Notify(paramsPos, numtoks, info);
+        }
+        else if (msg.jsoneq(methodPos, "mining.set_difficulty"))
+        {
+            int pos = Element(msg.toks, numtoks, paramsPos, 0);
+            double diff = (pos < 0)? 0: strtod(msg.GetTokenStart(pos), NULL);
+
+            if (!(diff > 0))
+            {
+                LOG(ERROR) << "Pool sent wrong difficulty " << line;
+
+                return;
+            }
+
+            // difficulties below 1 allow any solution, same as 1
+            DifficultyToBound(
+                (diff < 1)? 1: (diff >= 9.2e18)? (uint64_t)9.2e18:
+                (uint64_t)(diff + 0.5), shareBound
+            );
+
+            hasDifficulty = 1;
+
+            LOG(INFO) << "Pool share difficulty " << diff;
+
+            if (hasJob) { ApplyJob(info, 0); }
+        }
+        else if (msg.jsoneq(methodPos, "mining.set_extranonce"))
+        {
+            int en1 = Element(msg.toks, numtoks, paramsPos, 0);
+            int size = Element(msg.toks, numtoks, paramsPos, 1);
+
+            // nonces of the replaced extranonce are stale
+            if (
+                en1 >= 0 && size >= 0
+                && SetExtranonce(en1, size) == EXIT_SUCCESS && hasJob
+            )
+            {
+                ApplyJob(info, 1);
+            }
+        }
+        else
+        {
+            VLOG(1) << "Unexpected pool method " << line;
+        }
+
+        return;
+    }
+
+    //========================================================================//
+    //  Responses
+    //========================================================================//
+    if (idPos < 0 || !isdigit((unsigned char)*msg.GetTokenStart(idPos)))
+    {
+        VLOG(1) << "Unexpected pool message " << line;
+
+        return;
+    }
+
+    uint32_t id = strtoul(msg.GetTokenStart(idPos), NULL, 10);
+    // result is neither false nor null, error is null or absent
+    int success = resultPos >= 0
+        && *msg.GetTokenStart(resultPos) != 'f'
+        && *msg.GetTokenStart(resultPos) != 'n'
+        && (
+            errorPos < 0 || (
+                msg.toks[errorPos].type == JSMN_PRIMITIVE
+                && *msg.GetTokenStart(errorPos) == 'n'
+            )
+        );
+
+    if (id == 1)
+    {
+        int en1 = Element(msg.toks, numtoks, resultPos, 1);
+        int size = Element(msg.toks, numtoks, resultPos, 2);
+
+        if (
+            !success || en1 < 0 || size < 0
+            || SetExtranonce(en1, size) != EXIT_SUCCESS
+        )
+        {
+            LOG(ERROR) << "Pool subscription failed: " << line;
+        }
+    }
+    else if (id == 2)
+    {
+        if (success) { LOG(INFO) << "Authorized on pool as " << user; }
+        else { LOG(ERROR) << "Pool authorization failed: " << line; }
+    }
+    else if (id >= STRATUM_SUBMIT_ID)
+    {
+        sendMutex.lock();
+
+        std::map<uint32_t, int64_t>::iterator sub = pending.find(id);
+
+        if (sub != pending.end())
+        {
+            responseTime += NowMs() - sub->second;
+            ++responses;
+            pending.erase(sub);
+        }
+
+        sendMutex.unlock();
+
+        if (success)
+        {
+            ++accepted;
+            LOG(INFO) << "Share " << id << " accepted by pool";
+        }
+        else
+        {
+            ++rejected;
+            LOG(ERROR) << "Share " << id << " rejected by pool: " << line;
+        }
+    }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Wait for pool messages
+////////////////////////////////////////////////////////////////////////////////
+int StratumSource::Fetch(info_t * info, const int)
+{
+    if (!connected)
+    {
+        if (NowMs() < retryAt)
+        {
+            std::this_thread::sleep_for(milliseconds(BLOCK_PUSH_WAIT_MS));
+
+            return EXIT_SUCCESS;
+        }
+
+        if (Connect() != EXIT_SUCCESS)
+        {
+            LOG(INFO) << "Pool is unreachable, reconnecting in "
+                << BLOCK_PUSH_RETRY_MS << " ms";
+
+            retryAt = NowMs() + BLOCK_PUSH_RETRY_MS;
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    fd_set readable;
+    timeval timeout;
+
+    FD_ZERO(&readable);
+    FD_SET(sock, &readable);
+    timeout.tv_sec = 0;
+    timeout.tv_usec = BLOCK_PUSH_WAIT_MS * 1000;
+
+    int ready = select((int)sock + 1, &readable, NULL, NULL, &timeout);
+
+    if (!ready) { return EXIT_SUCCESS; }
+
+    char buf[0x1000];
+    int len = (ready > 0)? recv(sock, buf, sizeof(buf), 0): -1;
+
+    if (len <= 0)
+    {
+        LOG(INFO) << "Pool connection closed, reconnecting in "
+            << BLOCK_PUSH_RETRY_MS << " ms";
+
+        Disconnect();
+        retryAt = NowMs() + BLOCK_PUSH_RETRY_MS;
+
+        return EXIT_FAILURE;
+    }
+
+    stream.append(buf, len);
+
+    size_t pos;
+
+    while ((pos = stream.find('\n')) != std::string::npos)
+    {
+        std::string line = stream.substr(0, pos);
+
+        stream.erase(0, pos + 1);
+
+        if (!line.empty() && line[line.size() - 1] == '\r')
+        {
+            line.erase(line.size() - 1);
+        }
+
+        if (!line.empty()) { Handle(line, info); }
+    }
+
+    if (stream.size() > STRATUM_LINE_LEN)
+    {
+        LOG(ERROR) << "Pool message exceeds " << STRATUM_LINE_LEN << " bytes";
+
+        Disconnect();
+        retryAt = NowMs() + BLOCK_PUSH_RETRY_MS;
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void StratumSource::Stats(source_stats_t * stats)
+{
+    stats->requests = submitted.exchange(0);
+    stats->unchanged = 0;
+    stats->pushed = jobs;
+    stats->accepted = accepted.exchange(0);
+    stats->rejected = rejected.exchange(0);
+
+    sendMutex.lock();
+
+    stats->requestTime = (responses)? responseTime / responses: 0;
+    responses = 0;
+    responseTime = 0;
+
+    sendMutex.unlock();
+
+    jobs = 0;
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Share submission
+////////////////////////////////////////////////////////////////////////////////
+int StratumSource::Submit(const solution_t * sol)
+{
+    std::string id;
+    uint32_t bits;
+
+    jobMutex.lock();
+
+    int current = sol->mesId == jobMesId;
+
+    id = jobId;
+    bits = jobNonceBits;
+
+    jobMutex.unlock();
+
+    if (!current) { return SUBMIT_STALE; }
+
+    //========================================================================//
+    //  Form share
+    //========================================================================//
+    uint64_t nonce = *((uint64_t *)sol->nonce);
+    char en2[NONCE_SIZE_4 + 1];
+    char w[PK_SIZE_4 + 1];
+    char d[NUM_SIZE_4 << 1];
+    uint32_t len;
+
+    if (bits < 64) { nonce &= ((uint64_t)1 << bits) - 1; }
+
+    snprintf(en2, sizeof(en2), "%0*" PRIx64, (int)(bits >> 2), nonce);
+    BigEndianToHexStr(sol->w, PK_SIZE_8, w);
+    LittleEndianOf256ToDecStr(sol->d, d, &len);
+
+    std::lock_guard<std::mutex> lock(sendMutex);
+
+    if (!connected) { return EXIT_FAILURE; }
+
+    char head[64];
+
+    snprintf(
+        head, sizeof(head), "{\"id\":%u,\"method\":\"mining.submit\",", nextId
+    );
+
+    std::string line = std::string(head) + "\"params\":[\"" + user + "\",\""
+        + id + "\",\"" + en2 + "\",\"" + pkstr + "\",\"" + w + "\",\"" + d
+        + "\"]}\n";
+
+    if (Send(line) != EXIT_SUCCESS) { return EXIT_FAILURE; }
+
+    pending[nextId++] = NowMs();
+    ++submitted;
+
+    return EXIT_SUCCESS;
+}
+
+// stratum.cc
@@ -0,0 +1,263 @@
+// submitter.cc
+
+/*******************************************************************************
+
+    SUBMITTER -- Asynchronous puzzle solution submission
+
+*******************************************************************************/
+
+#include "../include/submitter.h"
+#include "../include/blocksource.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include "../include/processing.h"
+#include "../include/request.h"
+#include <curl/curl.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+using namespace std::chrono;
+
+static int64_t NowMs(void)
+{
+    return duration_cast<milliseconds>(
+        system_clock::now().time_since_epoch()
+    ).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Submitter setup
+////////////////////////////////////////////////////////////////////////////////
+Submitter::Submitter(
+    const char * to,
+    const char * pkstr,
+    info_t * info,
+    BlockSource * pool
+):
+    info(info), pool(pool), metrics(NULL), head(0), tail(0), running(0),
+    posted(0), failed(0), stale(0), dropped(0), lastLatency(0), maxLatency(0)
+{
+    strncpy(this->to, to, MAX_URL_SIZE - 1);
+    this->to[MAX_URL_SIZE - 1] = '\0';
+
+    strncpy(this->pkstr, pkstr, PK_SIZE_4);
+    this->pkstr[PK_SIZE_4] = '\0';
+
+    for (uint32_t i = 0; i < SUBMIT_QUEUE_LEN; ++i) { slots[i].seq = i; }
+}
+
+Submitter::~Submitter(void)
+{
+    Stop();
+}
+
+int Submitter::Start(void)
+{
+    if (running.exchange(1)) { return EXIT_FAILURE; }
+
+    thread = std::thread(&Submitter::Run, this);
+
+    return EXIT_SUCCESS;
+}
+
+void Submitter::Stop(void)
+{
+    running = 0;
+    ++queued;
+
+    if (thread.joinable()) { thread.join(); }
+
+    return;
+}
+
+void Submitter::Stats(submit_stats_t * stats) const
+{
+    stats->posted = posted.load();
+    stats->failed = failed.load();
+    stats->stale = stale.load();
+    stats->dropped = dropped.load();
+    stats->lastLatency = lastLatency.load();
+    stats->maxLatency = maxLatency.load();
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Bounded lock-free queue
+////////////////////////////////////////////////////////////////////////////////
+// slot i is free for the writer at position p if seq == p,
+// holds a solution for the reader at position p if seq == p + 1
+int Submitter::Enqueue(const solution_t * sol)
+{
+    uint32_t pos = head.load(std::memory_order_relaxed);
+
+    do
+    {
+        slot_t * slot = slots + (pos & (SUBMIT_QUEUE_LEN - 1));
+        uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (!diff)
+        {
+            if (head.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed
+            ))
+            {
+                slot->sol = *sol;
+                slot->seq.store(pos + 1, std::memory_order_release);
+                ++queued;
+
+                return EXIT_SUCCESS;
+            }
+        }
+        // queue is full
+        else if (diff < 0)
+        {
+            ++dropped;
+
+            LOG(ERROR) << "Solution queue is full, solution dropped";
+
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+    while (1);
+}
+
+// single reader
+int Submitter::Dequeue(solution_t * sol)
+{
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    slot_t * slot = slots + (pos & (SUBMIT_QUEUE_LEN - 1));
+
+    if (slot->seq.load(std::memory_order_acquire) != pos + 1)
+    {
+        return EXIT_FAILURE;
+    }
+
+    *sol = slot->sol;
+    tail.store(pos + 1, std::memory_order_relaxed);
+    slot->seq.store(pos + SUBMIT_QUEUE_LEN, std::memory_order_release);
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Submitter thread
+////////////////////////////////////////////////////////////////////////////////
+void Submitter::Submit(void * curl, const solution_t * sol)
+{
+    char request[JSON_CAPACITY];
+    char logstr[1000];
+
+    SolutionRequest(pkstr, sol->w, sol->nonce, sol->d, request);
+
+    PrintPuzzleSolution(sol->nonce, sol->d, logstr);
+
+    for (int retries = 0; ; ++retries)
+    {
+        // stale: node has a new message already
+        if (sol->mesId != info->mesId.load())
+        {
+            ++stale;
+
+            LOG(INFO) << "Dropping stale solution:\n" << logstr;
+
+            return;
+        }
+
+        int status = (pool)? pool->Submit(sol):
+            PostSolutionRequest((CURL *)curl, request);
+
+        // stale: pool has a new job already
+        if (status == SUBMIT_STALE)
+        {
+            ++stale;
+
+            LOG(INFO) << "Dropping share of a replaced job:\n" << logstr;
+
+            return;
+        }
+
+        if (status == EXIT_SUCCESS)
+        {
+            uint32_t latency = NowMs() - sol->found;
+            uint32_t max = maxLatency.load();
+
+            ++posted;
+            lastLatency = latency;
+
+            if (metrics) { metrics->post.Observe((uint64_t)latency * 1000); }
+
+            while (latency > max && !maxLatency.compare_exchange_weak(
+                max, latency
+            ));
+
+            LOG(INFO) << "Posted solution in " << latency << " ms:\n"
+                << logstr;
+
+            return;
+        }
+
+        if (retries + 1 >= MAX_POST_RETRIES) { break; }
+
+        // exponential backoff, Stop advances the epoch and wakes it,
+        // enqueues wake it too and the wait goes on till the deadline
+        int64_t until = NowMs() + ((int64_t)SUBMIT_BACKOFF_MS << retries);
+        uint_t seen = queued.load();
+        int64_t now;
+
+        while (running.load() && (now = NowMs()) < until)
+        {
+            seen = queued.Wait(seen, (uint32_t)(until - now));
+        }
+
+        // no retry after stop
+        if (!running.load()) { break; }
+    }
+
+    ++failed;
+
+    if (metrics) { metrics->postFailures.Add(); }
+
+    LOG(ERROR) << "Failed to post solution:\n" << logstr;
+
+    return;
+}
+
+void Submitter::Run(void)
+{
+    el::Helpers::setThreadName("submitter");
+
+    curl_slist * headers = NULL;
+    CURL * curl = (pool)? NULL: InitPostHandle(to, &headers);
+    solution_t sol;
+
+    while (running.load())
+    {
+        uint_t seen = queued.load();
+
+        if (Dequeue(&sol) != EXIT_SUCCESS)
+        {
+            queued.Wait(seen, 1000);
+
+            continue;
+        }
+
+        if (curl || pool) { Submit(curl, &sol); }
+        else { ++failed; }
+    }
+
+    while (Dequeue(&sol) == EXIT_SUCCESS) { ++dropped; }
+
+    if (curl) { curl_easy_cleanup(curl); }
+    curl_slist_free_all(headers);
+
+    return;
+}
+
+// submitter.cc
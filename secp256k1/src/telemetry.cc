@@ -0,0 +1,208 @@
+// telemetry.cc
+
+/*******************************************************************************
+
+    TELEMETRY -- Background sampling of GPU telemetry
+
+*******************************************************************************/
+
+#include "../include/telemetry.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#ifndef CPU_ONLY
+#include <nvml.h>
+#endif
+
+using namespace std::chrono;
+
+#ifndef CPU_ONLY
+////////////////////////////////////////////////////////////////////////////////
+//  NVML provider
+////////////////////////////////////////////////////////////////////////////////
+int NvmlProvider::Open(void)
+{
+    nvmlReturn_t result = nvmlInit();
+
+    if (result != NVML_SUCCESS)
+    {
+        LOG(ERROR) << "NVML initialization failed: "
+            << nvmlErrorString(result);
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int NvmlProvider::Sample(std::vector<gpu_sample_t> * gpus)
+{
+    unsigned int devcount;
+
+    gpus->clear();
+
+    if (nvmlDeviceGetCount(&devcount) != NVML_SUCCESS) { return EXIT_FAILURE; }
+
+    for (unsigned int i = 0; i < devcount; ++i)
+    {
+        nvmlDevice_t device;
+        nvmlPciInfo_t pciInfo;
+        gpu_sample_t gpu;
+
+        if (
+            nvmlDeviceGetHandleByIndex(i, &device) != NVML_SUCCESS
+            || nvmlDeviceGetPciInfo(device, &pciInfo) != NVML_SUCCESS
+        )
+        {
+            continue;
+        }
+
+        memset(&gpu, 0, sizeof(gpu));
+
+        // failed readings are left zero
+        nvmlDeviceGetName(device, gpu.name, TELEMETRY_STR_LEN);
+        nvmlDeviceGetUUID(device, gpu.uuid, TELEMETRY_STR_LEN);
+        strncpy(gpu.busId, pciInfo.busId, TELEMETRY_STR_LEN - 1);
+        gpu.pciBus = pciInfo.bus;
+        gpu.pciDevice = pciInfo.device;
+
+        nvmlDeviceGetFanSpeed(device, &gpu.fan);
+        nvmlDeviceGetPowerUsage(device, &gpu.power);
+        nvmlDeviceGetTemperature(
+            device, NVML_TEMPERATURE_GPU, &gpu.temperature
+        );
+
+        // mW
+        gpu.power /= 1000;
+
+        gpus->push_back(gpu);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void NvmlProvider::Close(void)
+{
+    nvmlShutdown();
+
+    return;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//  Sampler
+////////////////////////////////////////////////////////////////////////////////
+TelemetrySampler::TelemetrySampler(
+    TelemetryProvider * provider,
+    const uint32_t interval
+):
+    provider(provider), interval(interval), ring(TELEMETRY_HISTORY), head(0),
+    size(0), running(0)
+{}
+
+TelemetrySampler::~TelemetrySampler(void)
+{
+    Stop();
+}
+
+int TelemetrySampler::Start(void)
+{
+    if (running.exchange(1)) { return EXIT_FAILURE; }
+
+    thread = std::thread(&TelemetrySampler::Run, this);
+
+    return EXIT_SUCCESS;
+}
+
+void TelemetrySampler::Stop(void)
+{
+    running = 0;
+    ++wake;
+
+    if (thread.joinable()) { thread.join(); }
+
+    return;
+}
+
+int TelemetrySampler::Latest(telemetry_t * snap)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!size) { return EXIT_FAILURE; }
+
+    *snap = ring[(head + TELEMETRY_HISTORY - 1) % TELEMETRY_HISTORY];
+
+    return EXIT_SUCCESS;
+}
+
+void TelemetrySampler::Window(
+    const uint32_t ms,
+    std::vector<telemetry_t> * snaps
+)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    snaps->clear();
+
+    if (!size) { return; }
+
+    int64_t from
+        = ring[(head + TELEMETRY_HISTORY - 1) % TELEMETRY_HISTORY].time - ms;
+
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        const telemetry_t & snap
+            = ring[(head + TELEMETRY_HISTORY - size + i) % TELEMETRY_HISTORY];
+
+        if (snap.time >= from) { snaps->push_back(snap); }
+    }
+
+    return;
+}
+
+void TelemetrySampler::Run(void)
+{
+    el::Helpers::setThreadName("telemetry");
+
+    int opened = 0;
+    telemetry_t snap;
+
+    while (running.load())
+    {
+        uint_t seen = wake.load();
+
+        // transient failure at start is retried every interval
+        if (!opened) { opened = provider->Open() == EXIT_SUCCESS; }
+
+        snap.time = duration_cast<milliseconds>(
+            system_clock::now().time_since_epoch()
+        ).count();
+
+        // provider is read outside of the lock
+        snap.error = !opened || provider->Sample(&snap.gpus) != EXIT_SUCCESS;
+
+        if (snap.error) { snap.gpus.clear(); }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            ring[head].time = snap.time;
+            ring[head].error = snap.error;
+            ring[head].gpus.swap(snap.gpus);
+            head = (head + 1) % TELEMETRY_HISTORY;
+            if (size < TELEMETRY_HISTORY) { ++size; }
+        }
+
+        wake.Wait(seen, interval);
+    }
+
+    if (opened) { provider->Close(); }
+
+    return;
+}
+
+// telemetry.cc
@@ -6,17 +6,38 @@
 
 *******************************************************************************/
 
+#include "../include/autotune.h"
+#include "../include/backend.h"
+#include "../include/batchverify.h"
+#include "../include/blocksource.h"
+#include "../include/cpumining.h"
+#include "../include/cpuprimitives.h"
+#include "../include/multiblake.h"
 #include "../include/cryptography.h"
 #include "../include/definitions.h"
 #include "../include/easylogging++.h"
+#include "../include/hostarena.h"
+#include "../include/miner.h"
+#include "../include/httplib.h"
+#include "../include/metrics.h"
+#include "../include/request.h"
+#include "../include/stratum.h"
+#include "../include/submitter.h"
+#include "../include/telemetry.h"
+#include "../include/topology.h"
+#include "../include/uint256.h"
+#include "../include/uctxcache.h"
+#include "../include/verifier.h"
+#ifndef CPU_ONLY
+#include "../include/compaction.h"
 #include "../include/mining.h"
 #include "../include/prehash.h"
 #include "../include/reduction.h"
-#include "../include/request.h"
-#include <ctype.h>
 #include <cuda.h>
 #include <cuda_runtime.h>
 #include <cooperative_groups.h>
+#endif
+#include <ctype.h>
 #include <curl/curl.h>
 #include <inttypes.h>
 #include <iostream>
@@ -26,15 +47,31 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifdef _WIN32
+#include <direct.h>
+#define close closesocket
+#define rmdir _rmdir
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 INITIALIZE_EASYLOGGINGPP
 
 namespace ch = std::chrono;
 
+#ifndef CPU_ONLY
 ////////////////////////////////////////////////////////////////////////////////
 //  Test solutions correctness
 ////////////////////////////////////////////////////////////////////////////////
@@ -70,12 +107,24 @@ int TestSolutions(
     uint32_t * hashes_d;
     CUDA_CALL(cudaMalloc(&hashes_d, (uint32_t)N_LEN * NUM_SIZE_8));
 
-    // WORKSPACE_SIZE_8 bytes
-    // potential solutions of puzzle
-    uint32_t * res_d;
-    CUDA_CALL(cudaMalloc(&res_d, WORKSPACE_SIZE_8));
-    // indices of unfinalized hashes
-    uint32_t * indices_d = res_d + NONCES_PER_ITER * NUM_SIZE_32;
+    // hashes of the message with nonces
+    uint32_t * bhashes_d;
+    CUDA_CALL(cudaMalloc(&bhashes_d, NUM_SIZE_8 * THREADS_PER_ITER));
+
+    // solution candidates and their number
+    uint32_t * cands_d;
+    CUDA_CALL(cudaMalloc(&cands_d, (THREADS_PER_ITER + 1) * sizeof(uint32_t)));
+
+    // out of range hashes of a prehash and their number
+    uint32_t * invalid_d;
+    CUDA_CALL(cudaMalloc(&invalid_d, (MAX_INVALID + 1) * sizeof(uint32_t)));
+
+    // solutions of the puzzle and their number
+    result_t * results_d;
+    CUDA_CALL(cudaMalloc(
+        &results_d, MAX_RESULTS * sizeof(result_t) + sizeof(uint32_t)
+    ));
+    uint32_t * count_d = (uint32_t *)(results_d + MAX_RESULTS);
 
     uctx_t * uctxs_d = NULL;
 
@@ -131,7 +180,7 @@ int TestSolutions(
         );
     }
 
-    Prehash(info->keepPrehash, data_d, uctxs_d, hashes_d, res_d);
+    Prehash(info->keepPrehash, data_d, uctxs_d, hashes_d, invalid_d, 0);
     CUDA_CALL(cudaDeviceSynchronize());
 
     // calculate unfinalized hash of message
@@ -143,25 +192,46 @@ int TestSolutions(
         cudaMemcpyHostToDevice
     ));
 
-    // calculate solution candidates
-    BlockMining<<<1 + (THREADS_PER_ITER - 1) / BLOCK_DIM, BLOCK_DIM>>>(
-        bound_d, data_d, base, hashes_d, res_d, indices_d
+    cpySkSymbol((uint8_t *)info->sk);
+    cpyCtxSymbol(&ctx_h);
+
+    CUDA_CALL(cudaMemset(count_d, 0, sizeof(uint32_t)));
+
+    const geometry_t geometry = { BLOCK_DIM, NONCES_PER_ITER };
+    prefilter_t filter;
+
+    MiningPrefilter(
+        (const uint32_t *)info->bound, (const uint32_t *)info->sk, &filter
+    );
+
+    LaunchMining(
+        geometry, filter, bound_d, hashes_d, data_d, base, results_d, count_d,
+        bhashes_d, cands_d
     );
 
-    uint64_t res_h[NUM_SIZE_64];
-    uint32_t solFound = 0;
-    uint32_t nonce;
+    result_t results_h[MAX_RESULTS];
+    uint32_t count;
+    int found = 0;
+
     // copy results to host
     CUDA_CALL(cudaMemcpy(
-        res_h, res_d, NUM_SIZE_8,
-        cudaMemcpyDeviceToHost
+        &count, count_d, sizeof(uint32_t), cudaMemcpyDeviceToHost
     ));
+
+    if (count > MAX_RESULTS) { count = MAX_RESULTS; }
+
     CUDA_CALL(cudaMemcpy(
-        &nonce, indices_d, sizeof(uint32_t),
+        results_h, results_d, count * sizeof(result_t),
         cudaMemcpyDeviceToHost
     ));
-    LOG(INFO) << "Found nonce: " << nonce-1;
-    if(nonce != 0x3381BF)
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        LOG(INFO) << "Found nonce: " << results_h[i].nonce;
+        found = found || results_h[i].nonce == 0x3381BE;
+    }
+
+    if (!found)
     {
         LOG(ERROR) << "Solutions test failed: wrong nonce";
         exit(EXIT_FAILURE);
@@ -172,7 +242,10 @@ int TestSolutions(
     //========================================================================//
     CUDA_CALL(cudaFree(bound_d));
     CUDA_CALL(cudaFree(hashes_d));
-    CUDA_CALL(cudaFree(res_d));
+    CUDA_CALL(cudaFree(bhashes_d));
+    CUDA_CALL(cudaFree(cands_d));
+    CUDA_CALL(cudaFree(invalid_d));
+    CUDA_CALL(cudaFree(results_d));
 
     if (info->keepPrehash) { CUDA_CALL(cudaFree(uctxs_d)); }
 
@@ -215,12 +288,24 @@ int TestPerformance(
     uint32_t * hashes_d;
     CUDA_CALL(cudaMalloc(&hashes_d, (uint32_t)N_LEN * NUM_SIZE_8));
 
-    // WORKSPACE_SIZE_8 bytes
-    // potential solutions of puzzle
-    uint32_t * res_d;
-    CUDA_CALL(cudaMalloc(&res_d, WORKSPACE_SIZE_8));
-    // indices of unfinalized hashes
-    uint32_t * indices_d = res_d + NONCES_PER_ITER * NUM_SIZE_32;
+    // hashes of the message with nonces
+    uint32_t * bhashes_d;
+    CUDA_CALL(cudaMalloc(&bhashes_d, NUM_SIZE_8 * THREADS_PER_ITER));
+
+    // solution candidates and their number
+    uint32_t * cands_d;
+    CUDA_CALL(cudaMalloc(&cands_d, (THREADS_PER_ITER + 1) * sizeof(uint32_t)));
+
+    // out of range hashes of a prehash and their number
+    uint32_t * invalid_d;
+    CUDA_CALL(cudaMalloc(&invalid_d, (MAX_INVALID + 1) * sizeof(uint32_t)));
+
+    // solutions of the puzzle and their number
+    result_t * results_d;
+    CUDA_CALL(cudaMalloc(
+        &results_d, MAX_RESULTS * sizeof(result_t) + sizeof(uint32_t)
+    ));
+    uint32_t * count_d = (uint32_t *)(results_d + MAX_RESULTS);
 
     uctx_t * uctxs_d = NULL;
 
@@ -277,7 +362,7 @@ int TestPerformance(
         ch::system_clock::now().time_since_epoch()
     );
 
-    Prehash(0, data_d, NULL, hashes_d, res_d);
+    Prehash(0, data_d, NULL, hashes_d, invalid_d, 0);
 
     CUDA_CALL(cudaDeviceSynchronize());
     
@@ -301,7 +386,7 @@ int TestPerformance(
             ch::system_clock::now().time_since_epoch()
         );
 
-        Prehash(1, data_d, uctxs_d, hashes_d, res_d);
+        Prehash(1, data_d, uctxs_d, hashes_d, invalid_d, 0);
 
         CUDA_CALL(cudaDeviceSynchronize());
 
@@ -323,34 +408,41 @@ int TestPerformance(
         cudaMemcpyHostToDevice
     ));
 
+    cpySkSymbol((uint8_t *)info->sk);
+    cpyCtxSymbol(&ctx_h);
+
     LOG(INFO) << "BlockMining now for 1 minute";
     ms = ch::milliseconds::zero();
 
+    const geometry_t geometry = { BLOCK_DIM, NONCES_PER_ITER };
+    prefilter_t filter;
+
+    MiningPrefilter(
+        (const uint32_t *)info->bound, (const uint32_t *)info->sk, &filter
+    );
     uint32_t sum = 0;
     int iter = 0;
-    uint32_t nonce = 0;
+    uint32_t count = 0;
     start = ch::duration_cast<ch::milliseconds>(
         ch::system_clock::now().time_since_epoch()
     );
 
     for ( ; ms.count() < 60000; ++iter)
     {
-        // calculate solution candidates
-        BlockMining<<<1 + (THREADS_PER_ITER - 1) / BLOCK_DIM, BLOCK_DIM>>>(
-            bound_d, data_d, base, hashes_d, res_d, indices_d
+        CUDA_CALL(cudaMemset(count_d, 0, sizeof(uint32_t)));
+
+        LaunchMining(
+            geometry, filter, bound_d, hashes_d, data_d, base, results_d,
+            count_d, bhashes_d, cands_d
         );
 
         CUDA_CALL(cudaMemcpy(
-            &nonce, indices_d, sizeof(uint32_t),
+            &count, count_d, sizeof(uint32_t),
             cudaMemcpyDeviceToHost
         ));
 
-        if(nonce != 0) ++sum;
+        sum += count;
 
-        CUDA_CALL(cudaMemset(indices_d, 0 ,sizeof(uint32_t)));
-        // reduction now removed so no findsum
-        //sum += FindSum(indices_d, indices_d + NONCES_PER_ITER, NONCES_PER_ITER);
-        cudaDeviceSynchronize();
         base += NONCES_PER_ITER;
 
         ms = ch::duration_cast<ch::milliseconds>(
@@ -363,7 +455,10 @@ int TestPerformance(
     //========================================================================//
     CUDA_CALL(cudaFree(bound_d));
     CUDA_CALL(cudaFree(hashes_d));
-    CUDA_CALL(cudaFree(res_d));
+    CUDA_CALL(cudaFree(bhashes_d));
+    CUDA_CALL(cudaFree(cands_d));
+    CUDA_CALL(cudaFree(invalid_d));
+    CUDA_CALL(cudaFree(results_d));
 
     if (info->keepPrehash) { CUDA_CALL(cudaFree(uctxs_d)); }
 
@@ -375,6 +470,74 @@ int TestPerformance(
     return EXIT_SUCCESS;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//  Test device reduction and compaction against host primitives
+////////////////////////////////////////////////////////////////////////////////
+int TestPrimitives(void)
+{
+    const uint32_t len = CPU_PRIMITIVES_GRAIN * 3 + 7;
+    std::vector<uint32_t> in(len);
+    std::vector<uint32_t> out(len);
+
+    uint64_t state = 0x9E3779B97F4A7C15;
+
+    // sparse nonzero items
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        in[i] = (!(state >> 59))? (uint32_t)(state >> 16): 0;
+    }
+
+    uint32_t * data_d;
+    uint32_t * out_d;
+
+    CUDA_CALL(cudaMalloc(&data_d, (len + REDUCTION_BLOCK_DIM) << 2));
+    CUDA_CALL(cudaMalloc(&out_d, (len + 1) << 2));
+    CUDA_CALL(cudaMemcpy(data_d, in.data(), len << 2, cudaMemcpyHostToDevice));
+    CUDA_CALL(cudaMemset(out_d, 0, 4));
+
+    uint32_t * aux_d = data_d + len;
+
+    uint32_t sum = FindSum(data_d, aux_d, len);
+    uint32_t item = FindNonZero(data_d, aux_d, len);
+
+    Compactify<<<1 + (len - 1) / BLOCK_DIM, BLOCK_DIM>>>(
+        data_d, len, out_d + 1, out_d
+    );
+    CUDA_CALL(cudaMemcpy(
+        out.data(), out_d, (len + 1) << 2, cudaMemcpyDeviceToHost
+    ));
+
+    CUDA_CALL(cudaFree(data_d));
+    CUDA_CALL(cudaFree(out_d));
+
+    // device compaction keeps no order
+    uint32_t count = out[0];
+
+    std::sort(out.begin() + 1, out.begin() + 1 + count);
+
+    std::vector<uint32_t> ref(len);
+    uint32_t refCount = CpuCompactify(in.data(), len, ref.data(), 0);
+
+    std::sort(ref.begin(), ref.begin() + refCount);
+
+    int test = sum == CpuFindSum(in.data(), len, 0)
+        && item && std::find(in.begin(), in.end(), item) != in.end()
+        && count == refCount
+        && std::equal(ref.begin(), ref.begin() + count, out.begin() + 1);
+
+    if (!test)
+    {
+        LOG(ERROR) << "Device primitives test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Device primitives test passed\n";
+
+    return EXIT_SUCCESS;
+}
+#endif // CPU_ONLY
+
 
 // ugly stuff, will rewrite later
 void TestRequests()
@@ -385,6 +548,9 @@ void TestRequests()
     json_t oldreqbig(0, REQ_LEN);
     info_t testinfo;
 
+    testinfo.blockId = 0;
+    testinfo.mesId = 0;
+
     char bigrequest[] = "{ \"msg\" : \"46b7e94915275125129581725817295812759128"
                         "571925871285728572857285725285728571928517287519285718"
                         "275192857192857192857192587129581729587129581728571295"
@@ -494,89 +660,2353 @@ void TestNewCrypto()
 
 
 ////////////////////////////////////////////////////////////////////////////////
-//  Main
+//  Test 256-bit arithmetic and conversions
 ////////////////////////////////////////////////////////////////////////////////
-int main(int argc, char ** argv)
+static_assert(
+    U256Less(uint256_t(0, 0, 0, Q3), uint256_t(Q0, Q1, Q2, Q3))
+    && U256Compare(uint256_t(1), uint256_t(1)) == 0
+    && U256IsZero(uint256_t()),
+    "constexpr comparison of 256-bit numbers"
+);
+
+int TestUint256(void)
 {
-    START_EASYLOGGINGPP(argc, argv);
+    LOG(INFO) << "256-bit arithmetic test started";
 
-    el::Loggers::reconfigureAllLoggers(
-        el::ConfigurationType::Format, "%datetime %level [%thread] %msg"
-    );
+    const char * qdec = "115792089237316195423570985008687907852837564279074"
+        "904382605163141518161494337";
+    const char * maxdec = "11579208923731619542357098500868790785326998466564"
+        "0564039457584007913129639935";
+    const uint256_t q(Q0, Q1, Q2, Q3);
+    const uint256_t max(~0ull, ~0ull, ~0ull, ~0ull);
+    uint256_t num;
+    char str[NUM_SIZE_4 * 2];
 
-    el::Helpers::setThreadName("test thread");
+    //========================================================================//
+    //  Conversions
+    //========================================================================//
+    int test = DecStrToUint256(qdec, strlen(qdec), &num) == EXIT_SUCCESS
+        && !U256Compare(num, q)
+        && Uint256ToDecStr(num, str) == strlen(qdec) && !strcmp(str, qdec);
 
-    LOG(INFO) << "Checking crypto: ";
+    test = test && DecStrToUint256(maxdec, strlen(maxdec), &num) == EXIT_SUCCESS
+        && !U256Compare(num, max);
 
-    TestNewCrypto();
+    // 2^256, non-digit, empty string
+    strcpy(str, maxdec);
+    str[strlen(str) - 1] = '6';
 
-    LOG(INFO) << "Testing requests:";
+    test = test && DecStrToUint256(str, strlen(str), &num) == EXIT_FAILURE
+        && DecStrToUint256("12a", 3, &num) == EXIT_FAILURE
+        && DecStrToUint256("", 0, &num) == EXIT_FAILURE;
+
+    test = test && Uint256ToDecStr(uint256_t(), str) == 1 && !strcmp(str, "0")
+        && Uint256ToDecStr(uint256_t(10000000000000000000ull), str) == 20
+        && !strcmp(str, "10000000000000000000");
+
+    DecStrToHexStrOf64(qdec, strlen(qdec), str);
+
+    test = test && !strcmp(
+        str, "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141"
+    ) && HexStrToUint256(str, NUM_SIZE_4, &num) == EXIT_SUCCESS
+        && !U256Compare(num, q)
+        && HexStrToUint256("fe", 2, &num) == EXIT_SUCCESS
+        && !U256Compare(num, uint256_t(0xFE))
+        && HexStrToUint256("0x", 2, &num) == EXIT_FAILURE;
 
-    TestRequests();
     //========================================================================//
-    //  Check requirements
+    //  Arithmetic
     //========================================================================//
-    int deviceCount;
+    test = test && U256Add(max, uint256_t(1), &num) == 1 && U256IsZero(num)
+        && U256Sub(uint256_t(), uint256_t(1), &num) == 1
+        && !U256Compare(num, max)
+        && U256Sub(q, uint256_t(0, 1), &num) == 0
+        && !U256Compare(num, uint256_t(Q0, Q1 - 1, Q2, Q3));
 
-    if (cudaGetDeviceCount(&deviceCount) != cudaSuccess)
+    // (2^256 - 1)^2 = 2^512 - 2^257 + 1
+    uint64_t wide[NUM_SIZE_64 << 1];
+
+    U256MulWide(max, max, wide);
+
+    test = test && wide[0] == 1 && !wide[1] && !wide[2] && !wide[3]
+        && wide[4] == ~1ull && wide[5] == ~0ull && wide[6] == ~0ull
+        && wide[7] == ~0ull;
+
+    num = q;
+
+    test = test && U256DivSmall(&num, 10) == 7
+        && !U256MulAddSmall(&num, 10, 7) && !U256Compare(num, q)
+        && U256MulAddSmall(&num, 2, 0) == 1;
+
+    uint8_t bytes[NUM_SIZE_8];
+
+    U256ToBigEndian(q, bytes);
+
+    test = test && bytes[0] == 0xFF && bytes[NUM_SIZE_8 - 1] == 0x41
+        && !U256Compare(U256FromBigEndian(bytes), q);
+
+    if (!test)
     {
-        LOG(ERROR) << "Error checking GPU";
+        LOG(ERROR) << "256-bit arithmetic test failed";
         exit(EXIT_FAILURE);
     }
 
-    size_t freeMem;
-    size_t totalMem;
+    LOG(INFO) << "256-bit arithmetic test passed\n";
 
-    CUDA_CALL(cudaMemGetInfo(&freeMem, &totalMem));
-    
-    if (freeMem < MIN_FREE_MEMORY)
+    return EXIT_SUCCESS;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test host reduction, scan and compaction against serial loops
+////////////////////////////////////////////////////////////////////////////////
+int TestCpuPrimitives(void)
+{
+    // lengths about worker chunk boundaries
+    const uint32_t lens[] = {
+        0, 1, 1000, CPU_PRIMITIVES_GRAIN * 3 - 1, CPU_PRIMITIVES_GRAIN * 3 + 7
+    };
+    const uint32_t threads[] = { 1, 3, 0 };
+    const uint32_t counts = sizeof(threads) / sizeof(threads[0]);
+    // threads started per call, and fewer persistent ones than requested
+    CpuPool pool(2);
+    CpuPool * pools[] = { NULL, &pool };
+
+    uint64_t state = 0x9E3779B97F4A7C15;
+    int test = 1;
+
+    for (uint32_t l = 0; l < sizeof(lens) / sizeof(lens[0]); ++l)
     {
-        LOG(ERROR) << "Not enough GPU memory for mining,"
-            << " minimum 2.8 GiB needed";
+        const uint32_t len = lens[l];
+        std::vector<uint32_t> in(len + 1);
+        std::vector<uint32_t> out(len + 1);
+
+        // sparse nonzero items, none of the first ones
+        for (uint32_t i = 0; i < len; ++i)
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            in[i] = (i > len / 2 && !(state >> 59))? (uint32_t)(state >> 16): 0;
+        }
+
+        // serial reference
+        uint32_t sum = 0;
+        uint32_t item = 0;
+        std::vector<uint32_t> scan(len + 1);
+        std::vector<uint32_t> comp;
+
+        for (uint32_t i = 0; i < len; ++i)
+        {
+            scan[i] = sum;
+            sum += in[i];
+
+            if (in[i] && !item) { item = in[i]; }
+            if (in[i]) { comp.push_back(in[i]); }
+        }
 
+        for (uint32_t r = 0; r < 2 * counts; ++r)
+        {
+            const uint32_t thr = threads[r % counts];
+            CpuPool * p = pools[r / counts];
+
+            test = test && CpuFindSum(in.data(), len, thr, p) == sum
+                && CpuFindNonZero(in.data(), len, thr, p) == item;
+
+            test = test
+                && CpuCompactify(in.data(), len, out.data(), thr, p)
+                == comp.size()
+                && std::equal(comp.begin(), comp.end(), out.begin());
+
+            test = test
+                && CpuExclusiveScan(in.data(), len, out.data(), thr, p)
+                == sum
+                && std::equal(out.begin(), out.begin() + len, scan.begin());
+
+            // in place
+            out = in;
+
+            test = test
+                && CpuExclusiveScan(out.data(), len, out.data(), thr, p)
+                == sum
+                && std::equal(out.begin(), out.begin() + len, scan.begin());
+        }
+    }
+
+    if (!test)
+    {
+        LOG(ERROR) << "Host primitives test failed";
         exit(EXIT_FAILURE);
     }
-    
-    //========================================================================//
-    //  Set test info
-    //========================================================================//
-    info_t info;
-    uint8_t x[NUM_SIZE_8];
-    uint8_t w[PK_SIZE_8];
-    char seed[256] = "Va'esse deireadh aep eigean, va'esse eigh faidh'ar";
 
-    // generate secret key from seed
-    GenerateSecKey(seed, 50, info.sk, info.skstr);
-    // generate public key from secret key
-    GeneratePublicKey(info.skstr, info.pkstr, info.pk);
+    LOG(INFO) << "Host primitives test passed\n";
 
-    const char ref_pkstr[PK_SIZE_4 + 1]
-        = "020C16DFC5E23C59357E89D44977038F0A7851CC9926B3AABB3FF9E7E6A57315AD";
+    return EXIT_SUCCESS;
+}
 
-    int test = !strncmp(ref_pkstr, info.pkstr, PK_SIZE_4);
+////////////////////////////////////////////////////////////////////////////////
+//  Test reuse of host buffers
+////////////////////////////////////////////////////////////////////////////////
+int TestHostArena(void)
+{
+    HostArena arena;
+    const size_t size = (size_t)3 << 20;
+
+    uint8_t * buf = (uint8_t *)arena.Acquire(size);
+    int test = buf != NULL;
+
+    if (test)
+    {
+        memset(buf, 0x5A, size);
+        LOG(INFO) << "Host buffer of 3 MiB on " << arena.Describe(buf);
+    }
+
+    // released buffer is handed out again with its content, a buffer in
+    // use is not
+    arena.Release(buf);
+
+    uint8_t * again = (uint8_t *)arena.Acquire(size >> 1);
+    uint8_t * other = (uint8_t *)arena.Acquire(size >> 1);
+
+    test = test && again == buf && again[size - 1] == 0x5A
+        && other && other != buf;
+
+    // larger request maps a new buffer
+    arena.Release(again);
+    arena.Release(other);
+
+    uint8_t * large = (uint8_t *)arena.Acquire(size << 1);
+
+    test = test && large && large != buf && large != other;
+
+    if (large) { large[(size << 1) - 1] = 1; }
+
+    arena.Clear();
 
     if (!test)
     {
-        LOG(ERROR) << "OpenSSL: generated wrong public key";
-        return EXIT_FAILURE;
+        LOG(ERROR) << "Host arena test failed";
+        exit(EXIT_FAILURE);
     }
 
-    ((uint64_t *)info.bound)[0] = 0xFFFFFFFFFFFFFFFF;
-    ((uint64_t *)info.bound)[1] = 0xFFFFFFFFFFFFFFFF;
-    ((uint64_t *)info.bound)[2] = 0xFFFFFFFFFFFFFFFF;
-    ((uint64_t *)info.bound)[3] = 0x000002FFFFFFFFFF;
+    LOG(INFO) << "Host arena test passed\n";
 
-    ((uint64_t *)info.mes)[0] = 1;
-    ((uint64_t *)info.mes)[1] = 0;
-    ((uint64_t *)info.mes)[2] = 0;
-    ((uint64_t *)info.mes)[3] = 0;
+    return EXIT_SUCCESS;
+}
 
-    sprintf(seed, "%d", 0);
+////////////////////////////////////////////////////////////////////////////////
+//  Test NUMA topology and thread pinning
+////////////////////////////////////////////////////////////////////////////////
+int TestTopology(void)
+{
+    std::vector<numa_node_t> nodes;
+    std::vector<uint32_t> cpus;
 
-    // generate secret key from seed
-    GenerateSecKey(seed, 1, x, info.skstr);
-    // generate public key from secret key
-    GeneratePublicKey(info.skstr, info.pkstr, w);
+    const uint32_t ref[] = { 0, 1, 2, 3, 8, 10, 11 };
+
+    int test = ParseCpuList("0-3,8,10-11\n", &cpus) == EXIT_SUCCESS
+        && cpus == std::vector<uint32_t>(ref, ref + 7);
+
+    test = test && ParseCpuList("4-2", &cpus) == EXIT_FAILURE
+        && ParseCpuList("a,1", &cpus) == EXIT_FAILURE;
+
+    // every node has cores, none is empty
+    test = test && NumaNodes(&nodes) >= 1;
+
+    for (uint32_t n = 0; n < nodes.size(); ++n)
+    {
+        test = test && !nodes[n].cpus.empty();
+    }
+
+    LOG(INFO) << "Host has " << nodes.size() << " NUMA nodes";
+
+#ifdef __linux__
+    // pinned thread runs on cores of the last node only
+    if (test)
+    {
+        const std::vector<uint32_t> & pin = nodes.back().cpus;
+
+        std::thread pinned(
+            [&]()
+            {
+                int cpu;
+
+                test = PinThread(pin) == EXIT_SUCCESS
+                    && (cpu = sched_getcpu()) >= 0
+                    && std::find(pin.begin(), pin.end(), cpu) != pin.end();
+            }
+        );
+
+        pinned.join();
+    }
+#endif
+
+    if (!test)
+    {
+        LOG(ERROR) << "Topology test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Topology test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test multi-lane BLAKE2b-256 against the scalar one
+////////////////////////////////////////////////////////////////////////////////
+int TestCpuBlake(const info_t * info)
+{
+    LOG(INFO) << "CPU multi-lane BLAKE2b-256 test started";
+
+    const char * isas[] = { "scalar", "avx2", "avx512" };
+
+    b2b_lanes_t s;
+    uint8_t block[NUM_SIZE_8 + NONCE_SIZE_8];
+    uint8_t hash[NUM_SIZE_8];
+    uint8_t lane[NUM_SIZE_8];
+
+    memcpy(block, info->mes, NUM_SIZE_8);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if (CpuBlakeSelect(isas[i]) != EXIT_SUCCESS)
+        {
+            LOG(INFO) << isas[i] << " is not supported, skipped";
+            continue;
+        }
+
+        CpuBlakeInit(&s);
+
+        for (uint32_t l = 0; l < B2B_LANES; ++l)
+        {
+            uint64_t nonce = 0x3381BC + l;
+
+            for (int j = 0; j < NONCE_SIZE_8; ++j)
+            {
+                block[NUM_SIZE_8 + j]
+                    = (nonce >> ((NONCE_SIZE_8 - j - 1) << 3)) & 0xFF;
+            }
+
+            CpuBlakeLoad(&s, l, block, NUM_SIZE_8 + NONCE_SIZE_8);
+        }
+
+        CpuBlakeCompress(&s, NUM_SIZE_8 + NONCE_SIZE_8, 1);
+
+        for (uint32_t l = 0; l < B2B_LANES; ++l)
+        {
+            CpuBlakeHash(info->mes, 0x3381BC + l, hash);
+            CpuBlakeDump(&s, l, lane);
+
+            if (memcmp(hash, lane, NUM_SIZE_8))
+            {
+                LOG(ERROR) << "CPU multi-lane BLAKE2b-256 test failed on "
+                    << isas[i] << " lane " << l;
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    CpuBlakeSelect(NULL);
+
+    LOG(INFO) << "CPU multi-lane BLAKE2b-256 test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test multi-lane table precalculation against the scalar one
+////////////////////////////////////////////////////////////////////////////////
+int TestCpuPrehash(
+    const info_t * info,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    LOG(INFO) << "CPU table precalculation test started";
+
+    const char * isas[] = { "scalar", "avx2", "avx512" };
+
+    // ranges of the table with partial lane groups at both ends of it and
+    // in the middle, first and last of them untouched
+    const uint32_t ranges[][2] = {
+        { 0, B2B_LANES }, { 13, 5 }, { N_LEN / 2 + 3, 3 * B2B_LANES + 1 },
+        { N_LEN - 11, 11 }
+    };
+
+    // data: pk || mes || w || padding || x || sk
+    uint32_t data[DATA_SIZE_8 >> 2] = {0};
+
+    memcpy(data, info->pk, PK_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8, info->mes, NUM_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8 + NUM_SIZE_8, w, PK_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + NUM_SIZE_32, x, NUM_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, info->sk, NUM_SIZE_8);
+
+    // whole table is mapped, only pages of the ranges are touched
+    uint32_t * hashes = (uint32_t *)calloc(N_LEN, NUM_SIZE_8);
+    uint32_t elem[NUM_SIZE_32];
+
+    int test = hashes != NULL;
+
+    for (int i = 0; test && i < 3; ++i)
+    {
+        if (CpuBlakeSelect(isas[i]) != EXIT_SUCCESS) { continue; }
+
+        for (uint32_t r = 0; r < 4; ++r)
+        {
+            const uint32_t first = ranges[r][0];
+            const uint32_t last = first + ranges[r][1];
+
+            for (uint32_t j = first; j < last; ++j)
+            {
+                for (int k = 0; k < NUM_SIZE_32; ++k)
+                {
+                    hashes[TABLE_POS(j, k)] = 0;
+                }
+            }
+
+            CpuPrehashRange(0, data, NULL, first, last - first, hashes, 2);
+
+            // both parts of every element of the range, none past it
+            for (uint32_t j = first; test && j <= last && j < N_LEN; ++j)
+            {
+                if (j < last) { CpuHashElement(data, NULL, j, elem); }
+                else { memset(elem, 0, NUM_SIZE_8); }
+
+                for (int k = 0; k < NUM_SIZE_32; ++k)
+                {
+                    test = test && hashes[TABLE_POS(j, k)] == elem[k];
+                }
+
+                if (!test)
+                {
+                    LOG(ERROR) << "CPU table precalculation test failed on "
+                        << isas[i] << " element " << j;
+                }
+            }
+        }
+    }
+
+    CpuBlakeSelect(NULL);
+    free(hashes);
+
+    if (!test)
+    {
+        LOG(ERROR) << "CPU table precalculation test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "CPU table precalculation test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test host reference solution
+////////////////////////////////////////////////////////////////////////////////
+int TestCpuSolutions(
+    const info_t * info,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    LOG(INFO) << "CPU solutions test started";
+
+    // data: pk || mes || w || padding || x || sk
+    uint32_t data[DATA_SIZE_8 >> 2] = {0};
+
+    memcpy(data, info->pk, PK_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8, info->mes, NUM_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8 + NUM_SIZE_8, w, PK_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + NUM_SIZE_32, x, NUM_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, info->sk, NUM_SIZE_8);
+
+    uint8_t hash[NUM_SIZE_8];
+    uint32_t ind[K_LEN];
+    uint32_t elems[K_LEN * NUM_SIZE_32];
+    uint32_t d[NUM_SIZE_32];
+    result_t solution;
+    prefilter_t filter;
+
+    MiningPrefilter(
+        (const uint32_t *)info->bound,
+        data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, &filter
+    );
+
+    // only the first solution of the GPU test is valid
+    for (uint64_t nonce = 0x3381BC; nonce < 0x3381C0; ++nonce)
+    {
+        CpuBlakeHash(info->mes, nonce, hash);
+        CpuGenIndices(hash, ind);
+
+        uint64_t hi = filter.offset;
+
+        for (int k = 0; k < K_LEN; ++k)
+        {
+            CpuHashElement(data, NULL, ind[k], elems + k * NUM_SIZE_32);
+            hi += U256FromLittleEndian(elems + k * NUM_SIZE_32).w[3];
+        }
+
+        int valid = CpuSumModQ(
+            (const uint32_t *)info->bound,
+            data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, elems, d
+        );
+
+        // solutions always pass the prefilter
+        if (valid != (nonce == 0x3381BE) || (valid && hi > filter.threshold))
+        {
+            LOG(ERROR) << "CPU solutions test failed on nonce " << nonce;
+            exit(EXIT_FAILURE);
+        }
+
+        if (valid)
+        {
+            solution.nonce = nonce;
+            memcpy(solution.d, d, NUM_SIZE_8);
+        }
+    }
+
+    //========================================================================//
+    //  Host verification of device solutions
+    //========================================================================//
+    SolutionVerifier verifier;
+
+    verifier.SetKeys(info->pk, info->sk);
+    verifier.SetBlock(info->mes, x, w);
+    verifier.SetBound(info->bound);
+
+    int test = verifier.Verify(solution) && !verifier.Derate();
+
+    // wrong d, nonce over the bound
+    result_t wrong = solution;
+
+    wrong.d[3] ^= 0x100;
+    test = test && !verifier.Verify(wrong);
+
+    wrong = solution;
+    ++wrong.nonce;
+    test = test && !verifier.Verify(wrong) && !verifier.Derate();
+
+    // faults of a window are forgotten
+    for (uint32_t i = 0; i < VERIFY_FAULT_WINDOW; ++i) { verifier.Iteration(); }
+
+    for (uint32_t i = 0; test && i < VERIFY_FAULT_LIMIT - 1; ++i)
+    {
+        test = !verifier.Verify(wrong) && !verifier.Derate();
+    }
+
+    // derating by repeated faults up to the maximal level
+    test = test && !verifier.Verify(wrong) && verifier.Derate() == 1
+        && verifier.IdleUs(1000) == 10 * VERIFY_DERATE_IDLE;
+
+    for (uint32_t i = 0; test && i < VERIFY_FAULT_LIMIT * VERIFY_MAX_DERATE; ++i)
+    {
+        test = !verifier.Verify(wrong);
+    }
+
+    test = test && verifier.Derate() == VERIFY_MAX_DERATE
+        && verifier.Verify(solution);
+
+    if (!test)
+    {
+        LOG(ERROR) << "Solution verifier test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "CPU solutions test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test host block mining against the scalar evaluation of every nonce
+////////////////////////////////////////////////////////////////////////////////
+int TestCpuMining(
+    const info_t * info,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    LOG(INFO) << "CPU block mining test started";
+
+    // data: pk || mes || w || padding || x || sk
+    uint32_t data[DATA_SIZE_8 >> 2] = {0};
+
+    memcpy(data, info->pk, PK_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8, info->mes, NUM_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8 + NUM_SIZE_8, w, PK_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + NUM_SIZE_32, x, NUM_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, info->sk, NUM_SIZE_8);
+
+    const uint32_t * sk = data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32;
+
+    // ranges of nonces: around the solution of the GPU test with the bound
+    // of the block, with a bound of about Q / 8, then with a bound passing
+    // every nonce to overflow the results; worker chunks and lane groups
+    // of nonces end at odd places
+    const uint64_t bases[] = { 0x338100, 0x1000, 0x3381BE };
+    const uint32_t lens[] = { 301, 150, 3 * MAX_RESULTS + 11 };
+    uint32_t bounds[3][NUM_SIZE_32];
+
+    memcpy(bounds[0], info->bound, NUM_SIZE_8);
+    memset(bounds[1], 0xFF, NUM_SIZE_8);
+    bounds[1][NUM_SIZE_32 - 1] = 0x1FFFFFFF;
+    memset(bounds[2], 0xFF, NUM_SIZE_8);
+
+    // whole table is mapped, only elements read by the ranges are
+    // precalculated, as the whole one takes minutes on a single core
+    uint32_t * hashes = (uint32_t *)calloc(N_LEN, NUM_SIZE_8);
+    std::vector<bool> built(N_LEN, false);
+    CpuPool pool(2);
+
+    uint8_t hash[NUM_SIZE_8];
+    uint32_t ind[K_LEN];
+    uint32_t elems[K_LEN * NUM_SIZE_32];
+    uint32_t d[NUM_SIZE_32];
+    result_t results[MAX_RESULTS];
+    uint32_t count;
+
+    int test = hashes != NULL;
+
+    for (uint32_t r = 0; test && r < sizeof(lens) / sizeof(lens[0]); ++r)
+    {
+        //====================================================================//
+        //  Scalar evaluation of every nonce
+        //====================================================================//
+        std::map<uint64_t, std::vector<uint32_t>> ref;
+
+        for (uint64_t nonce = bases[r]; nonce < bases[r] + lens[r]; ++nonce)
+        {
+            CpuBlakeHash(info->mes, nonce, hash);
+            CpuGenIndices(hash, ind);
+
+            for (int k = 0; k < K_LEN; ++k)
+            {
+                CpuHashElement(data, NULL, ind[k], elems + k * NUM_SIZE_32);
+
+                if (!built[ind[k]])
+                {
+                    CpuPrehashRange(0, data, NULL, ind[k], 1, hashes, 1, &pool);
+                    built[ind[k]] = true;
+                }
+            }
+
+            if (CpuSumModQ(bounds[r], sk, elems, d))
+            {
+                ref[nonce].assign(d, d + NUM_SIZE_32);
+            }
+        }
+
+        // only the solution of the GPU test, some solutions, then more
+        // solutions than results
+        test = (!r)? ref.size() == 1 && ref.count(0x3381BE):
+            (r == 1)? ref.size() > 1 && ref.size() <= MAX_RESULTS:
+            ref.size() == lens[r];
+
+        //====================================================================//
+        //  Block mining with own and with kept workers and buffers
+        //====================================================================//
+        std::vector<uint32_t> flags(lens[r]);
+        std::vector<uint32_t> cands(lens[r]);
+        std::vector<uint32_t> counts(3);
+
+        for (int kept = 0; test && kept < 2; ++kept)
+        {
+            test = CpuBlockMining(
+                bounds[r], hashes, data, bases[r], lens[r], results, &count,
+                (kept)? flags.data(): NULL, (kept)? cands.data(): NULL,
+                (kept)? counts.data(): NULL, 3, (kept)? &pool: NULL
+            ) == EXIT_SUCCESS && count == ref.size();
+
+            // kept and lost solutions as fetched from a backend
+            const uint32_t fetched = (count < MAX_RESULTS)? count: MAX_RESULTS;
+            const uint32_t lost = count - fetched;
+
+            test = test && lost == ((ref.size() > MAX_RESULTS)?
+                ref.size() - MAX_RESULTS: 0);
+
+            // every kept solution once, with its d
+            std::map<uint64_t, std::vector<uint32_t>> res;
+
+            for (uint32_t i = 0; test && i < fetched; ++i)
+            {
+                res[results[i].nonce].assign(
+                    results[i].d, results[i].d + NUM_SIZE_32
+                );
+
+                test = ref.count(results[i].nonce)
+                    && res[results[i].nonce] == ref[results[i].nonce];
+            }
+
+            test = test && res.size() == fetched;
+        }
+
+        if (!test)
+        {
+            LOG(ERROR) << "CPU block mining test failed on nonces from "
+                << bases[r];
+        }
+    }
+
+    free(hashes);
+
+    if (!test)
+    {
+        LOG(ERROR) << "CPU block mining test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "CPU block mining test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test pool-side verification of submitted solutions
+////////////////////////////////////////////////////////////////////////////////
+int TestBatchVerify(
+    const info_t * info,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    LOG(INFO) << "Pool-side verification test started";
+
+    // data: pk || mes || w || padding || x || sk
+    uint32_t data[DATA_SIZE_8 >> 2] = {0};
+
+    memcpy(data, info->pk, PK_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8, info->mes, NUM_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8 + NUM_SIZE_8, w, PK_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + NUM_SIZE_32, x, NUM_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, info->sk, NUM_SIZE_8);
+
+    uint8_t hash[NUM_SIZE_8];
+    uint32_t ind[K_LEN];
+    uint32_t elems[K_LEN * NUM_SIZE_32];
+    uint32_t d[NUM_SIZE_32];
+    uint64_t nonce = 0x3381BE;
+
+    CpuBlakeHash(info->mes, nonce, hash);
+    CpuGenIndices(hash, ind);
+
+    for (int k = 0; k < K_LEN; ++k)
+    {
+        CpuHashElement(data, NULL, ind[k], elems + k * NUM_SIZE_32);
+    }
+
+    CpuSumModQ(
+        (const uint32_t *)info->bound,
+        data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, elems, d
+    );
+
+    //========================================================================//
+    //  Solution of the miner extended by its block
+    //========================================================================//
+    char pkstr[PK_SIZE_4 + 1];
+    char request[1024];
+    char bound[NUM_SIZE_4 * 2];
+    uint32_t len;
+
+    BigEndianToHexStr(info->pk, PK_SIZE_8, pkstr);
+    SolutionRequest(pkstr, w, (const uint8_t *)&nonce, (uint8_t *)d, request);
+    LittleEndianOf256ToDecStr(info->bound, bound, &len);
+
+    len = strlen(request) - 1;
+    strcpy(request + len, ",\"msg\":\"");
+    len += 8;
+    BigEndianToHexStr(info->mes, NUM_SIZE_8, request + len);
+    len += NUM_SIZE_4;
+    sprintf(request + len, "\",\"b\":%s}", bound);
+
+    submission_t sub;
+    SubmissionVerifier verifier;
+
+    int test = ParseSubmission(request, strlen(request), &sub) == EXIT_SUCCESS
+        && sub.nonce == nonce && !memcmp(sub.d, d, NUM_SIZE_8)
+        && !memcmp(sub.bound, info->bound, NUM_SIZE_8)
+        && verifier.Verify(sub);
+
+    // truncated object, malformed field
+    test = test && ParseSubmission(request, 20, &sub) == EXIT_FAILURE;
+
+    request[10] = 'Z';
+    test = test && ParseSubmission(request, strlen(request), &sub) == EXIT_FAILURE;
+
+    //========================================================================//
+    //  Batch of valid and corrupted submissions
+    //========================================================================//
+    const uint32_t count = 64;
+    std::vector<submission_t> subs(count);
+    std::vector<uint8_t> valid(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        subs[i] = sub;
+        memcpy(subs[i].d, d, NUM_SIZE_8);
+        memcpy(subs[i].pk, info->pk, PK_SIZE_8);
+        memcpy(subs[i].mes, info->mes, NUM_SIZE_8);
+    }
+
+    // wrong d, d over the bound, wrong nonce, swapped keys
+    subs[1].d[0] ^= 1;
+    memcpy(subs[2].bound, subs[2].d, NUM_SIZE_8);
+    ++subs[3].nonce;
+    memcpy(subs[4].pk, w, PK_SIZE_8);
+    memcpy(subs[4].w, info->pk, PK_SIZE_8);
+    // public key not on the curve
+    subs[5].pk[0] = 0x05;
+
+    VerifyBatch(subs.data(), count, valid.data(), 4);
+
+    for (uint32_t i = 0; test && i < count; ++i)
+    {
+        test = valid[i] == (i == 0 || i > 5);
+    }
+
+    if (!test)
+    {
+        LOG(ERROR) << "Pool-side verification test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Pool-side verification test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test in place parsing of block candidates
+////////////////////////////////////////////////////////////////////////////////
+int TestCandidateParse(void)
+{
+    LOG(INFO) << "Block candidate parsing test started";
+
+    info_t info;
+    json_t oldreq(0, REQ_LEN);
+    json_t newreq(0, REQ_LEN);
+    uint8_t mes[NUM_SIZE_8];
+
+    info.blockId = 0;
+    info.mesId = 0;
+
+    const char * msg = "46b7e949bfad202ab4e3dd9cc0603c1f61f53485854028b8fa03f"
+        "399544fb298";
+    const char * pk = "0395f8d54fdd5edb7eeab3228c952d39f5e60d048178f94ac992d4f"
+        "76a6dce4c71";
+
+    HexStrToBigEndian(msg, NUM_SIZE_4, mes, NUM_SIZE_8);
+
+    // reordered fields of mixed case with nested extra fields,
+    // more tokens than initially allocated
+    std::string body = std::string("{\"extra\":{\"a\":[1,2,{\"c\":3}]},\"PK\":\"")
+        + pk + "\",\"b\":2134,\"Msg\":\"" + msg + "\"";
+
+    for (int i = 0; i < REQ_LEN; ++i)
+    {
+        body += ",\"f" + std::to_string(i) + "\":" + std::to_string(i);
+    }
+
+    body += "}";
+
+    WriteFunc((void *)body.c_str(), 1, body.size(), &newreq);
+
+    int test = ApplyBlock(&oldreq, &newreq, &info, 0) == EXIT_SUCCESS
+        && info.blockId.load() == 1 && info.mesId == 1
+        && !U256Compare(U256FromLittleEndian(info.bound), uint256_t(2134))
+        && !memcmp(info.mes, mes, NUM_SIZE_8)
+        && oldreq.toklen > REQ_LEN;
+
+    // same body written in chunks is skipped by hash
+    newreq.Reset();
+    WriteFunc((void *)body.c_str(), 1, 10, &newreq);
+    WriteFunc((void *)(body.c_str() + 10), 1, body.size() - 10, &newreq);
+
+    test = test && newreq.hash == oldreq.hash
+        && ApplyBlock(&oldreq, &newreq, &info, 0) == EXIT_SUCCESS
+        && newreq.mesPos < 0 && info.blockId.load() == 1;
+
+    // changed extra field only, candidate is kept
+    body[body.size() - 2] = '7';
+    newreq.Reset();
+    WriteFunc((void *)body.c_str(), 1, body.size(), &newreq);
+
+    test = test && newreq.hash != oldreq.hash
+        && ApplyBlock(&oldreq, &newreq, &info, 0) == EXIT_SUCCESS
+        && info.blockId.load() == 1 && info.mesId == 1;
+
+    // changed bound at other position, message of other case is the same
+    std::string upper(msg);
+
+    for (size_t i = 0; i < upper.size(); ++i) { upper[i] = toupper(upper[i]); }
+
+    body = std::string("{\"msg\":\"") + upper + "\",\"b\":4268,\"pk\":\"" + pk
+        + "\"}";
+    newreq.Reset();
+    WriteFunc((void *)body.c_str(), 1, body.size(), &newreq);
+
+    test = test && ApplyBlock(&oldreq, &newreq, &info, 0) == EXIT_SUCCESS
+        && info.blockId.load() == 2 && info.mesId == 1
+        && !U256Compare(U256FromLittleEndian(info.bound), uint256_t(4268));
+
+    // field of a nested object only, not an object
+    const char * broken[] = {
+        "{\"msg\":\"46b7e\",\"pk\":\"0395\",\"extra\":{\"b\":1}}",
+        "[\"msg\",\"b\",\"pk\"]"
+    };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        newreq.Reset();
+        WriteFunc((void *)broken[i], 1, strlen(broken[i]), &newreq);
+
+        test = test && ApplyBlock(&oldreq, &newreq, &info, 0) == EXIT_FAILURE
+            && info.blockId.load() == 2;
+    }
+
+    if (!test)
+    {
+        LOG(ERROR) << "Block candidate parsing test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Block candidate parsing test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test block epoch signalling
+////////////////////////////////////////////////////////////////////////////////
+int TestEpoch(void)
+{
+    LOG(INFO) << "Block epoch test started";
+
+    epoch_t epoch(1);
+    uint_t woken = 0;
+    uint64_t avg;
+    uint64_t max;
+
+    // waiter times out without advance
+    int test = epoch.Wait(1, 10) == 1;
+
+    epoch.Latency(&avg, &max);
+    test = test && !avg && !max;
+
+    std::thread waiter([&](){ woken = epoch.Wait(1, 10000); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ++epoch;
+    waiter.join();
+
+    epoch.Latency(&avg, &max);
+
+    // waiter is woken by advance long before the timeout
+    test = test && woken == 2 && max >= avg && max < 1000000
+        && epoch.Wait(1, 10000) == 2;
+
+    if (!test)
+    {
+        LOG(ERROR) << "Block epoch test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Block epoch test passed, wake-up latency " << max << " us\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test miner thread cycle with a simulated device
+////////////////////////////////////////////////////////////////////////////////
+// solution of the data pk || mes || w || padding || x || sk for any bound
+static void FakeSolution(
+    const uint32_t * data,
+    const uint64_t nonce,
+    result_t * result
+)
+{
+    uint8_t hash[NUM_SIZE_8];
+    uint32_t ind[K_LEN];
+    uint32_t elems[K_LEN * NUM_SIZE_32];
+    uint32_t bound[NUM_SIZE_32];
+
+    memset(bound, 0xFF, NUM_SIZE_8);
+
+    result->nonce = nonce;
+
+    CpuBlakeHash((const uint8_t *)data + PK_SIZE_8, nonce, hash);
+    CpuGenIndices(hash, ind);
+
+    for (int k = 0; k < K_LEN; ++k)
+    {
+        CpuHashElement(data, NULL, ind[k], elems + k * NUM_SIZE_32);
+    }
+
+    CpuSumModQ(
+        bound, data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, elems, result->d
+    );
+
+    return;
+}
+
+class FakeBackend: public MiningBackend
+{
+public:
+    info_t * info = NULL;
+    int uploads = 0;
+    int bounds = 0;
+    int prehashes = 0;
+    int released = 0;
+    int doubleBuffer = 0;
+    int backs = 0;
+    int swaps = 0;
+    uint32_t backStart = 0;
+    std::vector<uint64_t> bases;
+
+    // data of the front buffer: pk || mes || w || padding || x || sk
+    uint32_t data[DATA_SIZE_8 >> 2] = {0};
+
+    const char * Name(void) const { return "FAKE"; }
+    std::pair<int, int> PciIds(void) const { return std::make_pair(-1, -1); }
+    int NumaNode(void) const { return -1; }
+    uint32_t NoncesPerIter(void) const { return 0x1000; }
+    int HashrateCycles(void) const { return 4; }
+
+    int Allocate(const uint8_t * pk, const uint8_t * sk, int *, int * dbuf)
+    {
+        memcpy(data, pk, PK_SIZE_8);
+        memcpy(data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, sk, NUM_SIZE_8);
+        *dbuf = doubleBuffer;
+        return EXIT_SUCCESS;
+    }
+
+    int InitPrehash(void) { return EXIT_SUCCESS; }
+
+    int UploadBlock(
+        const uint8_t *, const uint8_t * mes, const uint8_t * x,
+        const uint8_t * w
+    )
+    {
+        memcpy((uint8_t *)data + PK_SIZE_8, mes, NUM_SIZE_8);
+        memcpy((uint8_t *)data + PK_SIZE_8 + NUM_SIZE_8, w, PK_SIZE_8);
+        memcpy(data + COUPLED_PK_SIZE_32 + NUM_SIZE_32, x, NUM_SIZE_8);
+        ++uploads;
+        return EXIT_SUCCESS;
+    }
+
+    int UploadBound(const uint8_t *) { ++bounds; return EXIT_SUCCESS; }
+
+    int Prehash(void) { ++prehashes; return EXIT_SUCCESS; }
+
+    // bound changes on the 3rd iteration, message on the 5th,
+    // stop the cycle after 8 iterations
+    int Mine(const uint64_t base)
+    {
+        bases.push_back(base);
+
+        if (bases.size() == 3 || bases.size() == 5)
+        {
+            info->info_mutex.lock();
+
+            ++(info->bound[0]);
+            if (bases.size() == 5) { ++(info->mes[0]); ++(info->mesId); }
+
+            info->info_mutex.unlock();
+
+            ++(info->blockId);
+        }
+
+        return (bases.size() < 8)? EXIT_SUCCESS: EXIT_FAILURE;
+    }
+
+    // two solutions and one lost on the 2nd iteration, d of the second
+    // one is wrong
+    int FetchResults(result_t * results, uint32_t * count, uint32_t * lost)
+    {
+        *count = 0;
+        *lost = 0;
+
+        if (bases.size() == 2)
+        {
+            FakeSolution(data, bases[1], results);
+            FakeSolution(data, bases[1] + 1, results + 1);
+
+            results[1].d[0] ^= 1;
+
+            *count = 2;
+            *lost = 1;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    void Release(void) { ++released; }
+
+    // back buffer is built within 2 iterations
+    int PrehashBack(
+        const uint8_t *, const uint8_t *, const uint8_t *, const uint8_t *
+    )
+    {
+        ++backs;
+        backStart = bases.size();
+        return EXIT_SUCCESS;
+    }
+
+    int BackReady(int * ready)
+    {
+        *ready = bases.size() >= backStart + 2;
+        return EXIT_SUCCESS;
+    }
+
+    int SwapBuffers(void) { ++swaps; return EXIT_SUCCESS; }
+};
+
+int TestMinerLoop(const info_t * ref, const int doubleBuffer)
+{
+    LOG(INFO) << "Miner cycle test started, double buffer " << doubleBuffer;
+
+    info_t info;
+    FakeBackend backend;
+    Metrics metrics(1);
+
+    memcpy(info.sk, ref->sk, NUM_SIZE_8);
+    memcpy(info.pk, ref->pk, PK_SIZE_8);
+    memcpy(info.pkstr, ref->pkstr, PK_SIZE_4 + 1);
+    memcpy(info.mes, ref->mes, NUM_SIZE_8);
+    // every d is below the bound
+    memset(info.bound, 0xFF, NUM_SIZE_8);
+    info.to[0] = '\0';
+    info.cache[0] = '\0';
+    info.profiles[0] = '\0';
+    info.keepPrehash = 0;
+    info.doubleBuffer = doubleBuffer;
+    info.nonceBase = 0;
+    info.nonceBits = NONCE_SIZE_8 << 3;
+    info.poolMining = 1;
+    info.blockId = 1;
+    info.mesId = 1;
+
+    backend.info = &info;
+    backend.doubleBuffer = doubleBuffer;
+
+    Submitter submitter(info.to, info.pkstr, &info);
+
+    MinerThread(&backend, 0, &info, &submitter, &metrics);
+    el::Helpers::setThreadName("test thread");
+
+    // valid solution of the old message is queued and then dropped as stale
+    submit_stats_t stats;
+
+    submitter.Start();
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        submitter.Stats(&stats);
+
+        if (stats.stale == 1) { break; }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    submitter.Stop();
+
+    // bound-only change must not trigger prehash,
+    // pool mining goes on after solutions are found
+    int test = backend.released == 1 && backend.bases.size() == 8
+        && !backend.bases[0] && stats.stale == 1 && !stats.posted;
+
+    // new message is prehashed in the back buffer while mining goes on,
+    // bound is uploaded again after the swap
+    if (doubleBuffer)
+    {
+        test = test && backend.uploads == 1 && backend.prehashes == 1
+            && backend.backs == 1 && backend.swaps == 1
+            && backend.bounds == 2;
+    }
+    else
+    {
+        test = test && backend.uploads == 2 && backend.prehashes == 2
+            && backend.bounds == 1 && !backend.backs;
+    }
+
+    // interrupted iterations are repeated with the same base
+    for (uint32_t i = 1; test && i < backend.bases.size(); ++i)
+    {
+        uint64_t step = backend.bases[i] - backend.bases[i - 1];
+
+        test = !step || step == backend.NoncesPerIter();
+    }
+
+    // 8th iteration fails, 3rd and 5th are interrupted, every block is
+    // switched to and every message is prehashed once, invalid solution
+    // is dropped without derating
+    device_metrics_t * device = metrics.Device(0);
+    uint64_t switches = 0;
+    uint64_t prehashes = 0;
+
+    for (int i = 0; i <= METRICS_BUCKETS; ++i)
+    {
+        switches += device->blockSwitch.buckets[i].load();
+        prehashes += device->prehash.buckets[i].load();
+    }
+
+    std::string text;
+    std::vector<std::pair<int, int>> pci(1, std::make_pair(1, 0));
+
+    metrics.Prometheus(pci, &text);
+
+    test = test && device->iterations.Load() == 5
+        && device->staleIterations.Load() == 2
+        && device->solutions.Load() == 1 && device->lostSolutions.Load() == 1
+        && device->invalidSolutions.Load() == 1 && !device->derate.Load()
+        && switches == 3 && prehashes == 2
+        && text.find(
+            "autolykos_solutions_total{device=\"0\",pci=\"1:0\"} 1\n"
+        ) != std::string::npos
+        && text.find(
+            "autolykos_invalid_solutions_total{device=\"0\",pci=\"1:0\"} 1\n"
+        ) != std::string::npos
+        && text.find(
+            "autolykos_iteration_seconds_count{device=\"0\",pci=\"1:0\"} 5\n"
+        ) != std::string::npos;
+
+    if (!test)
+    {
+        LOG(ERROR) << "Miner cycle test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Miner cycle test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+// solutions at the end of the nonce range and past it on the first
+// iteration, then a job of other nonces, stop the cycle after 2 iterations
+class RangeBackend: public FakeBackend
+{
+public:
+    int Mine(const uint64_t base)
+    {
+        bases.push_back(base);
+
+        return (bases.size() < 2)? EXIT_SUCCESS: EXIT_FAILURE;
+    }
+
+    int FetchResults(result_t * results, uint32_t * count, uint32_t * lost)
+    {
+        FakeSolution(data, bases[0] + 0x7FE, results);
+        FakeSolution(data, bases[0] + 0x7FF, results + 1);
+        FakeSolution(data, bases[0] + 0x800, results + 2);
+
+        *count = 3;
+        *lost = 0;
+
+        info->info_mutex.lock();
+        info->nonceBase = 0x90000;
+        info->info_mutex.unlock();
+
+        ++(info->blockId);
+
+        return EXIT_SUCCESS;
+    }
+};
+
+int TestMinerRange(const info_t * ref)
+{
+    LOG(INFO) << "Miner nonce range test started";
+
+    info_t info;
+    RangeBackend backend;
+    Metrics metrics(1);
+
+    memcpy(info.sk, ref->sk, NUM_SIZE_8);
+    memcpy(info.pk, ref->pk, PK_SIZE_8);
+    memcpy(info.pkstr, ref->pkstr, PK_SIZE_4 + 1);
+    memcpy(info.mes, ref->mes, NUM_SIZE_8);
+    memset(info.bound, 0xFF, NUM_SIZE_8);
+    info.to[0] = '\0';
+    info.cache[0] = '\0';
+    info.profiles[0] = '\0';
+    info.keepPrehash = 0;
+    info.doubleBuffer = 0;
+    // 2^11 - 1 nonces, less than an iteration
+    info.nonceBase = 0x50000;
+    info.nonceBits = 11;
+    info.poolMining = 1;
+    info.blockId = 1;
+    info.mesId = 1;
+
+    backend.info = &info;
+
+    Submitter submitter(info.to, info.pkstr, &info);
+
+    MinerThread(&backend, 0, &info, &submitter, &metrics);
+    el::Helpers::setThreadName("test thread");
+
+    // only the solution within the range is kept, the next job is mined
+    // from its first nonce
+    device_metrics_t * device = metrics.Device(0);
+
+    int test = backend.bases.size() == 2 && backend.bases[0] == 0x50000
+        && backend.bases[1] == 0x90000 && device->solutions.Load() == 1
+        && !device->invalidSolutions.Load();
+
+    if (!test)
+    {
+        LOG(ERROR) << "Miner nonce range test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Miner nonce range test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test asynchronous solution submission with a local node stub
+////////////////////////////////////////////////////////////////////////////////
+int TestSubmitter(const info_t * ref, const uint8_t * w)
+{
+    LOG(INFO) << "Solution submitter test started";
+
+    info_t info;
+    httplib::Server node;
+    std::atomic<int> requests(0);
+    std::atomic<int> failing(0);
+    char to[MAX_URL_SIZE];
+
+    memcpy(info.pkstr, ref->pkstr, PK_SIZE_4 + 1);
+    info.blockId = 1;
+    info.mesId = 1;
+
+    // the very first POST fails with a server error
+    node.Post(
+        "/mining/solution",
+        [&](const httplib::Request &, httplib::Response & res)
+        {
+            res.status = (requests++ && !failing.load())? 200: 500;
+            res.set_content("{}", "application/json");
+        }
+    );
+
+    int port = node.bind_to_any_port("127.0.0.1");
+    std::thread server([&](){ node.listen_after_bind(); });
+
+    sprintf(to, "http://127.0.0.1:%d/mining/solution", port);
+
+    Submitter submitter(to, info.pkstr, &info);
+    solution_t sol;
+    submit_stats_t stats;
+
+    memcpy(sol.w, w, PK_SIZE_8);
+    memset(sol.nonce, 0, NONCE_SIZE_8);
+    memset(sol.d, 0, NUM_SIZE_8);
+    sol.found = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+
+    // queue overflows before the submitter starts
+    int test = 1;
+
+    for (int i = 0; i <= SUBMIT_QUEUE_LEN; ++i)
+    {
+        sol.mesId = (i < SUBMIT_QUEUE_LEN - 2)? 0: 1;
+
+        test = test
+            && (submitter.Enqueue(&sol) == EXIT_SUCCESS)
+            == (i < SUBMIT_QUEUE_LEN);
+    }
+
+    submitter.Start();
+
+    // all but two solutions are stale, the first fresh one is retried
+    for (int i = 0; i < 10000; ++i)
+    {
+        submitter.Stats(&stats);
+
+        if (stats.posted + stats.failed + stats.stale == SUBMIT_QUEUE_LEN)
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    test = test && stats.stale == SUBMIT_QUEUE_LEN - 2 && stats.posted == 2
+        && !stats.failed && stats.dropped == 1 && requests == 3
+        && stats.maxLatency >= stats.lastLatency
+        // the retried solution waits for the backoff
+        && stats.maxLatency >= SUBMIT_BACKOFF_MS;
+
+    // stop interrupts the second, twice as long, backoff at once
+    failing = 1;
+    test = test && submitter.Enqueue(&sol) == EXIT_SUCCESS;
+
+    for (int i = 0; i < 10000 && requests < 5; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    submitter.Stop();
+
+    int64_t stop = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    submitter.Stats(&stats);
+    node.stop();
+    server.join();
+
+    test = test && requests == 5 && stats.failed == 1
+        && stop < SUBMIT_BACKOFF_MS;
+
+    if (!test)
+    {
+        LOG(ERROR) << "Solution submitter test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Solution submitter test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test block sources with a local node stub
+////////////////////////////////////////////////////////////////////////////////
+int TestBlockSource(void)
+{
+    LOG(INFO) << "Block source test started";
+
+    info_t info;
+    httplib::Server node;
+    std::mutex mutex;
+    std::string candidate;
+    std::string etag;
+    std::atomic<int> version(0);
+    std::atomic<int> closing(0);
+    std::atomic<int> full(0);
+    std::atomic<int> unchanged(0);
+    char from[MAX_URL_SIZE];
+    char push[MAX_URL_SIZE];
+
+    info.blockId = 0;
+    info.mesId = 0;
+
+    // candidate with given last message digit and bound
+    auto SetCandidate = [&](const char digit, const char * bound)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        candidate = std::string("{\"msg\":\"46b7e949bfad202ab4e3dd9cc0603c1f"
+            "61f53485854028b8fa03f399544fb29") + digit + "\",\"b\":" + bound
+            + ",\"pk\":\"0395f8d54fdd5edb7eeab3228c952d39f5e60d048178f94ac99"
+            "2d4f76a6dce4c71\"}";
+        etag = std::string("\"") + digit + bound + "\"";
+        ++version;
+    };
+
+    node.Get(
+        "/mining/candidate",
+        [&](const httplib::Request & req, httplib::Response & res)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (req.get_header_value("If-None-Match") == etag)
+            {
+                ++unchanged;
+                res.status = 304;
+
+                return;
+            }
+
+            ++full;
+            res.set_header("ETag", etag.c_str());
+            res.set_content(candidate, "application/json");
+        }
+    );
+
+    // event with the current candidate on connection and on each change,
+    // the stream is closed after 5 seconds without changes or on test end
+    node.Get(
+        "/mining/events",
+        [&](const httplib::Request &, httplib::Response & res)
+        {
+            std::shared_ptr<int> sent = std::make_shared<int>(-1);
+
+            res.set_header("Content-Type", "text/event-stream");
+            res.set_chunked_content_provider(
+                [&, sent](size_t, httplib::DataSink sink, httplib::Done done)
+                {
+                    for (
+                        int i = 0; *sent == version && !closing && i < 5000;
+                        ++i
+                    )
+                    {
+                        std::this_thread::sleep_for(
+                            std::chrono::milliseconds(1)
+                        );
+                    }
+
+                    if (*sent == version) { done(); return; }
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    std::string event = ": comment\ndata: " + candidate
+                        + "\r\n\r\n";
+
+                    *sent = version;
+                    sink(event.c_str(), event.size());
+                },
+                [](){}
+            );
+        }
+    );
+
+    int port = node.bind_to_any_port("127.0.0.1");
+    std::thread server([&](){ node.listen_after_bind(); });
+
+    sprintf(from, "http://127.0.0.1:%d/mining/candidate", port);
+    sprintf(push, "http://127.0.0.1:%d/mining/events", port);
+
+    //========================================================================//
+    //  Conditional polling
+    //========================================================================//
+    PollSource poll(from);
+
+    SetCandidate('8', "2134");
+
+    // unchanged candidate is answered with 304, new bound keeps message
+    int test = poll.Request(&info, 0) == EXIT_SUCCESS
+        && poll.Request(&info, 0) == EXIT_SUCCESS
+        && info.blockId.load() == 1 && info.mesId.load() == 1
+        && full == 1 && unchanged == 1;
+
+    SetCandidate('8', "2135");
+
+    test = test && poll.Request(&info, 0) == EXIT_SUCCESS
+        && info.blockId.load() == 2 && info.mesId.load() == 1 && full == 2;
+
+    // candidate without bound is not taken, its tag is not sent back
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        candidate = "{\"msg\":\"46b7e\",\"pk\":\"0395f8d54fdd5edb7eeab3228c9"
+            "52d39f5e60d048178f94ac992d4f76a6dce4c71\"}";
+        etag = "\"broken\"";
+    }
+
+    test = test && poll.Request(&info, 0) == EXIT_FAILURE
+        && poll.Request(&info, 0) == EXIT_FAILURE && full == 4;
+
+    // the tag of the block mined is sent again
+    SetCandidate('8', "2135");
+
+    test = test && poll.Request(&info, 0) == EXIT_SUCCESS
+        && info.blockId.load() == 2 && full == 4 && unchanged == 2;
+
+    //========================================================================//
+    //  Push with fallback polling
+    //========================================================================//
+    info_t pushinfo;
+    PushSource source(from, push);
+    source_stats_t stats;
+
+    pushinfo.blockId = 0;
+    pushinfo.mesId = 0;
+
+    // the first step polls the candidate and connects the stream
+    test = test && source.Fetch(&pushinfo, 0) == EXIT_SUCCESS
+        && pushinfo.mesId.load() == 1;
+
+    // the stream delivers the current candidate, it is not a new one,
+    // then the changed one
+    for (int k = 0; k < 2; ++k)
+    {
+        stats.pushed = 0;
+
+        for (int i = 0; i < 100 && !stats.pushed; ++i)
+        {
+            source.Fetch(&pushinfo, 0);
+            source.Stats(&stats);
+        }
+
+        test = test && stats.pushed == 1
+            && pushinfo.mesId.load() == (uint_t)(k + 1);
+
+        SetCandidate('7', "2135");
+    }
+
+    test = test && pushinfo.blockId.load() == 2;
+
+    closing = 1;
+    node.stop();
+    server.join();
+
+    if (!test)
+    {
+        LOG(ERROR) << "Block source test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Block source test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test pool client with a local pool stub
+////////////////////////////////////////////////////////////////////////////////
+int TestStratum(const info_t * ref)
+{
+    LOG(INFO) << "Pool client test started";
+
+    //========================================================================//
+    //  Pool stub
+    //========================================================================//
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    if (
+        bind(listener, (sockaddr *)&addr, sizeof(addr))
+        || listen(listener, 1)
+        || getsockname(listener, (sockaddr *)&addr, &addrlen)
+    )
+    {
+        LOG(ERROR) << "Pool client test failed to listen";
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<std::string> shares;
+    const std::string mes1
+        = "46b7e949bfad202ab4e3dd9cc0603c1f61f53485854028b8fa03f399544fb298";
+    const std::string mes2
+        = "46b7e949bfad202ab4e3dd9cc0603c1f61f53485854028b8fa03f399544fb297";
+
+    // setup, job 1 with difficulty 2, then difficulty 4 after the first
+    // share and job 2 after the second one
+    std::thread pool([&]()
+    {
+        int conn = accept(listener, NULL, NULL);
+        std::string buf;
+
+        auto ReadLine = [&]() -> std::string
+        {
+            size_t pos;
+            char chunk[256];
+
+            while ((pos = buf.find('\n')) == std::string::npos)
+            {
+                int len = recv(conn, chunk, sizeof(chunk), 0);
+
+                if (len <= 0) { return ""; }
+
+                buf.append(chunk, len);
+            }
+
+            std::string line = buf.substr(0, pos);
+
+            buf.erase(0, pos + 1);
+
+            return line;
+        };
+
+        auto Write = [&](const std::string & line)
+        {
+            send(conn, line.c_str(), line.size(), 0);
+        };
+
+        ReadLine();
+        ReadLine();
+
+        Write(
+            "{\"id\":1,\"result\":[[[\"mining.notify\",\"ae68\"]],\"0a0b0c0d\","
+            "4],\"error\":null}\n{\"id\":2,\"result\":true,\"error\":null}\n"
+            "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[2]}\n"
+            "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"1\",100,\""
+            + mes1 + "\",\"2134\",true]}\n"
+        );
+
+        shares.push_back(ReadLine());
+
+        Write(
+            "{\"id\":3,\"result\":true,\"error\":null}\n"
+            "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[4]}\n"
+        );
+
+        shares.push_back(ReadLine());
+
+        Write(
+            "{\"id\":4,\"result\":false,\"error\":[23,\"Low difficulty\","
+            "null]}\n{\"id\":null,\"method\":\"mining.notify\",\"params\":"
+            "[\"2\",101,\"" + mes2 + "\",\"2134\",true]}\n"
+        );
+
+        while (!ReadLine().empty()) {}
+
+        close(conn);
+    });
+
+    //========================================================================//
+    //  Pool client
+    //========================================================================//
+    info_t info;
+    pool_t conf;
+    source_stats_t stats;
+    solution_t sol;
+    uint64_t q[NUM_SIZE_64] = { Q0, Q1, Q2, Q3 };
+
+    info.blockId = 0;
+    info.mesId = 0;
+    info.nonceBase = 0;
+    info.nonceBits = NONCE_SIZE_8 << 3;
+
+    sprintf(conf.url, "stratum+tcp://127.0.0.1:%d", ntohs(addr.sin_port));
+    strcpy(conf.user, "worker");
+    strcpy(conf.pass, "x");
+
+    std::unique_ptr<StratumSource> source(
+        new StratumSource(&conf, ref->pkstr)
+    );
+
+    // q / difficulty
+    auto BoundIs = [&](const int shift)
+    {
+        int eq = 1;
+
+        for (int i = 0; i < NUM_SIZE_64; ++i)
+        {
+            uint64_t word = q[i] >> shift;
+
+            if (i < NUM_SIZE_64 - 1) { word |= q[i + 1] << (64 - shift); }
+
+            eq = eq && ((uint64_t *)info.bound)[i] == word;
+        }
+
+        return eq;
+    };
+
+    auto WaitBlock = [&](const uint_t blockId)
+    {
+        for (int i = 0; i < 100 && info.blockId.load() < blockId; ++i)
+        {
+            source->Fetch(&info, 0);
+        }
+    };
+
+    // job 1: session nonce range, share bound is above block bound
+    WaitBlock(1);
+
+    int test = info.blockId.load() == 1 && info.mesId.load() == 1
+        && info.nonceBase == 0x0A0B0C0D00000000 && info.nonceBits == 32
+        && info.mes[0] == 0x46 && info.mes[NUM_SIZE_8 - 1] == 0x98
+        && BoundIs(1);
+
+    memset(&sol, 0, sizeof(sol));
+    sol.mesId = 1;
+    *((uint64_t *)sol.nonce) = 0x0A0B0C0D12345678;
+
+    test = test && source->Submit(&sol) == EXIT_SUCCESS;
+
+    // new difficulty only changes bound
+    WaitBlock(2);
+    source->Stats(&stats);
+
+    test = test && info.blockId.load() == 2 && info.mesId.load() == 1
+        && BoundIs(2) && stats.requests == 1 && stats.accepted == 1
+        && !stats.rejected && stats.pushed == 1;
+
+    // share through the submitter, rejected by the pool
+    Submitter submitter("", ref->pkstr, &info, source.get());
+    submit_stats_t substats;
+
+    submitter.Start();
+    *((uint64_t *)sol.nonce) = 0x0A0B0C0D00000001;
+    sol.found = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    submitter.Enqueue(&sol);
+
+    WaitBlock(3);
+    submitter.Stop();
+    submitter.Stats(&substats);
+
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count() - sol.found;
+
+    test = test && substats.lastLatency <= elapsed;
+
+    // share of the replaced job is not sent, counted as stale even if
+    // the message of the miners is not replaced yet
+    info_t lag;
+    submit_stats_t lagstats;
+
+    lag.mesId = 1;
+
+    Submitter late("", ref->pkstr, &lag, source.get());
+
+    late.Start();
+    late.Enqueue(&sol);
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        late.Stats(&lagstats);
+
+        if (lagstats.stale) { break; }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    late.Stop();
+
+    test = test && source->Submit(&sol) == SUBMIT_STALE
+        && lagstats.stale == 1 && !lagstats.posted && !lagstats.failed;
+
+    source->Fetch(&info, 0);
+    source->Stats(&stats);
+
+    test = test && info.blockId.load() == 3 && info.mesId.load() == 2
+        && info.mes[NUM_SIZE_8 - 1] == 0x97 && substats.posted == 1
+        && !stats.accepted && stats.rejected == 1 && stats.pushed == 1;
+
+    source.reset();
+    pool.join();
+    close(listener);
+
+    test = test && shares.size() == 2
+        && shares[0].find(
+            std::string("[\"worker\",\"1\",\"12345678\",\"") + ref->pkstr
+        ) != std::string::npos
+        && shares[1].find("\"1\",\"00000001\"") != std::string::npos;
+
+    if (!test)
+    {
+        LOG(ERROR) << "Pool client test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Pool client test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test GPU telemetry sampler with a simulated provider
+////////////////////////////////////////////////////////////////////////////////
+struct FakeTelemetry: public TelemetryProvider
+{
+    FakeTelemetry(void):
+        opens(0), samples(0), closes(0), fail(0), refuse(0)
+    {}
+
+    std::atomic<int> opens;
+    std::atomic<int> samples;
+    std::atomic<int> closes;
+    std::atomic<int> fail;
+    // number of first opens to fail
+    std::atomic<int> refuse;
+
+    int Open(void)
+    {
+        return (++opens > refuse.load())? EXIT_SUCCESS: EXIT_FAILURE;
+    }
+
+    // temperature is the number of the sample
+    int Sample(std::vector<gpu_sample_t> * gpus)
+    {
+        gpu_sample_t gpu;
+
+        memset(&gpu, 0, sizeof(gpu));
+        strcpy(gpu.name, "FAKE");
+        gpu.pciBus = 1;
+        gpu.temperature = ++samples;
+
+        gpus->assign(2, gpu);
+
+        return (fail.load())? EXIT_FAILURE: EXIT_SUCCESS;
+    }
+
+    void Close(void) { ++closes; }
+};
+
+int TestTelemetry(void)
+{
+    LOG(INFO) << "Telemetry sampler test started";
+
+    FakeTelemetry provider;
+    TelemetrySampler sampler(&provider, 20);
+    telemetry_t snap;
+    std::vector<telemetry_t> snaps;
+
+    int test = sampler.Latest(&snap) == EXIT_FAILURE;
+
+    sampler.Start();
+
+    while (provider.samples.load() < 5)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // readers get copies without waiting for the provider
+    test = test && sampler.Latest(&snap) == EXIT_SUCCESS && !snap.error
+        && snap.gpus.size() == 2 && snap.gpus[1].temperature >= 5
+        && !strcmp(snap.gpus[0].name, "FAKE");
+
+    sampler.Window(0xFFFFFFFF, &snaps);
+
+    test = test && snaps.size() >= 5 && snaps.back().time == snap.time;
+
+    for (uint32_t i = 1; test && i < snaps.size(); ++i)
+    {
+        test = snaps[i].time >= snaps[i - 1].time
+            && snaps[i].gpus[0].temperature
+            == snaps[i - 1].gpus[0].temperature + 1;
+    }
+
+    // window of the latest sample only
+    sampler.Window(0, &snaps);
+
+    test = test && snaps.size() >= 1 && snaps.back().time == snap.time;
+
+    // failed reading is stored as an error snapshot
+    provider.fail = 1;
+    int failAt = provider.samples.load();
+
+    while (provider.samples.load() < failAt + 2)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    test = test && sampler.Latest(&snap) == EXIT_SUCCESS && snap.error
+        && snap.gpus.empty();
+
+    sampler.Stop();
+
+    // library is initialized once for all samples
+    test = test && provider.opens == 1 && provider.closes == 1;
+
+    // library failing at start is opened on a later interval
+    FakeTelemetry late;
+    TelemetrySampler retry(&late, 20);
+
+    late.refuse = 2;
+    retry.Start();
+
+    while (late.samples.load() < 2)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    test = test && retry.Latest(&snap) == EXIT_SUCCESS && !snap.error;
+
+    retry.Stop();
+
+    test = test && late.opens == 3 && late.closes == 1;
+
+    if (!test)
+    {
+        LOG(ERROR) << "Telemetry sampler test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Telemetry sampler test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test geometry sweep and profiles with a simulated device
+////////////////////////////////////////////////////////////////////////////////
+class TuneBackend: public FakeBackend
+{
+public:
+    std::string key;
+    geometry_t geometry = { 1, 0x1000 };
+    // iterations of block dimension 1 and 2
+    int mined[3] = { 0, 0, 0 };
+
+    uint32_t NoncesPerIter(void) const { return geometry.nonces; }
+    std::string ProfileKey(void) const { return key; }
+
+    void Geometries(std::vector<geometry_t> * candidates) const
+    {
+        const geometry_t geoms[4]
+            = { { 1, 0x1000 }, { 1, 0x4000 }, { 2, 0x1000 }, { 2, 0x4000 } };
+
+        candidates->assign(geoms, geoms + 4);
+    }
+
+    int SetGeometry(const geometry_t & geom)
+    {
+        if (geom.blockDim < 1 || geom.blockDim > 2) { return EXIT_FAILURE; }
+
+        geometry = geom;
+
+        return EXIT_SUCCESS;
+    }
+
+    // 2 ms launch overhead and 4 ms per 0x1000 nonces of one block:
+    // 6, 18, 4 and 10 ms per iteration of the candidates
+    int Mine(const uint64_t)
+    {
+        ++mined[geometry.blockDim];
+
+        std::this_thread::sleep_for(ch::milliseconds(
+            2 + 4 * geometry.nonces / (0x1000 * geometry.blockDim)
+        ));
+
+        return EXIT_SUCCESS;
+    }
+
+    int FetchResults(result_t *, uint32_t * count, uint32_t * lost)
+    {
+        *count = 0;
+        *lost = 0;
+
+        return EXIT_SUCCESS;
+    }
+};
+
+int TestAutotune(void)
+{
+    LOG(INFO) << "Geometry autotuner test started";
+
+    const char * name = "./geometry.test.txt";
+    uint8_t bound[NUM_SIZE_8];
+    geometry_t geom;
+    double rate;
+    int test = 1;
+
+    memset(bound, 0xFF, NUM_SIZE_8);
+    remove(name);
+
+    //========================================================================//
+    //  Sweep with iteration limit
+    //========================================================================//
+    {
+        TuneBackend backend;
+
+        // best hashrate: 0x4000 nonces in 10 ms
+        test = SweepGeometry(&backend, 0, 100, &geom, &rate) == EXIT_SUCCESS
+            && geom.blockDim == 2 && geom.nonces == 0x4000
+            && backend.NoncesPerIter() == 0x4000 && rate > 1.0 && rate < 1.7;
+    }
+
+    {
+        TuneBackend backend;
+
+        // 18 and 10 ms iterations are too long,
+        // larger candidates are not timed past the warm-up
+        test = test
+            && SweepGeometry(&backend, 0, 8, &geom, &rate) == EXIT_SUCCESS
+            && geom.blockDim == 2 && geom.nonces == 0x1000
+            && backend.mined[1] == 1 + TUNE_ITERS + 1
+            && backend.mined[2] == 1 + TUNE_ITERS + 1;
+    }
+
+    {
+        TuneBackend backend;
+
+        // none fits: the smallest one
+        test = test
+            && SweepGeometry(&backend, 0, 3, &geom, &rate) == EXIT_SUCCESS
+            && geom.blockDim == 1 && geom.nonces == 0x1000 && rate == 0
+            && backend.mined[1] == 1 && backend.mined[2] == 1;
+    }
+
+    //========================================================================//
+    //  Profiles file
+    //========================================================================//
+    geometry_t first = { 1, 0x1000 };
+    geometry_t second = { 2, 0x4000 };
+    geometry_t replaced = { 2, 0x1000 };
+
+    test = test && LoadProfile(name, "FAKE A", &geom) == EXIT_FAILURE
+        && StoreProfile(name, "FAKE A", first) == EXIT_SUCCESS
+        && StoreProfile(name, "FAKE B v2", second) == EXIT_SUCCESS
+        && StoreProfile(name, "FAKE A", replaced) == EXIT_SUCCESS
+        && LoadProfile(name, "FAKE A", &geom) == EXIT_SUCCESS
+        && geom.blockDim == 2 && geom.nonces == 0x1000
+        && LoadProfile(name, "FAKE B v2", &geom) == EXIT_SUCCESS
+        && geom.blockDim == 2 && geom.nonces == 0x4000
+        && LoadProfile(name, "FAKE B", &geom) == EXIT_FAILURE;
+
+    //========================================================================//
+    //  Stored or swept geometry
+    //========================================================================//
+    {
+        TuneBackend backend;
+
+        // stored profile, no sweep
+        backend.key = "FAKE B v2";
+
+        test = test && Autotune(&backend, name, 0, bound) == EXIT_SUCCESS
+            && backend.NoncesPerIter() == 0x4000
+            && !backend.mined[1] && !backend.mined[2] && !backend.bounds;
+    }
+
+    {
+        TuneBackend backend;
+
+        // tuning disabled
+        backend.key = "FAKE C";
+
+        test = test && Autotune(&backend, "", 0, bound) == EXIT_SUCCESS
+            && backend.NoncesPerIter() == 0x1000 && !backend.mined[1];
+    }
+
+    {
+        TuneBackend backend;
+
+        // new device: sweep with zero bound, bound restored, profile stored
+        backend.key = "FAKE C";
+
+        test = test && Autotune(&backend, name, 0, bound) == EXIT_SUCCESS
+            && backend.NoncesPerIter() == 0x4000 && backend.mined[1]
+            && backend.bounds == 2
+            && LoadProfile(name, "FAKE C", &geom) == EXIT_SUCCESS
+            && geom.blockDim == 2 && geom.nonces == 0x4000;
+    }
+
+    remove(name);
+
+    if (!test)
+    {
+        LOG(ERROR) << "Geometry autotuner test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Geometry autotuner test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Test unfinalized hash contexts cache file
+////////////////////////////////////////////////////////////////////////////////
+static int CopyChunk(
+    void * arg,
+    const uint32_t first,
+    const uint32_t cnt,
+    uctx_t * chunk
+)
+{
+    std::vector<uctx_t> * uctxs = (std::vector<uctx_t> *)arg;
+
+    memcpy(&(*uctxs)[first], chunk, cnt * sizeof(uctx_t));
+
+    return EXIT_SUCCESS;
+}
+
+static int FillChunk(
+    void * arg,
+    const uint32_t first,
+    const uint32_t cnt,
+    uctx_t * chunk
+)
+{
+    std::vector<uctx_t> * uctxs = (std::vector<uctx_t> *)arg;
+
+    memcpy(chunk, &(*uctxs)[first], cnt * sizeof(uctx_t));
+
+    return EXIT_SUCCESS;
+}
+
+int TestUctxCache(const info_t * info)
+{
+    LOG(INFO) << "Unfinalized hashes cache test started";
+
+    // two chunks, the last one is partial
+    const uint32_t n = UCTX_CACHE_CHUNK + 1000;
+
+    std::vector<uctx_t> ref(n);
+    std::vector<uctx_t> res(n);
+    char name[MAX_URL_SIZE];
+    uint8_t pk[PK_SIZE_8];
+
+    for (uint32_t j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < 8; ++i) { ref[j].h[i] = (uint64_t)j * 8 + i; }
+
+        ref[j].t[0] = j;
+        ref[j].t[1] = 0;
+    }
+
+    // private directory: no cache of other runs or of a miner is found
+    char dir[] = "uctxtestXXXXXX";
+
+#ifdef _WIN32
+    int test = !_mktemp_s(dir, sizeof(dir)) && !_mkdir(dir);
+#else
+    int test = mkdtemp(dir) != NULL;
+#endif
+
+    UctxCacheName(dir, info->pk, name);
+    memcpy(pk, info->pk, PK_SIZE_8);
+    ++pk[1];
+
+    test = test
+        && UctxCacheLoad(name, info->pk, n, CopyChunk, &res) == EXIT_FAILURE
+        && UctxCacheStore(name, info->pk, n, FillChunk, &ref) == EXIT_SUCCESS
+        && UctxCacheLoad(name, info->pk, n, CopyChunk, &res) == EXIT_SUCCESS
+        && !memcmp(&ref[0], &res[0], n * sizeof(uctx_t))
+        // stale for other public key or number of contexts
+        && UctxCacheLoad(name, pk, n, CopyChunk, &res) == EXIT_FAILURE
+        && UctxCacheLoad(name, info->pk, n - 1, CopyChunk, &res)
+        == EXIT_FAILURE;
+
+    // corrupt a context of the last chunk
+    FILE * file = fopen(name, "r+b");
+
+    test = test && file && !fseek(file, -100, SEEK_END)
+        && fputc(0xFF, file) != EOF;
+
+    if (file) { fclose(file); }
+
+    test = test
+        && UctxCacheLoad(name, info->pk, n, CopyChunk, &res) == EXIT_FAILURE;
+
+    remove(name);
+    rmdir(dir);
+
+    if (!test)
+    {
+        LOG(ERROR) << "Unfinalized hashes cache test failed";
+        exit(EXIT_FAILURE);
+    }
+
+    LOG(INFO) << "Unfinalized hashes cache test passed\n";
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Main
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char ** argv)
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    el::Loggers::reconfigureAllLoggers(
+        el::ConfigurationType::Format, "%datetime %level [%thread] %msg"
+    );
+
+    el::Helpers::setThreadName("test thread");
+
+    LOG(INFO) << "Checking crypto: ";
+
+    TestNewCrypto();
+
+    LOG(INFO) << "Testing requests:";
+
+    TestRequests();
+
+    //========================================================================//
+    //  Set test info
+    //========================================================================//
+    info_t info;
+    uint8_t x[NUM_SIZE_8];
+    uint8_t w[PK_SIZE_8];
+    char seed[256] = "Va'esse deireadh aep eigean, va'esse eigh faidh'ar";
+
+    // generate secret key from seed
+    GenerateSecKey(seed, 50, info.sk, info.skstr);
+    // generate public key from secret key
+    GeneratePublicKey(info.skstr, info.pkstr, info.pk);
+
+    const char ref_pkstr[PK_SIZE_4 + 1]
+        = "020C16DFC5E23C59357E89D44977038F0A7851CC9926B3AABB3FF9E7E6A57315AD";
+
+    int test = !strncmp(ref_pkstr, info.pkstr, PK_SIZE_4);
+
+    if (!test)
+    {
+        LOG(ERROR) << "OpenSSL: generated wrong public key";
+        return EXIT_FAILURE;
+    }
+
+    ((uint64_t *)info.bound)[0] = 0xFFFFFFFFFFFFFFFF;
+    ((uint64_t *)info.bound)[1] = 0xFFFFFFFFFFFFFFFF;
+    ((uint64_t *)info.bound)[2] = 0xFFFFFFFFFFFFFFFF;
+    ((uint64_t *)info.bound)[3] = 0x000002FFFFFFFFFF;
+
+    ((uint64_t *)info.mes)[0] = 1;
+    ((uint64_t *)info.mes)[1] = 0;
+    ((uint64_t *)info.mes)[2] = 0;
+    ((uint64_t *)info.mes)[3] = 0;
+
+    sprintf(seed, "%d", 0);
+
+    // generate secret key from seed
+    GenerateSecKey(seed, 1, x, info.skstr);
+    // generate public key from secret key
+    GeneratePublicKey(info.skstr, info.pkstr, w);
+
+    //========================================================================//
+    //  Run host reference tests
+    //========================================================================//
+    TestUint256();
+    TestCpuPrimitives();
+    TestHostArena();
+    TestTopology();
+    TestCpuBlake(&info);
+    TestCpuPrehash(&info, x, w);
+    TestCpuSolutions(&info, x, w);
+    TestCpuMining(&info, x, w);
+    TestBatchVerify(&info, x, w);
+    TestCandidateParse();
+    TestEpoch();
+    TestMinerLoop(&info, 0);
+    TestMinerLoop(&info, 1);
+    TestMinerRange(&info);
+    TestUctxCache(&info);
+    TestSubmitter(&info, w);
+    TestBlockSource();
+    TestStratum(&info);
+    TestTelemetry();
+    TestAutotune();
+
+#ifdef CPU_ONLY
+    LOG(INFO) << "Host only build, skip GPU tests";
+    LOG(INFO) << "Test suite executable is now terminated";
+
+    return EXIT_SUCCESS;
+#else
+
+    //========================================================================//
+    //  Check requirements
+    //========================================================================//
+    int deviceCount;
+
+    if (cudaGetDeviceCount(&deviceCount) != cudaSuccess)
+    {
+        LOG(ERROR) << "Error checking GPU";
+        exit(EXIT_FAILURE);
+    }
+
+    size_t freeMem;
+    size_t totalMem;
+
+    CUDA_CALL(cudaMemGetInfo(&freeMem, &totalMem));
+    
+    if (freeMem < MIN_FREE_MEMORY)
+    {
+        LOG(ERROR) << "Not enough GPU memory for mining,"
+            << " minimum 2.8 GiB needed";
+
+        exit(EXIT_FAILURE);
+    }
+
+    TestPrimitives();
 
     //========================================================================//
     //  Run solutions correctness tests
@@ -612,6 +3042,7 @@ int main(int argc, char ** argv)
     LOG(INFO) << "Test suite executable is now terminated";
 
     return EXIT_SUCCESS;
+#endif // CPU_ONLY
 }
 
 // test.cu
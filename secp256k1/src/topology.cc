@@ -0,0 +1,213 @@
+// topology.cc
+
+/*******************************************************************************
+
+    TOPOLOGY -- NUMA nodes of the host, thread pinning and memory placement
+
+*******************************************************************************/
+
+#include "../include/topology.h"
+#include "../include/definitions.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// memory policies of mbind, as in numaif.h
+#define MPOL_PREFERRED_NODE  1
+#define MPOL_INTERLEAVE_ALL  3
+// move pages already touched
+#define MPOL_MOVE_PAGES      (1 << 1)
+
+////////////////////////////////////////////////////////////////////////////////
+//  Nodes
+////////////////////////////////////////////////////////////////////////////////
+int ParseCpuList(
+    const char * in,
+    std::vector<uint32_t> * cpus
+)
+{
+    cpus->clear();
+
+    while (*in && !isspace((unsigned char)*in))
+    {
+        char * end;
+        unsigned long first = strtoul(in, &end, 10);
+        unsigned long last = first;
+
+        if (end == in) { return EXIT_FAILURE; }
+
+        if (*end == '-')
+        {
+            in = end + 1;
+            last = strtoul(in, &end, 10);
+
+            if (end == in || last < first) { return EXIT_FAILURE; }
+        }
+
+        for (unsigned long c = first; c <= last; ++c)
+        {
+            cpus->push_back((uint32_t)c);
+        }
+
+        in = (*end == ',')? end + 1: end;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// first line of a sysfs file, empty if there is none
+static std::string ReadLine(const char * name)
+{
+    std::ifstream file(name);
+    std::string line;
+
+    std::getline(file, line);
+
+    return line;
+}
+
+int NumaNodes(std::vector<numa_node_t> * nodes)
+{
+    std::vector<uint32_t> ids;
+    char name[64];
+
+    nodes->clear();
+
+    if (
+        ParseCpuList(
+            ReadLine("/sys/devices/system/node/online").c_str(), &ids
+        ) == EXIT_SUCCESS
+    )
+    {
+        for (uint32_t n = 0; n < ids.size(); ++n)
+        {
+            numa_node_t node;
+
+            node.id = ids[n];
+            sprintf(name, "/sys/devices/system/node/node%u/cpulist", ids[n]);
+
+            // nodes of memory only are of no use for workers
+            if (
+                ParseCpuList(ReadLine(name).c_str(), &node.cpus)
+                == EXIT_SUCCESS && !node.cpus.empty()
+            )
+            {
+                nodes->push_back(node);
+            }
+        }
+    }
+
+    // one node of all cores
+    if (nodes->empty())
+    {
+        numa_node_t node;
+        uint32_t cores = std::thread::hardware_concurrency();
+
+        node.id = 0;
+
+        for (uint32_t c = 0; c < ((cores)? cores: 1); ++c)
+        {
+            node.cpus.push_back(c);
+        }
+
+        nodes->push_back(node);
+    }
+
+    return nodes->size();
+}
+
+int PciNumaNode(
+    const int domain,
+    const int bus,
+    const int device
+)
+{
+    char name[96];
+
+    if (domain < 0 || bus < 0 || device < 0) { return -1; }
+
+    sprintf(
+        name, "/sys/bus/pci/devices/%04x:%02x:%02x.0/numa_node",
+        domain, bus, device
+    );
+
+    std::string line = ReadLine(name);
+
+    // -1 is also written by the kernel for no affinity
+    return (line.empty())? -1: atoi(line.c_str());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Placement
+////////////////////////////////////////////////////////////////////////////////
+int PinThread(const std::vector<uint32_t> & cpus)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+
+    for (uint32_t c = 0; c < cpus.size(); ++c)
+    {
+        if (cpus[c] < CPU_SETSIZE) { CPU_SET(cpus[c], &set); }
+    }
+
+    return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))?
+        EXIT_FAILURE: EXIT_SUCCESS;
+#else
+    return EXIT_FAILURE;
+#endif
+}
+
+int BindMemory(
+    void * ptr,
+    const size_t size,
+    const int node
+)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = {0};
+    const int bits = 8 * sizeof(unsigned long);
+    std::vector<numa_node_t> nodes;
+
+    if (node >= MAX_NUMA_NODES) { return EXIT_FAILURE; }
+
+    if (node >= 0) { mask[node / bits] |= 1ul << (node % bits); }
+    else
+    {
+        NumaNodes(&nodes);
+
+        for (uint32_t n = 0; n < nodes.size(); ++n)
+        {
+            if (nodes[n].id < MAX_NUMA_NODES)
+            {
+                mask[nodes[n].id / bits] |= 1ul << (nodes[n].id % bits);
+            }
+        }
+    }
+
+    return (
+        syscall(
+            SYS_mbind, ptr, size,
+            (node >= 0)? MPOL_PREFERRED_NODE: MPOL_INTERLEAVE_ALL, mask,
+            MAX_NUMA_NODES + 1, MPOL_MOVE_PAGES
+        )
+    )? EXIT_FAILURE: EXIT_SUCCESS;
+#else
+    return EXIT_FAILURE;
+#endif
+}
+
+// topology.cc
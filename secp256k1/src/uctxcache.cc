@@ -0,0 +1,388 @@
+// uctxcache.cc
+
+/*******************************************************************************
+
+    UCTXCACHE -- On-disk cache of unfinalized hash contexts
+
+*******************************************************************************/
+
+#include "../include/uctxcache.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include "../include/multiblake.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char magic[8] = { 'A', 'U', 'T', 'O', 'U', 'C', 'T', 'X' };
+
+////////////////////////////////////////////////////////////////////////////////
+//  Fletcher-64 checksum of 32 bits words
+////////////////////////////////////////////////////////////////////////////////
+static uint64_t Checksum(const uctx_t * chunk, const uint32_t cnt)
+{
+    const uint32_t * words = (const uint32_t *)chunk;
+    const size_t len = (size_t)cnt * (sizeof(uctx_t) >> 2);
+
+    uint64_t a = 0;
+    uint64_t b = 0;
+
+    // sums stay below 2^64 for 2^15 words between reductions
+    for (size_t i = 0; i < len; )
+    {
+        size_t end = (len - i > 0x8000)? i + 0x8000: len;
+
+        for ( ; i < end; ++i)
+        {
+            a += words[i];
+            b += a;
+        }
+
+        a %= 0xFFFFFFFF;
+        b %= 0xFFFFFFFF;
+    }
+
+    return (b << 32) | a;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Header of the cache for public key and number of contexts
+////////////////////////////////////////////////////////////////////////////////
+static void PkHash(const uint8_t * pk, uint8_t * hash)
+{
+    b2b_lanes_t s;
+
+    CpuBlakeInit(&s);
+    CpuBlakeLoad(&s, 0, pk, PK_SIZE_8);
+    CpuBlakeCompress(&s, PK_SIZE_8, 1);
+    CpuBlakeDump(&s, 0, hash);
+
+    return;
+}
+
+static void SetHeader(
+    const uint8_t * pk,
+    const uint32_t n,
+    uctx_cache_header_t * header
+)
+{
+    memset(header, 0, sizeof(uctx_cache_header_t));
+    memcpy(header->magic, magic, sizeof(magic));
+
+    header->version = UCTX_CACHE_VERSION;
+    header->size = sizeof(uctx_t);
+    header->n = n;
+    header->chunk = UCTX_CACHE_CHUNK;
+    header->chunks = (n + UCTX_CACHE_CHUNK - 1) / UCTX_CACHE_CHUNK;
+
+    PkHash(pk, header->pkhash);
+
+    return;
+}
+
+// number of contexts in the chunk
+static uint32_t ChunkLen(const uint32_t n, const uint32_t c)
+{
+    uint32_t first = c * UCTX_CACHE_CHUNK;
+
+    return (n - first < UCTX_CACHE_CHUNK)? n - first: UCTX_CACHE_CHUNK;
+}
+
+// offset of contexts in the file
+static size_t DataOffset(const uint32_t chunks)
+{
+    size_t off = sizeof(uctx_cache_header_t) + chunks * sizeof(uint64_t);
+
+    return (off + UCTX_CACHE_ALIGN - 1) / UCTX_CACHE_ALIGN * UCTX_CACHE_ALIGN;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Cache file name
+////////////////////////////////////////////////////////////////////////////////
+void UctxCacheName(
+    // cache directory
+    const char * dir,
+    // public key
+    const uint8_t * pk,
+    // file name, MAX_URL_SIZE chars
+    char * name
+)
+{
+    uint8_t hash[NUM_SIZE_8];
+
+    PkHash(pk, hash);
+
+    snprintf(
+        name, MAX_URL_SIZE, "%s/uctx-%02x%02x%02x%02x%02x%02x%02x%02x.bin",
+        dir, hash[0], hash[1], hash[2], hash[3], hash[4], hash[5], hash[6],
+        hash[7]
+    );
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Load cache file
+////////////////////////////////////////////////////////////////////////////////
+// checks header against the running miner
+static int CheckHeader(
+    const uctx_cache_header_t * header,
+    const uint8_t * pk,
+    const uint32_t n
+)
+{
+    uctx_cache_header_t ref;
+
+    SetHeader(pk, n, &ref);
+
+    if (memcmp(header, &ref, sizeof(uctx_cache_header_t)))
+    {
+        LOG(INFO) << "Unfinalized hashes cache is stale, rebuilding";
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int UctxCacheLoad(
+    // file name
+    const char * name,
+    // public key
+    const uint8_t * pk,
+    // number of contexts
+    const uint32_t n,
+    // consumer of verified chunks
+    uctx_chunk_t sink,
+    // consumer argument
+    void * arg
+)
+{
+    const uint32_t chunks = (n + UCTX_CACHE_CHUNK - 1) / UCTX_CACHE_CHUNK;
+    const size_t off = DataOffset(chunks);
+    const size_t size = off + (size_t)n * sizeof(uctx_t);
+
+    int status = EXIT_SUCCESS;
+
+#ifndef _WIN32
+    int fd = open(name, O_RDONLY);
+
+    if (fd < 0) { return EXIT_FAILURE; }
+
+    struct stat st;
+
+    if (fstat(fd, &st) || (size_t)st.st_size != size)
+    {
+        LOG(INFO) << "Unfinalized hashes cache " << name << " has wrong size";
+        close(fd);
+
+        return EXIT_FAILURE;
+    }
+
+    // private mapping: consumers may not write through to the file
+    uint8_t * map = (uint8_t *)mmap(
+        NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0
+    );
+
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        LOG(ERROR) << "Failed to map unfinalized hashes cache " << name;
+
+        return EXIT_FAILURE;
+    }
+
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const uint64_t * checks
+        = (const uint64_t *)(map + sizeof(uctx_cache_header_t));
+    uctx_t * uctxs = (uctx_t *)(map + off);
+
+    status = CheckHeader((const uctx_cache_header_t *)map, pk, n);
+
+    for (uint32_t c = 0; status == EXIT_SUCCESS && c < chunks; ++c)
+    {
+        uint32_t first = c * UCTX_CACHE_CHUNK;
+        uint32_t cnt = ChunkLen(n, c);
+
+        if (Checksum(uctxs + first, cnt) != checks[c])
+        {
+            LOG(ERROR) << "Unfinalized hashes cache " << name
+                << " is corrupted at chunk " << c;
+
+            status = EXIT_FAILURE;
+        }
+        else
+        {
+            status = sink(arg, first, cnt, uctxs + first);
+        }
+    }
+
+    munmap(map, size);
+#else
+    FILE * in = fopen(name, "rb");
+
+    if (!in) { return EXIT_FAILURE; }
+
+    uctx_cache_header_t header;
+    std::vector<uint64_t> checks(chunks);
+    std::vector<uctx_t> buf(UCTX_CACHE_CHUNK);
+
+    if (
+        fread(&header, sizeof(header), 1, in) != 1
+        || (chunks && fread(&checks[0], sizeof(uint64_t), chunks, in) != chunks)
+        || fseek(in, (long)off, SEEK_SET)
+    )
+    {
+        fclose(in);
+
+        return EXIT_FAILURE;
+    }
+
+    status = CheckHeader(&header, pk, n);
+
+    for (uint32_t c = 0; status == EXIT_SUCCESS && c < chunks; ++c)
+    {
+        uint32_t first = c * UCTX_CACHE_CHUNK;
+        uint32_t cnt = ChunkLen(n, c);
+
+        if (
+            fread(&buf[0], sizeof(uctx_t), cnt, in) != cnt
+            || Checksum(&buf[0], cnt) != checks[c]
+        )
+        {
+            LOG(ERROR) << "Unfinalized hashes cache " << name
+                << " is corrupted at chunk " << c;
+
+            status = EXIT_FAILURE;
+        }
+        else
+        {
+            status = sink(arg, first, cnt, &buf[0]);
+        }
+    }
+
+    fclose(in);
+#endif
+
+    if (status == EXIT_SUCCESS)
+    {
+        LOG(INFO) << "Loaded unfinalized hashes cache " << name;
+    }
+
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Store cache file
+////////////////////////////////////////////////////////////////////////////////
+int UctxCacheStore(
+    // file name
+    const char * name,
+    // public key
+    const uint8_t * pk,
+    // number of contexts
+    const uint32_t n,
+    // producer of chunks
+    uctx_chunk_t source,
+    // producer argument
+    void * arg
+)
+{
+    uctx_cache_header_t header;
+
+    SetHeader(pk, n, &header);
+
+    const uint32_t chunks = header.chunks;
+    const size_t off = DataOffset(chunks);
+
+    // unique temporary file for concurrent writers of the same cache
+    char tmp[MAX_URL_SIZE + 64];
+
+    snprintf(
+        tmp, sizeof(tmp), "%s.%d.%zx.tmp", name, (int)getpid(),
+        std::hash<std::thread::id>()(std::this_thread::get_id())
+    );
+
+    FILE * out = fopen(tmp, "wb");
+
+    if (!out)
+    {
+        LOG(ERROR) << "Failed to create unfinalized hashes cache " << tmp;
+
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint64_t> checks(chunks + 1, 0);
+    std::vector<uctx_t> buf(UCTX_CACHE_CHUNK);
+    int status = EXIT_SUCCESS;
+
+    // contexts first, header and checksums are written at the end
+    if (fseek(out, (long)off, SEEK_SET)) { status = EXIT_FAILURE; }
+
+    for (uint32_t c = 0; status == EXIT_SUCCESS && c < chunks; ++c)
+    {
+        uint32_t first = c * UCTX_CACHE_CHUNK;
+        uint32_t cnt = ChunkLen(n, c);
+
+        status = source(arg, first, cnt, &buf[0]);
+
+        if (status != EXIT_SUCCESS) { break; }
+
+        checks[c] = Checksum(&buf[0], cnt);
+
+        if (fwrite(&buf[0], sizeof(uctx_t), cnt, out) != cnt)
+        {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    if (
+        status != EXIT_SUCCESS
+        || fseek(out, 0, SEEK_SET)
+        || fwrite(&header, sizeof(header), 1, out) != 1
+        || fwrite(&checks[0], sizeof(uint64_t), chunks, out) != chunks
+    )
+    {
+        status = EXIT_FAILURE;
+    }
+
+    if (fclose(out)) { status = EXIT_FAILURE; }
+
+    if (status == EXIT_SUCCESS)
+    {
+#ifdef _WIN32
+        remove(name);
+#endif
+        if (rename(tmp, name)) { status = EXIT_FAILURE; }
+    }
+
+    if (status != EXIT_SUCCESS)
+    {
+        LOG(ERROR) << "Failed to store unfinalized hashes cache " << name;
+        remove(tmp);
+
+        return EXIT_FAILURE;
+    }
+
+    LOG(INFO) << "Stored unfinalized hashes cache " << name;
+
+    return EXIT_SUCCESS;
+}
+
+// uctxcache.cc
@@ -0,0 +1,96 @@
+// verifier.cc
+
+/*******************************************************************************
+
+    VERIFIER -- Host verification of solutions found by a mining device
+
+*******************************************************************************/
+
+#include "../include/verifier.h"
+#include "../include/cpumining.h"
+#include "../include/definitions.h"
+#include <string.h>
+
+SolutionVerifier::SolutionVerifier(void):
+    faults(0), iterations(0), derate(0)
+{
+    memset(data, 0, sizeof(data));
+    memset(bound, 0, sizeof(bound));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Block data of the device
+////////////////////////////////////////////////////////////////////////////////
+void SolutionVerifier::SetKeys(const uint8_t * pk, const uint8_t * sk)
+{
+    memcpy(data, pk, PK_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, sk, NUM_SIZE_8);
+
+    return;
+}
+
+void SolutionVerifier::SetBlock(
+    const uint8_t * mes,
+    const uint8_t * x,
+    const uint8_t * w
+)
+{
+    memcpy((uint8_t *)data + PK_SIZE_8, mes, NUM_SIZE_8);
+    memcpy((uint8_t *)data + PK_SIZE_8 + NUM_SIZE_8, w, PK_SIZE_8);
+    memcpy(data + COUPLED_PK_SIZE_32 + NUM_SIZE_32, x, NUM_SIZE_8);
+
+    return;
+}
+
+void SolutionVerifier::SetBound(const uint8_t * bnd)
+{
+    memcpy(bound, bnd, NUM_SIZE_8);
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Recomputation of d from the K_LEN elements of the nonce
+////////////////////////////////////////////////////////////////////////////////
+int SolutionVerifier::Verify(const result_t & result)
+{
+    uint8_t hash[NUM_SIZE_8];
+    uint32_t ind[K_LEN];
+    uint32_t elems[K_LEN * NUM_SIZE_32];
+    uint32_t d[NUM_SIZE_32];
+
+    CpuBlakeHash((const uint8_t *)data + PK_SIZE_8, result.nonce, hash);
+    CpuGenIndices(hash, ind);
+
+    for (int k = 0; k < K_LEN; ++k)
+    {
+        CpuHashElement(data, NULL, ind[k], elems + k * NUM_SIZE_32);
+    }
+
+    int valid = CpuSumModQ(
+        bound, data + COUPLED_PK_SIZE_32 + 2 * NUM_SIZE_32, elems, d
+    ) && !memcmp(d, result.d, NUM_SIZE_8);
+
+    if (!valid && ++faults >= VERIFY_FAULT_LIMIT)
+    {
+        if (derate < VERIFY_MAX_DERATE) { ++derate; }
+
+        faults = 0;
+        iterations = 0;
+    }
+
+    return valid;
+}
+
+void SolutionVerifier::Iteration(void)
+{
+    if (++iterations >= VERIFY_FAULT_WINDOW)
+    {
+        faults = 0;
+        iterations = 0;
+    }
+
+    return;
+}
+
+// verifier.cc
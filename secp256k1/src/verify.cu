@@ -0,0 +1,191 @@
+// verify.cu
+
+/*******************************************************************************
+
+    VERIFY -- Pool-side verification of submitted solutions
+
+********************************************************************************
+
+    Host only, no CUDA device is needed. Submissions are read as JSON
+    lines from a file or stdin and verified in batches of VERIFY_BATCH
+    with all threads. One result per input line is printed to stdout:
+
+        {"line": 1, "valid": true}
+        {"line": 2, "valid": false}
+        {"line": 3, "valid": false, "error": "malformed"}
+
+    Empty lines are skipped. Throughput of verification is printed to
+    stderr at the end:
+
+        {"verified": 4096, "valid": 4095, "threads": 8, "seconds": 0.512,
+         "perSecond": 8000.0, "perSecondPerCore": 1000.0}
+
+    Usage: verify.out [-t THREADS] [FILE]
+
+    -t      number of worker threads (default all hardware threads)
+
+    Exit status is EXIT_SUCCESS if all submissions are valid.
+
+*******************************************************************************/
+
+#include "../include/batchverify.h"
+#include "../include/cpumining.h"
+#include "../include/definitions.h"
+#include "../include/easylogging++.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace std::chrono;
+
+////////////////////////////////////////////////////////////////////////////////
+//  Main
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char ** argv)
+{
+    START_EASYLOGGINGPP(argc, argv);
+
+    // stdout is for results only
+    el::Loggers::reconfigureAllLoggers(
+        el::ConfigurationType::ToStandardOutput, "false"
+    );
+    el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToFile, "false");
+
+    uint32_t threads = 0;
+    const char * fileName = NULL;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        if (!strcmp(argv[a], "-t") && a + 1 < argc)
+        {
+            threads = strtoul(argv[++a], NULL, 10);
+        }
+        else if (argv[a][0] != '-' && !fileName) { fileName = argv[a]; }
+        else
+        {
+            fprintf(stderr, "Usage: %s [-t THREADS] [FILE]\n", argv[0]);
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    FILE * in = (fileName)? fopen(fileName, "r"): stdin;
+
+    if (!in)
+    {
+        fprintf(stderr, "Failed to open %s\n", fileName);
+
+        return EXIT_FAILURE;
+    }
+
+    //========================================================================//
+    //  Batches of submissions
+    //========================================================================//
+    std::vector<submission_t> subs(VERIFY_BATCH);
+    std::vector<uint8_t> valid(VERIFY_BATCH);
+    // input lines of parsed submissions and of malformed lines
+    std::vector<uint64_t> lines(VERIFY_BATCH);
+    std::vector<uint64_t> malformed;
+
+    std::string line;
+    uint64_t lineNum = 0;
+    uint64_t verified = 0;
+    uint64_t validCount = 0;
+    uint64_t malformedCount = 0;
+    int64_t ns = 0;
+    int eof = 0;
+
+    while (!eof)
+    {
+        uint32_t count = 0;
+
+        malformed.clear();
+
+        while (count < VERIFY_BATCH)
+        {
+            int c;
+
+            line.clear();
+
+            while ((c = fgetc(in)) != EOF && c != '\n') { line += (char)c; }
+
+            if (c == EOF && line.empty()) { eof = 1; break; }
+
+            ++lineNum;
+
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+            {
+                continue;
+            }
+
+            if (
+                ParseSubmission(line.c_str(), line.size(), &subs[count])
+                == EXIT_SUCCESS
+            )
+            {
+                lines[count++] = lineNum;
+            }
+            else { malformed.push_back(lineNum); }
+        }
+
+        steady_clock::time_point start = steady_clock::now();
+
+        if (count) { VerifyBatch(subs.data(), count, valid.data(), threads); }
+
+        ns += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        verified += count;
+        malformedCount += malformed.size();
+
+        // results in input order
+        uint32_t m = 0;
+
+        for (uint32_t i = 0; i <= count; ++i)
+        {
+            const uint64_t next = (i < count)? lines[i]: UINT64_MAX;
+
+            for (; m < malformed.size() && malformed[m] < next; ++m)
+            {
+                printf(
+                    "{\"line\": %llu, \"valid\": false, \"error\": "
+                    "\"malformed\"}\n", (unsigned long long)malformed[m]
+                );
+            }
+
+            if (i == count) { break; }
+
+            validCount += valid[i];
+
+            printf(
+                "{\"line\": %llu, \"valid\": %s}\n", (unsigned long long)next,
+                (valid[i])? "true": "false"
+            );
+        }
+    }
+
+    if (fileName) { fclose(in); }
+
+    //========================================================================//
+    //  Throughput
+    //========================================================================//
+    const uint32_t cores = CpuThreads(threads);
+    const double rate = (ns)? verified * 1e9 / ns: 0.0;
+
+    fprintf(
+        stderr,
+        "{\"verified\": %llu, \"valid\": %llu, \"threads\": %u, "
+        "\"seconds\": %.3f, \"perSecond\": %.1f, \"perSecondPerCore\": %.1f}\n",
+        (unsigned long long)verified, (unsigned long long)validCount, cores,
+        ns * 1e-9, rate, rate / cores
+    );
+
+    return (validCount == verified && !malformedCount)?
+        EXIT_SUCCESS: EXIT_FAILURE;
+}
+
+// verify.cu
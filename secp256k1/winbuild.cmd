@@ -11,8 +11,9 @@ nvcc -o ../miner.exe -Xcompiler "/std:c++14" -gencode arch=compute_%CUDA_COMPUTE
  -l %LIBCURL_DIR%\builds\libcurl-vc-x64-release-dll-ipv6-sspi-winssl-obj-lib/libcurl ^
  -l %OPENSSL_DIR%\lib\libeay32 -L %OPENSSL_DIR%/lib ^
  -lnvml ^
-conversion.cc cryptography.cc definitions.cc jsmn.c httpapi.cc ^
-mining.cu prehash.cu processing.cc request.cc easylogging++.cc bip39/bip39.cc bip39/util.cc autolykos.cu
+autotune.cc backend.cc conversion.cc cpubackend.cc cpumining.cc cpuprimitives.cc cryptography.cc hostarena.cc topology.cc cudabackend.cu ^
+definitions.cc jsmn.c httpapi.cc miner.cc ^
+compaction.cu mining.cu multiblake.cc prehash.cu processing.cc reduction.cu blocksource.cc request.cc metrics.cc stratum.cc submitter.cc telemetry.cc uctxcache.cc verifier.cc easylogging++.cc bip39/bip39.cc bip39/util.cc autolykos.cu
 
 nvcc -o ../test.exe -Xcompiler "/std:c++14" -gencode arch=compute_%CUDA_COMPUTE_ARCH%,code=sm_%CUDA_COMPUTE_ARCH%^
  -gencode arch=compute_30,code=compute_30 -DBLOCK_DIM=%BLOCK_DIM% -DNONCES_PER_ITER=%WORKSPACE%^
@@ -20,7 +21,7 @@ nvcc -o ../test.exe -Xcompiler "/std:c++14" -gencode arch=compute_%CUDA_COMPUTE_
  -I %LIBCURL_DIR%\include ^
  -l %LIBCURL_DIR%\builds\libcurl-vc-x64-release-dll-ipv6-sspi-winssl-obj-lib/libcurl ^
  -l %OPENSSL_DIR%\lib\libeay32 -L %OPENSSL_DIR%/lib ^
-test.cu conversion.cc cryptography.cc definitions.cc jsmn.c ^
-mining.cu prehash.cu processing.cc request.cc easylogging++.cc
+test.cu autotune.cc conversion.cc cpumining.cc cpuprimitives.cc cryptography.cc hostarena.cc topology.cc definitions.cc jsmn.c miner.cc ^
+compaction.cu mining.cu multiblake.cc prehash.cu processing.cc reduction.cu blocksource.cc request.cc metrics.cc stratum.cc submitter.cc telemetry.cc uctxcache.cc verifier.cc batchverify.cc easylogging++.cc
 cd ..
 SET PATH=%PATH%;C:\Program Files\NVIDIA Corporation\NVSMI
\ No newline at end of file